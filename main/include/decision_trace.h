@@ -0,0 +1,95 @@
+#ifndef DECISION_TRACE_H
+#define DECISION_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "../include/types.h"
+
+
+#define DECISION_TRACE
+#define DECISION_TRACE_CAPACITY     128         // records kept, power of two
+#define DECISION_TRACE_TOP_N        3           // challengers recorded per decision
+
+#define DECISION_TRACE_FRAME_MAGIC  0x43525444u // "DTRC" little-endian
+
+
+typedef enum {
+    DECISION_KEEP = 0,              // active task still valid
+    DECISION_INIT_SELECT,           // no active task, best task selected
+    DECISION_STALE_REPLACE,         // active handle went stale, best task selected
+    DECISION_INELIGIBLE_REPLACE,    // active task completed/suppressed/killed, best task selected
+    DECISION_CLEAR,                 // nothing schedulable, active cleared
+    DECISION_FORCED,                // operator confirmed a switch prompt
+} decision_reason;
+
+#define DECISION_FLAG_DWELL_SATISFIED   0x01
+#define DECISION_FLAG_HAS_ACTIVE        0x04    // an active task exists after the decision
+
+
+/* Scores are Q8.8. raw = base + urgency + age; ranking adds zone. */
+typedef struct __attribute__((packed)) {
+    uint16_t index;
+    uint8_t table;
+    uint8_t kind;
+    int16_t base_q8;                // base priority term less the ignore penalty
+    int16_t urgency_q8;
+    int16_t age_q8;
+    int16_t zone_q8;                // zone-batch adjustment relative to the active task
+} decision_challenger;
+
+typedef struct __attribute__((packed)) {
+    uint32_t seq;                   // consecutive across the ring; gaps mean dropped records
+    uint32_t time_ms;
+    uint16_t active_index;          // active task after the decision, UINT16_MAX if none
+    uint16_t active_generation;
+    int16_t active_score_q8;        // raw score of that task
+    uint8_t reason;                 // decision_reason
+    uint8_t flags;                  // DECISION_FLAG_*
+    uint8_t pending_count;          // saturates at 255
+    uint8_t critical_count;         // saturates at 255
+    uint8_t challenger_count;
+    uint8_t reserved;
+    decision_challenger challengers[DECISION_TRACE_TOP_N];     // best first, by ranking score
+} decision_record;
+
+/* Socket dump framing: header followed by `count` records. */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t record_size;
+    uint16_t count;
+} decision_trace_frame_header;
+
+
+/**
+ * Append a decision record, overwriting the oldest once the ring is full.
+ *
+ * Single writer (the scheduler tick). Never blocks and takes no locks:
+ * a slot is stamped invalid, filled, then stamped with its sequence number
+ * so concurrent readers can detect and skip a slot being overwritten.
+ * The record's seq field is assigned here.
+ */
+void decision_trace_record(const decision_record *record);
+
+
+/**
+ * Copy up to `max` records starting at sequence *cursor into `out`.
+ *
+ * Records already overwritten are skipped, so the cursor jumps forward to
+ * the oldest record still held. On return *cursor is the sequence to pass
+ * next time. Safe to call from any task concurrently with the writer.
+ *
+ * @return number of records copied.
+ */
+size_t decision_trace_read(uint32_t *cursor, decision_record *out, size_t max);
+
+
+/**
+ * Log every held record as "DTR:<hex>" lines, for capture from the serial
+ * monitor and decoding with tools/decision_trace.py. Stops at the head seen
+ * on entry; slots torn or overwritten while dumping are skipped.
+ */
+void decision_trace_dump_serial(void);
+
+
+#endif
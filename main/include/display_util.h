@@ -49,6 +49,15 @@ typedef struct {
 } display_spi_ctx;
 
 
+/* Bus traffic since boot or display_reset_bus_stats(), to compare draw paths on the device. */
+typedef struct {
+    uint32_t transactions;          // SPI transactions, command and data
+    uint32_t windows;               // CASET/RASET/RAMWR address windows opened
+    uint32_t bus_acquires;
+    uint32_t bytes;                 // bytes clocked out, commands and arguments included
+} display_bus_stats;
+
+
 /*
  The LCD needs a bunch of command/argument values to be initialized. They are stored in this struct.
 */
@@ -122,8 +131,39 @@ void display_fill(spi_device_handle_t dev_handle, uint16_t colour);
 void display_write(spi_device_handle_t dev_handle, uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *pixels);
 
 
+/**
+ * Draw a string in the 5x7 font, background included.
+ *
+ * The whole string is rasterised and written through one address window
+ * under a single bus acquire, so a label costs a handful of SPI
+ * transactions whatever its length. Every pixel of the box is written:
+ * the text's own colour where the glyphs are lit, `bg` everywhere else,
+ * including the gaps between characters. The box is
+ * strlen(text) * CHAR_WIDTH * scale - scale wide (no gap after the last
+ * character) and CHAR_HEIGHT * scale high, clipped to the screen.
+ *
+ * Timing / blocking behaviour:
+ *  - Blocks while acquiring the SPI bus and transmitting pixel data.
+ *  - Performs no RTOS delays.
+ *
+ * UI task only: the pixels are staged in the buffer display_fill() uses.
+ *
+ * @param display SPI device handle for the display.
+ * @param x X coordinate of the top-left corner (screen space).
+ * @param y Y coordinate of the top-left corner (screen space).
+ * @param text NUL-terminated string; characters without a glyph are blank.
+ * @param color RGB565 text colour.
+ * @param bg RGB565 colour of what the text is drawn on.
+ * @param scale Pixels per font pixel, 1 or more.
+ */
 void draw_text(spi_device_handle_t display, uint16_t x, uint16_t y, const char *text,
-               uint16_t color, uint8_t scale);
+               uint16_t color, uint16_t bg, uint8_t scale);
+
+
+// SPI counters for every display call so far. UI task only, like the drawing itself.
+const display_bus_stats *display_get_bus_stats(void);
+
+void display_reset_bus_stats(void);
 
 
 /**
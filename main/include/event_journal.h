@@ -0,0 +1,156 @@
+#ifndef EVENT_JOURNAL_H
+#define EVENT_JOURNAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../include/types.h"
+
+
+#define EVENT_JOURNAL_PARTITION         "journal"   // data partition, see partitions.csv
+#define EVENT_JOURNAL_SUBTYPE           0x40        // custom data subtype of that partition
+#define EVENT_JOURNAL_RING_CAPACITY     256         // events staged in RAM, power of two
+#define EVENT_JOURNAL_SECTOR_SIZE       4096        // flash erase unit
+#define EVENT_JOURNAL_BLOCK_MAX         496         // encoded bytes per flash block, header excluded
+#define EVENT_JOURNAL_FLUSH_EVENTS      96          // staged events that trigger a block write
+#define EVENT_JOURNAL_FLUSH_MS          30000       // oldest staged event waits at most this long
+#define EVENT_JOURNAL_POLL_MS           1000        // writer task wake-up period
+#define EVENT_JOURNAL_NO_TABLE          0xFF        // table field of events not about a table
+
+#define EVENT_JOURNAL_SECTOR_MAGIC      0x324A4545u // "EEJ2" little-endian
+#define EVENT_JOURNAL_FRAME_MAGIC       0x4C4E4A45u // "EJNL" little-endian
+
+
+typedef enum {
+    JOURNAL_BOOT = 0,               // arg: 1 if warm_restart_resume() restored the state
+    JOURNAL_TRANSITION,             // arg: table_state entered
+    JOURNAL_ADMIT,                  // arg: task_kind admitted
+    JOURNAL_IGNORE,                 // arg: task_kind ignored
+    JOURNAL_COMPLETE,               // arg: task_kind completed
+    JOURNAL_FORCE_SWITCH,           // arg: task_kind the operator switched to
+    JOURNAL_EVENT_COUNT,
+} journal_event_type;
+
+#define EVENT_JOURNAL_TYPE_BITS         3
+
+_Static_assert(JOURNAL_EVENT_COUNT <= (1 << EVENT_JOURNAL_TYPE_BITS), "event type shares a varint with the time delta");
+
+
+/* On flash every event is a varint head, (time delta from the previous
+   event in its block << EVENT_JOURNAL_TYPE_BITS) | type, then the table
+   byte, then the arg byte: three bytes for an event within 16 ms of the
+   one before, four within 2 s. Blocks are self-contained and CRC-checked. */
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;                 // EVENT_JOURNAL_SECTOR_MAGIC
+    uint32_t seq;                   // one more than the sector written before it
+    uint32_t seq_check;             // ~seq, so a torn header is never taken for valid
+    uint32_t reserved;
+} event_journal_sector_header;
+
+typedef struct __attribute__((packed)) {
+    uint16_t length;                // encoded bytes after this header, 0xFFFF where nothing is written
+    uint16_t count;                 // events in the block
+    uint32_t base_time;             // time of the first event, the first delta is from here
+    uint32_t crc;                   // esp_rom_crc32_le over the encoded bytes
+} event_journal_block_header;
+
+
+/* Export framing, one frame per flash block and an empty frame to end:
+   the block's events transposed into columns of `count` entries each,
+   varint heads then table bytes then arg bytes, `length` bytes in all.
+   Like fields sit together, which suits the per-table decoder and any
+   compressor downstream. */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;                 // EVENT_JOURNAL_FRAME_MAGIC
+    uint16_t count;
+    uint16_t length;
+    uint32_t base_time;
+    uint32_t sector_seq;            // flash sector the block came from, orders blocks across boots
+} event_journal_frame_header;
+
+
+typedef struct {
+    uint32_t recorded;              // events accepted into the RAM ring since boot
+    uint32_t dropped;               // events lost to a full ring
+    uint32_t written;               // events written to flash
+    uint32_t blocks;                // blocks written
+    uint32_t erases;                // sectors erased
+    uint32_t sector_seq;            // sequence of the sector being written
+} event_journal_stats;
+
+
+/* Position of an export in the journal, see event_journal_export(). */
+typedef struct {
+    uint32_t sector_seq;            // 0 before the first call
+    uint32_t offset;
+} event_journal_cursor;
+
+
+/**
+ * Stage an event for the journal.
+ *
+ * Never blocks and takes no locks: the event goes into a RAM ring that the
+ * writer drains to flash in batches. Single producer: the task that owns
+ * the trace system. When the ring is full the event is counted as dropped.
+ */
+void event_journal_record(journal_event_type type, uint8_t table, uint8_t arg, time_ms now);
+
+
+/**
+ * Find the journal partition and the end of what was written before reset.
+ *
+ * Reads every sector header, then the blocks of the newest sector. Writing
+ * resumes after the last intact block, or in a fresh sector if that one
+ * ends in a torn write. A partition with no valid sector starts over.
+ *
+ * @return false if there is no journal partition; events are then staged
+ *         and dropped, never written.
+ */
+bool event_journal_mount(void);
+
+
+/**
+ * Write staged events to flash, as the writer task does.
+ *
+ * Writes a block once EVENT_JOURNAL_FLUSH_EVENTS are staged or the oldest
+ * one is EVENT_JOURNAL_FLUSH_MS old, or all of them with `force`. Erases
+ * the next sector, round robin over the partition, when a block does not
+ * fit. Writer only; blocks on flash.
+ *
+ * @return Events written.
+ */
+uint32_t event_journal_flush(time_ms now, bool force);
+
+
+/**
+ * Mount the journal, record a JOURNAL_BOOT event and start the writer task
+ * at low priority, so flash writes and erases never run on the UI or tick
+ * tasks. Call once at startup, after warm_restart_resume().
+ *
+ * @param resumed Whether the state was restored, recorded as the boot arg.
+ */
+void event_journal_start(bool resumed);
+
+
+/**
+ * Encode the next flash block at or after *cursor as one export frame.
+ *
+ * Walks sectors oldest first. Blocks whose CRC fails, and sectors erased
+ * under the cursor, are skipped. Safe to call from any task while the
+ * writer runs.
+ *
+ * @param cursor Zeroed to start from the oldest block, advanced past the
+ *               block exported.
+ * @param out    At least sizeof(event_journal_frame_header) +
+ *               EVENT_JOURNAL_BLOCK_MAX bytes.
+ * @return Bytes of the frame in `out`, 0 once the journal is exhausted.
+ */
+size_t event_journal_export(event_journal_cursor *cursor, uint8_t *out, size_t out_size);
+
+
+const event_journal_stats *event_journal_get_stats(void);
+
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef FLOOR_LAYOUT_H
+#define FLOOR_LAYOUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+
+/* Tables a compiled layout can hold. Must cover MAX_TABLES, which
+   trace_system.c checks; host builds that raise MAX_TABLES past it raise
+   this too. */
+#ifndef FLOOR_MAX_TABLES
+#define FLOOR_MAX_TABLES            32
+#endif
+_Static_assert(FLOOR_MAX_TABLES <= UINT8_MAX, "layout blobs count tables in a uint8_t");
+
+#define FLOOR_ZONE_NONE             UINT8_MAX       // table belongs to no zone
+#define FLOOR_DISTANCE_UNKNOWN      UINT16_MAX      // blob entry: derive from coordinates
+
+#define FLOOR_LAYOUT_MAGIC          0x59414C46u     // "FLAY" little-endian
+#define FLOOR_LAYOUT_VERSION        1
+
+#define FLOOR_NVS_NAMESPACE         "floor"
+#define FLOOR_NVS_KEY               "layout"
+
+
+/* Layout blob, little-endian, as produced by tools/floor_layout.py:
+
+     floor_layout_header
+     floor_layout_table_record[table_count]
+     uint16_t distance_dm[table_count * (table_count - 1) / 2]
+         upper triangle, row-major: (0,1) (0,2) ... (1,2) ...
+         FLOOR_DISTANCE_UNKNOWN falls back to the straight line
+     uint32_t crc32 of everything above (zlib / esp_rom_crc32_le) */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t table_count;            // tables numbered 0 .. table_count - 1
+    uint8_t zone_count;
+} floor_layout_header;
+
+typedef struct __attribute__((packed)) {
+    int16_t x_dm;                   // position in decimetres
+    int16_t y_dm;
+    uint8_t zone;                   // 0 .. zone_count - 1, or FLOOR_ZONE_NONE
+    uint8_t reserved;
+} floor_layout_table_record;
+
+
+/* Compiled layout. Lookups are single array reads; tables outside the
+   layout are unzoned and zero distance from everything. */
+typedef struct {
+    bool loaded;
+    uint8_t table_count;
+    uint8_t zone_count;
+    uint8_t zone[FLOOR_MAX_TABLES];
+    uint16_t distance_dm[FLOOR_MAX_TABLES][FLOOR_MAX_TABLES];
+} floor_layout;
+
+extern floor_layout floor_plan;
+
+
+/**
+ * Load the built-in layout: two zones, tables 1-10 and 18-23 in zone 0 and
+ * tables 11-17 in zone 1, 20 m apart. Table 0 is unzoned.
+ */
+void floor_layout_load_default(void);
+
+
+/**
+ * Validate a layout blob and compile it into floor_plan.
+ *
+ * On any error floor_plan is left unchanged.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE for a truncated blob or too many
+ *         tables, ESP_ERR_INVALID_VERSION for a bad magic or version,
+ *         ESP_ERR_INVALID_CRC for a checksum mismatch, or
+ *         ESP_ERR_INVALID_ARG for an out-of-range zone.
+ */
+esp_err_t floor_layout_load_blob(const uint8_t *blob, size_t len);
+
+
+/**
+ * Load the layout blob stored under FLOOR_NVS_NAMESPACE / FLOOR_NVS_KEY.
+ * Falls back to the built-in layout if the key is missing or invalid.
+ * NVS must already be initialised.
+ */
+esp_err_t floor_layout_load_from_nvs(void);
+
+
+static inline uint8_t floor_layout_zone(uint8_t table_number) {
+    return (table_number < FLOOR_MAX_TABLES) ? floor_plan.zone[table_number] : FLOOR_ZONE_NONE;
+}
+
+
+static inline uint16_t floor_layout_distance_dm(uint8_t from_table, uint8_t to_table) {
+    return (from_table < FLOOR_MAX_TABLES && to_table < FLOOR_MAX_TABLES)
+        ? floor_plan.distance_dm[from_table][to_table] : 0;
+}
+
+
+#endif
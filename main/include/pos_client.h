@@ -10,22 +10,21 @@ typedef enum {
     POS_CUSTOMERS_SEATED = 0,
     POS_ORDER_READY      = 1,
     POS_BILL_REQUESTED   = 2,
+    POS_TRACE_DUMP       = 3,   // not a table event: reply with new decision trace records
+    POS_JOURNAL_DUMP     = 4,   // not a table event: reply with the whole event journal
 } pos_event_type;
 
 
-/* 2-byte wire message, no framing. table_index must be < MAX_TABLES. */
+/* 2-byte wire message, no framing. table_index must be < system_get_table_count(). */
 typedef struct {
     uint8_t type;
     uint8_t table_index;
 } __attribute__((packed)) pos_message;
 
 
-/* Call once at startup. */
+/* Call once at startup. Table events are posted as system commands for
+   the scheduler tick task to apply, see system_command.h. */
 void pos_client_start(void);
 
 
-/* Drain queued POS events into the table FSM. Call from the scheduler tick. */
-void pos_client_drain_events(time_ms current_time_ms);
-
-
 #endif // POS_CLIENT_H
@@ -0,0 +1,84 @@
+#ifndef SCHED_SCORE_H
+#define SCHED_SCORE_H
+
+#include "../include/types.h"
+
+#include <stdint.h>
+#include <float.h>
+#include <math.h>
+
+
+/* Score arithmetic shared by the scheduler and the staff assignment
+   engine.
+
+   The scheduler ranks on sched_key, a score held exactly in an int64_t,
+   the same in every build. One score point is KEY_ONE = 60000 * 2^32 key
+   units, so a rate given per minute, as the config gives them, is a whole
+   number of units per ms: each term of a score is exact, equal scores
+   compare equal and two score lines cross at a time that integer division
+   finds exactly. Keys hold scores within +-35000.
+
+   sched_score is a score as handed out, to traces, logs and the staff
+   auction: float by default, Q16.16 when SCHEDULER_FIXED_POINT is defined.
+   It is always derived from a key, so the choice changes what is reported
+   but never which task the scheduler picks. Conversions from float happen
+   only at init. */
+
+typedef int64_t sched_key;
+
+#define KEY_ONE             ((sched_key)60000 << 32)
+#define KEY_MIN             INT64_MIN
+
+static inline sched_key key_from_double(double v) {
+    return (sched_key)llround(v * (double)KEY_ONE);
+}
+
+// Units per ms of a rate in score per minute.
+static inline sched_key key_rate_per_min(double v) {
+    return (sched_key)llround(v * 4294967296.0);        // 2^32
+}
+
+static inline double key_to_double(sched_key k) {
+    return (double)k / (double)KEY_ONE;
+}
+
+// Q8.8, rounded and saturating; used for compact trace records.
+static inline int16_t key_to_q8(sched_key k) {
+    long q = lround(key_to_double(k) * 256.0);
+    return (int16_t)((q > INT16_MAX) ? INT16_MAX : (q < INT16_MIN) ? INT16_MIN : q);
+}
+
+
+// #define SCHEDULER_FIXED_POINT
+#ifdef SCHEDULER_FIXED_POINT
+
+typedef int32_t sched_score;        // Q16.16 score
+
+#define SCORE_MIN           INT32_MIN
+
+static inline sched_score score_from_float(float v) {
+    return (sched_score)(v * 65536.0f + ((v >= 0.0f) ? 0.5f : -0.5f));
+}
+
+static inline sched_score score_from_key(sched_key k) {
+    return (sched_score)(k / (KEY_ONE >> 16));
+}
+
+static inline double score_to_double(sched_score v) {
+    return (double)v / 65536.0;
+}
+
+#else
+
+typedef float sched_score;
+
+#define SCORE_MIN           (-FLT_MAX)
+
+static inline sched_score score_from_float(float v)   { return v; }
+static inline sched_score score_from_key(sched_key k) { return (float)key_to_double(k); }
+static inline double score_to_double(sched_score v)   { return (double)v; }
+
+#endif
+
+
+#endif
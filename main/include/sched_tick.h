@@ -0,0 +1,52 @@
+#ifndef SCHED_TICK_H
+#define SCHED_TICK_H
+
+
+#include <stdbool.h>
+
+#include "types.h"
+
+
+#define SCHED_TICK_MIN_SLEEP_MS     5           // floor on a wait, absorbs deadline rounding
+#define SCHED_TICK_MAX_SLEEP_MS     60000       // safety net: re-evaluate at least this often
+#define SCHED_TICK_COMMAND_BATCH    16          // commands applied per pass before the system tick
+#define SCHED_TICK_SYNC_TIMEOUT_MS  100         // longest sched_tick_sync() waits for the owner
+
+
+/**
+ * Start the scheduler tick task.
+ *
+ * The task owns the trace system: it is the only task that mutates it. Each
+ * pass applies up to SCHED_TICK_COMMAND_BATCH posted commands (see
+ * system_command.h), runs trace_system_tick(), publishes a fresh
+ * system_snapshot, saves the warm restart image (see warm_restart.h), then
+ * sleeps until system_next_deadline() or until sched_tick_wake() is called,
+ * whichever comes first. A full batch skips the sleep. Call once, after warm_restart_resume() and before starting any
+ * task that reads the snapshot.
+ */
+void sched_tick_start(void);
+
+
+/**
+ * Wake the scheduler tick task early.
+ *
+ * Call after posting commands. Safe before sched_tick_start().
+ * Not for use from an ISR.
+ */
+void sched_tick_wake(void);
+
+
+/**
+ * Wake the tick task and wait until every command posted so far has been
+ * applied and a snapshot including them published, for callers that read
+ * back the state they just changed.
+ *
+ * Blocks on a task notification for at most SCHED_TICK_SYNC_TIMEOUT_MS.
+ * One task may wait at a time; the UI task is the only caller.
+ *
+ * @return true once applied, false on timeout or before sched_tick_start().
+ */
+bool sched_tick_sync(void);
+
+
+#endif // SCHED_TICK_H
@@ -0,0 +1,129 @@
+#ifndef STAFF_SCHEDULER_H
+#define STAFF_SCHEDULER_H
+
+#include "../include/types.h"
+#include "../include/task_pool.h"
+#include "../include/trace_scheduler.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+#ifndef MAX_STAFF
+#define MAX_STAFF                   8
+#endif
+
+/* Free ready tasks one auction can hold. With n idle waiters, a task whose
+   raw score trails the n-th best by more than the zone adjustment spread
+   (scheduler_transition_key_bounds) is never any waiter's better pick, so
+   only the tasks within that spread are entered and the assignment is as
+   good as one over every free task. If more than this many are within
+   reach, the best by raw score are kept and last_truncated is set; the
+   assignment then falls short of the optimum by at most n times the
+   spread. The default covers the device's whole task pool, so only larger
+   host pools can truncate. */
+#ifndef STAFF_MAX_CANDIDATES
+#define STAFF_MAX_CANDIDATES        32
+#endif
+
+
+typedef struct {
+    float auction_epsilon;          // minimum bid increment; assignments are within MAX_STAFF * epsilon of optimal
+    uint16_t max_bids;              // bids per tick before the remaining waiters are assigned greedily
+} staff_scheduler_config;
+
+
+typedef struct {
+    bool on_shift;
+    bool has_active_task;
+    task_id active_task_id;
+    time_ms task_active_since;
+
+    /* Last task the waiter was assigned, kept after it ends so the next
+       assignment is scored by the walk from where the waiter actually is. */
+    uint8_t last_table;
+    task_kind last_kind;
+} staff_member;
+
+
+#define STAFF_AUCTION_OBJECTS       ((MAX_STAFF > STAFF_MAX_CANDIDATES) ? MAX_STAFF : STAFF_MAX_CANDIDATES)
+
+/* Per-tick auction scratch, kept in the scheduler so separate instances
+   can run on separate threads. value[w][t] is waiter idle_staff[w]'s
+   valuation of ready slot free_slot[t]. Sized by STAFF_MAX_CANDIDATES,
+   not by the pool capacity. */
+typedef struct {
+    uint8_t idle_staff[MAX_STAFF];
+    uint16_t held_slot[MAX_STAFF];
+    uint16_t free_slot[STAFF_MAX_CANDIDATES];
+    sched_key free_raw[STAFF_MAX_CANDIDATES];
+    sched_score value[MAX_STAFF][STAFF_MAX_CANDIDATES];
+
+    sched_score price[STAFF_AUCTION_OBJECTS];
+    int16_t holder[STAFF_AUCTION_OBJECTS];      // bidder holding each object, or -1
+    int16_t held[MAX_STAFF];                    // object held by each bidder, or -1
+} staff_auction;
+
+
+/* Assigns ready tasks to several waiters sharing one task pool. Like the
+   single-operator scheduler, a waiter keeps their active task until a
+   natural breakpoint (completed, killed, suppressed or stale). Each tick,
+   the waiters at a breakpoint bid against each other in an auction for
+   the tasks no other waiter holds. A task is worth its raw score plus the
+   zone-batch adjustment from that waiter's previous task. Waiters who keep
+   their task do not bid, so a re-solve costs nothing until a task changes.
+
+   Tables are numbered in a uint8_t, as everywhere in the task pool, so one
+   instance serves at most 255 tables; a larger floor runs an instance per
+   section. */
+typedef struct {
+    staff_scheduler_config cfg;
+    sched_score epsilon;
+
+    staff_member staff[MAX_STAFF];
+    uint8_t staff_count;
+
+    uint16_t pending_count;         // ready tasks not held by any waiter
+    uint16_t last_bid_count;        // bids spent by the most recent auction
+    bool last_truncated;            // it left out tasks within reach, see STAFF_MAX_CANDIDATES
+
+    staff_auction auction;
+} staff_scheduler;
+
+
+/**
+ * Initialise a staff scheduler with `staff_count` waiters, all on shift and
+ * idle, applying defaults for any zero-valued config fields.
+ */
+void staff_scheduler_init(staff_scheduler *ss, const staff_scheduler_config *cfg, uint8_t staff_count);
+
+
+/**
+ * Put a waiter on or off shift. Going off shift releases the waiter's active
+ * task back to the pool for the next tick's auction.
+ */
+void staff_scheduler_set_on_shift(staff_scheduler *ss, uint8_t staff_index, bool on_shift);
+
+
+/**
+ * Advance the assignment by one tick.
+ *
+ * Wakes expired suppressions and clears every waiter whose active task has
+ * reached a natural breakpoint. Then it auctions the unheld ready tasks
+ * among the idle on-shift waiters. Scores come from `scoring`, so both
+ * engines rank tasks the same way.
+ *
+ * Runs in O(unheld tasks * idle waiters) to pick the candidates, then
+ * O(bids * candidates) with at most cfg.max_bids bids, and does not block
+ * or allocate.
+ */
+void staff_scheduler_tick(staff_scheduler *ss, const scheduler *scoring, task_pool *pool, time_ms now);
+
+
+/**
+ * Active task of a waiter, or INVALID_TASK_ID when idle, off shift or out of range.
+ */
+task_id staff_scheduler_active_task(const staff_scheduler *ss, uint8_t staff_index);
+
+
+#endif
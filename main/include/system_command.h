@@ -0,0 +1,88 @@
+#ifndef SYSTEM_COMMAND_H
+#define SYSTEM_COMMAND_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../include/types.h"
+#include "../include/table_fsm.h"
+#include "../include/task_pool.h"
+#include "../include/trace_scheduler.h"
+
+
+#define SYSTEM_COMMAND_CAPACITY     32          // commands in flight, power of two
+
+
+/* Every mutation of the trace system is a command. Any task may post one;
+   only the owner (the scheduler tick task) applies them, in posting order,
+   so the table FSMs, task pool and scheduler have a single writer. */
+typedef enum {
+    SYSTEM_CMD_TABLE_EVENT = 0,     // system_apply_events(), batched with the table events around it
+    SYSTEM_CMD_USER_ACTION,         // system_apply_user_action_to_task(task, arg)
+    SYSTEM_CMD_FORCE_ACTIVE,        // system_force_active_task(task)
+    SYSTEM_CMD_FORCE_TABLE_TASK,    // force the current task of table_index active, if any
+    SYSTEM_CMD_UNDO_IGNORE,         // system_undo_task_ignore(task, arg, prev_suppress_until)
+} system_command_type;
+
+typedef struct {
+    uint8_t type;                   // system_command_type
+    uint8_t table_index;
+    uint8_t arg;                    // fsm_transition_event, user_action or previous ignore count
+    task_id task;
+    time_ms prev_suppress_until;    // SYSTEM_CMD_UNDO_IGNORE only
+} system_command;
+
+
+/**
+ * Post a command for the owner to apply.
+ *
+ * Lock-free and safe from any number of tasks at once. The command is
+ * applied by the next system_command_apply(); wake the owner with
+ * sched_tick_wake() after posting. Commands from one task are applied in
+ * the order that task posted them.
+ *
+ * @param command Command to copy into the ring.
+ * @return false if the ring is full and the command was dropped.
+ */
+bool system_command_post(const system_command *command);
+
+
+/**
+ * Apply up to max_commands posted commands, oldest first, at current_time.
+ *
+ * Consecutive table events go to system_apply_events() as one batch, so
+ * the scheduler runs once for the run rather than once per event.
+ *
+ * Owner only: must always be called from the same task.
+ *
+ * @return Number of commands applied. Less than max_commands means the ring
+ *         was drained.
+ */
+uint16_t system_command_apply(time_ms current_time, uint16_t max_commands);
+
+
+/* Sequence numbers for waiting on the owner: every command posted before
+   system_command_posted() returned has been applied once
+   system_command_applied_through() returns true for that value. */
+uint32_t system_command_posted(void);
+
+bool system_command_applied_through(uint32_t posted);
+
+
+// Commands dropped because the ring was full, since boot.
+uint32_t system_command_dropped(void);
+
+
+/* Posting shorthands, one per command type. */
+bool system_post_table_event(uint8_t table_index, fsm_transition_event event);
+
+bool system_post_user_action(task_id id, user_action action);
+
+bool system_post_force_active(task_id id);
+
+bool system_post_force_table_task(uint8_t table_index);
+
+bool system_post_undo_ignore(task_id id, uint8_t prev_ignore_count, time_ms prev_suppress_until);
+
+
+#endif
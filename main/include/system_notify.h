@@ -0,0 +1,82 @@
+#ifndef SYSTEM_NOTIFY_H
+#define SYSTEM_NOTIFY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "../include/system_snapshot.h"
+
+
+#define SYSTEM_NOTIFY_INDEX             1       // notification slot the bus owns; slot 0 stays free for plain wakes
+#define SYSTEM_NOTIFY_MAX_SUBSCRIBERS   4
+
+_Static_assert(SYSTEM_NOTIFY_INDEX < configTASK_NOTIFICATION_ARRAY_ENTRIES,
+               "set CONFIG_FREERTOS_TASK_NOTIFICATION_ARRAY_ENTRIES above SYSTEM_NOTIFY_INDEX");
+
+
+/**
+ * Subscribe a task to system changes.
+ *
+ * After every snapshot that changes something in `mask`, the task's
+ * notification value at SYSTEM_NOTIFY_INDEX gets those SYSTEM_CHANGE_* bits
+ * set (see system_snapshot.h). Bits accumulate until the task takes them
+ * with system_notify_wait(), so nothing is missed while it is busy. With
+ * SYSTEM_CHANGE_TABLES in `mask`, the tables that changed accumulate the
+ * same way in a table bitmap kept for the task, taken with
+ * system_notify_take_tables().
+ *
+ * Safe from any task, at any time. There is no unsubscribe.
+ *
+ * @param task Task to notify, NULL for the calling task.
+ * @param mask SYSTEM_CHANGE_* bits of interest.
+ * @return false if SYSTEM_NOTIFY_MAX_SUBSCRIBERS are already subscribed.
+ */
+bool system_notify_subscribe(TaskHandle_t task, uint32_t mask);
+
+
+/**
+ * Notify every subscriber whose mask intersects `changes`.
+ *
+ * Owner only, right after system_snapshot_publish(), so a subscriber that
+ * wakes and reads the snapshot always sees the changes it was told about.
+ *
+ * @param changes SYSTEM_CHANGE_* bits, as returned by the publish.
+ * @param changed_tables SYSTEM_TABLE_WORDS words of tables that changed,
+ *        read when `changes` has SYSTEM_CHANGE_TABLES.
+ */
+void system_notify_publish(uint32_t changes, const uint32_t *changed_tables);
+
+
+/**
+ * Block the calling subscriber until it is notified or `timeout` passes.
+ *
+ * @return The SYSTEM_CHANGE_* bits set since the last wait, 0 on timeout.
+ */
+uint32_t system_notify_wait(TickType_t timeout);
+
+
+/**
+ * Take the tables changed since the calling subscriber last took or
+ * acknowledged them, as SYSTEM_TABLE_WORDS words in `tables`, and clear
+ * them. All zero for a task that is not subscribed to SYSTEM_CHANGE_TABLES.
+ */
+void system_notify_take_tables(uint32_t *tables);
+
+
+/**
+ * Drop pending `bits` for the calling subscriber, for state it is about to
+ * draw in full anyway. SYSTEM_CHANGE_TABLES also drops every pending table.
+ * Call before reading the snapshot it draws from: a publish landing in
+ * between sets the bits again.
+ */
+void system_notify_ack(uint32_t bits);
+
+
+// Drop one pending table for the calling subscriber, as system_notify_ack() does for bits.
+void system_notify_ack_table(uint8_t table_index);
+
+
+#endif
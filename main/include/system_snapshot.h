@@ -0,0 +1,133 @@
+#ifndef SYSTEM_SNAPSHOT_H
+#define SYSTEM_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../include/types.h"
+#include "../include/task_domain.h"
+#include "../include/trace_system.h"
+
+
+/* What changed since the previous version, per table. */
+typedef enum {
+    SYSTEM_TABLE_CHANGED_STATE   = 1 << 0,     // state, prev_state or state_entered_at
+    SYSTEM_TABLE_CHANGED_TASK    = 1 << 1,     // current task id, kind or deadline
+    SYSTEM_TABLE_CHANGED_OVERDUE = 1 << 2,     // current task's overdue level
+} system_table_change;
+
+
+/* Tables as a bitmap, table n at bit n % 32 of word n / 32, sized from
+   MAX_TABLES so the bus carries every table however many there are. */
+#define SYSTEM_TABLE_WORDS              ((MAX_TABLES + 31) / 32)
+
+static inline bool system_tables_test(const uint32_t *tables, uint8_t table_index) {
+    return table_index < MAX_TABLES && (tables[table_index / 32] & (1u << (table_index % 32)));
+}
+
+
+/* What changed since the previous version, as one word: whether any table
+   changed, the union of their system_table_change bits, and the
+   system-wide parts. Which tables changed goes alongside as a table bitmap.
+   Fits a task notification value, see system_notify.h. */
+#define SYSTEM_CHANGE_TABLES            (1u << 0)       // one or more tables, see changed_tables
+#define SYSTEM_CHANGE_TABLE_FIELD_SHIFT 1               // system_table_change bits start here
+#define SYSTEM_CHANGE_TABLE_STATE       ((uint32_t)SYSTEM_TABLE_CHANGED_STATE   << SYSTEM_CHANGE_TABLE_FIELD_SHIFT)
+#define SYSTEM_CHANGE_TABLE_TASK        ((uint32_t)SYSTEM_TABLE_CHANGED_TASK    << SYSTEM_CHANGE_TABLE_FIELD_SHIFT)
+#define SYSTEM_CHANGE_TABLE_OVERDUE     ((uint32_t)SYSTEM_TABLE_CHANGED_OVERDUE << SYSTEM_CHANGE_TABLE_FIELD_SHIFT)
+#define SYSTEM_CHANGE_ACTIVE            (1u << 4)       // active task replaced, or its kind, overdue level or deadline
+#define SYSTEM_CHANGE_CRITICAL          (1u << 5)       // top critical pending task replaced
+#define SYSTEM_CHANGE_COUNTS            (1u << 6)       // pending, critical or active table counts
+#define SYSTEM_CHANGE_SWITCH            (1u << 7)       // predicted switch prompt time or challenger
+#define SYSTEM_CHANGE_ALL               (SYSTEM_CHANGE_TABLES | SYSTEM_CHANGE_TABLE_STATE | SYSTEM_CHANGE_TABLE_TASK | \
+                                         SYSTEM_CHANGE_TABLE_OVERDUE | SYSTEM_CHANGE_ACTIVE | SYSTEM_CHANGE_CRITICAL | \
+                                         SYSTEM_CHANGE_COUNTS | SYSTEM_CHANGE_SWITCH)
+
+
+/* A copy of everything the UI shows, published by the owner (the scheduler
+   tick task) after each pass. Readers copy it out whole, so they never see
+   a half-applied command and never touch the task pool. */
+
+
+typedef struct {
+    bool    has_task;
+    task_id id;                     // INVALID_TASK_ID when !has_task
+    uint8_t kind;                   // task_kind
+    uint8_t table_number;
+    uint8_t overdue_level;          // task_overdue_level
+    uint8_t ignore_count;
+    time_ms deadline;               // time_limit
+    time_ms suppress_until;
+} system_task_view;
+
+
+typedef struct {
+    uint8_t state;                  // table_state
+    uint8_t prev_state;             // TABLE_IDLE when there is nothing to undo
+    uint8_t task_kind;              // kind the state calls for, TASK_NOT_APPLICABLE if none
+    uint8_t overdue_level;          // of the current task, TASK_ON_TIME if none
+    task_id task_id;                // current task, INVALID_TASK_ID if none admitted
+    time_ms state_entered_at;
+    time_ms deadline;               // current task's time_limit, 0 if none
+} system_table_view;
+
+
+typedef struct {
+    uint32_t version;               // 0 until the first publish, then one per publish
+    time_ms  published_at;
+
+    system_task_view active;
+    system_task_view critical;      // top critical pending task, has_task false if none
+
+    uint16_t pending_count;         // eligible tasks other than the active task
+    uint16_t critical_count;        // pending tasks exceeding the switch-prompt threshold
+    uint8_t  active_tables;         // tables whose state calls for a task
+
+    // Next switch prompt while none is due, see system_predict_next_switch(); assumes no events in between
+    time_ms  switch_at;             // 0 when none is predicted
+    task_id  switch_task;           // challenger expected to raise it, INVALID_TASK_ID if none
+
+    uint32_t changes;               // SYSTEM_CHANGE_* against the previous version, all on the first
+    uint32_t changed_tables[SYSTEM_TABLE_WORDS];    // tables with any table_changes bit
+    uint8_t  table_changes[MAX_TABLES];     // system_table_change bits per table
+
+    system_table_view tables[MAX_TABLES];
+} system_snapshot;
+
+
+/**
+ * Build a snapshot of the trace system and make it the current one.
+ *
+ * Owner only: call from the task that applies commands, after it has
+ * applied them, or before any other task starts. Never blocks and never
+ * waits for readers. When nothing the snapshot carries changed, the
+ * current snapshot stays current and its version does not move.
+ *
+ * @param now Current time, recorded as published_at.
+ * @param changed_tables If not NULL and anything changed, receives
+ *        SYSTEM_TABLE_WORDS words: the tables that changed, all of them on
+ *        the first publish.
+ * @return SYSTEM_CHANGE_* bits against the previous snapshot, 0 if nothing
+ *         the snapshot carries changed.
+ */
+uint32_t system_snapshot_publish(time_ms now, uint32_t *changed_tables);
+
+
+/**
+ * Copy the current snapshot into `out`.
+ *
+ * Safe from any task. Retries if a publish lands during the copy, so the
+ * result is always one whole snapshot.
+ *
+ * @return The copied snapshot's version, 0 if nothing was published yet.
+ */
+uint32_t system_snapshot_read(system_snapshot *out);
+
+
+// Table view by index, NULL when out of range.
+static inline const system_table_view *system_snapshot_table(const system_snapshot *snap, uint8_t table_index) {
+    return (table_index < MAX_TABLES) ? &snap->tables[table_index] : NULL;
+}
+
+
+#endif
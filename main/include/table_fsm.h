@@ -7,6 +7,9 @@
 #include <stdint.h>
 
 
+#define DINING_CHECKIN_INTERVAL_MS  (15 * TIME_SCALE)   // DINING -> CHECKUP after this long
+#define TABLE_FSM_NO_DEADLINE       UINT32_MAX
+
 
 typedef enum {
     EVENT_MARK_COMPLETE,
@@ -17,6 +20,8 @@ typedef enum {
     EVENT_UNDO,
 
     TIMEOUT_PERIODIC_CHECKIN,
+
+    FSM_EVENT_COUNT,
 } fsm_transition_event;
 
 
@@ -30,6 +35,8 @@ typedef enum {
     TABLE_CHECKUP,
     TABLE_REQUESTED_BILL,
     TABLE_DONE,
+
+    TABLE_STATE_COUNT,
 } table_state;
 
 
@@ -39,6 +46,21 @@ typedef struct {
 } task_spec;
 
 
+/* What a state asks for. One per state in TABLE_FSM_STATES. */
+typedef struct {
+    task_kind task;                     // TASK_NOT_APPLICABLE if the state emits none
+    time_ms timeout;                    // time in the state before timeout_event fires, TABLE_FSM_NO_DEADLINE if never
+    fsm_transition_event timeout_event;
+} table_fsm_state_info;
+
+
+/* Generated from main/table_fsm.spec by tools/table_fsm_gen.py, see
+   src/table_fsm_table.c. A (state, event) pair without a transition maps
+   to the state itself. */
+extern const uint8_t TABLE_FSM_NEXT_STATE[TABLE_STATE_COUNT][FSM_EVENT_COUNT];
+extern const table_fsm_state_info TABLE_FSM_STATES[TABLE_STATE_COUNT];
+
+
 typedef struct {
     uint8_t table_number;
 
@@ -64,12 +86,23 @@ typedef struct {
 bool fsm_get_current_task_for_table(table_context *table, task_spec *out_task);
 
 
+/**
+ * Task kind a table in `state` asks for, TASK_NOT_APPLICABLE if none or if
+ * `state` is out of range. One load from TABLE_FSM_STATES.
+ */
+static inline task_kind table_fsm_task_kind(table_state state) {
+    if ((unsigned)state >= TABLE_STATE_COUNT) return TASK_NOT_APPLICABLE;
+    return TABLE_FSM_STATES[state].task;
+}
+
+
 /**
  * Apply a transition event to a table finite state machine.
  *
- * Evaluates the given event against the table's current state and performs
- * a state transition if the event is valid in that state. On transition,
- * the table state and state-entry timestamp are updated.
+ * Looks the next state up in TABLE_FSM_NEXT_STATE and performs the
+ * transition if the event is valid in the current state. EVENT_UNDO is
+ * handled ahead of the table. On transition, the table state and
+ * state-entry timestamp are updated.
  *
  * If the event does not result in a state change, the table state is left
  * unchanged.
@@ -105,4 +138,16 @@ bool table_apply_event(table_context *table, fsm_transition_event event, time_ms
 void table_fsm_tick(table_context *table, time_ms current_time);
 
 
+/**
+ * Time at which table_fsm_tick() will next fire a timeout for this table,
+ * or TABLE_FSM_NO_DEADLINE if its current state has none.
+ *
+ * This function is pure and non-blocking.
+ *
+ * @param table Table FSM context to query.
+ * @return Absolute deadline in milliseconds.
+ */
+time_ms table_fsm_next_deadline(const table_context *table);
+
+
 #endif
\ No newline at end of file
@@ -72,6 +72,14 @@ typedef enum {
 } task_status;
 
 
+/* Advanced by timer events, never by comparing against the clock. */
+typedef enum {
+    TASK_ON_TIME,
+    TASK_OVERDUE,               // past time_limit
+    TASK_CRITICALLY_OVERDUE,    // past time_limit + TASK_CRITICAL_OVRDUE_TIME_LIMIT
+} task_overdue_level;
+
+
 typedef enum {
     SUCCESS = 0,
     TASK_DOES_NOT_EXIST,
@@ -99,6 +107,7 @@ typedef struct {
     time_ms created_at;
 
     uint8_t ignore_count;
+    uint8_t overdue_level;      // task_overdue_level
 
     uint8_t table_number;
     task_kind kind;
@@ -4,51 +4,151 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "task_domain.h"
 
 
-#define TASK_POOL_CAPACITY           32
+#define TASK_POOL_NO_POS             UINT16_MAX
+#define TASK_POOL_MAX_CAPACITY       (UINT16_MAX - 1)   // slot indices are uint16_t, UINT16_MAX is the invalid id
+#define TASK_POOL_WORD_BITS          32                 // bitmap word, the native width on the ESP32-S3
+#define TASK_POOL_BITMAP_WORDS(n)    (((size_t)(n) + TASK_POOL_WORD_BITS - 1) / TASK_POOL_WORD_BITS)
+
+
+/* Slot sets kept as bitmaps, one bit per slot. Eligible, suppressed and dead
+   (completed or killed) partition the occupied slots once their status has
+   been filed with task_pool_add() or task_pool_sync(). */
+typedef enum {
+    TASK_POOL_OCCUPIED = 0,
+    TASK_POOL_ELIGIBLE,
+    TASK_POOL_SUPPRESSED,
+    TASK_POOL_DEAD,
+    TASK_POOL_SET_COUNT,
+} task_pool_set;
 
 
 typedef struct {
     task task_instance;
     uint16_t generation;
+    uint16_t next_free;             // next slot on the free list while unoccupied
+    uint16_t table_prev;            // neighbours on the task's table chain while indexed
+    uint16_t table_next;
     bool occupied;
+    bool indexed;                   // on its table chain, see task_pool_add()
+    bool changed;                   // on the changed list, see task_pool_clear_changed()
 } task_slot;
 
+
+/* One internal node of the scheduler's ranking tree over the slots, see
+   trace_scheduler.c. The pool only stores the nodes. */
+typedef struct {
+    uint16_t best;                  // best ranked ready slot below, TASK_POOL_NO_POS if none
+    uint16_t best_critical;         // best ranked slot below over the switch-prompt threshold
+    uint16_t critical_count;
+    time_ms due;                    // earliest time any of the above may change, 0 to recompute
+    time_ms due_critical;           // the same for best_critical and critical_count alone
+} task_pool_rank_node;
+
+/* Every array below is carved out of the arena handed to task_pool_init()
+   and holds `capacity` entries, or `table_count` for the per-table indexes.
+   The pool never allocates or frees memory. */
 typedef struct {
-    task_slot slots[TASK_POOL_CAPACITY];
+    uint16_t capacity;
+    task_slot *slots;
+
+    /* One bitmap per task_pool_set, TASK_POOL_BITMAP_WORDS(capacity) words
+       each, updated on every allocate, free and status sync. Walks go
+       word at a time with count-trailing-zeros and counts are popcounts. */
+    uint32_t *bitmap[TASK_POOL_SET_COUNT];
+    uint16_t bitmap_words;
+
+    /* Secondary indexes over the tasks added with task_pool_add().
+       key_slot[table * TASK_NOT_APPLICABLE + kind] is the slot most recently
+       added for that key among those still indexed, and table_head[table]
+       starts a doubly linked chain, newest first, through
+       task_slot.table_prev/table_next of every occupied slot on the table.
+       Both are maintained on add and free, so keyed lookups and per-table
+       walks never scan the pool. */
+    uint16_t table_count;
+    uint16_t *key_slot;
+    uint16_t *table_head;
+
+    /* Free list: unoccupied slots linked through task_slot.next_free, most
+       recently freed first. */
+    uint16_t free_head;
+
+    /* Ready queue: indices of TASK_ELIGIBLE slots, packed densely so the
+       scheduler only visits schedulable tasks. ready_pos maps slot -> position. */
+    uint16_t *ready;
+    uint16_t *ready_pos;
+    uint16_t ready_count;
+
+    /* Suppressed set: indices of TASK_SUPPRESSED slots, dense and unordered.
+       When they wake is up to the owner, see task_pool_wake_expired(). */
+    uint16_t *suppressed;
+    uint16_t *suppressed_pos;
+    uint16_t suppressed_count;
+
+    /* Changed list: slots filed or freed since the scheduler last took the
+       list, each once, so it re-ranks only those. */
+    uint16_t *changed;
+    uint16_t changed_count;
+
+    /* Ranking tree kept by the scheduler: rank[1] is the root, node i has
+       children 2i and 2i + 1, and i >= capacity is the leaf for slot
+       i - capacity. rank_valid is cleared whenever the slots are reset. */
+    task_pool_rank_node *rank;
+    bool rank_valid;
 } task_pool;
 
 
+/* Arena bytes needed per slot and per table, and for a pool of n slots over
+   `tables` tables including its bitmaps. The extra alignof(task_slot)
+   covers aligning an arbitrary arena pointer. */
+#define TASK_POOL_BYTES_PER_SLOT     (sizeof(task_slot) + sizeof(task_pool_rank_node) + 5 * sizeof(uint16_t))
+#define TASK_POOL_BYTES_PER_TABLE    ((TASK_NOT_APPLICABLE + 1) * sizeof(uint16_t))
+#define TASK_POOL_MAX_TABLES         (UINT8_MAX + 1)    // task table numbers are uint8_t
+#define TASK_POOL_ARENA_SIZE(n, tables) \
+    ((size_t)(n) * TASK_POOL_BYTES_PER_SLOT + (size_t)(tables) * TASK_POOL_BYTES_PER_TABLE + \
+     TASK_POOL_SET_COUNT * TASK_POOL_BITMAP_WORDS(n) * sizeof(uint32_t) + _Alignof(task_slot))
+
+
 
 
 /**
- * Initialise a task pool and reset all slot state.
+ * Initialise a task pool over a caller-supplied arena and reset all slot state.
  *
- * Clears the task pool, marks all slots as unoccupied, and resets generation
- * counters. Any previously allocated task identifiers become invalid after
- * this call.
+ * The per-table indexes for table_count tables are carved first, and the
+ * capacity is as many slots as fit in the rest, capped at
+ * TASK_POOL_MAX_CAPACITY; size the arena with TASK_POOL_ARENA_SIZE(). The
+ * arena must outlive the pool and need not be aligned. All slots are marked
+ * unoccupied and put on the free list, and generation counters are reset,
+ * so any previously allocated task identifiers become invalid.
  *
  * This function performs no blocking operations and does not allocate memory.
  * It must be called before any other task_pool_* function is used.
  *
  * @param pool Task pool to initialise.
+ * @param arena Backing storage for the slots and queues.
+ * @param arena_size Size of the arena in bytes.
+ * @param table_count Number of tables keyed tasks may belong to, at most
+ *                    TASK_POOL_MAX_TABLES.
+ * @return The pool capacity, 0 if the arena is too small for the indexes
+ *         and a single slot.
  */
-void task_pool_init(task_pool *pool);
+uint16_t task_pool_init(task_pool *pool, void *arena, size_t arena_size, uint16_t table_count);
 
 
 /**
  * Allocate a free slot from the task pool.
  *
- * Searches for an unoccupied slot, marks it as occupied, and returns a
+ * Pops the head of the free list, marks it as occupied, and returns a
  * generation-stamped task identifier. The task contents are not initialised
  * by this function and must be set by the caller.
  *
  * If no free slot is available, an invalid task identifier is returned.
  *
- * This function is non-blocking and performs a bounded linear scan of the pool.
+ * This function is non-blocking and runs in constant time.
  *
  * @param pool Task pool to allocate from.
  * @return Task identifier for the allocated slot, or an invalid ID on failure.
@@ -56,16 +156,40 @@ void task_pool_init(task_pool *pool);
 task_id task_pool_allocate(task_pool *pool);
 
 
+/**
+ * Set the slot generations and free list order of an empty pool.
+ *
+ * For rebuilding a saved pool: list the slots that will be added again
+ * first, in the order they will be added, then the rest in their saved
+ * free list order. Each task_pool_allocate(), and so each new key passed
+ * to task_pool_add(), then takes the next listed slot with its saved
+ * generation, so task identifiers come back unchanged and the slots left
+ * over form the saved free list.
+ *
+ * This function performs no blocking operations and runs in time
+ * proportional to the pool capacity.
+ *
+ * @param pool Task pool with nothing allocated, e.g. straight after task_pool_init().
+ * @param order Every slot index exactly once.
+ * @param generation Generation to give each slot, by slot index.
+ * @param count Entries in order and generation; must equal the pool capacity.
+ * @return false, with the pool unchanged, if the pool is not empty or
+ *         order is not a permutation of its slots.
+ */
+bool task_pool_seed_free_list(task_pool *pool, const uint16_t *order, const uint16_t *generation, uint16_t count);
+
+
 /**
  * Free a previously allocated task slot.
  *
  * Marks the specified slot as unoccupied and increments its generation counter
- * to invalidate any stale task identifiers referencing the same index.
+ * to invalidate any stale task identifiers referencing the same index, then
+ * drops it from the per-table indexes and pushes it on the free list.
  *
  * If the identifier is invalid, stale, or refers to an unoccupied slot, this
  * function has no effect.
  *
- * This function is non-blocking and performs no memory allocation.
+ * This function is non-blocking and runs in constant time.
  *
  * @param pool Task pool containing the slot.
  * @param id Task identifier to free.
@@ -101,22 +225,24 @@ const task *task_pool_get_const(const task_pool *pool, task_id id);
  *
  * This function is pure and non-blocking.
  *
+ * @param pool Task pool the identifier belongs to.
  * @param id Task identifier to validate.
  * @return true if the identifier index is within pool bounds.
  */
-bool is_task_id_valid(task_id id);
+bool is_task_id_valid(const task_pool *pool, task_id id);
 
 
 /**
  * Find an existing active task matching a logical key.
  *
- * Searches the task pool for an occupied task matching the given table number
- * and task kind. Tasks that are completed or killed are ignored.
+ * Looks up the task most recently added for the given table number and task
+ * kind, and returns it if it is still eligible. Suppressed, completed and
+ * killed tasks are ignored.
  *
  * This function is used to prevent duplicate tasks representing the same
  * logical unit of work.
  *
- * This function is non-blocking and performs a bounded linear scan of the pool.
+ * This function is non-blocking and runs in constant time.
  *
  * @param pool Task pool to search.
  * @param table_number Table identifier associated with the task.
@@ -134,11 +260,12 @@ task_id task_pool_find_by_key(const task_pool *pool, uint8_t table_number, task_
  * exists, that task is updated with current default parameters and returned.
  * If a completed or killed version exists, it is freed and replaced.
  *
- * If no matching task exists, a new task slot is allocated and initialised.
- * If the pool is full, an invalid task identifier is returned.
+ * If no matching task exists, a new task slot is allocated, initialised and
+ * entered in the key map and the table's chain. If the pool is full or the
+ * table number is out of range, an invalid task identifier is returned.
  *
- * This function performs no blocking operations and executes in bounded time
- * proportional to the task pool capacity.
+ * This function performs no blocking operations and executes in time
+ * proportional to the number of tasks on the table.
  *
  * @param pool Task pool to modify.
  * @param table_number Table identifier associated with the task.
@@ -149,6 +276,143 @@ task_id task_pool_find_by_key(const task_pool *pool, uint8_t table_number, task_
 task_id task_pool_add(task_pool *pool, uint8_t table_number, task_kind kind, time_ms now);
 
 
+/**
+ * Walk the tasks on a table's chain, most recently added first.
+ *
+ * task_pool_table_first() returns the first task on the table and
+ * task_pool_table_next() the one after `id`, or an invalid identifier at
+ * the end. Only tasks added with task_pool_add() are on a chain. Changing
+ * a task's status during the walk is fine; freeing the current task is not.
+ *
+ * Both are non-blocking and run in constant time.
+ */
+task_id task_pool_table_first(const task_pool *pool, uint8_t table_number);
+
+task_id task_pool_table_next(const task_pool *pool, task_id id);
+
+
+/**
+ * Re-file a task in the ready queue or suppressed set after its status changed.
+ *
+ * Must be called after any task_domain mutation (complete, ignore, kill,
+ * undo) performed outside the pool, so the queues keep matching the slot
+ * statuses. Eligible tasks go on the ready queue, suppressed tasks in the
+ * suppressed set, and completed or killed tasks on neither.
+ *
+ * Stale or invalid identifiers are ignored. This function is non-blocking
+ * and runs in constant time.
+ *
+ * @param pool Task pool containing the task.
+ * @param id Task identifier whose status changed.
+ */
+void task_pool_sync(task_pool *pool, task_id id);
+
+
+/**
+ * Return every suppressed task whose suppression has elapsed to the ready queue.
+ *
+ * Polling fallback for pools whose owner does not time suppression expiry
+ * itself. trace_system does, with a timer wheel, and calls refresh_task() and
+ * task_pool_sync() per expired task instead. Scans the suppressed set only.
+ *
+ * @param pool Task pool to update.
+ * @param now Current system time in milliseconds.
+ * @return Number of tasks made eligible.
+ */
+uint16_t task_pool_wake_expired(task_pool *pool, time_ms now);
+
+
+/**
+ * Number of slots in a set: a popcount over its bitmap.
+ *
+ * This function is pure and non-blocking, and runs in time proportional to
+ * capacity / TASK_POOL_WORD_BITS.
+ */
+uint16_t task_pool_count(const task_pool *pool, task_pool_set set);
+
+
+/**
+ * Walk the slots of a set in index order, a bitmap word at a time:
+ *
+ *     task_pool_iter it = task_pool_iter_begin(pool, TASK_POOL_ELIGIBLE);
+ *     for (uint16_t i = task_pool_iter_next(&it); i != TASK_POOL_NO_POS; i = task_pool_iter_next(&it))
+ *
+ * Empty words are skipped whole and members found with count-trailing-zeros.
+ * Each word is read once, when the walk reaches it, so the current slot may
+ * leave the set during the walk but other slots should not change sets.
+ * Inline because the walk calls it once per member.
+ */
+typedef struct {
+    const uint32_t *words;
+    uint16_t word_count;
+    uint16_t w;
+    uint32_t word;                  // members of words[w] not yet returned
+} task_pool_iter;
+
+static inline task_pool_iter task_pool_iter_begin(const task_pool *pool, task_pool_set set) {
+    task_pool_iter it = { .words = pool->bitmap[set], .word_count = pool->bitmap_words, .w = 0 };
+    it.word = (it.word_count > 0) ? it.words[0] : 0;
+    return it;
+}
+
+static inline uint16_t task_pool_iter_next(task_pool_iter *it) {
+    while (it->word == 0) {
+        if (++it->w >= it->word_count) {
+            it->w = it->word_count;
+            return TASK_POOL_NO_POS;
+        }
+        it->word = it->words[it->w];
+    }
+
+    uint16_t index = (uint16_t)(it->w * TASK_POOL_WORD_BITS + (uint32_t)__builtin_ctz(it->word));
+    it->word &= it->word - 1;
+    return index;
+}
+
+
+/**
+ * Empty the changed list.
+ *
+ * Every slot filed by task_pool_add(), task_pool_sync() or
+ * task_pool_wake_expired(), or freed, goes on the list once until it is
+ * cleared. The scheduler reads pool->changed[0 .. changed_count) on each
+ * tick and then clears it; nothing else should.
+ *
+ * @param pool Task pool whose list to clear.
+ */
+void task_pool_clear_changed(task_pool *pool);
+
+
+/**
+ * Free every completed or killed task.
+ *
+ * Walks the dead bitmap a word at a time, so the cost is proportional to
+ * capacity / TASK_POOL_WORD_BITS plus the number of tasks freed. Tasks
+ * whose status changed since they were last filed are not seen until
+ * task_pool_sync() files them.
+ *
+ * @param pool Task pool to reap.
+ * @return Number of tasks freed.
+ */
+uint16_t task_pool_reap(task_pool *pool);
+
+
+/**
+ * Check the per-table indexes and slot bitmaps against the slots, for debug builds.
+ *
+ * Verifies that every chain is well linked and holds exactly the indexed
+ * occupied slots of its table, that every key map entry names the newest
+ * slot on the chain with that key, or none if there is none, that the
+ * bitmaps match the slots' occupancy and filed status, and that the
+ * changed list holds each flagged slot once. Runs in time proportional to
+ * the pool capacity.
+ *
+ * @param pool Task pool to check.
+ * @return Number of inconsistencies found, 0 if the indexes are sound.
+ */
+uint16_t task_pool_check_indexes(const task_pool *pool);
+
+
 
 
 #endif
\ No newline at end of file
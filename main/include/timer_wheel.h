@@ -0,0 +1,127 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "types.h"
+#include "task_domain.h"
+
+
+#define TIMER_WHEEL_SLOT_BITS       6
+#define TIMER_WHEEL_SLOTS           (1u << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_LEVELS          6           // 6 x 6 bits spans all of time_ms at 1 ms resolution
+#define TIMER_WHEEL_LISTS           (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS + 1)   // last list holds due timers
+#ifndef TIMER_WHEEL_CAPACITY
+#define TIMER_WHEEL_CAPACITY        128         // 3 per task slot, 1 per table, 1 for the scheduler
+#endif
+
+#define TIMER_NONE                  UINT16_MAX
+
+
+typedef uint16_t timer_handle;
+
+
+typedef enum {
+    TIMER_TASK_UNSUPPRESS = 0,      // suppress_until reached, task may be scheduled again
+    TIMER_TASK_OVERDUE,             // time_limit reached
+    TIMER_TASK_CRITICAL,            // time_limit + TASK_CRITICAL_OVRDUE_TIME_LIMIT reached
+    TIMER_TABLE_CHECKIN,            // DINING check-in interval elapsed
+    TIMER_SCHEDULER_RECHECK,        // scheduler_next_change() reached
+} timer_event_type;
+
+
+typedef struct {
+    timer_event_type type;
+    uint8_t table;                  // TIMER_TABLE_CHECKIN
+    task_id task;                   // TIMER_TASK_*
+    time_ms expires_at;
+} timer_event;
+
+
+typedef struct {
+    timer_event event;
+    uint16_t next;
+    uint16_t prev;
+    uint16_t list;                  // index into timer_wheel.head, TIMER_NONE while free
+} timer_entry;
+
+
+/* Hierarchical timing wheel. A timer lives at the level of the highest 6-bit
+   group in which its expiry differs from `now`, so it is touched once per
+   level on its way down and the cost of advancing is proportional to the
+   timers that cascade or fire, not to the elapsed time. */
+typedef struct {
+    time_ms now;                                    // every timer due by now has been fired or is on the due list
+    uint64_t occupied[TIMER_WHEEL_LEVELS];          // non-empty slots per level
+    uint16_t head[TIMER_WHEEL_LISTS];
+    uint16_t due_tail;
+    uint16_t free_head;
+    uint16_t count;
+    timer_entry entries[TIMER_WHEEL_CAPACITY];
+} timer_wheel;
+
+
+typedef void (*timer_fire_fn)(void *ctx, const timer_event *event);
+
+
+/**
+ * Initialise an empty timer wheel at time `now`.
+ *
+ * @param wheel Timer wheel to initialise.
+ * @param now   Current system time in milliseconds.
+ */
+void timer_wheel_init(timer_wheel *wheel, time_ms now);
+
+
+/**
+ * Schedule a timer for event->expires_at.
+ *
+ * A timer already due fires on the next timer_wheel_advance(). Runs in
+ * constant time and may be called from a fire callback.
+ *
+ * @param wheel Timer wheel to schedule on.
+ * @param event Event delivered when the timer fires; copied.
+ * @return Handle for timer_wheel_cancel(), or TIMER_NONE if the wheel is full.
+ */
+timer_handle timer_wheel_schedule(timer_wheel *wheel, const timer_event *event);
+
+
+/**
+ * Cancel a pending timer and set *handle to TIMER_NONE.
+ *
+ * A handle of TIMER_NONE is ignored. The owner must clear its handle when
+ * the timer fires, as handles are reused. Runs in constant time.
+ *
+ * @param wheel  Timer wheel holding the timer.
+ * @param handle Handle returned by timer_wheel_schedule().
+ */
+void timer_wheel_cancel(timer_wheel *wheel, timer_handle *handle);
+
+
+/**
+ * Advance the wheel to `now`, firing every timer due by then in expiry order.
+ *
+ * Each timer is freed before its callback runs, so the callback may cancel
+ * or schedule timers, including ones already due.
+ *
+ * @param wheel Timer wheel to advance.
+ * @param now   Current system time in milliseconds; must not go backwards.
+ * @param fire  Callback invoked once per expired timer.
+ * @param ctx   Passed through to the callback.
+ * @return Number of timers fired.
+ */
+uint16_t timer_wheel_advance(timer_wheel *wheel, time_ms now, timer_fire_fn fire, void *ctx);
+
+
+/**
+ * Expiry of the earliest pending timer, or UINT32_MAX if there is none.
+ *
+ * The result may be at or before wheel->now if a due timer has not been
+ * fired yet. Does not mutate the wheel.
+ */
+time_ms timer_wheel_next_expiry(const timer_wheel *wheel);
+
+
+#endif // TIMER_WHEEL_H
@@ -4,8 +4,12 @@
 #include "../include/types.h"
 #include "../include/task_pool.h"
 #include "../include/task_domain.h"
+#include "../include/sched_score.h"
 
 #include <stdbool.h>
+#include <stdint.h>
+
+
 
 
 typedef enum {
@@ -32,21 +36,48 @@ typedef struct {
 } scheduler_config;
 
 
+/* Task scores are piecewise linear in time: the age and urgency terms grow
+   at a fixed rate and then saturate. The rates and saturation spans are
+   derived from the config once at init, so scoring is a clamp and an
+   integer multiply-add per term. Every field is a sched_key or a time, so
+   scoring is exact and uses no float operations in any build. */
+typedef struct {
+    sched_key age_rate;             // key per ms of task age, before the age cap
+    sched_key urgency_rate;         // key per ms overdue, before the urgency cap
+    time_ms age_span_ms;            // age at which the age term saturates
+    time_ms urgency_span_ms;        // overdue time at which the urgency term saturates
+
+    sched_key base_term[TASK_NOT_APPLICABLE];      // base_priority_weight * TASK_BASE_PRIORITY[kind]
+    sched_key ignore_penalty;                      // score lost per ignore
+    sched_key preempt_delta;
+    sched_key zone_batch_bonus[TASK_NOT_APPLICABLE][TASK_NOT_APPLICABLE];    // by from and to kind, scaled for batch compatibility
+    sched_key cross_zone_penalty;
+} scheduler_score_model;
+
+
 typedef struct {
     scheduler_config cfg;
+    scheduler_score_model model;
 
     bool has_active_task;
     task_id active_task_id;
     time_ms task_active_since;
 
-    uint8_t pending_count;          // eligible tasks excluding the active task
-    uint8_t critical_count;         // pending tasks whose score exceeds active + preempt_delta
+    uint16_t pending_count;         // eligible tasks excluding the active task
+    uint16_t critical_count;        // pending tasks whose score exceeds active + preempt_delta
     task_id top_critical_id;        // highest-scoring critical pending task
+
+    bool rank_built;                // the pool's ranking tree is this scheduler's
+    bool rank_tracking;             // and keeps the critical set against rank_basis
+    task_id rank_basis;             // active task the tree ranks against
+
+    bool record_decisions;          // write ticks to the decision trace, a single-writer ring
 } scheduler;
 
 
 /**
  * Initialise a scheduler instance, applying defaults for any zero-valued config fields.
+ * Decisions are recorded; clear record_decisions on every instance but one.
  */
 void scheduler_init(scheduler *scheduler, const scheduler_config *config);
 
@@ -58,6 +89,18 @@ void scheduler_init(scheduler *scheduler, const scheduler_config *config);
  * stale handle, or ineligible task).  The pending-task cache is refreshed
  * every tick; critical_count reflects tasks that exceed the switch-prompt
  * threshold relative to the current active task.
+ *
+ * Only the ready queue is considered. Suppressed tasks must be returned to
+ * it by the caller when their suppression expires.
+ *
+ * Ranking is incremental: a kinetic tournament tree kept in the pool holds
+ * the best task and the critical set against the active task, and each
+ * node knows the earliest time its result can change. A tick re-ranks only
+ * the slots on the pool's changed list and the nodes whose time has come,
+ * so a change costs O(log n). The whole tree is rebuilt, in O(n), when the
+ * active task changes or its own score is updated. One scheduler ranks a
+ * given pool, and every change to a task's score inputs must be filed with
+ * task_pool_sync().
  */
 void scheduler_tick(scheduler *scheduler_instance, task_pool *pool, time_ms current_time);
 
@@ -69,4 +112,89 @@ void scheduler_tick(scheduler *scheduler_instance, task_pool *pool, time_ms curr
 void scheduler_force_active(scheduler *s, task_id id, time_ms now);
 
 
+/**
+ * Raw score of a task at `now`: base priority plus the age and urgency
+ * terms, less the ignore penalty. Excludes any zone adjustment.
+ *
+ * scheduler_task_key() is the same score as the scheduler ranks it,
+ * exact and identical in every build; scheduler_task_score() converts it
+ * for reporting.
+ */
+sched_key scheduler_task_key(const scheduler *s, const task *t, time_ms now);
+
+sched_score scheduler_task_score(const scheduler *s, const task *t, time_ms now);
+
+
+/**
+ * Zone-batch adjustment for moving from a task of from_kind at from_table
+ * to a task of to_kind at to_table: the batch bonus within a zone, the
+ * cross-zone penalty between zones, zero when either table is unzoned.
+ * As a key, and converted for reporting.
+ */
+sched_key scheduler_transition_key(const scheduler *s,
+                                   uint8_t from_table, task_kind from_kind,
+                                   uint8_t to_table, task_kind to_kind);
+
+sched_score scheduler_transition_adjustment(const scheduler *s,
+                                            uint8_t from_table, task_kind from_kind,
+                                            uint8_t to_table, task_kind to_kind);
+
+
+/**
+ * Least and greatest scheduler_transition_key() over every pair of tables
+ * and kinds, so callers can tell when a zone adjustment cannot change an
+ * order of raw scores.
+ */
+void scheduler_transition_key_bounds(const scheduler *s, sched_key *min, sched_key *max);
+
+
+/**
+ * Predict when the switch prompt will next appear.
+ *
+ * Solves the piecewise-linear score lines of the active task and every
+ * pending or suppressed task for the earliest time at which a challenger's
+ * raw score exceeds the active score plus preempt_delta, with the minimum
+ * dwell time satisfied. The result assumes no task, table or user event
+ * occurs in between; callers should re-query after any such change.
+ *
+ * This function does not mutate the scheduler or pool and runs in time
+ * proportional to the number of pending and suppressed tasks.
+ *
+ * @param s Scheduler instance.
+ * @param pool Task pool the scheduler ranks.
+ * @param now Current system time in milliseconds.
+ * @param out_time Receives the predicted switch time (>= now).
+ * @param out_id Optional, receives the challenger that triggers the prompt.
+ * @return true if a switch prompt is predicted, false if none will occur
+ *         (no active task, or no challenger can overtake it).
+ */
+bool scheduler_predict_next_switch(const scheduler *s, const task_pool *pool, time_ms now,
+                                   time_ms *out_time, task_id *out_id);
+
+
+/**
+ * Earliest time after `now` at which a scheduler_tick() with no intervening
+ * events could produce a different result.
+ *
+ * Covers the end of the minimum dwell time and every pending task's next
+ * score breakpoint (age cap, time limit, urgency cap).
+ * It also covers the point within the current segment where a pending task
+ * crosses the switch-prompt threshold, in either direction, or overtakes
+ * another in the critical set. Waking at the returned time and finding
+ * nothing changed is harmless; sleeping past it is not.
+ *
+ * Read from the root of the ranking tree in O(1). If tasks have changed
+ * since the last tick, returns now + 1 so the caller ticks again.
+ *
+ * Suppression expiry is not included: scheduler_tick() does not wake
+ * suppressed tasks, so the caller times those itself.
+ *
+ * Call after scheduler_tick(). Does not mutate the scheduler or pool.
+ *
+ * @return Absolute time in milliseconds, or UINT32_MAX if nothing can
+ *         change without an external event.
+ */
+time_ms scheduler_next_change(const scheduler *s, const task_pool *pool, time_ms now);
+
+
 #endif
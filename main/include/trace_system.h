@@ -3,16 +3,291 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "../include/types.h"
 #include "../include/table_fsm.h"
 #include "../include/task_pool.h"
 #include "../include/trace_scheduler.h"
+#include "../include/staff_scheduler.h"
+#include "../include/timer_wheel.h"
+#include "../include/event_journal.h"
 
 
+/* Table capacity; trace_system_init() takes how many are in use. The device
+   keeps 24, the size the UI is laid out for. Host builds may raise it with
+   -DMAX_TABLES=n, together with SYSTEM_TASK_CAPACITY, TIMER_WHEEL_CAPACITY
+   and FLOOR_MAX_TABLES. */
+#ifndef MAX_TABLES
 #define MAX_TABLES      24
+#endif
+#ifndef SYSTEM_TASK_CAPACITY
+#define SYSTEM_TASK_CAPACITY    32      // task pool slots: one live task per busy table plus completed/killed headroom
+#endif
+
+_Static_assert(MAX_TABLES < TASK_POOL_MAX_TABLES, "table numbers are uint8_t and 0xFF means no table");
+_Static_assert(SYSTEM_TASK_CAPACITY < UINT8_MAX, "image slots are uint8_t and 0xFF means no active task");
+
+
+/* Invariant checking after every system call, chosen at build time with
+   -DSYSTEM_CHECK_LEVEL=n. Below FULL each call checks the tables touched
+   since the last call plus a rotating sample, within a fixed budget, so
+   the whole system is still covered every few calls. */
+#define SYSTEM_CHECK_OFF        0       // compiled out
+#define SYSTEM_CHECK_COUNT      1       // budgeted, violations counted only
+#define SYSTEM_CHECK_LOG        2       // budgeted, violations counted and logged
+#define SYSTEM_CHECK_FULL       3       // every table and slot on every call, logged
+
+#ifndef SYSTEM_CHECK_LEVEL
+#define SYSTEM_CHECK_LEVEL      SYSTEM_CHECK_COUNT
+#endif
+
+#define SYSTEM_CHECK_TABLE_BUDGET   4   // tables checked per call, touched ones first
+#define SYSTEM_CHECK_SLOT_BUDGET    8   // task pool slots checked per call
+
+
+/* Waiters assigned tasks by staff_scheduler, chosen at build time with
+   -DSYSTEM_STAFF_COUNT=n (at most MAX_STAFF). 0 compiles it out. Otherwise
+   every scheduler run also re-solves the assignment, after the single
+   operator's scheduler, which still picks the task the device shows. */
+#ifndef SYSTEM_STAFF_COUNT
+#define SYSTEM_STAFF_COUNT      0
+#endif
+
+_Static_assert(SYSTEM_STAFF_COUNT <= MAX_STAFF, "SYSTEM_STAFF_COUNT past MAX_STAFF; raise MAX_STAFF too");
+
+
+typedef enum {
+    SYSTEM_INVARIANT_MISSING_TASK = 0,  // table state calls for a task, none is live and none was killed by ignores
+    SYSTEM_INVARIANT_STALE_TASK,        // table has a live task its state does not call for
+    SYSTEM_INVARIANT_READY_QUEUE,       // eligible task not queued, or queue size != eligible count
+    SYSTEM_INVARIANT_SUPPRESS_TIMER,    // suppressed task with no wake-up timer
+    SYSTEM_INVARIANT_POOL_INDEX,        // task_pool_check_indexes() found inconsistencies
+    SYSTEM_INVARIANT_ACTIVE_TASK,       // scheduler's active task is stale or not eligible
+    SYSTEM_INVARIANT_ACTIVE_SET,        // table in the active set iff not IDLE, see system_get_active_tables()
+    SYSTEM_INVARIANT_COUNT,
+} system_invariant;
+
+
+typedef struct {
+    uint32_t runs;                              // checker calls
+    uint32_t sweeps;                            // completed passes over every pool slot
+    uint32_t violations;                        // all kinds, since boot
+    uint32_t by_kind[SYSTEM_INVARIANT_COUNT];
+    uint8_t  last_kind;                         // system_invariant of the latest violation
+    uint8_t  last_table;                        // its table, 0xFF if not table-specific
+} system_check_stats;
+
+/* Compact copy of the live system state, enough to rebuild it after a
+   warm reset (see warm_restart.h). Live tasks are stored with their slot,
+   and every slot's generation and the free list order with them, so task
+   ids and slot-order tie-breaks come back unchanged. Timers, the pool's
+   indexes and the scheduler's counts are derived again on restore. */
+#define SYSTEM_IMAGE_MAGIC      0x54524345u     // "TRCE"
+#define SYSTEM_IMAGE_VERSION    3               // bump when any system_image_* layout changes
+#define SYSTEM_IMAGE_NO_ACTIVE  0xFF
+
+#define SYSTEM_IMAGE_TABLE_TASK_KILLED  0x01    // the table's task was ignored until killed, see killed_task_tables
+
+
+typedef struct {
+    uint8_t state;                  // table_state
+    uint8_t prev_state;
+    uint8_t flags;                  // SYSTEM_IMAGE_TABLE_*
+    time_ms state_entered_at;
+} system_image_table;
+
+
+typedef struct {
+    uint8_t slot;                   // pool slot index
+    uint8_t table_number;
+    uint8_t kind;                   // task_kind
+    uint8_t status;                 // TASK_ELIGIBLE or TASK_SUPPRESSED, dead tasks are dropped
+    uint8_t ignore_count;
+    uint8_t overdue_level;
+    time_ms created_at;
+    time_ms time_limit;
+    time_ms suppress_until;         // 0 when never suppressed
+} system_image_task;
+
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;                  // sizeof(system_image), catches layout changes between builds
+    uint32_t sequence;              // set by the caller, e.g. to pick the newer of two images
+    uint16_t table_count;           // tables in use; restore needs the same count
+    uint16_t reserved;
+    time_ms  captured_at;           // clock at capture; restore shifts every time by (now - captured_at)
+    time_ms  active_since;
+    uint8_t  slot_count;            // pool capacity; task_count + free_count slots
+    uint8_t  task_count;
+    uint8_t  free_count;
+    uint8_t  active_index;          // into tasks, SYSTEM_IMAGE_NO_ACTIVE if none
+
+    system_image_table tables[MAX_TABLES];             // first table_count in use
+    system_image_task  tasks[SYSTEM_TASK_CAPACITY];     // ready queue order, then suppressed
+    uint8_t  free_slots[SYSTEM_TASK_CAPACITY];          // free list order
+    uint16_t generations[SYSTEM_TASK_CAPACITY];         // by slot index
+
+    uint32_t crc;                   // esp_rom_crc32_le over every byte before it
+} system_image;
+
+
+typedef struct {
+    uint8_t table_index;
+    uint8_t event;                  // fsm_transition_event
+} system_table_event;
+
+
+/* Every event the system journals, with the arguments event_journal_record()
+   takes. A context hands them to its hook as they happen, on the calling
+   thread; the firmware's hook is the flash journal. */
+typedef void (*system_event_hook)(void *user, journal_event_type type, uint8_t table, uint8_t arg, time_ms now);
+
+
+typedef struct {
+    timer_handle unsuppress;
+    timer_handle overdue;
+    timer_handle critical;
+} system_task_timers;
+
+
+/* One complete trace system: a floor's tables, their tasks, the scheduler
+   and every timer, with nothing kept outside it. Contexts share only the
+   floor layout, which they read, so separate contexts can run on separate
+   threads, e.g. many simulated restaurants on a host, or one per section
+   on a device. Calls on one context must come from one thread at a time.
+
+   Fields are private to trace_system.c. The task pool points into
+   pool_arena, so a context must not be copied or moved once initialised;
+   capture and restore an image instead. */
+typedef struct {
+    uint16_t      table_count;                  // tables in use, see trace_system_ctx_init()
+    table_context tables[MAX_TABLES];
+    task_pool     pool;
+    uint8_t       pool_arena[TASK_POOL_ARENA_SIZE(SYSTEM_TASK_CAPACITY, MAX_TABLES)];
+    scheduler     sched;
+#if SYSTEM_STAFF_COUNT > 0
+    staff_scheduler staff;                      // see SYSTEM_STAFF_COUNT
+#endif
+
+    /* Every time-triggered transition is a timer on this wheel; nothing polls the clock. */
+    timer_wheel        timers;
+    system_task_timers task_timers[SYSTEM_TASK_CAPACITY];  // by pool slot
+    timer_handle       table_checkin_timers[MAX_TABLES];
+    timer_handle       scheduler_recheck_timer;
+
+    /* Active set, see system_get_active_tables() */
+    uint8_t  active_tables[MAX_TABLES];
+    uint8_t  active_table_pos[MAX_TABLES];      // table -> position in active_tables, UINT8_MAX if IDLE
+    uint16_t active_table_count;
+
+    system_check_stats check_stats;
+    /* Bit per busy table whose task was ignored until killed. It gets no
+       new task until its state changes, which clears the bit. */
+    uint32_t killed_task_tables[(MAX_TABLES + 31) / 32];
+
+    uint32_t check_touched_tables[(MAX_TABLES + 31) / 32];  // bit per table changed since it was last checked
+    uint16_t check_table_cursor;                            // into active_tables
+    uint16_t check_slot_cursor;
+
+    system_event_hook event_hook;               // NULL: events are dropped
+    void             *event_hook_user;
+    bool              record_decisions;         // scheduler decisions go to the decision trace
+} trace_system_ctx;
+
+
+/* ------------------------------------------------------------------ */
+/* Context API                                                         */
+/*   trace_system_ctx_* and system_ctx_* behave exactly as the default  */
+/*   instance functions of the same name further down, on the context  */
+/*   given. They touch no hardware: the clock is only read through the */
+/*   `now` arguments, and the journal and decision trace only through  */
+/*   the hooks set below.                                              */
+/* ------------------------------------------------------------------ */
+
+/**
+ * Initialise a context, as trace_system_init() does the default instance.
+ *
+ * Clears the event hook and turns decision recording off. Loads the
+ * default floor layout if none is loaded yet; the layout is shared by every
+ * context and only read after that, so load it, or initialise a first
+ * context, before starting others on other threads.
+ *
+ * @param ctx         Context to initialise, fully overwritten.
+ * @param config      As for trace_system_init().
+ * @param table_count As for trace_system_init().
+ * @param now         Current time, where the timer wheel starts.
+ * @return As for trace_system_init(); ctx is untouched when false.
+ */
+bool trace_system_ctx_init(trace_system_ctx *ctx, const scheduler_config *config, uint16_t table_count, time_ms now);
+
+/**
+ * Send the context's journal events to `hook`, NULL to drop them. Kept by
+ * system_ctx_restore_image(), cleared by trace_system_ctx_init().
+ */
+void system_ctx_set_event_hook(trace_system_ctx *ctx, system_event_hook hook, void *user);
 
-extern table_context table_fsm_instances[MAX_TABLES];
+/**
+ * Have the context's scheduler write its decisions to the decision trace
+ * (see decision_trace.h). The trace is one ring with a single writer, so
+ * at most one context may have this on. Kept like the event hook.
+ */
+void system_ctx_set_record_decisions(trace_system_ctx *ctx, bool record);
+
+/**
+ * Reinitialise the waiters with `config`, all on shift and idle; they are
+ * assigned tasks again on the next scheduler run. trace_system_ctx_init()
+ * and system_ctx_restore_image() start them with the defaults, since
+ * assignments are not part of the image. No-op when SYSTEM_STAFF_COUNT is 0.
+ */
+void system_ctx_set_staff_config(trace_system_ctx *ctx, const staff_scheduler_config *config);
+
+// Waiter's assigned task, INVALID_TASK_ID if idle, off shift, or out of range
+task_id system_ctx_get_staff_task(const trace_system_ctx *ctx, uint8_t staff_index);
+
+// Put a waiter on or off shift and re-solve the assignment; going off releases their task
+void system_ctx_set_staff_on_shift(trace_system_ctx *ctx, uint8_t staff_index, bool on_shift, time_ms now);
+
+void system_ctx_apply_table_fsm_event(trace_system_ctx *ctx, uint8_t table_index, fsm_transition_event ev,
+                                      time_ms current_time_ms);
+uint16_t system_ctx_apply_events(trace_system_ctx *ctx, const system_table_event *batch, uint16_t count,
+                                 time_ms current_time_ms);
+bool system_ctx_apply_user_action_to_task(trace_system_ctx *ctx, task_id shown_task_id, user_action action,
+                                          time_ms current_time_ms);
+bool system_ctx_undo_task_ignore(trace_system_ctx *ctx, task_id id, uint8_t prev_ignore_count,
+                                 time_ms prev_suppress_until, time_ms now);
+void trace_system_ctx_tick(trace_system_ctx *ctx, time_ms current_time_ms);
+void system_ctx_force_active_task(trace_system_ctx *ctx, task_id id, time_ms now);
+
+table_state system_ctx_get_table_state(const trace_system_ctx *ctx, uint8_t table_index);
+uint16_t system_ctx_get_table_count(const trace_system_ctx *ctx);
+uint16_t system_ctx_get_active_tables(const trace_system_ctx *ctx, const uint8_t **tables);
+const table_context *system_ctx_get_table(const trace_system_ctx *ctx, uint8_t table_index);
+task_id system_ctx_get_active_task_id(const trace_system_ctx *ctx);
+const task *system_ctx_get_active_task(const trace_system_ctx *ctx);
+task *system_ctx_get_current_task_pointer_for_table(trace_system_ctx *ctx, uint8_t table_index);
+task_kind system_ctx_get_current_task_kind_for_table(const trace_system_ctx *ctx, uint8_t table_index);
+uint16_t system_ctx_get_pending_count(const trace_system_ctx *ctx);
+uint16_t system_ctx_get_critical_pending_count(const trace_system_ctx *ctx);
+const task *system_ctx_get_top_critical_task(const trace_system_ctx *ctx);
+bool system_ctx_predict_next_switch(const trace_system_ctx *ctx, time_ms now, time_ms *out_time, task_id *out_id);
+const system_check_stats *system_ctx_get_check_stats(const trace_system_ctx *ctx);
+time_ms system_ctx_next_deadline(const trace_system_ctx *ctx, time_ms now);
+
+void system_ctx_capture_image(const trace_system_ctx *ctx, system_image *image, uint32_t sequence, time_ms now);
+bool system_ctx_restore_image(trace_system_ctx *ctx, const system_image *image, size_t size,
+                              const scheduler_config *config, uint16_t table_count, time_ms now);
+
+
+/* ------------------------------------------------------------------ */
+/* Default instance                                                    */
+/*   The firmware runs one context, owned by the sched_tick task (see  */
+/*   system_command.h), journaling to flash and recording decisions.   */
+/*   These wrap the context API on it, reading the clock where the     */
+/*   context takes `now`.                                              */
+/* ------------------------------------------------------------------ */
 
 
 /**
@@ -23,12 +298,17 @@ extern table_context table_fsm_instances[MAX_TABLES];
  * pool and scheduler using the provided configuration.
  *
  * This function must be called once during system startup before any
- * table events or scheduler ticks are processed.
+ * table events or scheduler ticks are processed. Events go to the event
+ * journal and scheduler decisions to the decision trace.
  *
- * @param config Optional scheduler configuration. If NULL, default
- *               scheduler parameters are used.
+ * @param config      Optional scheduler configuration. If NULL, default
+ *                    scheduler parameters are used.
+ * @param table_count Tables in use, numbered 0..table_count-1, at most
+ *                    MAX_TABLES; 0 means MAX_TABLES. The snapshot and the
+ *                    notification bus carry every one of them.
+ * @return false, initialising nothing, if table_count exceeds MAX_TABLES.
  */
-void trace_system_init(const scheduler_config *cfg);
+bool trace_system_init(const scheduler_config *cfg, uint16_t table_count);
 
 
 /**
@@ -51,6 +331,26 @@ void trace_system_init(const scheduler_config *cfg);
 void system_apply_table_fsm_event(uint8_t table_index, fsm_transition_event ev, time_ms current_time_ms);
 
 
+/**
+ * Apply a batch of table FSM events, in order, with one reschedule.
+ *
+ * Every event goes through its table's FSM as it would one at a time, so
+ * the states reached are the same. Events that cause no transition, such
+ * as a POS message delivered twice, drop out there. A table that moves
+ * several times has its tasks replaced once, for the state it ends in,
+ * so a superseded state never gets a task. Dead tasks are reaped once,
+ * then the scheduler and the invariant checks run once for the batch.
+ *
+ * Invalid table indices are logged and skipped.
+ *
+ * @param batch           Events, applied in array order.
+ * @param count           Events in the batch.
+ * @param current_time_ms Current system time in milliseconds.
+ * @return                Transitions taken.
+ */
+uint16_t system_apply_events(const system_table_event *batch, uint16_t count, time_ms current_time_ms);
+
+
 /**
  * Apply a user-initiated action to the scheduling system and propagate
  * any resulting domain state changes.
@@ -67,19 +367,35 @@ bool system_apply_user_action_to_task(task_id shown_task_id, user_action action,
 table_state system_get_table_state(uint8_t table_index);
 
 
+// Tables in use, as given to trace_system_init(). Fixed from then on, so any task may read it.
+uint16_t system_get_table_count(void);
+
+
+/**
+ * The tables that are not IDLE, in no particular order.
+ *
+ * Kept up to date on every transition into and out of IDLE, so per-table
+ * work costs O(busy tables) however many tables the floor has. Owner only;
+ * the list is valid until the next system call.
+ *
+ * @param tables Set to the table numbers.
+ * @return How many there are.
+ */
+uint16_t system_get_active_tables(const uint8_t **tables);
+
+
 /**
  * Advance the trace system by one scheduling tick.
  *
- * Iterates over all table FSM instances, allowing each to perform any
- * time-based state transitions. If a table FSM changes state as a result
- * of the tick, tasks derived from the new state are admitted or updated
- * accordingly. After all table FSMs have been processed, the scheduler
- * is advanced to potentially select or update the active task.
+ * Fires every system timer due by current_time: suppression expiry,
+ * overdue and critically-overdue marks, DINING check-ins and scheduler
+ * rechecks. If a table FSM changes state as a result, tasks derived from
+ * the new state are admitted or updated accordingly. If anything fired,
+ * the scheduler is advanced to potentially select or update the active task.
  *
- * This function is intended to be called periodically from a timer or
- * scheduler context. It performs no blocking operations, does not sleep
- * or delay, and completes in bounded time proportional to the number of
- * tables and active tasks.
+ * The other system_* entry points fire due timers themselves, so this only
+ * needs calling at system_next_deadline(). It performs no blocking
+ * operations and costs O(timers fired) when nothing else changes.
  *
  * @param current_time Current system time in milliseconds, used for
  *                     FSM timing and scheduler decisions.
@@ -87,7 +403,7 @@ table_state system_get_table_state(uint8_t table_index);
 void trace_system_tick(time_ms current_time_ms);
 
 
-// Read-only accessors for UI
+// Accessors for the owner task and system_snapshot_publish(); other tasks read the snapshot
 const table_context *system_get_table(uint8_t table_index);
 
 task_id system_get_active_task_id(void);
@@ -100,12 +416,78 @@ task *system_get_current_task_pointer_for_table(uint8_t table_index);
 
 task_kind system_get_current_task_kind_for_table(uint8_t table_index);
 
-uint8_t system_get_pending_count(void);
+uint16_t system_get_pending_count(void);
 
-uint8_t system_get_critical_pending_count(void);
+uint16_t system_get_critical_pending_count(void);
 
 const task *system_get_top_critical_task(void);
 
 void system_force_active_task(task_id id, time_ms now);
 
+// Time at which the switch prompt is next expected, see scheduler_predict_next_switch().
+bool system_predict_next_switch(time_ms now, time_ms *out_time, task_id *out_id);
+
+// Waiters, see SYSTEM_STAFF_COUNT and system_ctx_get_staff_task()
+task_id system_get_staff_task(uint8_t staff_index);
+
+void system_set_staff_on_shift(uint8_t staff_index, bool on_shift, time_ms now);
+
+// Invariant checker counters; all zero when SYSTEM_CHECK_LEVEL is SYSTEM_CHECK_OFF.
+const system_check_stats *system_get_check_stats(void);
+
+const char *system_invariant_to_str(system_invariant kind);
+
+/**
+ * Capture the live system state into `image`, sealed with a CRC.
+ *
+ * Owner only, between system calls. O(table_count + pool slots), no allocation.
+ *
+ * @param image    Destination, fully overwritten.
+ * @param sequence Stored as is in image->sequence.
+ * @param now      Current time, stored as captured_at.
+ */
+void system_capture_image(system_image *image, uint32_t sequence, time_ms now);
+
+
+/**
+ * Check an image's header, size, CRC and field ranges without applying it.
+ *
+ * @param image Candidate image, possibly garbage from uninitialised memory.
+ * @param size  Bytes actually available at `image`; shorter than
+ *              sizeof(system_image) is rejected as truncated.
+ * @return true if the image is intact and internally consistent. Restore
+ *         can still refuse it if the pool capacity differs.
+ */
+bool system_image_valid(const system_image *image, size_t size);
+
+
+/**
+ * Initialise the trace system, then rebuild the state held in `image`.
+ *
+ * Every stored time is shifted by (now - captured_at), so deadlines keep
+ * the distance they had at capture and the time spent in the reset is not
+ * charged to any table or task. Tasks return to their slots under their
+ * old ids; task timers, table check-ins and the scheduler's counts are
+ * recomputed as if each task had just been admitted with its stored fields.
+ *
+ * If the image is not valid the system is left freshly initialised, as
+ * after trace_system_init() alone. A table count trace_system_init() would
+ * reject is rejected here too, and nothing is initialised.
+ *
+ * @param image       Image from system_capture_image(), possibly from before a reset.
+ * @param size        Bytes available at `image`, see system_image_valid().
+ * @param config      As for trace_system_init().
+ * @param table_count As for trace_system_init(); an image captured with a
+ *                    different count is not restored.
+ * @param now         Current time on the clock the system runs on from here.
+ * @return true if the image was restored, false on a cold start.
+ */
+bool system_restore_image(const system_image *image, size_t size, const scheduler_config *config,
+                          uint16_t table_count, time_ms now);
+
+
+// Earliest time trace_system_tick() can change anything without an external event,
+// UINT32_MAX if never: the next expiry on the system timer wheel.
+time_ms system_next_deadline(time_ms now);
+
 #endif
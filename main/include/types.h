@@ -4,13 +4,28 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+
+/* Host replay builds define TRACE_VIRTUAL_CLOCK and drive virtual_clock_us
+   themselves, so the core never reads the hardware timer. */
+#ifdef TRACE_VIRTUAL_CLOCK
+extern int64_t virtual_clock_us;
+#else
 #include "esp_timer.h"
+#endif
 
 
 typedef uint32_t time_ms;
 
+static inline int64_t clock_now_us(void) {
+#ifdef TRACE_VIRTUAL_CLOCK
+    return virtual_clock_us;
+#else
+    return esp_timer_get_time();
+#endif
+}
+
 static inline time_ms get_time() {
-    return (time_ms)(esp_timer_get_time() / 1000ULL);
+    return (time_ms)(clock_now_us() / 1000ULL);
 }
 
 static inline time_ms get_time_elapsed(time_ms start_of_task) {
@@ -7,6 +7,7 @@
 
 #include "../include/display_util.h"
 #include "../include/table_fsm.h"
+#include "../include/system_snapshot.h"
 #include "../include/types.h"
 
 
@@ -19,6 +20,8 @@ enum {
     TABLES_PER_PAGE = 9
 };
 
+_Static_assert(NUM_OF_TABLES <= MAX_TABLES, "the grid shows tables the snapshot does not carry");
+
 
 /* ---- Layout / dimension constants ---- */
 enum {
@@ -92,6 +95,8 @@ enum {
     UI_SLEEP_CORNER_MAX_Y = 40,
     UI_SLEEP_HOLD_MS      = 1000,
     UI_INACTIVITY_SLEEP_MS = 30000,
+    UI_SWITCH_PREWAKE_MS  = 2000,       // light a sleeping display this long before a predicted switch prompt
+    UI_POLL_MS            = 50,         // touch poll period, the longest the UI loop waits
 
     UI_UNDO_TIMEOUT_MS    = 5000,
     UI_SWIPE_THRESHOLD    = 60,
@@ -198,12 +203,15 @@ typedef struct {
     uint8_t urgency_level;   // 0 = normal, 1 = overdue, 2 = critically overdue (>= 5 min past deadline)
     time_ms deadline;
 
-    uint8_t pending_count;          // eligible tasks other than the active task
-    uint8_t critical_count;         // pending tasks exceeding the switch-prompt threshold
+    uint8_t active_tables;          // tables whose state calls for a task
+    uint16_t pending_count;         // eligible tasks other than the active task
+    uint16_t critical_count;        // pending tasks exceeding the switch-prompt threshold
     task_id critical_task_id;       // top critical pending task
     task_kind critical_task_kind;
     uint8_t critical_table_number;
     time_ms critical_deadline;
+    time_ms switch_at;              // predicted switch prompt, 0 if none expected
+    task_id switch_task_id;         // challenger expected to raise it
 } ui_snapshot;
 
 
@@ -360,7 +368,7 @@ static inline bool state_can_request_bill(table_state state) {
 }
 
 
-static inline bool table_can_undo(const table_context *tbl) {
+static inline bool table_can_undo(const system_table_view *tbl) {
     return tbl != NULL && tbl->prev_state != TABLE_IDLE;
 }
 
@@ -17,10 +17,13 @@ void ui_draw_main_time(spi_device_handle_t display, ui_snapshot snapshot);
 rect table_tile_rect(uint8_t index);
 
 
-void ui_draw_grid(spi_device_handle_t display);
+void ui_draw_grid(spi_device_handle_t display, const system_snapshot *view);
 
+// Redraw the tiles of tables in `tables`, a table bitmap (see system_snapshot.h), that are on the current page.
+void ui_draw_grid_tiles(spi_device_handle_t display, const system_snapshot *view, const uint32_t *tables);
 
-void draw_active_table_page(spi_device_handle_t display_handle, uint8_t table_index);
+
+void draw_active_table_page(spi_device_handle_t display_handle, const system_snapshot *view, uint8_t table_index);
 
 
 void ui_draw_switch_prompt(spi_device_handle_t display, ui_snapshot snap);
@@ -8,7 +8,8 @@
 #include "../include/ui_internal.h"
 
 
-void draw_label(spi_device_handle_t display, rect r, const char *label, size_t label_len, uint16_t text_color, bool snap_left);
+void draw_label(spi_device_handle_t display, rect r, const char *label, size_t label_len, uint16_t text_color,
+                uint16_t bg_color, bool snap_left);
 
 
 void draw_filled_rect(spi_device_handle_t display,
@@ -35,7 +36,7 @@ void draw_button_take_order(spi_device_handle_t display);
 void draw_button_highlight(spi_device_handle_t display, ui_action act);
 
 
-void draw_urgency_icon(spi_device_handle_t display, rect r, size_t label_len, uint16_t color);
+void draw_urgency_icon(spi_device_handle_t display, rect r, size_t label_len, uint16_t color, uint16_t bg_color);
 
 
 void draw_battery_icon(spi_device_handle_t display, uint8_t bars);
@@ -44,10 +45,10 @@ void draw_battery_icon(spi_device_handle_t display, uint8_t bars);
 void draw_back_icon(spi_device_handle_t display);
 
 
-void restore_button(spi_device_handle_t display, ui_action act, uint8_t sel_table);
+void restore_button(spi_device_handle_t display, ui_action act, const system_table_view *sel_table);
 
 
-void draw_pending_badge(spi_device_handle_t display, uint8_t pending_count, uint8_t critical_count);
+void draw_pending_badge(spi_device_handle_t display, uint16_t pending_count, uint16_t critical_count);
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef WARM_RESTART_H
+#define WARM_RESTART_H
+
+
+#include <stdbool.h>
+
+#include "types.h"
+#include "trace_scheduler.h"
+
+
+#define WARM_RESTART_MAX_RESUMES    3           // resumes in a row before a cold start, in case the state itself crashes
+#define WARM_RESTART_STABLE_MS      60000       // uptime after which a resume counts as having held
+
+
+/**
+ * Initialise the trace system, resuming the pre-reset state when possible.
+ *
+ * After a reset that keeps RTC memory (brownout, watchdog, panic, software
+ * restart) the newest intact image saved by warm_restart_save() is restored
+ * with system_restore_image(), so tables, tasks and the active task survive
+ * with their deadlines intact. After power-on, or when neither image passes
+ * its CRC and range checks, this is trace_system_init(config, MAX_TABLES).
+ * So is the resume after WARM_RESTART_MAX_RESUMES that each reset again
+ * within WARM_RESTART_STABLE_MS, which stops a state that crashes the
+ * firmware from being restored forever.
+ *
+ * Call once at startup, in place of trace_system_init() and before the
+ * display and the tick task start.
+ *
+ * @return true if the state was resumed, false on a cold start.
+ */
+bool warm_restart_resume(const scheduler_config *config);
+
+
+/**
+ * Save the current system state to RTC memory.
+ *
+ * Owner only, after each pass that applied commands or fired timers.
+ * Writes alternate between two images, so a reset in the middle of a
+ * save still leaves the previous one intact.
+ */
+void warm_restart_save(time_ms now);
+
+
+#endif // WARM_RESTART_H
@@ -0,0 +1,95 @@
+#include "../include/decision_trace.h"
+
+#include <string.h>
+#include <stdatomic.h>
+
+#include "esp_log.h"
+
+
+#define TRACE_MASK                  (DECISION_TRACE_CAPACITY - 1)
+#define STAMP_WRITING               0u          // stamps are seq + 1, so 0 is never valid
+
+_Static_assert((DECISION_TRACE_CAPACITY & TRACE_MASK) == 0, "DECISION_TRACE_CAPACITY must be a power of two");
+
+
+typedef struct {
+    _Atomic uint32_t stamp;         // seq + 1 of the record held, STAMP_WRITING while filling
+    decision_record record;
+} trace_slot;
+
+static const char *TAG = "dtrace";
+
+static trace_slot trace_ring[DECISION_TRACE_CAPACITY];
+static _Atomic uint32_t trace_head;                 // next sequence number to write
+
+
+/* ------------------------------------------------------------------ */
+/* API                                                                 */
+/* ------------------------------------------------------------------ */
+
+void decision_trace_record(const decision_record *record) {
+    uint32_t seq = atomic_load_explicit(&trace_head, memory_order_relaxed);
+    trace_slot *slot = &trace_ring[seq & TRACE_MASK];
+
+    atomic_store_explicit(&slot->stamp, STAMP_WRITING, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->record = *record;
+    slot->record.seq = seq;
+
+    atomic_store_explicit(&slot->stamp, seq + 1, memory_order_release);
+    atomic_store_explicit(&trace_head, seq + 1, memory_order_release);
+}
+
+
+size_t decision_trace_read(uint32_t *cursor, decision_record *out, size_t max) {
+    uint32_t head = atomic_load_explicit(&trace_head, memory_order_acquire);
+    uint32_t seq = *cursor;
+    size_t copied = 0;
+
+    if (head - seq > DECISION_TRACE_CAPACITY) seq = head - DECISION_TRACE_CAPACITY;
+
+    for (; seq != head && copied < max; ++seq) {
+        trace_slot *slot = &trace_ring[seq & TRACE_MASK];
+
+        uint32_t before = atomic_load_explicit(&slot->stamp, memory_order_acquire);
+        if (before != seq + 1) continue;        // being overwritten, or already newer
+
+        out[copied] = slot->record;
+
+        atomic_thread_fence(memory_order_acquire);
+        uint32_t after = atomic_load_explicit(&slot->stamp, memory_order_relaxed);
+        if (after == before) copied++;
+    }
+
+    *cursor = seq;
+    return copied;
+}
+
+
+void decision_trace_dump_serial(void) {
+    // Dump up to the head seen on entry, so a running writer cannot keep the loop going.
+    uint32_t end = atomic_load_explicit(&trace_head, memory_order_acquire);
+    uint32_t cursor = end > DECISION_TRACE_CAPACITY ? end - DECISION_TRACE_CAPACITY : 0;
+    decision_record record;
+
+    // The cursor can pass end if the writer laps us; read() always moves it forward by at least one.
+    while ((int32_t)(end - cursor) > 0) {
+        if (decision_trace_read(&cursor, &record, 1) == 0) continue;   // slot torn or overwritten
+
+        const uint8_t *bytes = (const uint8_t *)&record;
+        char line[4 + 2 * sizeof(record) + 1];
+        char *p = line;
+
+        memcpy(p, "DTR:", 4);
+        p += 4;
+        for (size_t i = 0; i < sizeof(record); ++i) {
+            static const char hex[] = "0123456789abcdef";
+            *p++ = hex[bytes[i] >> 4];
+            *p++ = hex[bytes[i] & 0x0F];
+        }
+        *p = '\0';
+
+        ESP_LOGI(TAG, "%s", line);
+    }
+}
@@ -18,6 +18,11 @@
 
 static const char *TAG_DISPLAY = "display";
 
+/* Pixel staging for display_fill() and draw_text(), both UI task only. DMA reads it in place. */
+static uint16_t band_buffer[DISPLAY_WIDTH * PARALLEL_SPI_LINES];
+
+static display_bus_stats bus_stats;
+
 
 /* ST7789V2 init sequence */
 DRAM_ATTR static const lcd_init_cmd init_cmds[16] = {
@@ -57,6 +62,8 @@ static void send_display_cmd(spi_device_handle_t dev_handle, const uint8_t cmd,
 
     esp_err_t result = spi_device_polling_transmit(dev_handle, &transaction);
     assert(result == ESP_OK);
+    bus_stats.transactions++;
+    bus_stats.bytes++;
 }
 
 
@@ -72,6 +79,14 @@ static void send_display_data(spi_device_handle_t dev_handle, const uint8_t *dat
 
     esp_err_t result = spi_device_polling_transmit(dev_handle, &transaction);
     assert(result == ESP_OK);
+    bus_stats.transactions++;
+    bus_stats.bytes += (uint32_t)data_length;
+}
+
+
+static void acquire_bus(spi_device_handle_t dev_handle) {
+    ESP_ERROR_CHECK(spi_device_acquire_bus(dev_handle, portMAX_DELAY));
+    bus_stats.bus_acquires++;
 }
 
 
@@ -81,7 +96,7 @@ static void send_cmd_with_data(spi_device_handle_t dev_handle,
                         const uint8_t *data,
                         int data_len,
                         bool keep_active) {
-    ESP_ERROR_CHECK(spi_device_acquire_bus(dev_handle, portMAX_DELAY));
+    acquire_bus(dev_handle);
 
     send_display_cmd(dev_handle, cmd, keep_active);
     send_display_data(dev_handle, data, data_len);
@@ -152,6 +167,9 @@ static void send_lines(spi_device_handle_t spi_handle,
                                                   portMAX_DELAY);
         assert(result == ESP_OK);
     }
+    bus_stats.transactions += 6;
+    bus_stats.windows++;
+    bus_stats.bytes += 3 + 2 * 4 + DISPLAY_WIDTH * PARALLEL_SPI_LINES * sizeof(uint16_t);
 }
 
 
@@ -169,76 +187,114 @@ static void send_line_finish(spi_device_handle_t spi_handle)
 }
 
 
-/* ------------------- Text Render ------------------- */
-/* Draw a solid block (scale x scale) */
-static inline void draw_block(spi_device_handle_t display, uint16_t x, uint16_t y, uint8_t scale, uint16_t color) {
-    /* small stack buffer */
-    uint16_t line[16];
-    if (scale == 0 || scale > 4) return;
+/* Set the address window and start RAMWR; pixel data follows. The bus must be held. */
+static void open_window(spi_device_handle_t dev_handle, uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+    const uint16_t x0 = x + X_START;
+    const uint16_t y0 = y + Y_START;
+    const uint16_t x1 = x0 + w - 1;
+    const uint16_t y1 = y0 + h - 1;
 
-    for (uint8_t i = 0; i < scale; i++) line[i] = color;
+    const uint8_t caset_payload[4] = { x0 >> 8, x0 & 0xFF, x1 >> 8, x1 & 0xFF };
+    const uint8_t raset_payload[4] = { y0 >> 8, y0 & 0xFF, y1 >> 8, y1 & 0xFF };
 
-    for (uint8_t row = 0; row < scale; row++) {
-        display_write(display, x, (uint16_t)(y + row), scale, 1, line);
-    }
+    send_display_cmd(dev_handle, 0x2A, true);
+    send_display_data(dev_handle, caset_payload, sizeof(caset_payload));
+
+    send_display_cmd(dev_handle, 0x2B, true);
+    send_display_data(dev_handle, raset_payload, sizeof(raset_payload));
+
+    send_display_cmd(dev_handle, 0x2C, true);
+    bus_stats.windows++;
 }
 
 
-static void draw_char(spi_device_handle_t display, uint16_t x, uint16_t y, char c, 
-                      uint16_t color, uint8_t scale) {
-    if (scale == 0) return;
+/* ------------------- Text Render ------------------- */
+/* A string is rasterised row by row, background included, into band_buffer
+   and sent through one address window: one bus acquire and one
+   CASET/RASET/RAMWR per string, then a data transaction per band of rows,
+   a single one for UI-sized text. */
 
-    const uint8_t *glyph = get_glyph(c);
-    if (!glyph) return;
+#define GLYPH_COLUMNS   5       // font5x7 glyphs are 5 columns of 7-bit rows; CHAR_WIDTH adds the gap
 
-    // 5 columns × 7 rows
-    for (uint8_t col = 0; col < 5; col++) {
-        uint8_t bits = glyph[col];
 
-        for (uint8_t row = 0; row < 7; row++) {
-            bool char_color = (bits & (1u << row)) != 0;
+static inline uint16_t swap_rgb565(uint16_t colour) {
+    return (uint16_t)((colour << 8) | (colour >> 8));
+}
 
-        if (!char_color) {
-            continue;
-        }
 
-            // scaled pixel = filled block
-            draw_block(display,
-                       (uint16_t)(x + col * scale),
-                       (uint16_t)(y + row * scale),
-                       scale,
-                       color);
+/* One display row of a string: glyph_row of every glyph, scaled across. */
+static void rasterise_text_row(uint16_t *line, uint16_t width, const uint8_t *const *glyphs, uint16_t glyph_count,
+                               uint8_t glyph_row, uint8_t scale, uint16_t fg, uint16_t bg) {
+    uint16_t px = 0;
+
+    for (uint16_t i = 0; i < glyph_count && px < width; i++) {
+        const uint8_t *glyph = glyphs[i];
+
+        for (uint8_t col = 0; col < CHAR_WIDTH && px < width; col++) {
+            bool lit = glyph && col < GLYPH_COLUMNS && ((glyph[col] >> glyph_row) & 1u);
+            uint16_t pixel = lit ? fg : bg;
+
+            for (uint8_t s = 0; s < scale && px < width; s++) line[px++] = pixel;
         }
     }
 }
 
 
-void draw_text(spi_device_handle_t display, uint16_t x, uint16_t y, const char *text, 
-               uint16_t color, uint8_t scale) {
-    if (!text || scale == 0) return;
+void draw_text(spi_device_handle_t display, uint16_t x, uint16_t y, const char *text,
+               uint16_t color, uint16_t bg, uint8_t scale) {
+    if (!text || scale == 0 || x >= DISPLAY_WIDTH || y >= DISPLAY_HEIGHT) return;
 
-    uint16_t cx = x;
-    const uint16_t advance = (uint16_t)(CHAR_WIDTH * scale); // 5 cols + 1 space
+    size_t len = strlen(text);
+    if (len == 0) return;
 
-    while (*text) {
-        draw_char(display, cx, y, *text, color, scale);
-        cx = (uint16_t)(cx + advance);
-        text++;
-    }
-}
+    // The gap after the last character is left out, so the box is exactly the text
+    const uint16_t advance = (uint16_t)(CHAR_WIDTH * scale);
+    size_t full_width = len * advance - scale;
+    uint16_t width  = (full_width > (size_t)(DISPLAY_WIDTH - x)) ? (uint16_t)(DISPLAY_WIDTH - x) : (uint16_t)full_width;
+    uint16_t height = (uint16_t)(CHAR_HEIGHT * scale);
+    if (height > DISPLAY_HEIGHT - y) height = (uint16_t)(DISPLAY_HEIGHT - y);
+
+    // Characters clipped off the right edge are not looked up
+    const uint8_t *glyphs[DISPLAY_WIDTH / CHAR_WIDTH];
+    uint16_t glyph_count = (uint16_t)((width + advance - 1) / advance);
+    for (uint16_t i = 0; i < glyph_count; i++) glyphs[i] = get_glyph(text[i]);
 
+    const uint16_t fg = swap_rgb565(color);
+    const uint16_t back = swap_rgb565(bg);
+    const uint16_t band_rows = (uint16_t)(sizeof(band_buffer) / sizeof(band_buffer[0]) / width);
 
+    acquire_bus(display);
+    open_window(display, x, y, width, height);
+
+    for (uint16_t row = 0; row < height; row += band_rows) {
+        uint16_t rows = (height - row < band_rows) ? (uint16_t)(height - row) : band_rows;
+
+        for (uint16_t r = 0; r < rows; r++) {
+            uint16_t *line = &band_buffer[(size_t)r * width];
+            uint8_t glyph_row = (uint8_t)((row + r) / scale);
+
+            // Rows within one scaled glyph row are copies of its first
+            if (r > 0 && (row + r) % scale != 0) {
+                memcpy(line, line - width, width * sizeof(uint16_t));
+            } else {
+                rasterise_text_row(line, width, glyphs, glyph_count, glyph_row, scale, fg, back);
+            }
+        }
+
+        send_display_data(display, (const uint8_t *)band_buffer, (int)((size_t)rows * width * sizeof(uint16_t)));
+    }
+
+    spi_device_release_bus(display);
+}
 
 
 /* Full-screen clear using band writes */
 void display_fill(spi_device_handle_t dev_handle, uint16_t colour) {
-    static uint16_t band_buffer[DISPLAY_WIDTH * PARALLEL_SPI_LINES];
-
     for (int pixel_index = 0; pixel_index < DISPLAY_WIDTH * PARALLEL_SPI_LINES; pixel_index++) {
         band_buffer[pixel_index] = colour;
     }
 
-    ESP_ERROR_CHECK(spi_device_acquire_bus(dev_handle, portMAX_DELAY));
+    acquire_bus(dev_handle);
 
     for (int y = 0; y < DISPLAY_HEIGHT; y += PARALLEL_SPI_LINES) {
         send_lines(dev_handle, y, band_buffer);
@@ -321,23 +377,8 @@ void display_write(spi_device_handle_t dev_handle,
 {
     if (!pixels || w == 0 || h == 0) return;
 
-    const uint16_t x0 = x + X_START;
-    const uint16_t y0 = y + Y_START;
-    const uint16_t x1 = x0 + w - 1;
-    const uint16_t y1 = y0 + h - 1;
-
-    const uint8_t caset_payload[4] = { x0 >> 8, x0 & 0xFF, x1 >> 8, x1 & 0xFF };
-    const uint8_t raset_payload[4] = { y0 >> 8, y0 & 0xFF, y1 >> 8, y1 & 0xFF };
-
-    ESP_ERROR_CHECK(spi_device_acquire_bus(dev_handle, portMAX_DELAY));
-
-    send_display_cmd(dev_handle, 0x2A, true);
-    send_display_data(dev_handle, caset_payload, sizeof(caset_payload));
-
-    send_display_cmd(dev_handle, 0x2B, true);
-    send_display_data(dev_handle, raset_payload, sizeof(raset_payload));
-
-    send_display_cmd(dev_handle, 0x2C, true);
+    acquire_bus(dev_handle);
+    open_window(dev_handle, x, y, w, h);
 
     /* RGB565 needs byte swap on little-endian CPU */
     const size_t total_pixels = (size_t)w * (size_t)h;
@@ -352,8 +393,7 @@ void display_write(spi_device_handle_t dev_handle,
         if (chunk_pixels > swap_capacity) chunk_pixels = swap_capacity;
 
         for (size_t i = 0; i < chunk_pixels; i++) {
-            uint16_t pixel = pixels[pixels_sent + i];
-            swap_buffer[i] = (uint16_t)((pixel << 8) | (pixel >> 8));
+            swap_buffer[i] = swap_rgb565(pixels[pixels_sent + i]);
         }
 
         send_display_data(dev_handle,
@@ -364,4 +404,14 @@ void display_write(spi_device_handle_t dev_handle,
     }
 
     spi_device_release_bus(dev_handle);
-}
\ No newline at end of file
+}
+
+
+const display_bus_stats *display_get_bus_stats(void) {
+    return &bus_stats;
+}
+
+
+void display_reset_bus_stats(void) {
+    memset(&bus_stats, 0, sizeof(bus_stats));
+}
@@ -0,0 +1,439 @@
+#include "../include/event_journal.h"
+
+#include <string.h>
+#include <stdatomic.h>
+
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+
+#ifndef TRACE_VIRTUAL_CLOCK
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+
+#define RING_MASK           (EVENT_JOURNAL_RING_CAPACITY - 1)
+#define VARINT_MAX_BYTES    5
+#define DELTA_MAX           (UINT32_MAX >> EVENT_JOURNAL_TYPE_BITS)
+#define EVENT_MAX_BYTES     (VARINT_MAX_BYTES + 2)
+#define BLOCK_ALIGN         4
+#define LENGTH_ERASED       0xFFFF
+
+_Static_assert((EVENT_JOURNAL_RING_CAPACITY & RING_MASK) == 0, "EVENT_JOURNAL_RING_CAPACITY must be a power of two");
+_Static_assert(EVENT_JOURNAL_FLUSH_EVENTS <= EVENT_JOURNAL_RING_CAPACITY, "flush threshold must fit in the ring");
+_Static_assert(sizeof(event_journal_sector_header) + sizeof(event_journal_block_header) + EVENT_JOURNAL_BLOCK_MAX
+               <= EVENT_JOURNAL_SECTOR_SIZE, "a block must fit in a sector");
+
+
+static const char *TAG = "journal";
+
+
+typedef struct {
+    time_ms time;
+    uint8_t type;
+    uint8_t table;
+    uint8_t arg;
+} journal_event;
+
+
+/* ------------------------------------------------------------------ */
+/* Staging ring                                                        */
+/*   Single producer (the trace system owner) and single consumer     */
+/*   (the writer). The producer never waits: a full ring drops the    */
+/*   event and counts it.                                              */
+/* ------------------------------------------------------------------ */
+
+static journal_event staged[EVENT_JOURNAL_RING_CAPACITY];
+static _Atomic uint32_t staged_head;        // next slot the producer fills
+static _Atomic uint32_t staged_tail;        // next slot the writer drains
+
+static event_journal_stats stats;
+
+
+void event_journal_record(journal_event_type type, uint8_t table, uint8_t arg, time_ms now) {
+    uint32_t head = atomic_load_explicit(&staged_head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&staged_tail, memory_order_acquire);
+
+    if (head - tail >= EVENT_JOURNAL_RING_CAPACITY) {
+        stats.dropped++;
+        return;
+    }
+
+    staged[head & RING_MASK] = (journal_event){
+        .time  = now,
+        .type  = (uint8_t)type,
+        .table = table,
+        .arg   = arg,
+    };
+    atomic_store_explicit(&staged_head, head + 1, memory_order_release);
+    stats.recorded++;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Flash layout                                                        */
+/*   Sectors are written round robin, so erases spread evenly over    */
+/*   the partition. Sequence n always lives in sector (n - 1) % count, */
+/*   which lets a reader find any sector from the head sequence.      */
+/*   Each sector is a header then blocks, each block aligned to       */
+/*   BLOCK_ALIGN and written with a single write.                     */
+/* ------------------------------------------------------------------ */
+
+static const esp_partition_t *journal_partition;
+static uint32_t sector_count;
+static uint32_t head_sector;                // sector being written, writer only
+static _Atomic uint32_t head_seq;           // its sequence, 0 before the first sector
+static uint32_t head_offset;                // next block offset in it, writer only
+
+static uint8_t block_buffer[sizeof(event_journal_block_header) + EVENT_JOURNAL_BLOCK_MAX];
+
+
+static inline uint32_t align_block(uint32_t bytes) {
+    return (bytes + BLOCK_ALIGN - 1) & ~(uint32_t)(BLOCK_ALIGN - 1);
+}
+
+
+static inline uint32_t sector_for_seq(uint32_t seq) {
+    return (seq - 1) % sector_count;
+}
+
+
+static bool read_sector_seq(uint32_t sector, uint32_t *seq) {
+    event_journal_sector_header header;
+    if (esp_partition_read(journal_partition, (size_t)sector * EVENT_JOURNAL_SECTOR_SIZE,
+                           &header, sizeof(header)) != ESP_OK) {
+        return false;
+    }
+    if (header.magic != EVENT_JOURNAL_SECTOR_MAGIC || header.seq_check != ~header.seq || header.seq == 0) return false;
+
+    *seq = header.seq;
+    return true;
+}
+
+
+/* Read and check the block at `offset`. Returns false for an erased or
+   damaged block; *erased tells the two apart. */
+static bool read_block(uint32_t sector, uint32_t offset, event_journal_block_header *header,
+                       uint8_t *body, bool *erased) {
+    size_t base = (size_t)sector * EVENT_JOURNAL_SECTOR_SIZE + offset;
+    *erased = false;
+
+    if (offset + sizeof(*header) > EVENT_JOURNAL_SECTOR_SIZE) {
+        *erased = true;
+        return false;
+    }
+    if (esp_partition_read(journal_partition, base, header, sizeof(*header)) != ESP_OK) return false;
+
+    if (header->length == LENGTH_ERASED) {
+        *erased = true;
+        return false;
+    }
+    if (header->length > EVENT_JOURNAL_BLOCK_MAX ||
+        offset + sizeof(*header) + header->length > EVENT_JOURNAL_SECTOR_SIZE) {
+        return false;
+    }
+    if (esp_partition_read(journal_partition, base + sizeof(*header), body, header->length) != ESP_OK) return false;
+
+    return esp_rom_crc32_le(0, body, header->length) == header->crc;
+}
+
+
+// Offset after the last intact block, EVENT_JOURNAL_SECTOR_SIZE if the sector cannot take more
+static uint32_t find_sector_end(uint32_t sector) {
+    event_journal_block_header header;
+    uint32_t offset = sizeof(event_journal_sector_header);
+
+    while (1) {
+        bool erased;
+        if (!read_block(sector, offset, &header, block_buffer, &erased)) {
+            // A torn or damaged block may have programmed bytes past its header; never write over it
+            return erased ? offset : EVENT_JOURNAL_SECTOR_SIZE;
+        }
+        offset += align_block(sizeof(header) + header.length);
+    }
+}
+
+
+static bool open_next_sector(void) {
+    uint32_t sector = (head_sector + 1) % sector_count;
+    uint32_t seq = atomic_load_explicit(&head_seq, memory_order_relaxed) + 1;
+
+    esp_err_t err = esp_partition_erase_range(journal_partition, (size_t)sector * EVENT_JOURNAL_SECTOR_SIZE,
+                                              EVENT_JOURNAL_SECTOR_SIZE);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "erase of sector %lu failed: %s", (unsigned long)sector, esp_err_to_name(err));
+        return false;
+    }
+    stats.erases++;
+
+    event_journal_sector_header header = {
+        .magic     = EVENT_JOURNAL_SECTOR_MAGIC,
+        .seq       = seq,
+        .seq_check = ~seq,
+        .reserved  = UINT32_MAX,
+    };
+    err = esp_partition_write(journal_partition, (size_t)sector * EVENT_JOURNAL_SECTOR_SIZE, &header, sizeof(header));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "header write to sector %lu failed: %s", (unsigned long)sector, esp_err_to_name(err));
+        return false;
+    }
+
+    head_sector = sector;
+    head_offset = sizeof(header);
+    atomic_store_explicit(&head_seq, seq, memory_order_release);
+    stats.sector_seq = seq;
+    return true;
+}
+
+
+static bool write_block(uint32_t length) {
+    uint32_t bytes = sizeof(event_journal_block_header) + length;
+
+    if (head_offset + bytes > EVENT_JOURNAL_SECTOR_SIZE && !open_next_sector()) return false;
+
+    esp_err_t err = esp_partition_write(journal_partition,
+                                        (size_t)head_sector * EVENT_JOURNAL_SECTOR_SIZE + head_offset,
+                                        block_buffer, bytes);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "block write failed: %s", esp_err_to_name(err));
+        head_offset = EVENT_JOURNAL_SECTOR_SIZE;        // part may be programmed; resume in a fresh sector
+        return false;
+    }
+
+    head_offset += align_block(bytes);
+    stats.blocks++;
+    return true;
+}
+
+
+bool event_journal_mount(void) {
+    journal_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, EVENT_JOURNAL_SUBTYPE,
+                                                 EVENT_JOURNAL_PARTITION);
+    if (!journal_partition) {
+        ESP_LOGW(TAG, "no '%s' partition, events will not be kept", EVENT_JOURNAL_PARTITION);
+        return false;
+    }
+
+    sector_count = journal_partition->size / EVENT_JOURNAL_SECTOR_SIZE;
+    if (sector_count < 2) {
+        ESP_LOGE(TAG, "partition too small: %lu bytes", (unsigned long)journal_partition->size);
+        journal_partition = NULL;
+        return false;
+    }
+
+    uint32_t newest = 0;
+    for (uint32_t sector = 0; sector < sector_count; ++sector) {
+        uint32_t seq;
+        if (!read_sector_seq(sector, &seq)) continue;
+        if (newest == 0 || (int32_t)(seq - newest) > 0) {
+            newest = seq;
+            head_sector = sector;
+        }
+    }
+
+    if (newest != 0 && sector_for_seq(newest) == head_sector) {
+        head_offset = find_sector_end(head_sector);
+    } else {
+        // Empty, or laid out for another partition size: carry on from the next
+        // sequence that maps to sector 0, so no older sector ever looks newer
+        newest = (newest + sector_count - 1) / sector_count * sector_count;
+        head_sector = sector_count - 1;
+        head_offset = EVENT_JOURNAL_SECTOR_SIZE;
+    }
+    atomic_store_explicit(&head_seq, newest, memory_order_release);
+    stats.sector_seq = newest;
+
+    ESP_LOGI(TAG, "mounted %lu sectors, head seq=%lu sector=%lu offset=%lu",
+             (unsigned long)sector_count, (unsigned long)newest,
+             (unsigned long)head_sector, (unsigned long)head_offset);
+    return true;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Writer                                                              */
+/* ------------------------------------------------------------------ */
+
+static size_t put_varint(uint8_t *out, uint32_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+
+uint32_t event_journal_flush(time_ms now, bool force) {
+    if (!journal_partition) return 0;
+
+    uint32_t written = 0;
+
+    while (1) {
+        uint32_t tail = atomic_load_explicit(&staged_tail, memory_order_relaxed);
+        uint32_t head = atomic_load_explicit(&staged_head, memory_order_acquire);
+        uint32_t pending = head - tail;
+
+        if (pending == 0) break;
+        if (!force && pending < EVENT_JOURNAL_FLUSH_EVENTS &&
+            now - staged[tail & RING_MASK].time < EVENT_JOURNAL_FLUSH_MS) {
+            break;
+        }
+
+        event_journal_block_header *header = (event_journal_block_header *)block_buffer;
+        uint8_t *body = block_buffer + sizeof(*header);
+        uint32_t length = 0;
+        uint16_t count = 0;
+        time_ms previous = staged[tail & RING_MASK].time;
+
+        header->base_time = previous;
+        for (; count < pending && length + EVENT_MAX_BYTES <= EVENT_JOURNAL_BLOCK_MAX; ++count) {
+            const journal_event *event = &staged[(tail + count) & RING_MASK];
+            uint32_t delta = event->time - previous;
+            if (delta > DELTA_MAX) break;       // only across ~6 days of silence; starts the next block
+
+            length += put_varint(body + length, delta << EVENT_JOURNAL_TYPE_BITS | event->type);
+            body[length++] = event->table;
+            body[length++] = event->arg;
+            previous = event->time;
+        }
+        header->length = (uint16_t)length;
+        header->count  = count;
+        header->crc    = esp_rom_crc32_le(0, body, length);
+
+        // On failure the events stay staged and the next poll tries again
+        if (!write_block(length)) break;
+
+        atomic_store_explicit(&staged_tail, tail + count, memory_order_release);
+        written += count;
+        stats.written += count;
+    }
+
+    return written;
+}
+
+
+#ifndef TRACE_VIRTUAL_CLOCK
+/* Device only: host builds call event_journal_flush() themselves. */
+static void journal_task(void *arg) {
+    (void)arg;
+
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(EVENT_JOURNAL_POLL_MS));
+        event_journal_flush(get_time(), false);
+    }
+}
+
+
+void event_journal_start(bool resumed) {
+    event_journal_mount();
+    event_journal_record(JOURNAL_BOOT, EVENT_JOURNAL_NO_TABLE, resumed ? 1 : 0, get_time());
+
+    // Below the UI and tick tasks: flash erases stall only this one
+    xTaskCreate(journal_task, "journal", 3072, NULL, 2, NULL);
+}
+#endif
+
+
+/* ------------------------------------------------------------------ */
+/* Export                                                              */
+/* ------------------------------------------------------------------ */
+
+static size_t get_varint(const uint8_t *in, size_t available, uint32_t *value) {
+    uint32_t result = 0;
+    for (size_t n = 0; n < available && n < VARINT_MAX_BYTES; ++n) {
+        result |= (uint32_t)(in[n] & 0x7F) << (7 * n);
+        if (!(in[n] & 0x80)) {
+            *value = result;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+
+/* Rows (head, table, arg) to columns: all heads, then all tables, then
+   all args. Same bytes, so the same length. Returns false if malformed. */
+static bool transpose_block(const uint8_t *rows, uint32_t length, uint16_t count, uint8_t *columns) {
+    if (length < 2u * count) return false;
+
+    uint8_t *tables = columns + (length - 2u * count);
+    uint8_t *args = tables + count;
+    uint32_t in = 0;
+    uint32_t heads = 0;
+
+    for (uint16_t i = 0; i < count; ++i) {
+        uint32_t head;
+        size_t n = get_varint(rows + in, length - in, &head);
+        if (n == 0 || in + n + 2 > length) return false;
+
+        memcpy(columns + heads, rows + in, n);
+        heads += n;
+        in += n;
+        tables[i] = rows[in++];
+        args[i] = rows[in++];
+    }
+    return in == length;
+}
+
+
+size_t event_journal_export(event_journal_cursor *cursor, uint8_t *out, size_t out_size) {
+    if (!journal_partition || out_size < sizeof(event_journal_frame_header) + EVENT_JOURNAL_BLOCK_MAX) return 0;
+
+    uint32_t newest = atomic_load_explicit(&head_seq, memory_order_acquire);
+    if (newest == 0) return 0;
+
+    // Start at, or skip forward to, the oldest sector still held
+    uint32_t oldest = (newest > sector_count) ? newest - sector_count + 1 : 1;
+    if (cursor->sector_seq == 0 || (int32_t)(cursor->sector_seq - oldest) < 0) {
+        cursor->sector_seq = oldest;
+        cursor->offset = sizeof(event_journal_sector_header);
+    }
+
+    uint8_t rows[EVENT_JOURNAL_BLOCK_MAX];
+    event_journal_block_header block;
+
+    while ((int32_t)(cursor->sector_seq - newest) <= 0) {
+        uint32_t sector = sector_for_seq(cursor->sector_seq);
+        uint32_t seq;
+        bool erased = false;
+        bool valid = read_sector_seq(sector, &seq) && seq == cursor->sector_seq &&
+                     read_block(sector, cursor->offset, &block, rows, &erased);
+
+        // The writer may have erased the sector for reuse while the block was read
+        if (valid && (!read_sector_seq(sector, &seq) || seq != cursor->sector_seq)) valid = false;
+
+        if (!valid) {
+            // An erased block in the head sector is where the writer is; come back later
+            if (erased && cursor->sector_seq == atomic_load_explicit(&head_seq, memory_order_acquire)) return 0;
+
+            cursor->sector_seq++;
+            cursor->offset = sizeof(event_journal_sector_header);
+            newest = atomic_load_explicit(&head_seq, memory_order_acquire);
+            continue;
+        }
+
+        cursor->offset += align_block(sizeof(block) + block.length);
+
+        event_journal_frame_header *frame = (event_journal_frame_header *)out;
+        if (!transpose_block(rows, block.length, block.count, out + sizeof(*frame))) continue;
+
+        *frame = (event_journal_frame_header){
+            .magic      = EVENT_JOURNAL_FRAME_MAGIC,
+            .count      = block.count,
+            .length     = block.length,
+            .base_time  = block.base_time,
+            .sector_seq = cursor->sector_seq,
+        };
+        return sizeof(*frame) + block.length;
+    }
+
+    return 0;
+}
+
+
+const event_journal_stats *event_journal_get_stats(void) {
+    return &stats;
+}
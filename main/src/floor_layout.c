@@ -0,0 +1,156 @@
+#include "../include/floor_layout.h"
+
+#include <string.h>
+#include <math.h>
+
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+
+
+/* --- Built-in layout --- */
+#define DEFAULT_TABLE_COUNT         24
+#define DEFAULT_CROSS_ZONE_DM       200
+
+
+static const char *TAG = "floor";
+
+floor_layout floor_plan;
+
+
+/* ------------------------------------------------------------------ */
+/* Internal helpers                                                   */
+/* ------------------------------------------------------------------ */
+
+static void layout_clear(floor_layout *layout) {
+    memset(layout, 0, sizeof(*layout));
+    memset(layout->zone, FLOOR_ZONE_NONE, sizeof(layout->zone));
+}
+
+
+static uint16_t straight_line_dm(const floor_layout_table_record *a, const floor_layout_table_record *b) {
+    float dx = (float)a->x_dm - (float)b->x_dm;
+    float dy = (float)a->y_dm - (float)b->y_dm;
+    float d  = sqrtf(dx * dx + dy * dy) + 0.5f;
+    return (d >= (float)FLOOR_DISTANCE_UNKNOWN) ? (FLOOR_DISTANCE_UNKNOWN - 1) : (uint16_t)d;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* API                                                                 */
+/* ------------------------------------------------------------------ */
+
+void floor_layout_load_default(void) {
+    layout_clear(&floor_plan);
+    floor_plan.table_count = DEFAULT_TABLE_COUNT;
+    floor_plan.zone_count  = 2;
+
+    for (uint8_t table = 1; table < DEFAULT_TABLE_COUNT; ++table) {
+        floor_plan.zone[table] = (table >= 11 && table <= 17) ? 1 : 0;
+    }
+
+    for (uint8_t a = 0; a < DEFAULT_TABLE_COUNT; ++a) {
+        for (uint8_t b = 0; b < DEFAULT_TABLE_COUNT; ++b) {
+            bool cross = floor_plan.zone[a] != FLOOR_ZONE_NONE &&
+                         floor_plan.zone[b] != FLOOR_ZONE_NONE &&
+                         floor_plan.zone[a] != floor_plan.zone[b];
+            floor_plan.distance_dm[a][b] = cross ? DEFAULT_CROSS_ZONE_DM : 0;
+        }
+    }
+
+    floor_plan.loaded = true;
+}
+
+
+esp_err_t floor_layout_load_blob(const uint8_t *blob, size_t len) {
+    floor_layout_header header;
+
+    if (!blob || len < sizeof(header) + sizeof(uint32_t)) return ESP_ERR_INVALID_SIZE;
+    memcpy(&header, blob, sizeof(header));
+
+    if (header.magic != FLOOR_LAYOUT_MAGIC || header.version != FLOOR_LAYOUT_VERSION) {
+        ESP_LOGE(TAG, "bad layout magic/version %08lx/%u", (unsigned long)header.magic, header.version);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (header.table_count > FLOOR_MAX_TABLES) {
+        ESP_LOGE(TAG, "layout has %u tables, max %u", header.table_count, FLOOR_MAX_TABLES);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    size_t n = header.table_count;
+    size_t pairs = n ? n * (n - 1) / 2 : 0;
+    size_t body = sizeof(header) + n * sizeof(floor_layout_table_record) + pairs * sizeof(uint16_t);
+    if (len != body + sizeof(uint32_t)) {
+        ESP_LOGE(TAG, "layout size %u, expected %u", (unsigned)len, (unsigned)(body + sizeof(uint32_t)));
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint32_t crc;
+    memcpy(&crc, blob + body, sizeof(crc));
+    if (esp_rom_crc32_le(0, blob, body) != crc) {
+        ESP_LOGE(TAG, "layout crc mismatch");
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    floor_layout_table_record records[FLOOR_MAX_TABLES];
+    memcpy(records, blob + sizeof(header), n * sizeof(records[0]));
+
+    for (size_t i = 0; i < n; ++i) {
+        if (records[i].zone != FLOOR_ZONE_NONE && records[i].zone >= header.zone_count) {
+            ESP_LOGE(TAG, "table %u zone %u out of range", (unsigned)i, records[i].zone);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    /* Compile into a scratch copy so a bad blob never leaves floor_plan half-written. */
+    static floor_layout compiled;
+    layout_clear(&compiled);
+    compiled.table_count = header.table_count;
+    compiled.zone_count  = header.zone_count;
+
+    const uint8_t *dist = blob + sizeof(header) + n * sizeof(floor_layout_table_record);
+    for (size_t a = 0; a < n; ++a) {
+        compiled.zone[a] = records[a].zone;
+
+        for (size_t b = a + 1; b < n; ++b) {
+            uint16_t d;
+            memcpy(&d, dist, sizeof(d));
+            dist += sizeof(d);
+
+            if (d == FLOOR_DISTANCE_UNKNOWN) d = straight_line_dm(&records[a], &records[b]);
+            compiled.distance_dm[a][b] = d;
+            compiled.distance_dm[b][a] = d;
+        }
+    }
+
+    compiled.loaded = true;
+    floor_plan = compiled;
+
+    ESP_LOGI(TAG, "layout loaded: %u tables, %u zones", floor_plan.table_count, floor_plan.zone_count);
+    return ESP_OK;
+}
+
+
+esp_err_t floor_layout_load_from_nvs(void) {
+    static uint8_t blob[sizeof(floor_layout_header)
+                        + FLOOR_MAX_TABLES * sizeof(floor_layout_table_record)
+                        + FLOOR_MAX_TABLES * (FLOOR_MAX_TABLES - 1) / 2 * sizeof(uint16_t)
+                        + sizeof(uint32_t)];
+    size_t len = sizeof(blob);
+    nvs_handle_t handle;
+
+    esp_err_t err = nvs_open(FLOOR_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_OK) {
+        err = nvs_get_blob(handle, FLOOR_NVS_KEY, blob, &len);
+        nvs_close(handle);
+    }
+    if (err == ESP_OK) {
+        err = floor_layout_load_blob(blob, len);
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "no usable layout in NVS (%s), using built-in layout", esp_err_to_name(err));
+        floor_layout_load_default();
+    }
+    return err;
+}
@@ -10,6 +10,7 @@
 #include "driver/i2c.h"
 #include "driver/gpio.h"
 #include "esp_err.h"
+#include "nvs_flash.h"
 
 #include "../include/display_util.h"
 #include "../include/trace_system.h"
@@ -21,6 +22,10 @@
 #include "../include/haptic_driver.h"
 #include "../include/battery_monitor.h"
 #include "../include/pos_client.h"
+#include "../include/floor_layout.h"
+#include "../include/sched_tick.h"
+#include "../include/warm_restart.h"
+#include "../include/event_journal.h"
 
 
 #define SYS_EN_GPIO 41
@@ -29,20 +34,6 @@
 // #define WIFI_ENABLED
 
 
-void scheduler_tick_task(void *arg) {
-    (void)arg;
-
-    while (1) {
-        time_ms current_time_ms = get_time();
-        #ifdef WIFI_ENABLED
-            pos_client_drain_events(current_time_ms);
-        #endif
-        trace_system_tick(current_time_ms);
-        vTaskDelay(pdMS_TO_TICKS(500));
-    }
-}
-
-
 void app_main(void) {
     esp_log_level_set("trace_sched", ESP_LOG_INFO);
     esp_log_level_set("task_domain", ESP_LOG_INFO);
@@ -64,9 +55,17 @@ void app_main(void) {
     ESP_LOGW(TAG, "%d", err_no);
     ESP_LOGI(TAG, "DRV2605L init done");
     
-    /* Core scheduler setup */
+    /* Floor layout, from NVS when one has been provisioned */
+    if (nvs_flash_init() == ESP_OK) {
+        floor_layout_load_from_nvs();
+    }
+
+    /* Core scheduler setup: resumes the pre-reset state after a warm reset,
+       before the display comes up, so the first frame already shows it */
     scheduler_config system_config = {0};
-    trace_system_init(&system_config);
+    bool resumed = warm_restart_resume(&system_config);
+    event_journal_start(resumed);
+    touch_init();
 
     #ifdef WIFI_ENABLED 
         pos_client_start();
@@ -77,9 +76,8 @@ void app_main(void) {
 
     /* Display and UI */
     display_spi_ctx display_context = display_init();
-    ui_draw_grid(display_context.dev_handle);
 
-    /* Runtime tasks */
+    /* Runtime tasks: the tick task publishes the first snapshot the UI reads */
+    sched_tick_start();
     xTaskCreate(ui_task, "ui_task", 4096, &display_context, 5, NULL);
-    xTaskCreate(scheduler_tick_task, "sched_tick", 4096, NULL, 5, NULL);
 }
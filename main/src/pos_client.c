@@ -7,7 +7,6 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
-#include "freertos/queue.h"
 
 #include "nvs_flash.h"
 #include "esp_netif.h"
@@ -18,6 +17,10 @@
 #include "../include/pos_client.h"
 #include "../include/trace_system.h"
 #include "../include/table_fsm.h"
+#include "../include/decision_trace.h"
+#include "../include/event_journal.h"
+#include "../include/sched_tick.h"
+#include "../include/system_command.h"
 
 
 #define WIFI_SSID           "56ws-guest" // "Deco Wi-Fi"
@@ -26,7 +29,7 @@
 #define SERVER_PORT         5050
 
 #define RECONNECT_DELAY_MS  30000
-#define EVENT_QUEUE_LEN     16
+#define TRACE_SEND_BATCH    16
 
 #define WIFI_GOT_IP_BIT     BIT0
 
@@ -34,7 +37,12 @@
 static const char *TAG = "pos_client";
 
 static EventGroupHandle_t s_wifi_event_group;
-static QueueHandle_t      s_event_queue;
+
+static const fsm_transition_event POS_EVENT_MAP[] = {
+    [POS_CUSTOMERS_SEATED] = EVENT_CUSTOMERS_SEATED,
+    [POS_ORDER_READY]      = EVENT_POS_ORDER_READY,
+    [POS_BILL_REQUESTED]   = EVENT_TABLE_REQUESTED_BILL,
+};
 
 
 static void wifi_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data) {
@@ -85,6 +93,49 @@ static void wifi_init(void) {
 }
 
 
+/* Send every decision record since the previous dump as framed batches,
+   ending with an empty frame. Records are consumed, so each dump only
+   carries what is new. */
+static bool send_decision_trace(int sock) {
+    static uint32_t s_trace_cursor;
+    static decision_record batch[TRACE_SEND_BATCH];
+    size_t count;
+
+    do {
+        count = decision_trace_read(&s_trace_cursor, batch, TRACE_SEND_BATCH);
+
+        decision_trace_frame_header header = {
+            .magic       = DECISION_TRACE_FRAME_MAGIC,
+            .record_size = sizeof(decision_record),
+            .count       = (uint16_t)count,
+        };
+        if (send(sock, &header, sizeof(header), 0) != (int)sizeof(header)) return false;
+
+        size_t bytes = count * sizeof(decision_record);
+        if (bytes && send(sock, batch, bytes, 0) != (int)bytes) return false;
+    } while (count > 0);
+
+    return true;
+}
+
+
+/* Send the event journal, oldest block first, one columnar frame per
+   flash block, ending with an empty frame. Unlike the decision trace
+   nothing is consumed: every dump carries all the journal still holds. */
+static bool send_event_journal(int sock) {
+    static uint8_t frame[sizeof(event_journal_frame_header) + EVENT_JOURNAL_BLOCK_MAX];
+    event_journal_cursor cursor = {0};
+    size_t bytes;
+
+    while ((bytes = event_journal_export(&cursor, frame, sizeof(frame))) > 0) {
+        if (send(sock, frame, bytes, 0) != (int)bytes) return false;
+    }
+
+    event_journal_frame_header end = { .magic = EVENT_JOURNAL_FRAME_MAGIC };
+    return send(sock, &end, sizeof(end), 0) == (int)sizeof(end);
+}
+
+
 static void pos_receive_task(void *arg) {
     (void)arg;
 
@@ -135,14 +186,28 @@ static void pos_receive_task(void *arg) {
                 break;
             }
 
-            if (msg.type > POS_BILL_REQUESTED || msg.table_index >= MAX_TABLES) {
-                ESP_LOGW(TAG, "Dropped invalid message: type=%u table=%u", msg.type, msg.table_index);
+            if (msg.type == POS_TRACE_DUMP) {
+                if (!send_decision_trace(sock)) {
+                    ESP_LOGW(TAG, "Decision trace send failed: errno %d", errno);
+                }
                 continue;
             }
 
-            if (xQueueSend(s_event_queue, &msg, 0) != pdTRUE) {
-                ESP_LOGW(TAG, "Event queue full, dropping message: type=%u table=%u", msg.type, msg.table_index);
+            if (msg.type == POS_JOURNAL_DUMP) {
+                if (!send_event_journal(sock)) {
+                    ESP_LOGW(TAG, "Event journal send failed: errno %d", errno);
+                }
+                continue;
+            }
+
+            if (msg.type > POS_BILL_REQUESTED || msg.table_index >= system_get_table_count()) {
+                ESP_LOGW(TAG, "Dropped invalid message: type=%u table=%u", msg.type, msg.table_index);
+                continue;
             }
+
+            ESP_LOGI(TAG, "Posting POS event: type=%u table=%u", msg.type, msg.table_index);
+            system_post_table_event(msg.table_index, POS_EVENT_MAP[msg.type]);
+            sched_tick_wake();
         }
 
         close(sock);
@@ -153,25 +218,9 @@ static void pos_receive_task(void *arg) {
 
 void pos_client_start(void) {
     s_wifi_event_group = xEventGroupCreate();
-    s_event_queue      = xQueueCreate(EVENT_QUEUE_LEN, sizeof(pos_message));
 
     wifi_init();
 
     xTaskCreate(pos_receive_task, "pos_recv", 4096, NULL, 4, NULL);
 }
 
-
-void pos_client_drain_events(time_ms current_time_ms) {
-    static const fsm_transition_event event_map[] = {
-        [POS_CUSTOMERS_SEATED] = EVENT_CUSTOMERS_SEATED,
-        [POS_ORDER_READY]      = EVENT_POS_ORDER_READY,
-        [POS_BILL_REQUESTED]   = EVENT_TABLE_REQUESTED_BILL,
-    };
-
-    pos_message msg;
-    while (xQueueReceive(s_event_queue, &msg, 0) == pdTRUE) {
-        fsm_transition_event ev = event_map[msg.type];
-        ESP_LOGI(TAG, "Applying POS event: type=%u table=%u", msg.type, msg.table_index);
-        system_apply_table_fsm_event(msg.table_index, ev, current_time_ms);
-    }
-}
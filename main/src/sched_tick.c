@@ -0,0 +1,96 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#include "../include/sched_tick.h"
+#include "../include/trace_system.h"
+#include "../include/system_command.h"
+#include "../include/system_snapshot.h"
+#include "../include/system_notify.h"
+#include "../include/warm_restart.h"
+
+
+static const char *TAG = "sched_tick";
+
+static TaskHandle_t s_tick_task;
+static TaskHandle_t volatile s_sync_waiter;     // task blocked in sched_tick_sync(), if any
+
+
+/* Wait until `deadline`, clamped so a missed wake-up never stalls the system. */
+static TickType_t sleep_ticks(time_ms deadline, time_ms now) {
+    time_ms wait_ms = (deadline > now) ? deadline - now : 0;
+
+    if (wait_ms < SCHED_TICK_MIN_SLEEP_MS) wait_ms = SCHED_TICK_MIN_SLEEP_MS;
+    if (wait_ms > SCHED_TICK_MAX_SLEEP_MS) wait_ms = SCHED_TICK_MAX_SLEEP_MS;
+
+    // Round up so the wake never lands just before the deadline
+    return (TickType_t)((wait_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+}
+
+
+static void sched_tick_task(void *arg) {
+    (void)arg;
+
+    while (1) {
+        time_ms current_time_ms = get_time();
+
+        // This task is the only writer of the trace system: everyone else posts commands
+        uint16_t applied = system_command_apply(current_time_ms, SCHED_TICK_COMMAND_BATCH);
+        trace_system_tick(current_time_ms);
+
+        // Published before waking a syncing reader, so it reads its own commands back
+        uint32_t changed_tables[SYSTEM_TABLE_WORDS];
+        uint32_t changes = system_snapshot_publish(current_time_ms, changed_tables);
+        system_notify_publish(changes, changed_tables);
+        warm_restart_save(current_time_ms);
+
+        TaskHandle_t waiter = s_sync_waiter;
+        if (waiter) xTaskNotifyGive(waiter);
+
+        // A full batch may have left more queued; go round again without sleeping
+        if (applied == SCHED_TICK_COMMAND_BATCH) continue;
+
+        time_ms deadline = system_next_deadline(current_time_ms);
+        ESP_LOGD(TAG, "next deadline in %ld ms",
+                 (deadline == UINT32_MAX) ? -1L : (long)(deadline - current_time_ms));
+
+        // Any number of wakes while sleeping or ticking collapse into one pass
+        ulTaskNotifyTake(pdTRUE, sleep_ticks(deadline, current_time_ms));
+    }
+}
+
+
+void sched_tick_start(void) {
+    // Readers may start before the first pass; give them the initial state
+    system_snapshot_publish(get_time(), NULL);
+    xTaskCreate(sched_tick_task, "sched_tick", 4096, NULL, 5, &s_tick_task);
+}
+
+
+void sched_tick_wake(void) {
+    if (s_tick_task) xTaskNotifyGive(s_tick_task);
+}
+
+
+bool sched_tick_sync(void) {
+    uint32_t posted = system_command_posted();
+    if (system_command_applied_through(posted)) return true;
+    if (!s_tick_task) return false;
+
+    // Register before waking, so the pass that applies our commands sees us
+    s_sync_waiter = xTaskGetCurrentTaskHandle();
+    sched_tick_wake();
+
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(SCHED_TICK_SYNC_TIMEOUT_MS);
+    bool applied;
+    while (!(applied = system_command_applied_through(posted))) {
+        TickType_t waited = xTaskGetTickCount() - start;
+        if (waited >= timeout) break;
+        ulTaskNotifyTake(pdTRUE, timeout - waited);
+    }
+
+    s_sync_waiter = NULL;
+    if (!applied) ESP_LOGW(TAG, "sync timed out, commands still queued");
+    return applied;
+}
@@ -0,0 +1,327 @@
+#include "../include/staff_scheduler.h"
+#include "../include/task_domain.h"
+
+#include <string.h>
+
+#include "esp_log.h"
+
+
+/* --- Auction defaults --- */
+#define AUCTION_EPSILON             0.05f
+#define AUCTION_MAX_BIDS            256
+
+#define AUCTION_NONE                (-1)
+
+_Static_assert(STAFF_MAX_CANDIDATES >= MAX_STAFF, "every idle waiter needs a candidate task");
+
+
+static const char *TAG = "staff_sched";
+
+
+/* ------------------------------------------------------------------ */
+/* Auction                                                             */
+/*   Runs on the instance's staff_auction scratch. The smaller side    */
+/*   bids, so bidders never outnumber objects and every bidder ends    */
+/*   up with an object.                                                */
+/* ------------------------------------------------------------------ */
+
+static inline sched_score auction_value(const staff_auction *a, bool staff_bid, uint16_t bidder, uint16_t object) {
+    return staff_bid ? a->value[bidder][object] : a->value[object][bidder];
+}
+
+
+/* Forward auction with a fixed epsilon. An unassigned bidder takes its best
+   object at current prices, raising that price by the margin over its
+   second-best object plus epsilon and evicting the previous holder. With
+   bidders <= objects this ends with everyone assigned, within
+   bidders * epsilon of the optimal total value. If the bid budget runs out
+   first, the remaining bidders take their best unheld object greedily. */
+static uint16_t run_auction(staff_auction *a, uint16_t bidders, uint16_t objects, bool staff_bid,
+                            sched_score epsilon, uint16_t max_bids)
+{
+    int16_t unassigned[MAX_STAFF];
+    uint16_t top = 0;
+    uint16_t bids = 0;
+
+    for (uint16_t o = 0; o < objects; ++o) {
+        a->price[o]  = 0;
+        a->holder[o] = AUCTION_NONE;
+    }
+    for (uint16_t b = bidders; b > 0; --b) {
+        a->held[b - 1] = AUCTION_NONE;
+        unassigned[top++] = (int16_t)(b - 1);
+    }
+
+    while (top > 0 && bids < max_bids) {
+        int16_t b = unassigned[--top];
+
+        int16_t best = AUCTION_NONE;
+        sched_score best_net = SCORE_MIN;
+        sched_score second_net = SCORE_MIN;
+
+        for (uint16_t o = 0; o < objects; ++o) {
+            sched_score net = auction_value(a, staff_bid, (uint16_t)b, o) - a->price[o];
+            if (best == AUCTION_NONE || net > best_net) {
+                second_net = best_net;
+                best_net   = net;
+                best       = (int16_t)o;
+            } else if (net > second_net) {
+                second_net = net;
+            }
+        }
+
+        a->price[best] += (objects > 1) ? (best_net - second_net) + epsilon : epsilon;
+
+        if (a->holder[best] != AUCTION_NONE) {
+            a->held[a->holder[best]] = AUCTION_NONE;
+            unassigned[top++]        = a->holder[best];
+        }
+        a->holder[best] = b;
+        a->held[b]      = best;
+        ++bids;
+    }
+
+    while (top > 0) {
+        int16_t b = unassigned[--top];
+        int16_t best = AUCTION_NONE;
+
+        for (uint16_t o = 0; o < objects; ++o) {
+            if (a->holder[o] != AUCTION_NONE) continue;
+            if (best == AUCTION_NONE ||
+                auction_value(a, staff_bid, (uint16_t)b, o) > auction_value(a, staff_bid, (uint16_t)b, (uint16_t)best))
+                best = (int16_t)o;
+        }
+
+        a->holder[best] = b;
+        a->held[b]      = best;
+    }
+
+    return bids;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Internal helpers                                                   */
+/* ------------------------------------------------------------------ */
+
+static void staff_clear_active(staff_member *m, time_ms now) {
+    m->has_active_task   = false;
+    m->active_task_id    = INVALID_TASK_ID;
+    m->task_active_since = now;
+}
+
+
+static bool slot_is_held(const staff_auction *a, uint8_t held_count, uint16_t slot) {
+    for (uint8_t i = 0; i < held_count; ++i) {
+        if (a->held_slot[i] == slot) return true;
+    }
+    return false;
+}
+
+
+static uint16_t lowest_candidate(const staff_auction *a, uint16_t count) {
+    uint16_t lowest = 0;
+    for (uint16_t j = 1; j < count; ++j) {
+        if (a->free_raw[j] < a->free_raw[lowest]) lowest = j;
+    }
+    return lowest;
+}
+
+
+// Raw score of the n-th best candidate, 1 <= n <= MAX_STAFF and n <= count
+static sched_key nth_best_raw(const staff_auction *a, uint16_t count, uint8_t n) {
+    sched_key best[MAX_STAFF];
+    uint8_t have = 0;
+
+    for (uint16_t j = 0; j < count; ++j) {
+        sched_key raw = a->free_raw[j];
+        if (have == n && raw <= best[n - 1]) continue;
+
+        uint8_t at = (have < n) ? have++ : (uint8_t)(n - 1);
+        while (at > 0 && best[at - 1] < raw) {
+            best[at] = best[at - 1];
+            at--;
+        }
+        best[at] = raw;
+    }
+    return best[n - 1];
+}
+
+
+static void staff_set_active(staff_member *m, const task *t, time_ms now) {
+    m->has_active_task   = true;
+    m->active_task_id    = t->id;
+    m->task_active_since = now;
+    m->last_table        = t->table_number;
+    m->last_kind         = t->kind;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* API                                                                 */
+/* ------------------------------------------------------------------ */
+
+void staff_scheduler_init(staff_scheduler *ss, const staff_scheduler_config *cfg, uint8_t staff_count) {
+    memset(ss, 0, sizeof(*ss));
+    if (cfg) ss->cfg = *cfg;
+
+    if (ss->cfg.auction_epsilon == 0)  ss->cfg.auction_epsilon = AUCTION_EPSILON;
+    if (ss->cfg.max_bids == 0)         ss->cfg.max_bids        = AUCTION_MAX_BIDS;
+
+    ss->epsilon = score_from_float(ss->cfg.auction_epsilon);
+    if (ss->epsilon <= 0) ss->epsilon = score_from_float(AUCTION_EPSILON);
+
+    if (staff_count > MAX_STAFF) {
+        ESP_LOGW(TAG, "staff_count %u exceeds MAX_STAFF, using %u", staff_count, MAX_STAFF);
+        staff_count = MAX_STAFF;
+    }
+    ss->staff_count = staff_count;
+
+    for (uint8_t i = 0; i < staff_count; ++i) {
+        ss->staff[i].on_shift  = true;
+        ss->staff[i].last_kind = TASK_NOT_APPLICABLE;
+        staff_clear_active(&ss->staff[i], 0);
+    }
+}
+
+
+void staff_scheduler_set_on_shift(staff_scheduler *ss, uint8_t staff_index, bool on_shift) {
+    if (staff_index >= ss->staff_count) return;
+
+    staff_member *m = &ss->staff[staff_index];
+    m->on_shift = on_shift;
+    if (!on_shift && m->has_active_task) {
+        ESP_LOGI(TAG, "staff %u off shift, releasing (%u,%u)",
+            staff_index, m->active_task_id.index, m->active_task_id.generation);
+        staff_clear_active(m, m->task_active_since);
+    }
+}
+
+
+void staff_scheduler_tick(staff_scheduler *ss, const scheduler *scoring, task_pool *pool, time_ms now) {
+    staff_auction *a = &ss->auction;
+
+    task_pool_wake_expired(pool, now);
+
+    uint8_t held_count = 0;
+    uint8_t idle_count = 0;
+
+    /* Waiters keep their task until a natural breakpoint */
+    for (uint8_t i = 0; i < ss->staff_count; ++i) {
+        staff_member *m = &ss->staff[i];
+
+        if (m->has_active_task) {
+            task *t = task_pool_get(pool, m->active_task_id);
+            if (m->on_shift && t && t->status == TASK_ELIGIBLE) {
+                a->held_slot[held_count++] = m->active_task_id.index;
+                continue;
+            }
+            staff_clear_active(m, now);
+        }
+        if (m->on_shift) a->idle_staff[idle_count++] = i;
+    }
+
+    /* Collect the free ready tasks, keeping the best STAFF_MAX_CANDIDATES
+       by raw score once there are more */
+    uint16_t free_count = 0;
+    uint16_t candidates = 0;
+    uint16_t lowest = 0;
+    sched_key best_dropped = KEY_MIN;
+    for (uint16_t r = 0; r < pool->ready_count; ++r) {
+        uint16_t slot = pool->ready[r];
+        if (slot_is_held(a, held_count, slot)) continue;
+
+        free_count++;
+        if (idle_count == 0) continue;
+
+        sched_key raw = scheduler_task_key(scoring, &pool->slots[slot].task_instance, now);
+        if (candidates < STAFF_MAX_CANDIDATES) {
+            a->free_slot[candidates] = slot;
+            a->free_raw[candidates]  = raw;
+            if (++candidates == STAFF_MAX_CANDIDATES) lowest = lowest_candidate(a, candidates);
+            continue;
+        }
+        if (raw <= a->free_raw[lowest]) {
+            if (raw > best_dropped) best_dropped = raw;
+            continue;
+        }
+
+        if (a->free_raw[lowest] > best_dropped) best_dropped = a->free_raw[lowest];
+        a->free_slot[lowest] = slot;
+        a->free_raw[lowest]  = raw;
+        lowest = lowest_candidate(a, candidates);
+    }
+
+    ss->last_bid_count = 0;
+    ss->last_truncated = false;
+    if (idle_count == 0 || candidates == 0) {
+        ss->pending_count = free_count;
+        return;
+    }
+
+    /* Cut to the tasks within the adjustment spread of the idle_count-th
+       best: each below it scores under idle_count others for every waiter */
+    if (candidates > idle_count) {
+        sched_key min_adjust, max_adjust;
+        scheduler_transition_key_bounds(scoring, &min_adjust, &max_adjust);
+
+        sched_key reach = nth_best_raw(a, candidates, idle_count) - (max_adjust - min_adjust);
+        ss->last_truncated = best_dropped > reach;
+
+        uint16_t kept = 0;
+        for (uint16_t j = 0; j < candidates; ++j) {
+            if (a->free_raw[j] < reach) continue;
+            a->free_slot[kept] = a->free_slot[j];
+            a->free_raw[kept]  = a->free_raw[j];
+            kept++;
+        }
+        candidates = kept;
+    }
+    if (ss->last_truncated) {
+        ESP_LOGW(TAG, "more than %u tasks within reach, auctioning the best by raw score", STAFF_MAX_CANDIDATES);
+    }
+
+    for (uint16_t j = 0; j < candidates; ++j) {
+        const task *t = &pool->slots[a->free_slot[j]].task_instance;
+        sched_key raw = a->free_raw[j];
+
+        for (uint8_t w = 0; w < idle_count; ++w) {
+            const staff_member *m = &ss->staff[a->idle_staff[w]];
+            a->value[w][j] = score_from_key(raw + scheduler_transition_key(scoring, m->last_table, m->last_kind,
+                                                                           t->table_number, t->kind));
+        }
+    }
+
+    bool staff_bid = idle_count <= candidates;
+    uint16_t bidders = staff_bid ? idle_count : candidates;
+    uint16_t objects = staff_bid ? candidates : idle_count;
+
+    ss->last_bid_count = run_auction(a, bidders, objects, staff_bid, ss->epsilon, ss->cfg.max_bids);
+    if (ss->last_bid_count >= ss->cfg.max_bids) {
+        ESP_LOGW(TAG, "auction hit bid budget (%u), finished greedily", ss->cfg.max_bids);
+    }
+
+    for (uint16_t b = 0; b < bidders; ++b) {
+        uint16_t o = (uint16_t)a->held[b];
+        uint8_t w  = staff_bid ? (uint8_t)b : (uint8_t)o;
+        uint16_t j = staff_bid ? o : b;
+
+        staff_member *m = &ss->staff[a->idle_staff[w]];
+        const task *t = &pool->slots[a->free_slot[j]].task_instance;
+        staff_set_active(m, t, now);
+
+        ESP_LOGI(TAG, "assign t=%lu staff=%u task=(%u,%u) table=%u kind=%s value=%.2f",
+            (unsigned long)now, a->idle_staff[w], t->id.index, t->id.generation,
+            t->table_number, task_kind_to_str(t->kind), score_to_double(a->value[w][j]));
+    }
+
+    ss->pending_count = (uint16_t)(free_count - bidders);
+}
+
+
+task_id staff_scheduler_active_task(const staff_scheduler *ss, uint8_t staff_index) {
+    if (staff_index >= ss->staff_count) return INVALID_TASK_ID;
+
+    const staff_member *m = &ss->staff[staff_index];
+    return m->has_active_task ? m->active_task_id : INVALID_TASK_ID;
+}
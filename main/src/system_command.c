@@ -0,0 +1,239 @@
+#include "../include/system_command.h"
+#include "../include/trace_system.h"
+
+#include <stdatomic.h>
+
+#include "esp_log.h"
+
+
+#define COMMAND_MASK                (SYSTEM_COMMAND_CAPACITY - 1)
+
+_Static_assert((SYSTEM_COMMAND_CAPACITY & COMMAND_MASK) == 0, "SYSTEM_COMMAND_CAPACITY must be a power of two");
+
+
+static const char *TAG = "sys_cmd";
+
+
+/* ------------------------------------------------------------------ */
+/* Ring                                                                */
+/*   Bounded MPSC queue with a sequence number per cell. A cell whose  */
+/*   sequence equals the enqueue position is free for that position;  */
+/*   position + 1 means it holds that position's command. Producers    */
+/*   claim positions with a CAS on command_tail and publish the cell   */
+/*   with a release store, so the single consumer never sees a        */
+/*   half-written command and nobody ever blocks.                      */
+/*   Cells store their sequence less their own index, so the zeroed   */
+/*   ring starts with every cell free for its first lap.               */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    _Atomic uint32_t sequence;      // less the cell's index, see above
+    system_command command;
+} command_cell;
+
+static command_cell command_ring[SYSTEM_COMMAND_CAPACITY];
+static _Atomic uint32_t command_tail;               // next position to claim
+static _Atomic uint32_t command_head;               // next position to apply, owner writes
+static _Atomic uint32_t command_drops;
+
+
+static inline uint32_t cell_sequence(uint32_t index) {
+    return atomic_load_explicit(&command_ring[index].sequence, memory_order_acquire) + index;
+}
+
+
+static inline void cell_publish(uint32_t index, uint32_t sequence) {
+    atomic_store_explicit(&command_ring[index].sequence, sequence - index, memory_order_release);
+}
+
+
+bool system_command_post(const system_command *command) {
+    if (!command) return false;
+
+    uint32_t pos = atomic_load_explicit(&command_tail, memory_order_relaxed);
+    uint32_t index;
+
+    while (1) {
+        index = pos & COMMAND_MASK;
+        int32_t lag = (int32_t)(cell_sequence(index) - pos);
+
+        if (lag == 0) {
+            // Free for this position: claim it, or retry from wherever the tail moved
+            if (atomic_compare_exchange_weak_explicit(&command_tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (lag < 0) {
+            // Still holds the command from one lap ago: the ring is full
+            atomic_fetch_add_explicit(&command_drops, 1, memory_order_relaxed);
+            return false;
+        } else {
+            pos = atomic_load_explicit(&command_tail, memory_order_relaxed);
+        }
+    }
+
+    command_ring[index].command = *command;
+    cell_publish(index, pos + 1);
+    return true;
+}
+
+
+// Owner only. command_head is advanced separately, once the command took effect.
+static bool command_ring_pop(uint32_t pos, system_command *out) {
+    uint32_t index = pos & COMMAND_MASK;
+
+    if (cell_sequence(index) != pos + 1) return false;
+
+    *out = command_ring[index].command;
+    cell_publish(index, pos + SYSTEM_COMMAND_CAPACITY);
+    return true;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Applying                                                            */
+/* ------------------------------------------------------------------ */
+
+static void command_dispatch(const system_command *command, time_ms now) {
+    switch ((system_command_type)command->type) {
+        case SYSTEM_CMD_USER_ACTION:
+            system_apply_user_action_to_task(command->task, (user_action)command->arg, now);
+            break;
+
+        case SYSTEM_CMD_FORCE_ACTIVE:
+            system_force_active_task(command->task, now);
+            break;
+
+        case SYSTEM_CMD_FORCE_TABLE_TASK: {
+            task *t = system_get_current_task_pointer_for_table(command->table_index);
+            if (t) system_force_active_task(t->id, now);
+            break;
+        }
+
+        case SYSTEM_CMD_UNDO_IGNORE:
+            system_undo_task_ignore(command->task, command->arg, command->prev_suppress_until, now);
+            break;
+
+        default:
+            ESP_LOGW(TAG, "Dropped unknown command type=%u", command->type);
+            break;
+    }
+}
+
+
+/* Runs of table events are handed to the trace system as one batch, so a
+   burst of POS messages costs one reschedule instead of one each. Any
+   other command ends the run first, which keeps posting order. */
+static uint16_t flush_table_events(system_table_event *events, uint16_t count, time_ms now) {
+    if (count) system_apply_events(events, count, now);
+    return 0;
+}
+
+
+uint16_t system_command_apply(time_ms current_time, uint16_t max_commands) {
+    system_table_event events[SYSTEM_COMMAND_CAPACITY];
+    uint16_t pending = 0;
+    uint16_t applied = 0;
+    uint32_t pos = atomic_load_explicit(&command_head, memory_order_relaxed);
+    system_command command;
+
+    while (applied < max_commands && command_ring_pop(pos, &command)) {
+        pos++;
+        applied++;
+
+        if (command.type == SYSTEM_CMD_TABLE_EVENT) {
+            events[pending++] = (system_table_event){ .table_index = command.table_index, .event = command.arg };
+            if (pending < SYSTEM_COMMAND_CAPACITY) continue;
+            pending = flush_table_events(events, pending, current_time);
+        } else {
+            pending = flush_table_events(events, pending, current_time);
+            command_dispatch(&command, current_time);
+        }
+
+        // Published after the commands took effect, for system_command_applied_through()
+        atomic_store_explicit(&command_head, pos, memory_order_release);
+    }
+
+    flush_table_events(events, pending, current_time);
+    atomic_store_explicit(&command_head, pos, memory_order_release);
+    return applied;
+}
+
+
+uint32_t system_command_posted(void) {
+    return atomic_load_explicit(&command_tail, memory_order_acquire);
+}
+
+
+bool system_command_applied_through(uint32_t posted) {
+    uint32_t head = atomic_load_explicit(&command_head, memory_order_acquire);
+    return (int32_t)(head - posted) >= 0;
+}
+
+
+uint32_t system_command_dropped(void) {
+    return atomic_load_explicit(&command_drops, memory_order_relaxed);
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Posting shorthands                                                  */
+/* ------------------------------------------------------------------ */
+
+static bool post_or_warn(const system_command *command) {
+    if (system_command_post(command)) return true;
+
+    ESP_LOGW(TAG, "Command ring full, dropped type=%u table=%u", command->type, command->table_index);
+    return false;
+}
+
+
+bool system_post_table_event(uint8_t table_index, fsm_transition_event event) {
+    system_command command = {
+        .type        = SYSTEM_CMD_TABLE_EVENT,
+        .table_index = table_index,
+        .arg         = (uint8_t)event,
+        .task        = INVALID_TASK_ID,
+    };
+    return post_or_warn(&command);
+}
+
+
+bool system_post_user_action(task_id id, user_action action) {
+    system_command command = {
+        .type = SYSTEM_CMD_USER_ACTION,
+        .arg  = (uint8_t)action,
+        .task = id,
+    };
+    return post_or_warn(&command);
+}
+
+
+bool system_post_force_active(task_id id) {
+    system_command command = {
+        .type = SYSTEM_CMD_FORCE_ACTIVE,
+        .task = id,
+    };
+    return post_or_warn(&command);
+}
+
+
+bool system_post_force_table_task(uint8_t table_index) {
+    system_command command = {
+        .type        = SYSTEM_CMD_FORCE_TABLE_TASK,
+        .table_index = table_index,
+        .task        = INVALID_TASK_ID,
+    };
+    return post_or_warn(&command);
+}
+
+
+bool system_post_undo_ignore(task_id id, uint8_t prev_ignore_count, time_ms prev_suppress_until) {
+    system_command command = {
+        .type                = SYSTEM_CMD_UNDO_IGNORE,
+        .arg                 = prev_ignore_count,
+        .task                = id,
+        .prev_suppress_until = prev_suppress_until,
+    };
+    return post_or_warn(&command);
+}
@@ -0,0 +1,104 @@
+#include "../include/system_notify.h"
+
+#include <stdatomic.h>
+
+#include "esp_log.h"
+
+
+static const char *TAG = "sys_notify";
+
+
+/* Entries are claimed with a fetch-add and become visible to the owner
+   when their handle is stored, so subscribing never takes a lock and the
+   owner skips an entry that is claimed but not yet filled in. The owner
+   sets table bits before it notifies and the subscriber swaps them out,
+   so a table is never lost, at worst taken before its notification. */
+typedef struct {
+    _Atomic(TaskHandle_t) task;
+    _Atomic uint32_t mask;
+    _Atomic uint32_t tables[SYSTEM_TABLE_WORDS];
+} notify_subscriber;
+
+static notify_subscriber subscribers[SYSTEM_NOTIFY_MAX_SUBSCRIBERS];
+static _Atomic uint32_t subscriber_count;
+
+
+static notify_subscriber *calling_subscriber(void) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    uint32_t count = atomic_load_explicit(&subscriber_count, memory_order_relaxed);
+    if (count > SYSTEM_NOTIFY_MAX_SUBSCRIBERS) count = SYSTEM_NOTIFY_MAX_SUBSCRIBERS;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        if (atomic_load_explicit(&subscribers[i].task, memory_order_acquire) == self) return &subscribers[i];
+    }
+    return NULL;
+}
+
+
+bool system_notify_subscribe(TaskHandle_t task, uint32_t mask) {
+    uint32_t slot = atomic_fetch_add_explicit(&subscriber_count, 1, memory_order_relaxed);
+    if (slot >= SYSTEM_NOTIFY_MAX_SUBSCRIBERS) {
+        ESP_LOGW(TAG, "No room for another subscriber (max %d)", SYSTEM_NOTIFY_MAX_SUBSCRIBERS);
+        return false;
+    }
+
+    if (!task) task = xTaskGetCurrentTaskHandle();
+    atomic_store_explicit(&subscribers[slot].mask, mask, memory_order_relaxed);
+    atomic_store_explicit(&subscribers[slot].task, task, memory_order_release);
+    return true;
+}
+
+
+void system_notify_publish(uint32_t changes, const uint32_t *changed_tables) {
+    if (changes == 0) return;
+
+    uint32_t count = atomic_load_explicit(&subscriber_count, memory_order_relaxed);
+    if (count > SYSTEM_NOTIFY_MAX_SUBSCRIBERS) count = SYSTEM_NOTIFY_MAX_SUBSCRIBERS;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        TaskHandle_t task = atomic_load_explicit(&subscribers[i].task, memory_order_acquire);
+        if (!task) continue;
+
+        uint32_t bits = changes & atomic_load_explicit(&subscribers[i].mask, memory_order_relaxed);
+        if (!bits) continue;
+
+        if (bits & SYSTEM_CHANGE_TABLES) {
+            for (uint32_t w = 0; w < SYSTEM_TABLE_WORDS; ++w) {
+                if (changed_tables[w]) atomic_fetch_or_explicit(&subscribers[i].tables[w], changed_tables[w], memory_order_release);
+            }
+        }
+        xTaskNotifyIndexed(task, SYSTEM_NOTIFY_INDEX, bits, eSetBits);
+    }
+}
+
+
+uint32_t system_notify_wait(TickType_t timeout) {
+    uint32_t bits = 0;
+    xTaskNotifyWaitIndexed(SYSTEM_NOTIFY_INDEX, 0, UINT32_MAX, &bits, timeout);
+    return bits;
+}
+
+
+void system_notify_take_tables(uint32_t *tables) {
+    notify_subscriber *sub = calling_subscriber();
+
+    for (uint32_t w = 0; w < SYSTEM_TABLE_WORDS; ++w) {
+        tables[w] = sub ? atomic_exchange_explicit(&sub->tables[w], 0, memory_order_acquire) : 0;
+    }
+}
+
+
+void system_notify_ack(uint32_t bits) {
+    ulTaskNotifyValueClearIndexed(NULL, SYSTEM_NOTIFY_INDEX, bits);
+
+    notify_subscriber *sub = calling_subscriber();
+    if (!sub || !(bits & SYSTEM_CHANGE_TABLES)) return;
+    for (uint32_t w = 0; w < SYSTEM_TABLE_WORDS; ++w) atomic_store_explicit(&sub->tables[w], 0, memory_order_relaxed);
+}
+
+
+void system_notify_ack_table(uint8_t table_index) {
+    notify_subscriber *sub = calling_subscriber();
+    if (!sub || table_index >= MAX_TABLES) return;
+    atomic_fetch_and_explicit(&sub->tables[table_index / 32], ~(1u << (table_index % 32)), memory_order_relaxed);
+}
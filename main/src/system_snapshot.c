@@ -0,0 +1,185 @@
+#include "../include/system_snapshot.h"
+#include "../include/trace_system.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+
+/* ------------------------------------------------------------------ */
+/* Publishing                                                          */
+/*   Two buffers; the current one is snapshot_buffers[version & 1].   */
+/*   The owner fills the other one and then bumps the version, so a   */
+/*   reader always copies a finished buffer. The buffer it copies is  */
+/*   only rewritten after the next publish, which moves the version;  */
+/*   a reader that finds the version unchanged after its copy has a  */
+/*   whole snapshot, otherwise it copies again. The owner never      */
+/*   waits.                                                            */
+/* ------------------------------------------------------------------ */
+
+static system_snapshot snapshot_buffers[2];
+static _Atomic uint32_t snapshot_version;
+
+
+static void fill_task_view(system_task_view *view, const task *t) {
+    if (!t) {
+        *view = (system_task_view){
+            .has_task     = false,
+            .id           = INVALID_TASK_ID,
+            .kind         = TASK_NOT_APPLICABLE,
+            .table_number = 0xFF,
+        };
+        return;
+    }
+
+    *view = (system_task_view){
+        .has_task       = true,
+        .id             = t->id,
+        .kind           = t->kind,
+        .table_number   = t->table_number,
+        .overdue_level  = t->overdue_level,
+        .ignore_count   = t->ignore_count,
+        .deadline       = t->time_limit,
+        .suppress_until = t->suppress_until,
+    };
+}
+
+
+static void fill_table_view(system_table_view *view, uint8_t table_index) {
+    const table_context *table = system_get_table(table_index);
+    if (!table) {
+        // Beyond system_get_table_count(): shown as a table that is never seated
+        *view = (system_table_view){
+            .state     = TABLE_IDLE,
+            .task_kind = TASK_NOT_APPLICABLE,
+            .task_id   = INVALID_TASK_ID,
+        };
+        return;
+    }
+
+    const task *t = system_get_current_task_pointer_for_table(table_index);
+
+    view->state            = table->state;
+    view->prev_state       = table->prev_state;
+    view->state_entered_at = table->state_entered_at;
+    view->task_kind        = system_get_current_task_kind_for_table(table_index);
+    view->task_id          = t ? t->id            : INVALID_TASK_ID;
+    view->overdue_level    = t ? t->overdue_level : TASK_ON_TIME;
+    view->deadline         = t ? t->time_limit    : 0;
+}
+
+
+static bool task_view_equal(const system_task_view *a, const system_task_view *b) {
+    return a->has_task == b->has_task && a->id.index == b->id.index && a->id.generation == b->id.generation &&
+           a->kind == b->kind && a->overdue_level == b->overdue_level && a->deadline == b->deadline;
+}
+
+
+static uint8_t diff_table_view(const system_table_view *now, const system_table_view *before) {
+    uint8_t changed = 0;
+
+    if (now->state != before->state || now->prev_state != before->prev_state ||
+        now->state_entered_at != before->state_entered_at) {
+        changed |= SYSTEM_TABLE_CHANGED_STATE;
+    }
+    if (now->task_id.index != before->task_id.index || now->task_id.generation != before->task_id.generation ||
+        now->task_kind != before->task_kind || now->deadline != before->deadline) {
+        changed |= SYSTEM_TABLE_CHANGED_TASK;
+    }
+    if (now->overdue_level != before->overdue_level) changed |= SYSTEM_TABLE_CHANGED_OVERDUE;
+
+    return changed;
+}
+
+
+/* The owner still holds the previous version in the other buffer, so the
+   changes come from comparing the two rather than from hooks in every
+   mutation path. */
+static uint32_t diff_snapshot(system_snapshot *snap, const system_snapshot *before) {
+    uint32_t changes = 0;
+
+    memset(snap->changed_tables, 0, sizeof(snap->changed_tables));
+    for (uint8_t i = 0; i < MAX_TABLES; ++i) {
+        uint8_t changed = diff_table_view(&snap->tables[i], &before->tables[i]);
+        snap->table_changes[i] = changed;
+        if (!changed) continue;
+
+        snap->changed_tables[i / 32] |= 1u << (i % 32);
+        changes |= SYSTEM_CHANGE_TABLES | ((uint32_t)changed << SYSTEM_CHANGE_TABLE_FIELD_SHIFT);
+    }
+
+    if (!task_view_equal(&snap->active, &before->active))     changes |= SYSTEM_CHANGE_ACTIVE;
+    if (!task_view_equal(&snap->critical, &before->critical)) changes |= SYSTEM_CHANGE_CRITICAL;
+    if (snap->pending_count != before->pending_count || snap->critical_count != before->critical_count ||
+        snap->active_tables != before->active_tables) {
+        changes |= SYSTEM_CHANGE_COUNTS;
+    }
+    if (snap->switch_at != before->switch_at || snap->switch_task.index != before->switch_task.index ||
+        snap->switch_task.generation != before->switch_task.generation) {
+        changes |= SYSTEM_CHANGE_SWITCH;
+    }
+    return changes;
+}
+
+
+uint32_t system_snapshot_publish(time_ms now, uint32_t *changed_tables) {
+    uint32_t version = atomic_load_explicit(&snapshot_version, memory_order_relaxed) + 1;
+    system_snapshot *snap = &snapshot_buffers[version & 1];
+    const system_snapshot *before = &snapshot_buffers[(version - 1) & 1];
+
+    // Readers of the previous version must see it move before this buffer changes under them
+    atomic_thread_fence(memory_order_release);
+
+    snap->version      = version;
+    snap->published_at = now;
+
+    fill_task_view(&snap->active, system_get_active_task());
+    fill_task_view(&snap->critical, system_get_top_critical_task());
+    snap->pending_count  = system_get_pending_count();
+    snap->critical_count = system_get_critical_pending_count();
+
+    // Once a challenger is critical the prompt is due now, and the prediction would move with every publish
+    if (snap->critical_count > 0 || !system_predict_next_switch(now, &snap->switch_at, &snap->switch_task)) {
+        snap->switch_at   = 0;
+        snap->switch_task = INVALID_TASK_ID;
+    }
+
+    snap->active_tables = 0;
+    for (uint8_t i = 0; i < MAX_TABLES; ++i) {
+        fill_table_view(&snap->tables[i], i);
+        if (snap->tables[i].task_kind != TASK_NOT_APPLICABLE) snap->active_tables++;
+    }
+
+    if (version == 1) {
+        snap->changes = SYSTEM_CHANGE_ALL;
+        memset(snap->table_changes, SYSTEM_TABLE_CHANGED_STATE | SYSTEM_TABLE_CHANGED_TASK |
+               SYSTEM_TABLE_CHANGED_OVERDUE, sizeof(snap->table_changes));
+        memset(snap->changed_tables, 0, sizeof(snap->changed_tables));
+        for (uint8_t i = 0; i < MAX_TABLES; ++i) snap->changed_tables[i / 32] |= 1u << (i % 32);
+    } else {
+        snap->changes = diff_snapshot(snap, before);
+        if (snap->changes == 0) return 0;       // this buffer is simply filled again next time
+    }
+
+    atomic_store_explicit(&snapshot_version, version, memory_order_release);
+    if (changed_tables) memcpy(changed_tables, snap->changed_tables, sizeof(snap->changed_tables));
+    return snap->changes;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Reading                                                             */
+/* ------------------------------------------------------------------ */
+
+uint32_t system_snapshot_read(system_snapshot *out) {
+    uint32_t version = atomic_load_explicit(&snapshot_version, memory_order_acquire);
+
+    while (1) {
+        memcpy(out, &snapshot_buffers[version & 1], sizeof(*out));
+
+        atomic_thread_fence(memory_order_acquire);
+        uint32_t now_version = atomic_load_explicit(&snapshot_version, memory_order_relaxed);
+        if (now_version == version) return version;
+
+        version = now_version;
+    }
+}
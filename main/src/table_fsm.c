@@ -1,6 +1,10 @@
 #include "../include/table_fsm.h"
 
 
+/* The transitions, the task each state emits and the state timeouts live
+   in main/table_fsm.spec; TABLE_FSM_NEXT_STATE and TABLE_FSM_STATES are
+   generated from it. Only undo is handled here. */
+
 
 static inline void enter_state(table_context *table, table_state next, time_ms current_time) {
     table->prev_state = table->state;
@@ -10,7 +14,7 @@ static inline void enter_state(table_context *table, table_state next, time_ms c
 
 
 bool table_apply_event(table_context *table, fsm_transition_event event, time_ms current_time) {
-    table_state prev = table->state;
+    if ((unsigned)event >= FSM_EVENT_COUNT || (unsigned)table->state >= TABLE_STATE_COUNT) return false;
 
     if (event == EVENT_UNDO && table->prev_state != TABLE_IDLE) {
         table_state restore = table->prev_state;
@@ -20,133 +24,19 @@ bool table_apply_event(table_context *table, fsm_transition_event event, time_ms
         return true;
     }
 
-    switch (table->state) {
-        case TABLE_IDLE:
-            if (event == EVENT_CUSTOMERS_SEATED) {
-                enter_state(table, TABLE_SEATED, current_time);
-            }
-            break;
-
-        case TABLE_SEATED:
-            if (event == EVENT_MARK_COMPLETE || event == EVENT_TAKE_ORDER_EARLY_OR_REPEAT) {
-                enter_state(table, TABLE_READY_FOR_ORDER, current_time);
-            }
-            break;
-
-        case TABLE_READY_FOR_ORDER:
-            if (event == EVENT_MARK_COMPLETE) {
-                enter_state(table, TABLE_PLACED_ORDER, current_time);
-            }
-            break;
-
-        case TABLE_PLACED_ORDER:
-            if (event == EVENT_MARK_COMPLETE) {
-                enter_state(table, TABLE_WAITING_FOR_ORDER, current_time);
-            }
-            else if (event == EVENT_TAKE_ORDER_EARLY_OR_REPEAT) {
-                enter_state(table, TABLE_READY_FOR_ORDER, current_time);
-            }
-            else if (event == EVENT_POS_ORDER_READY) {
-                enter_state(table, TABLE_WAITING_FOR_ORDER, current_time);
-            }
-            break;
-
-        case TABLE_WAITING_FOR_ORDER:
-            if (event == EVENT_MARK_COMPLETE) {
-                enter_state(table, TABLE_DINING, current_time);
-            }
-            else if (event == EVENT_TAKE_ORDER_EARLY_OR_REPEAT) {
-                enter_state(table, TABLE_READY_FOR_ORDER, current_time);
-            }
-            else if (event == EVENT_TABLE_REQUESTED_BILL) {
-                enter_state(table, TABLE_REQUESTED_BILL, current_time);
-            }
-            break;
-
-        case TABLE_DINING:
-            if (event == TIMEOUT_PERIODIC_CHECKIN) {
-                enter_state(table, TABLE_CHECKUP, current_time);
-            }
-            else if (event == EVENT_TAKE_ORDER_EARLY_OR_REPEAT) {
-                enter_state(table, TABLE_READY_FOR_ORDER, current_time);
-            }
-            else if (event == EVENT_TABLE_REQUESTED_BILL) {
-                enter_state(table, TABLE_REQUESTED_BILL, current_time);
-            }
-            break;
-
-        case TABLE_CHECKUP:
-            if (event == EVENT_TAKE_ORDER_EARLY_OR_REPEAT) {
-                enter_state(table, TABLE_READY_FOR_ORDER, current_time);
-            }
-            else if (event == EVENT_MARK_COMPLETE) {
-                enter_state(table, TABLE_DINING, current_time);
-            }
-            else if (event == EVENT_TABLE_REQUESTED_BILL) {
-                enter_state(table, TABLE_REQUESTED_BILL, current_time);
-            }
-            break;
-        
-        case TABLE_REQUESTED_BILL:
-            if (event == EVENT_MARK_COMPLETE) {
-                enter_state(table, TABLE_DONE, current_time);
-            }
-            break;
-
-        case TABLE_DONE:
-            if (event == EVENT_MARK_COMPLETE) {
-                enter_state(table, TABLE_IDLE, current_time);
-            }
-            break;
-    }
+    table_state next = (table_state)TABLE_FSM_NEXT_STATE[table->state][event];
+    if (next == table->state) return false;
 
-    return table->state != prev;
+    enter_state(table, next, current_time);
+    return true;
 }
 
 
 bool fsm_get_current_task_for_table(table_context *table, task_spec *out_task) {
     if (!table || !out_task) return false;
 
-    task_kind kind;
-
-    switch (table->state) {
-        case TABLE_SEATED:
-            kind = SERVE_WATER;
-            break;
-
-        case TABLE_READY_FOR_ORDER:
-            kind = TAKE_ORDER;
-            break;
-
-        case TABLE_PLACED_ORDER:
-            kind = PREPARE_ORDER;
-            break;
-
-        case TABLE_WAITING_FOR_ORDER:
-            kind = SERVE_ORDER;
-            break;
-
-        case TABLE_DINING:
-            return false;
-
-        case TABLE_CHECKUP:
-            kind = MONITOR_TABLE;
-            break;
-
-        case TABLE_REQUESTED_BILL:
-            kind = PRESENT_BILL;
-            break;
-
-        case TABLE_DONE:
-            kind = CLEAR_TABLE;
-            break;
-
-        case TABLE_IDLE:
-            return false;
-
-        default:
-            return false;
-    }
+    task_kind kind = table_fsm_task_kind(table->state);
+    if (kind == TASK_NOT_APPLICABLE) return false;
 
     out_task->table_number = table->table_number;
     out_task->task_kind = kind;
@@ -155,19 +45,23 @@ bool fsm_get_current_task_for_table(table_context *table, task_spec *out_task) {
 
 
 void table_fsm_tick(table_context *table, time_ms current_time) {
-    if (!table) return;
-
-    time_ms dt = current_time - table->state_entered_at;
+    if (!table || (unsigned)table->state >= TABLE_STATE_COUNT) return;
 
-    switch (table->state) {
-        case TABLE_DINING:
-            if (dt >= 15 * TIME_SCALE) {
-                table_apply_event(table, TIMEOUT_PERIODIC_CHECKIN, current_time);
-            }
-            break;
+    const table_fsm_state_info *info = &TABLE_FSM_STATES[table->state];
+    if (info->timeout == TABLE_FSM_NO_DEADLINE) return;
 
-        default:
-            break;
+    time_ms dt = current_time - table->state_entered_at;
+    if (dt >= info->timeout) {
+        table_apply_event(table, info->timeout_event, current_time);
     }
 }
 
+
+time_ms table_fsm_next_deadline(const table_context *table) {
+    if (!table || (unsigned)table->state >= TABLE_STATE_COUNT) return TABLE_FSM_NO_DEADLINE;
+
+    time_ms timeout = TABLE_FSM_STATES[table->state].timeout;
+    if (timeout == TABLE_FSM_NO_DEADLINE) return TABLE_FSM_NO_DEADLINE;
+
+    return table->state_entered_at + timeout;
+}
@@ -0,0 +1,122 @@
+/* Generated by tools/table_fsm_gen.py from main/table_fsm.spec. Do not edit. */
+
+#include "../include/table_fsm.h"
+
+
+// Names are bound by enum value, so the spec must list them in enum order
+_Static_assert(TABLE_STATE_COUNT == 9, "main/table_fsm.spec lists every table_state");
+_Static_assert(FSM_EVENT_COUNT == 7, "main/table_fsm.spec lists every fsm_transition_event");
+_Static_assert(TABLE_IDLE == 0, "main/table_fsm.spec lists table_state in enum order");
+_Static_assert(TABLE_SEATED == 1, "main/table_fsm.spec lists table_state in enum order");
+_Static_assert(TABLE_READY_FOR_ORDER == 2, "main/table_fsm.spec lists table_state in enum order");
+_Static_assert(TABLE_PLACED_ORDER == 3, "main/table_fsm.spec lists table_state in enum order");
+_Static_assert(TABLE_WAITING_FOR_ORDER == 4, "main/table_fsm.spec lists table_state in enum order");
+_Static_assert(TABLE_DINING == 5, "main/table_fsm.spec lists table_state in enum order");
+_Static_assert(TABLE_CHECKUP == 6, "main/table_fsm.spec lists table_state in enum order");
+_Static_assert(TABLE_REQUESTED_BILL == 7, "main/table_fsm.spec lists table_state in enum order");
+_Static_assert(TABLE_DONE == 8, "main/table_fsm.spec lists table_state in enum order");
+_Static_assert(EVENT_MARK_COMPLETE == 0, "main/table_fsm.spec lists fsm_transition_event in enum order");
+_Static_assert(EVENT_TAKE_ORDER_EARLY_OR_REPEAT == 1, "main/table_fsm.spec lists fsm_transition_event in enum order");
+_Static_assert(EVENT_CUSTOMERS_SEATED == 2, "main/table_fsm.spec lists fsm_transition_event in enum order");
+_Static_assert(EVENT_POS_ORDER_READY == 3, "main/table_fsm.spec lists fsm_transition_event in enum order");
+_Static_assert(EVENT_TABLE_REQUESTED_BILL == 4, "main/table_fsm.spec lists fsm_transition_event in enum order");
+_Static_assert(EVENT_UNDO == 5, "main/table_fsm.spec lists fsm_transition_event in enum order");
+_Static_assert(TIMEOUT_PERIODIC_CHECKIN == 6, "main/table_fsm.spec lists fsm_transition_event in enum order");
+
+
+const uint8_t TABLE_FSM_NEXT_STATE[TABLE_STATE_COUNT][FSM_EVENT_COUNT] = {
+    [TABLE_IDLE] = {
+        [EVENT_MARK_COMPLETE]              = TABLE_IDLE,
+        [EVENT_TAKE_ORDER_EARLY_OR_REPEAT] = TABLE_IDLE,
+        [EVENT_CUSTOMERS_SEATED]           = TABLE_SEATED,
+        [EVENT_POS_ORDER_READY]            = TABLE_IDLE,
+        [EVENT_TABLE_REQUESTED_BILL]       = TABLE_IDLE,
+        [EVENT_UNDO]                       = TABLE_IDLE,
+        [TIMEOUT_PERIODIC_CHECKIN]         = TABLE_IDLE,
+    },
+    [TABLE_SEATED] = {
+        [EVENT_MARK_COMPLETE]              = TABLE_READY_FOR_ORDER,
+        [EVENT_TAKE_ORDER_EARLY_OR_REPEAT] = TABLE_READY_FOR_ORDER,
+        [EVENT_CUSTOMERS_SEATED]           = TABLE_SEATED,
+        [EVENT_POS_ORDER_READY]            = TABLE_SEATED,
+        [EVENT_TABLE_REQUESTED_BILL]       = TABLE_SEATED,
+        [EVENT_UNDO]                       = TABLE_SEATED,
+        [TIMEOUT_PERIODIC_CHECKIN]         = TABLE_SEATED,
+    },
+    [TABLE_READY_FOR_ORDER] = {
+        [EVENT_MARK_COMPLETE]              = TABLE_PLACED_ORDER,
+        [EVENT_TAKE_ORDER_EARLY_OR_REPEAT] = TABLE_READY_FOR_ORDER,
+        [EVENT_CUSTOMERS_SEATED]           = TABLE_READY_FOR_ORDER,
+        [EVENT_POS_ORDER_READY]            = TABLE_READY_FOR_ORDER,
+        [EVENT_TABLE_REQUESTED_BILL]       = TABLE_READY_FOR_ORDER,
+        [EVENT_UNDO]                       = TABLE_READY_FOR_ORDER,
+        [TIMEOUT_PERIODIC_CHECKIN]         = TABLE_READY_FOR_ORDER,
+    },
+    [TABLE_PLACED_ORDER] = {
+        [EVENT_MARK_COMPLETE]              = TABLE_WAITING_FOR_ORDER,
+        [EVENT_TAKE_ORDER_EARLY_OR_REPEAT] = TABLE_READY_FOR_ORDER,
+        [EVENT_CUSTOMERS_SEATED]           = TABLE_PLACED_ORDER,
+        [EVENT_POS_ORDER_READY]            = TABLE_WAITING_FOR_ORDER,
+        [EVENT_TABLE_REQUESTED_BILL]       = TABLE_PLACED_ORDER,
+        [EVENT_UNDO]                       = TABLE_PLACED_ORDER,
+        [TIMEOUT_PERIODIC_CHECKIN]         = TABLE_PLACED_ORDER,
+    },
+    [TABLE_WAITING_FOR_ORDER] = {
+        [EVENT_MARK_COMPLETE]              = TABLE_DINING,
+        [EVENT_TAKE_ORDER_EARLY_OR_REPEAT] = TABLE_READY_FOR_ORDER,
+        [EVENT_CUSTOMERS_SEATED]           = TABLE_WAITING_FOR_ORDER,
+        [EVENT_POS_ORDER_READY]            = TABLE_WAITING_FOR_ORDER,
+        [EVENT_TABLE_REQUESTED_BILL]       = TABLE_REQUESTED_BILL,
+        [EVENT_UNDO]                       = TABLE_WAITING_FOR_ORDER,
+        [TIMEOUT_PERIODIC_CHECKIN]         = TABLE_WAITING_FOR_ORDER,
+    },
+    [TABLE_DINING] = {
+        [EVENT_MARK_COMPLETE]              = TABLE_DINING,
+        [EVENT_TAKE_ORDER_EARLY_OR_REPEAT] = TABLE_READY_FOR_ORDER,
+        [EVENT_CUSTOMERS_SEATED]           = TABLE_DINING,
+        [EVENT_POS_ORDER_READY]            = TABLE_DINING,
+        [EVENT_TABLE_REQUESTED_BILL]       = TABLE_REQUESTED_BILL,
+        [EVENT_UNDO]                       = TABLE_DINING,
+        [TIMEOUT_PERIODIC_CHECKIN]         = TABLE_CHECKUP,
+    },
+    [TABLE_CHECKUP] = {
+        [EVENT_MARK_COMPLETE]              = TABLE_DINING,
+        [EVENT_TAKE_ORDER_EARLY_OR_REPEAT] = TABLE_READY_FOR_ORDER,
+        [EVENT_CUSTOMERS_SEATED]           = TABLE_CHECKUP,
+        [EVENT_POS_ORDER_READY]            = TABLE_CHECKUP,
+        [EVENT_TABLE_REQUESTED_BILL]       = TABLE_REQUESTED_BILL,
+        [EVENT_UNDO]                       = TABLE_CHECKUP,
+        [TIMEOUT_PERIODIC_CHECKIN]         = TABLE_CHECKUP,
+    },
+    [TABLE_REQUESTED_BILL] = {
+        [EVENT_MARK_COMPLETE]              = TABLE_DONE,
+        [EVENT_TAKE_ORDER_EARLY_OR_REPEAT] = TABLE_REQUESTED_BILL,
+        [EVENT_CUSTOMERS_SEATED]           = TABLE_REQUESTED_BILL,
+        [EVENT_POS_ORDER_READY]            = TABLE_REQUESTED_BILL,
+        [EVENT_TABLE_REQUESTED_BILL]       = TABLE_REQUESTED_BILL,
+        [EVENT_UNDO]                       = TABLE_REQUESTED_BILL,
+        [TIMEOUT_PERIODIC_CHECKIN]         = TABLE_REQUESTED_BILL,
+    },
+    [TABLE_DONE] = {
+        [EVENT_MARK_COMPLETE]              = TABLE_IDLE,
+        [EVENT_TAKE_ORDER_EARLY_OR_REPEAT] = TABLE_DONE,
+        [EVENT_CUSTOMERS_SEATED]           = TABLE_DONE,
+        [EVENT_POS_ORDER_READY]            = TABLE_DONE,
+        [EVENT_TABLE_REQUESTED_BILL]       = TABLE_DONE,
+        [EVENT_UNDO]                       = TABLE_DONE,
+        [TIMEOUT_PERIODIC_CHECKIN]         = TABLE_DONE,
+    },
+};
+
+
+const table_fsm_state_info TABLE_FSM_STATES[TABLE_STATE_COUNT] = {
+    [TABLE_IDLE]              = { .task = TASK_NOT_APPLICABLE, .timeout = TABLE_FSM_NO_DEADLINE, .timeout_event = EVENT_MARK_COMPLETE },
+    [TABLE_SEATED]            = { .task = SERVE_WATER, .timeout = TABLE_FSM_NO_DEADLINE, .timeout_event = EVENT_MARK_COMPLETE },
+    [TABLE_READY_FOR_ORDER]   = { .task = TAKE_ORDER, .timeout = TABLE_FSM_NO_DEADLINE, .timeout_event = EVENT_MARK_COMPLETE },
+    [TABLE_PLACED_ORDER]      = { .task = PREPARE_ORDER, .timeout = TABLE_FSM_NO_DEADLINE, .timeout_event = EVENT_MARK_COMPLETE },
+    [TABLE_WAITING_FOR_ORDER] = { .task = SERVE_ORDER, .timeout = TABLE_FSM_NO_DEADLINE, .timeout_event = EVENT_MARK_COMPLETE },
+    [TABLE_DINING]            = { .task = TASK_NOT_APPLICABLE, .timeout = DINING_CHECKIN_INTERVAL_MS, .timeout_event = TIMEOUT_PERIODIC_CHECKIN },
+    [TABLE_CHECKUP]           = { .task = MONITOR_TABLE, .timeout = TABLE_FSM_NO_DEADLINE, .timeout_event = EVENT_MARK_COMPLETE },
+    [TABLE_REQUESTED_BILL]    = { .task = PRESENT_BILL, .timeout = TABLE_FSM_NO_DEADLINE, .timeout_event = EVENT_MARK_COMPLETE },
+    [TABLE_DONE]              = { .task = CLEAR_TABLE, .timeout = TABLE_FSM_NO_DEADLINE, .timeout_event = EVENT_MARK_COMPLETE },
+};
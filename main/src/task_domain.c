@@ -5,7 +5,7 @@
 
 static const char *TAG = "task_domain";
 
-extern task_id INVALID_TASK_ID = { .index = UINT16_MAX, .generation = 0 };
+task_id INVALID_TASK_ID = { .index = UINT16_MAX, .generation = 0 };
 
 
 void task_init(task *task, task_id id, task_kind kind, time_ms created_at, uint8_t table) {
@@ -17,6 +17,7 @@ void task_init(task *task, task_id id, task_kind kind, time_ms created_at, uint8
     task->time_limit = TASK_TIME_LIMIT[kind] + created_at;
     task->suppress_until = 0;
     task->ignore_count = 0;
+    task->overdue_level = TASK_ON_TIME;
     task->table_number = table;
     task->kind = kind;
 }
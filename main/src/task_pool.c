@@ -6,61 +6,320 @@
 extern task_id INVALID_TASK_ID;
 
 
-bool is_task_id_valid(task_id id) {
-    return id.index < TASK_POOL_CAPACITY;
+/* ------------------------------------------------------------------ */
+/* Slot bitmaps                                                        */
+/* ------------------------------------------------------------------ */
+
+static inline void bitmap_set(task_pool *pool, task_pool_set set, uint16_t index) {
+    pool->bitmap[set][index / TASK_POOL_WORD_BITS] |= 1u << (index % TASK_POOL_WORD_BITS);
 }
 
 
-void task_pool_init(task_pool *pool) {
-    if (!pool) return;
+static inline void bitmap_clear(task_pool *pool, task_pool_set set, uint16_t index) {
+    pool->bitmap[set][index / TASK_POOL_WORD_BITS] &= ~(1u << (index % TASK_POOL_WORD_BITS));
+}
+
+
+static inline bool bitmap_test(const task_pool *pool, task_pool_set set, uint16_t index) {
+    return (pool->bitmap[set][index / TASK_POOL_WORD_BITS] >> (index % TASK_POOL_WORD_BITS)) & 1u;
+}
+
+
+// Move an occupied slot to the status set matching `set`, out of the other two.
+static void bitmap_file(task_pool *pool, uint16_t index, task_pool_set set) {
+    bitmap_clear(pool, TASK_POOL_ELIGIBLE, index);
+    bitmap_clear(pool, TASK_POOL_SUPPRESSED, index);
+    bitmap_clear(pool, TASK_POOL_DEAD, index);
+    bitmap_set(pool, set, index);
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Ready queue (dense set of eligible slots)                          */
+/* ------------------------------------------------------------------ */
+
+static void ready_insert(task_pool *pool, uint16_t index) {
+    if (pool->ready_pos[index] != TASK_POOL_NO_POS) return;
+
+    pool->ready_pos[index] = pool->ready_count;
+    pool->ready[pool->ready_count++] = index;
+}
+
+
+static void ready_remove(task_pool *pool, uint16_t index) {
+    uint16_t pos = pool->ready_pos[index];
+    if (pos == TASK_POOL_NO_POS) return;
+
+    // Swap the last entry into the hole to keep the set dense
+    uint16_t last = pool->ready[--pool->ready_count];
+    pool->ready[pos] = last;
+    pool->ready_pos[last] = pos;
+    pool->ready_pos[index] = TASK_POOL_NO_POS;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Suppressed set (dense, unordered; expiry is timed by the caller)   */
+/* ------------------------------------------------------------------ */
+
+static void suppressed_insert(task_pool *pool, uint16_t index) {
+    if (pool->suppressed_pos[index] != TASK_POOL_NO_POS) return;
+
+    uint16_t pos = pool->suppressed_count++;
+    pool->suppressed[pos] = index;
+    pool->suppressed_pos[index] = pos;
+}
+
+
+static void suppressed_remove(task_pool *pool, uint16_t index) {
+    uint16_t pos = pool->suppressed_pos[index];
+    if (pos == TASK_POOL_NO_POS) return;
+
+    uint16_t last = --pool->suppressed_count;
+    if (pos != last) {
+        pool->suppressed[pos] = pool->suppressed[last];
+        pool->suppressed_pos[pool->suppressed[pos]] = pos;
+    }
+    pool->suppressed_pos[index] = TASK_POOL_NO_POS;
+}
+
+
+static void mark_changed(task_pool *pool, uint16_t index) {
+    if (pool->slots[index].changed) return;
+
+    pool->slots[index].changed = true;
+    pool->changed[pool->changed_count++] = index;
+}
+
+
+// File a slot on the queue matching its current status.
+static void queue_slot(task_pool *pool, uint16_t index) {
+    const task *task = &pool->slots[index].task_instance;
+
+    mark_changed(pool, index);
+
+    switch (task->status) {
+        case TASK_ELIGIBLE:
+            suppressed_remove(pool, index);
+            ready_insert(pool, index);
+            bitmap_file(pool, index, TASK_POOL_ELIGIBLE);
+            break;
+
+        case TASK_SUPPRESSED:
+            ready_remove(pool, index);
+            suppressed_insert(pool, index);
+            bitmap_file(pool, index, TASK_POOL_SUPPRESSED);
+            break;
+
+        default:
+            ready_remove(pool, index);
+            suppressed_remove(pool, index);
+            bitmap_file(pool, index, TASK_POOL_DEAD);
+            break;
+    }
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Per-table indexes (key map and table chains)                        */
+/* ------------------------------------------------------------------ */
+
+static inline uint16_t *key_entry(const task_pool *pool, uint8_t table_number, task_kind kind) {
+    return &pool->key_slot[(uint32_t)table_number * TASK_NOT_APPLICABLE + kind];
+}
+
+
+static void index_insert(task_pool *pool, uint16_t index) {
+    task_slot *slot = &pool->slots[index];
+    uint8_t table_number = slot->task_instance.table_number;
+
+    slot->table_prev = TASK_POOL_NO_POS;
+    slot->table_next = pool->table_head[table_number];
+    if (slot->table_next != TASK_POOL_NO_POS) pool->slots[slot->table_next].table_prev = index;
+    pool->table_head[table_number] = index;
+    slot->indexed = true;
+
+    *key_entry(pool, table_number, slot->task_instance.kind) = index;
+}
+
+
+static void index_remove(task_pool *pool, uint16_t index) {
+    task_slot *slot = &pool->slots[index];
+    if (!slot->indexed) return;
+
+    uint8_t table_number = slot->task_instance.table_number;
+    if (slot->table_prev != TASK_POOL_NO_POS) pool->slots[slot->table_prev].table_next = slot->table_next;
+    else                                      pool->table_head[table_number] = slot->table_next;
+    if (slot->table_next != TASK_POOL_NO_POS) pool->slots[slot->table_next].table_prev = slot->table_prev;
+    slot->indexed = false;
+
+    /* Chains run newest first, so the newest task left with this key is
+       the first one further down */
+    task_kind kind = slot->task_instance.kind;
+    uint16_t *key = key_entry(pool, table_number, kind);
+    if (*key != index) return;
+
+    uint16_t i = slot->table_next;
+    while (i != TASK_POOL_NO_POS && pool->slots[i].task_instance.kind != kind) i = pool->slots[i].table_next;
+    *key = i;
+}
+
+
+static task_id slot_id(const task_pool *pool, uint16_t index) {
+    if (index == TASK_POOL_NO_POS) return INVALID_TASK_ID;
+
+    task_id id = { .index = index, .generation = pool->slots[index].generation };
+    return id;
+}
+
+
+bool is_task_id_valid(const task_pool *pool, task_id id) {
+    return pool && id.index < pool->capacity;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Arena layout                                                        */
+/* ------------------------------------------------------------------ */
+
+static uint8_t *carve(uint8_t **cursor, size_t size) {
+    uint8_t *block = *cursor;
+    *cursor += size;
+    return block;
+}
+
+
+uint16_t task_pool_init(task_pool *pool, void *arena, size_t arena_size, uint16_t table_count) {
+    if (!pool) return 0;
 
     memset(pool, 0, sizeof(*pool));
-    for (uint16_t index = 0; index < TASK_POOL_CAPACITY; ++index) {
-        pool->slots[index].occupied = false;
-        pool->slots[index].generation = 0;
+    pool->free_head = TASK_POOL_NO_POS;
+    if (table_count > TASK_POOL_MAX_TABLES) table_count = TASK_POOL_MAX_TABLES;
+    if (!arena || arena_size < TASK_POOL_ARENA_SIZE(1, table_count)) return 0;
+
+    // Bitmaps cost a few bits per slot, rounded up to whole words, so settle
+    // the capacity down from the estimate that ignores them
+    size_t capacity = (arena_size - _Alignof(task_slot) - (size_t)table_count * TASK_POOL_BYTES_PER_TABLE) /
+                      TASK_POOL_BYTES_PER_SLOT;
+    if (capacity > TASK_POOL_MAX_CAPACITY) capacity = TASK_POOL_MAX_CAPACITY;
+    while (TASK_POOL_ARENA_SIZE(capacity, table_count) > arena_size) capacity--;
+
+    pool->capacity = (uint16_t)capacity;
+    pool->table_count = table_count;
+    pool->bitmap_words = (uint16_t)TASK_POOL_BITMAP_WORDS(capacity);
+
+    // Carve the arrays in descending alignment so each one starts aligned
+    uintptr_t base = ((uintptr_t)arena + _Alignof(task_slot) - 1) & ~(uintptr_t)(_Alignof(task_slot) - 1);
+    uint8_t *cursor = (uint8_t *)base;
+
+    pool->slots              = (task_slot *)carve(&cursor, capacity * sizeof(task_slot));
+    for (int set = 0; set < TASK_POOL_SET_COUNT; ++set) {
+        pool->bitmap[set]    = (uint32_t *)carve(&cursor, pool->bitmap_words * sizeof(uint32_t));
+        memset(pool->bitmap[set], 0, pool->bitmap_words * sizeof(uint32_t));
+    }
+    pool->rank               = (task_pool_rank_node *)carve(&cursor, capacity * sizeof(task_pool_rank_node));
+    pool->ready              = (uint16_t *)carve(&cursor, capacity * sizeof(uint16_t));
+    pool->ready_pos          = (uint16_t *)carve(&cursor, capacity * sizeof(uint16_t));
+    pool->suppressed         = (uint16_t *)carve(&cursor, capacity * sizeof(uint16_t));
+    pool->suppressed_pos     = (uint16_t *)carve(&cursor, capacity * sizeof(uint16_t));
+    pool->changed            = (uint16_t *)carve(&cursor, capacity * sizeof(uint16_t));
+    pool->key_slot           = (uint16_t *)carve(&cursor, (size_t)table_count * TASK_NOT_APPLICABLE * sizeof(uint16_t));
+    pool->table_head         = (uint16_t *)carve(&cursor, (size_t)table_count * sizeof(uint16_t));
+
+    memset(pool->slots, 0, capacity * sizeof(task_slot));
+    for (uint16_t index = 0; index < pool->capacity; ++index) {
+        pool->slots[index].next_free = (index + 1 < pool->capacity) ? (uint16_t)(index + 1) : TASK_POOL_NO_POS;
+        pool->ready_pos[index] = TASK_POOL_NO_POS;
+        pool->suppressed_pos[index] = TASK_POOL_NO_POS;
     }
+    memset(pool->key_slot, 0xFF, (size_t)table_count * TASK_NOT_APPLICABLE * sizeof(uint16_t));
+    memset(pool->table_head, 0xFF, (size_t)table_count * sizeof(uint16_t));
+    pool->free_head = 0;
+    pool->ready_count = 0;
+    pool->suppressed_count = 0;
+    pool->changed_count = 0;
+    pool->rank_valid = false;
+
+    return pool->capacity;
 }
 
 
 task_id task_pool_allocate(task_pool *pool) {
     task_id invalid = { .index = UINT16_MAX, .generation = 0 };
     if (!pool) return invalid;
+    if (pool->free_head == TASK_POOL_NO_POS) return invalid;
+
+    uint16_t index = pool->free_head;
+    task_slot *slot = &pool->slots[index];
 
-    for (uint16_t index = 0; index < TASK_POOL_CAPACITY; ++index) {
-        task_slot *slot = &pool->slots[index];
+    pool->free_head = slot->next_free;
+    slot->next_free = TASK_POOL_NO_POS;
+    slot->occupied = true;
+    bitmap_set(pool, TASK_POOL_OCCUPIED, index);
 
-        if (slot->occupied == false) {
-            slot->occupied = true;
+    task_id id = {
+        .index = index,
+        .generation = slot->generation
+    };
+    return id;
+}
 
-            task_id id = {
-                .index = index,
-                .generation = slot->generation
-            };
-            return id;
+
+bool task_pool_seed_free_list(task_pool *pool, const uint16_t *order, const uint16_t *generation, uint16_t count) {
+    if (!pool || !order || !generation || count != pool->capacity) return false;
+    if (task_pool_count(pool, TASK_POOL_OCCUPIED) != 0) return false;
+
+    // ready_pos is all TASK_POOL_NO_POS in an empty pool; borrow it to spot repeats
+    bool valid = true;
+    uint16_t marked = 0;
+    for (; marked < count; ++marked) {
+        uint16_t index = order[marked];
+        if (index >= pool->capacity || pool->ready_pos[index] != TASK_POOL_NO_POS) {
+            valid = false;
+            break;
         }
+        pool->ready_pos[index] = 0;
     }
+    for (uint16_t i = 0; i < marked; ++i) pool->ready_pos[order[i]] = TASK_POOL_NO_POS;
+    if (!valid) return false;
 
-    return invalid;
+    for (uint16_t i = 0; i < count; ++i) {
+        task_slot *slot = &pool->slots[order[i]];
+        slot->generation = generation[order[i]];
+        slot->next_free = (i + 1 < count) ? order[i + 1] : TASK_POOL_NO_POS;
+    }
+    pool->free_head = count ? order[0] : TASK_POOL_NO_POS;
+    return true;
 }
 
 
 void task_pool_free(task_pool *pool, task_id id) {
     if (!pool) return;
-    if (!is_task_id_valid(id)) return;
+    if (!is_task_id_valid(pool, id)) return;
 
     task_slot *slot = &pool->slots[id.index];
 
     if (slot->occupied == false) return;
     if (slot->generation != id.generation) return;
 
+    ready_remove(pool, id.index);
+    suppressed_remove(pool, id.index);
+    index_remove(pool, id.index);
+    mark_changed(pool, id.index);
+    for (int set = 0; set < TASK_POOL_SET_COUNT; ++set) {
+        bitmap_clear(pool, (task_pool_set)set, id.index);
+    }
+
     slot->occupied = false;
     slot->generation++;
+    slot->next_free = pool->free_head;
+    pool->free_head = id.index;
 }
 
 
 task *task_pool_get(task_pool *pool, task_id id) {
     if (!pool) return NULL;
-    if (!is_task_id_valid(id)) return NULL;
+    if (!is_task_id_valid(pool, id)) return NULL;
 
     task_slot *slot = &pool->slots[id.index];
 
@@ -73,7 +332,7 @@ task *task_pool_get(task_pool *pool, task_id id) {
 
 const task *task_pool_get_const(const task_pool *pool, task_id id) {
     if (!pool) return NULL;
-    if (!is_task_id_valid(id)) return NULL;
+    if (!is_task_id_valid(pool, id)) return NULL;
 
     const task_slot *slot = &pool->slots[id.index];
 
@@ -86,27 +345,21 @@ const task *task_pool_get_const(const task_pool *pool, task_id id) {
 
 task_id task_pool_find_by_key(const task_pool *pool, uint8_t table_number, task_kind kind) {
     if (!pool) return INVALID_TASK_ID;
+    if (table_number >= pool->table_count || kind >= TASK_NOT_APPLICABLE) return INVALID_TASK_ID;
 
-    for (uint16_t i = 0; i < TASK_POOL_CAPACITY; ++i) {
-        const task_slot *slot = &pool->slots[i];
-        if (!slot->occupied) continue;
+    uint16_t index = *key_entry(pool, table_number, kind);
+    if (index == TASK_POOL_NO_POS) return INVALID_TASK_ID;
 
-        const task *task = &slot->task_instance;
+    // Only treat it as “existing” if it’s still relevant
+    if (pool->slots[index].task_instance.status != TASK_ELIGIBLE) return INVALID_TASK_ID;
 
-        // Only treat it as “existing” if it’s still relevant
-        if (task->table_number == table_number && task->kind == kind &&
-            task->status == TASK_ELIGIBLE) {
-
-            task_id id = { .index = i, .generation = slot->generation };
-            return id;
-        }
-    }
-    return INVALID_TASK_ID;
+    return slot_id(pool, index);
 }
 
 
 task_id task_pool_add(task_pool *pool, uint8_t table_number, task_kind kind, time_ms now) {
     if (!pool) return INVALID_TASK_ID;
+    if (table_number >= pool->table_count || kind >= TASK_NOT_APPLICABLE) return INVALID_TASK_ID;
 
     // If a relevant task already exists, update it and return it.
     task_id existing = task_pool_find_by_key(pool, table_number, kind);
@@ -119,22 +372,20 @@ task_id task_pool_add(task_pool *pool, uint8_t table_number, task_kind kind, tim
             task->time_limit = now + TASK_TIME_LIMIT[kind];
             task->suppress_until = 0;
             task->ignore_count = 0;
+            task->overdue_level = TASK_ON_TIME;
             task->status = TASK_ELIGIBLE;
+            queue_slot(pool, existing.index);
         }
         return existing;
     }
 
     // If a dead version exists (completed/killed), free it so we can reuse the slot.
-    for (uint16_t i = 0; i < TASK_POOL_CAPACITY; ++i) {
-        task_slot *slot = &pool->slots[i];
-        if (!slot->occupied) continue;
-
-        task *task = &slot->task_instance;
-        if (task->table_number == table_number && task->kind == kind &&
+    for (uint16_t i = pool->table_head[table_number]; i != TASK_POOL_NO_POS; i = pool->slots[i].table_next) {
+        const task *task = &pool->slots[i].task_instance;
+        if (task->kind == kind &&
             (task->status == TASK_KILLED || task->status == TASK_COMPLETED)) {
 
-            task_id dead_task = { .index = i, .generation = slot->generation };
-            task_pool_free(pool, dead_task);
+            task_pool_free(pool, slot_id(pool, i));
             break;
         }
     }
@@ -150,7 +401,169 @@ task_id task_pool_add(task_pool *pool, uint8_t table_number, task_kind kind, tim
               kind,
               now,
               table_number);
+    index_insert(pool, id.index);
+    queue_slot(pool, id.index);
 
     return id;
 }
 
+
+task_id task_pool_table_first(const task_pool *pool, uint8_t table_number) {
+    if (!pool || table_number >= pool->table_count) return INVALID_TASK_ID;
+    return slot_id(pool, pool->table_head[table_number]);
+}
+
+
+task_id task_pool_table_next(const task_pool *pool, task_id id) {
+    if (!task_pool_get_const(pool, id)) return INVALID_TASK_ID;
+    if (!pool->slots[id.index].indexed) return INVALID_TASK_ID;
+    return slot_id(pool, pool->slots[id.index].table_next);
+}
+
+
+void task_pool_sync(task_pool *pool, task_id id) {
+    if (!task_pool_get(pool, id)) return;
+    queue_slot(pool, id.index);
+}
+
+
+uint16_t task_pool_wake_expired(task_pool *pool, time_ms now) {
+    if (!pool) return 0;
+
+    uint16_t woken = 0;
+    uint16_t pos = 0;
+    while (pos < pool->suppressed_count) {
+        uint16_t index = pool->suppressed[pos];
+        task *task = &pool->slots[index].task_instance;
+
+        if (now < task->suppress_until) {
+            pos++;
+            continue;
+        }
+
+        // Leaving the set moves the last entry into this position
+        refresh_task(task, now);
+        queue_slot(pool, index);
+        woken++;
+    }
+    return woken;
+}
+
+
+uint16_t task_pool_count(const task_pool *pool, task_pool_set set) {
+    if (!pool || set >= TASK_POOL_SET_COUNT) return 0;
+
+    uint32_t count = 0;
+    for (uint16_t w = 0; w < pool->bitmap_words; ++w) {
+        count += (uint32_t)__builtin_popcount(pool->bitmap[set][w]);
+    }
+    return (uint16_t)count;
+}
+
+
+void task_pool_clear_changed(task_pool *pool) {
+    if (!pool) return;
+
+    for (uint16_t i = 0; i < pool->changed_count; ++i) {
+        pool->slots[pool->changed[i]].changed = false;
+    }
+    pool->changed_count = 0;
+}
+
+
+uint16_t task_pool_reap(task_pool *pool) {
+    if (!pool) return 0;
+
+    // Freeing only clears the bits of the slot being freed, which the walk allows
+    uint16_t reaped = 0;
+    task_pool_iter it = task_pool_iter_begin(pool, TASK_POOL_DEAD);
+    for (uint16_t index = task_pool_iter_next(&it); index != TASK_POOL_NO_POS; index = task_pool_iter_next(&it)) {
+        task_pool_free(pool, slot_id(pool, index));
+        reaped++;
+    }
+    return reaped;
+}
+
+
+uint16_t task_pool_check_indexes(const task_pool *pool) {
+    if (!pool) return 0;
+
+    uint16_t errors = 0;
+    uint32_t chained = 0;
+
+    for (uint16_t table_number = 0; table_number < pool->table_count; ++table_number) {
+        uint16_t prev = TASK_POOL_NO_POS;
+        uint32_t length = 0;
+
+        for (uint16_t i = pool->table_head[table_number]; i != TASK_POOL_NO_POS; i = pool->slots[i].table_next) {
+            const task_slot *slot = &pool->slots[i];
+
+            // A cycle or a cross-linked chain would otherwise never end
+            if (i >= pool->capacity || ++length > pool->capacity) { errors++; break; }
+
+            if (!slot->occupied || !slot->indexed) errors++;
+            if (slot->task_instance.table_number != table_number) errors++;
+            if (slot->table_prev != prev) errors++;
+            prev = i;
+        }
+        chained += length;
+
+        // Each key names the first slot of its kind on the chain, if any
+        bool seen[TASK_NOT_APPLICABLE] = { false };
+        uint16_t expect[TASK_NOT_APPLICABLE];
+        for (uint16_t kind = 0; kind < TASK_NOT_APPLICABLE; ++kind) expect[kind] = TASK_POOL_NO_POS;
+
+        length = 0;
+        for (uint16_t i = pool->table_head[table_number]; i != TASK_POOL_NO_POS; i = pool->slots[i].table_next) {
+            if (i >= pool->capacity || ++length > pool->capacity) break;
+
+            task_kind kind = pool->slots[i].task_instance.kind;
+            if ((int)kind < (int)TASK_NOT_APPLICABLE && !seen[kind]) {
+                seen[kind] = true;
+                expect[kind] = i;
+            }
+        }
+
+        for (uint16_t kind = 0; kind < TASK_NOT_APPLICABLE; ++kind) {
+            if (*key_entry(pool, (uint8_t)table_number, (task_kind)kind) != expect[kind]) errors++;
+        }
+    }
+
+    uint32_t indexed = 0, flagged = 0;
+    for (uint16_t i = 0; i < pool->capacity; ++i) {
+        const task_slot *slot = &pool->slots[i];
+        if (slot->indexed) {
+            indexed++;
+            if (!slot->occupied) errors++;
+        }
+        if (slot->changed) flagged++;
+
+        if (bitmap_test(pool, TASK_POOL_OCCUPIED, i) != slot->occupied) errors++;
+
+        // Slots allocated but never filed carry only the occupied bit
+        bool eligible   = bitmap_test(pool, TASK_POOL_ELIGIBLE, i);
+        bool suppressed = bitmap_test(pool, TASK_POOL_SUPPRESSED, i);
+        bool dead       = bitmap_test(pool, TASK_POOL_DEAD, i);
+        if (!slot->occupied && (eligible || suppressed || dead)) errors++;
+        if (eligible + suppressed + dead > 1) errors++;
+        if (eligible   && slot->task_instance.status != TASK_ELIGIBLE) errors++;
+        if (suppressed && slot->task_instance.status != TASK_SUPPRESSED) errors++;
+        if (dead && slot->task_instance.status != TASK_COMPLETED && slot->task_instance.status != TASK_KILLED) errors++;
+    }
+    if (indexed != chained) errors++;
+
+    if (flagged != pool->changed_count) errors++;
+    for (uint16_t i = 0; i < pool->changed_count; ++i) {
+        if (pool->changed[i] >= pool->capacity || !pool->slots[pool->changed[i]].changed) errors++;
+    }
+
+    // Bits past the capacity in the last word must stay clear
+    if (pool->capacity % TASK_POOL_WORD_BITS) {
+        uint32_t tail = ~0u << (pool->capacity % TASK_POOL_WORD_BITS);
+        for (int set = 0; set < TASK_POOL_SET_COUNT; ++set) {
+            if (pool->bitmap[set][pool->bitmap_words - 1] & tail) errors++;
+        }
+    }
+
+    return errors;
+}
@@ -0,0 +1,230 @@
+#include "../include/timer_wheel.h"
+
+#include <string.h>
+
+
+#define SLOT_MASK       (TIMER_WHEEL_SLOTS - 1)
+#define DUE_LIST        (TIMER_WHEEL_LISTS - 1)
+
+_Static_assert(TIMER_WHEEL_SLOTS == 64, "occupancy bitmaps are uint64_t");
+_Static_assert(TIMER_WHEEL_CAPACITY < TIMER_NONE, "timer handles are uint16_t");
+
+
+static inline unsigned level_shift(unsigned level) {
+    return level * TIMER_WHEEL_SLOT_BITS;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Lists                                                               */
+/* ------------------------------------------------------------------ */
+
+static void list_push(timer_wheel *w, uint16_t list, uint16_t index) {
+    timer_entry *e = &w->entries[index];
+    e->list = list;
+    e->prev = TIMER_NONE;
+
+    if (list == DUE_LIST) {
+        // Due timers fire in the order they became due
+        e->next = TIMER_NONE;
+        e->prev = w->due_tail;
+        if (w->due_tail != TIMER_NONE) w->entries[w->due_tail].next = index;
+        else                           w->head[DUE_LIST] = index;
+        w->due_tail = index;
+        return;
+    }
+
+    e->next = w->head[list];
+    if (e->next != TIMER_NONE) w->entries[e->next].prev = index;
+    w->head[list] = index;
+    w->occupied[list / TIMER_WHEEL_SLOTS] |= 1ull << (list % TIMER_WHEEL_SLOTS);
+}
+
+
+static void list_unlink(timer_wheel *w, uint16_t index) {
+    timer_entry *e = &w->entries[index];
+    uint16_t list = e->list;
+
+    if (e->prev != TIMER_NONE) w->entries[e->prev].next = e->next;
+    else                       w->head[list] = e->next;
+    if (e->next != TIMER_NONE) w->entries[e->next].prev = e->prev;
+
+    if (list == DUE_LIST) {
+        if (w->due_tail == index) w->due_tail = e->prev;
+    } else if (w->head[list] == TIMER_NONE) {
+        w->occupied[list / TIMER_WHEEL_SLOTS] &= ~(1ull << (list % TIMER_WHEEL_SLOTS));
+    }
+    e->list = TIMER_NONE;
+}
+
+
+/* File a timer by the highest 6-bit group in which its expiry differs from now. */
+static void place(timer_wheel *w, uint16_t index) {
+    time_ms expires_at = w->entries[index].event.expires_at;
+
+    if (expires_at <= w->now) {
+        list_push(w, DUE_LIST, index);
+        return;
+    }
+
+    unsigned top_bit = 31u - (unsigned)__builtin_clz(expires_at ^ w->now);
+    unsigned level = top_bit / TIMER_WHEEL_SLOT_BITS;
+    unsigned slot = (expires_at >> level_shift(level)) & SLOT_MASK;
+    list_push(w, (uint16_t)(level * TIMER_WHEEL_SLOTS + slot), index);
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Advancing                                                           */
+/* ------------------------------------------------------------------ */
+
+/* Earliest time after now at which a slot must be emptied. Every occupied
+   slot lies ahead of now's group at its level, and lower levels always come
+   due before higher ones, so the first level with anything queued decides. */
+static time_ms next_cascade(const timer_wheel *w) {
+    for (unsigned level = 0; level < TIMER_WHEEL_LEVELS; ++level) {
+        unsigned shift = level_shift(level);
+        unsigned current = (w->now >> shift) & SLOT_MASK;
+        uint64_t ahead = w->occupied[level] & ~((2ull << current) - 1);
+        if (!ahead) continue;
+
+        unsigned slot = (unsigned)__builtin_ctzll(ahead);
+        uint64_t group = ((uint64_t)w->now >> (shift + TIMER_WHEEL_SLOT_BITS)) << (shift + TIMER_WHEEL_SLOT_BITS);
+        return (time_ms)(group | ((uint64_t)slot << shift));
+    }
+    return UINT32_MAX;
+}
+
+
+/* Re-file every slot that starts at now, highest level first so timers
+   cascading down land in slots emptied later in the same pass. */
+static void cascade(timer_wheel *w) {
+    for (int level = TIMER_WHEEL_LEVELS - 1; level >= 0; --level) {
+        unsigned shift = level_shift((unsigned)level);
+        if (((uint64_t)w->now & ((1ull << shift) - 1)) != 0) continue;
+
+        unsigned slot = (w->now >> shift) & SLOT_MASK;
+        if (!(w->occupied[level] & (1ull << slot))) continue;
+
+        uint16_t list = (uint16_t)(level * TIMER_WHEEL_SLOTS + slot);
+        uint16_t index = w->head[list];
+        w->head[list] = TIMER_NONE;
+        w->occupied[level] &= ~(1ull << slot);
+
+        while (index != TIMER_NONE) {
+            uint16_t next = w->entries[index].next;
+            place(w, index);
+            index = next;
+        }
+    }
+}
+
+
+static uint16_t fire_due(timer_wheel *w, timer_fire_fn fire, void *ctx) {
+    uint16_t fired = 0;
+
+    while (w->head[DUE_LIST] != TIMER_NONE) {
+        uint16_t index = w->head[DUE_LIST];
+        timer_event event = w->entries[index].event;
+
+        list_unlink(w, index);
+        w->entries[index].next = w->free_head;
+        w->free_head = index;
+        w->count--;
+
+        fire(ctx, &event);
+        fired++;
+    }
+    return fired;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* API                                                                 */
+/* ------------------------------------------------------------------ */
+
+void timer_wheel_init(timer_wheel *wheel, time_ms now) {
+    if (!wheel) return;
+
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->now = now;
+    for (uint16_t list = 0; list < TIMER_WHEEL_LISTS; ++list) {
+        wheel->head[list] = TIMER_NONE;
+    }
+    wheel->due_tail = TIMER_NONE;
+
+    for (uint16_t index = 0; index < TIMER_WHEEL_CAPACITY; ++index) {
+        wheel->entries[index].list = TIMER_NONE;
+        wheel->entries[index].next = (index + 1 < TIMER_WHEEL_CAPACITY) ? (uint16_t)(index + 1) : TIMER_NONE;
+    }
+    wheel->free_head = 0;
+}
+
+
+timer_handle timer_wheel_schedule(timer_wheel *wheel, const timer_event *event) {
+    if (!wheel || !event) return TIMER_NONE;
+    if (wheel->free_head == TIMER_NONE) return TIMER_NONE;
+
+    uint16_t index = wheel->free_head;
+    wheel->free_head = wheel->entries[index].next;
+    wheel->count++;
+
+    wheel->entries[index].event = *event;
+    place(wheel, index);
+    return index;
+}
+
+
+void timer_wheel_cancel(timer_wheel *wheel, timer_handle *handle) {
+    if (!wheel || !handle || *handle == TIMER_NONE) return;
+
+    uint16_t index = *handle;
+    *handle = TIMER_NONE;
+    if (index >= TIMER_WHEEL_CAPACITY || wheel->entries[index].list == TIMER_NONE) return;
+
+    list_unlink(wheel, index);
+    wheel->entries[index].next = wheel->free_head;
+    wheel->free_head = index;
+    wheel->count--;
+}
+
+
+uint16_t timer_wheel_advance(timer_wheel *wheel, time_ms now, timer_fire_fn fire, void *ctx) {
+    if (!wheel || !fire) return 0;
+
+    uint16_t fired = fire_due(wheel, fire, ctx);
+
+    while (wheel->now < now) {
+        time_ms next = next_cascade(wheel);
+        if (next > now) {
+            // Nothing queued comes due before now; skip straight there
+            wheel->now = now;
+            break;
+        }
+
+        wheel->now = next;
+        cascade(wheel);
+        fired += fire_due(wheel, fire, ctx);
+    }
+    return fired;
+}
+
+
+time_ms timer_wheel_next_expiry(const timer_wheel *wheel) {
+    if (!wheel) return UINT32_MAX;
+    if (wheel->head[DUE_LIST] != TIMER_NONE) return wheel->entries[wheel->head[DUE_LIST]].event.expires_at;
+
+    // The earliest timer is in the first occupied slot of the lowest occupied level
+    for (unsigned level = 0; level < TIMER_WHEEL_LEVELS; ++level) {
+        if (!wheel->occupied[level]) continue;
+
+        unsigned slot = (unsigned)__builtin_ctzll(wheel->occupied[level]);
+        time_ms earliest = UINT32_MAX;
+        for (uint16_t index = wheel->head[level * TIMER_WHEEL_SLOTS + slot]; index != TIMER_NONE;
+             index = wheel->entries[index].next) {
+            if (wheel->entries[index].event.expires_at < earliest) earliest = wheel->entries[index].event.expires_at;
+        }
+        return earliest;
+    }
+    return UINT32_MAX;
+}
@@ -1,5 +1,7 @@
 #include "../include/trace_scheduler.h"
 #include "../include/task_domain.h"
+#include "../include/floor_layout.h"
+#include "../include/decision_trace.h"
 
 #include <string.h>
 #include <float.h>
@@ -25,33 +27,24 @@
 #define ZONE_BATCH_BONUS            1.0f
 #define CROSS_ZONE_PENALTY          1.0f
 
-
 static const char *TAG = "trace_sched";
 
 
 typedef struct {
     task_id best_id;
-    float best_score;
-    uint8_t pending_count;
-    uint8_t critical_count;
+    sched_key best_key;
+    uint16_t pending_count;
+    uint16_t critical_count;
     task_id top_critical_id;
-    float top_critical_score;
+    sched_key top_critical_key;
+#ifdef DECISION_TRACE
+    uint8_t challenger_count;                           // best non-active tasks by ranking key
+    uint16_t challenger_index[DECISION_TRACE_TOP_N];
+    sched_key challenger_key[DECISION_TRACE_TOP_N];
+#endif
 } scheduler_scan_result;
 
 
-/* ------------------------------------------------------------------ */
-/* Zone model                                                          */
-/* ------------------------------------------------------------------ */
-
-typedef enum { ZONE_A, ZONE_B, ZONE_UNKNOWN } table_zone;
-
-static table_zone zone_of_table(uint8_t table_number) {
-    if ((table_number >= 1 && table_number <= 10) || (table_number >= 18 && table_number <= 24)) return ZONE_A;
-    if (table_number >= 11 && table_number <= 17) return ZONE_B;
-    return ZONE_UNKNOWN;
-}
-
-
 /* ------------------------------------------------------------------ */
 /* Batch-compatibility matrix                                          */
 /*   BATCH_COMPAT[active_kind][challenger_kind]                       */
@@ -82,150 +75,629 @@ static inline void scheduler_clear_active(scheduler *s, time_ms current_time) {
 }
 
 
-static float compute_task_urgency(const task *t, time_ms current_time) {
-    float overdue_ms = (current_time > t->time_limit)
-        ? (float)(current_time - t->time_limit) : 0.0f;
-    float urgency = overdue_ms / (60000.0f * URGENCY_GROWTH_RATE);
-    return (urgency > URGENCY_CAP) ? URGENCY_CAP : urgency;
+/* Time spent in [start, start + span], i.e. the clamped input of one
+   rising-then-flat score segment. */
+static inline time_ms clamp_elapsed(time_ms current_time, time_ms start, time_ms span) {
+    if (current_time <= start) return 0;
+    time_ms elapsed = current_time - start;
+    return (elapsed > span) ? span : elapsed;
 }
 
 
-static float task_base_score(const scheduler *s, const task *t, time_ms current_time) {
-    float urgency = compute_task_urgency(t, current_time);
-
-    float age_ms = (current_time > t->created_at)
-        ? (float)(current_time - t->created_at) : 0.0f;
-    float age = age_ms / (60000.0f * AGE_GROWTH_RATE);
-    if (age > AGE_CAP) age = AGE_CAP;
+static sched_key task_key(const scheduler *s, const task *t, time_ms current_time) {
+    sched_key urgency = s->model.urgency_rate * clamp_elapsed(current_time, t->time_limit, s->model.urgency_span_ms);
+    sched_key age     = s->model.age_rate     * clamp_elapsed(current_time, t->created_at, s->model.age_span_ms);
 
-    float score = s->cfg.base_priority_weight * (float)t->base_priority
-                + s->cfg.urgency_weight        * urgency
-                + s->cfg.age_weight            * age
-                - s->cfg.ignore_penalty_weight * (float)t->ignore_count;
+    sched_key key = s->model.base_term[t->kind]
+                  + urgency
+                  + age
+                  - s->model.ignore_penalty * t->ignore_count;
 
     ESP_LOGD(TAG, "base id=%u bp=%.2f age=%.2f urg=%.2f score=%.2f",
-        t->id.index, (double)t->base_priority, (double)age, (double)urgency, (double)score);
+        t->id.index, (double)t->base_priority, key_to_double(age), key_to_double(urgency), key_to_double(key));
+
+    return key;
+}
+
+
+/* Rate of task_key() in the segment that starts at current_time. */
+static sched_key task_key_rate(const scheduler *s, const task *t, time_ms current_time) {
+    sched_key rate = 0;
+
+    if (current_time >= t->created_at && current_time - t->created_at < s->model.age_span_ms)
+        rate += s->model.age_rate;
+    if (current_time >= t->time_limit && current_time - t->time_limit < s->model.urgency_span_ms)
+        rate += s->model.urgency_rate;
+
+    return rate;
+}
+
+
+/* First whole ms x >= 0 at which a line f0 + rate * x, rate > 0, is above
+   zero (strict) or at least zero. Keys are exact, so this is the crossing
+   the per-tick comparison sees, with no stepping. */
+static inline sched_key key_first_crossing(sched_key f0, sched_key rate, bool strict) {
+    if (f0 > 0 || (f0 == 0 && !strict)) return 0;
+    return strict ? (-f0) / rate + 1 : (-f0 + rate - 1) / rate;
+}
+
+
+static void scheduler_init_score_model(scheduler *s) {
+    const float ms_per_min = 60000.0f;
+
+    s->model.age_rate        = key_rate_per_min((double)s->cfg.age_weight     / AGE_GROWTH_RATE);
+    s->model.urgency_rate    = key_rate_per_min((double)s->cfg.urgency_weight / URGENCY_GROWTH_RATE);
+    s->model.age_span_ms     = (time_ms)(AGE_CAP     * ms_per_min * AGE_GROWTH_RATE);
+    s->model.urgency_span_ms = (time_ms)(URGENCY_CAP * ms_per_min * URGENCY_GROWTH_RATE);
+
+    for (int kind = 0; kind < (int)TASK_NOT_APPLICABLE; ++kind) {
+        s->model.base_term[kind] = key_from_double((double)s->cfg.base_priority_weight * TASK_BASE_PRIORITY[kind]);
+
+        for (int to_kind = 0; to_kind < (int)TASK_NOT_APPLICABLE; ++to_kind) {
+            s->model.zone_batch_bonus[kind][to_kind] =
+                key_from_double((double)s->cfg.zone_batch_bonus * BATCH_COMPAT[kind][to_kind]);
+        }
+    }
+    s->model.ignore_penalty     = key_from_double(s->cfg.ignore_penalty_weight);
+    s->model.preempt_delta      = key_from_double(s->cfg.preempt_delta);
+    s->model.cross_zone_penalty = key_from_double(s->cfg.cross_zone_penalty);
+}
+
+
+/* Zone-batch adjustment for moving from a task of from_kind at from_table
+   to one of to_kind at to_table. */
+static sched_key zone_transition_adjustment(const scheduler *s,
+                                            uint8_t from_table, task_kind from_kind,
+                                            uint8_t to_table, task_kind to_kind)
+{
+    sched_key adjustment = 0;
+    uint8_t from_zone = floor_layout_zone(from_table);
+    uint8_t to_zone   = floor_layout_zone(to_table);
+
+    if (from_zone != FLOOR_ZONE_NONE && to_zone == from_zone) {
+        if ((int)from_kind < (int)TASK_NOT_APPLICABLE && (int)to_kind < (int)TASK_NOT_APPLICABLE)
+            adjustment += s->model.zone_batch_bonus[from_kind][to_kind];
+    }
 
-    return score;
+    if (from_zone != FLOOR_ZONE_NONE && to_zone != FLOOR_ZONE_NONE && to_zone != from_zone)
+        adjustment -= s->model.cross_zone_penalty;
+
+    return adjustment;
 }
 
 
 /* Zone-batch adjustment applied to challenger tasks to influence
    next-task selection at natural breakpoints. */
-static float challenger_zone_adjustment(const scheduler *s,
-                                        const task *active_task,
-                                        const task *challenger_task)
+static sched_key challenger_zone_adjustment(const scheduler *s,
+                                            const task *active_task,
+                                            uint8_t challenger_table,
+                                            task_kind challenger_kind)
 {
-    if (!active_task) return 0.0f;
+    if (!active_task) return 0;
+
+    return zone_transition_adjustment(s, active_task->table_number, active_task->kind,
+                                      challenger_table, challenger_kind);
+}
+
 
-    float adjustment = 0.0f;
-    table_zone active_zone     = zone_of_table(active_task->table_number);
-    table_zone challenger_zone = zone_of_table(challenger_task->table_number);
+/* Strictly better score, or an equal score on a lower slot index. The ready
+   queue is unordered, so the index tie-break keeps selection identical to a
+   first-wins scan of the pool in slot order. */
+static inline bool ranks_above(sched_key key, uint16_t index, sched_key best_key, uint16_t best_index) {
+    return (key > best_key) || (key == best_key && index < best_index);
+}
 
-    if (active_zone != ZONE_UNKNOWN && challenger_zone == active_zone) {
-        int active_kind = (int)active_task->kind;
-        int challenger_kind = (int)challenger_task->kind;
-        if (active_kind < (int)TASK_NOT_APPLICABLE && challenger_kind < (int)TASK_NOT_APPLICABLE)
-            adjustment += s->cfg.zone_batch_bonus * BATCH_COMPAT[active_kind][challenger_kind];
+
+#ifdef DECISION_TRACE
+/* Keep the DECISION_TRACE_TOP_N best challengers seen by the scan. */
+static inline void trace_note_challenger(scheduler_scan_result *r, sched_key key, uint16_t index) {
+    uint8_t at = r->challenger_count;
+    while (at > 0 && ranks_above(key, index, r->challenger_key[at - 1], r->challenger_index[at - 1])) at--;
+    if (at >= DECISION_TRACE_TOP_N) return;
+
+    uint8_t last = (r->challenger_count < DECISION_TRACE_TOP_N) ? r->challenger_count++ : (DECISION_TRACE_TOP_N - 1);
+    for (uint8_t i = last; i > at; --i) {
+        r->challenger_key[i] = r->challenger_key[i - 1];
+        r->challenger_index[i] = r->challenger_index[i - 1];
     }
+    r->challenger_key[at] = key;
+    r->challenger_index[at] = index;
+}
+#endif
 
-    if (active_zone != ZONE_UNKNOWN && challenger_zone != ZONE_UNKNOWN && challenger_zone != active_zone)
-        adjustment -= s->cfg.cross_zone_penalty;
 
-    return adjustment;
+/* The critical test: challenger's raw score over the active score plus
+   preempt_delta. */
+static inline bool challenger_overtakes(const scheduler *s, const task *challenger, const task *active, time_ms t) {
+    return task_key(s, challenger, t) > (task_key(s, active, t) + s->model.preempt_delta);
+}
+
+
+/* Challenger score less the switch threshold; positive means critical. */
+static inline sched_key task_key_margin(const scheduler *s, const task *challenger, const task *active, time_ms t) {
+    return task_key(s, challenger, t) - (task_key(s, active, t) + s->model.preempt_delta);
+}
+
+
+/* First score breakpoint of t after `now` (age cap, time limit, urgency
+   cap), UINT32_MAX if none is left; its slope is constant until then. */
+static time_ms task_next_breakpoint(const scheduler *s, const task *t, time_ms now) {
+    time_ms breakpoints[3] = {
+        t->created_at + s->model.age_span_ms,
+        t->time_limit,
+        t->time_limit + s->model.urgency_span_ms,
+    };
+
+    time_ms next = UINT32_MAX;
+    for (int i = 0; i < 3; ++i) {
+        if (breakpoints[i] > now && breakpoints[i] < next) next = breakpoints[i];
+    }
+    return next;
 }
 
 
-static bool task_id_is_valid(task_id id) {
-    return id.index != UINT16_MAX;
+static inline time_ms min_time(time_ms a, time_ms b) {
+    return (a < b) ? a : b;
 }
 
 
-static bool active_task_is_usable(task *active_task) {
-    return active_task && active_task->status == TASK_ELIGIBLE;
+/* Earliest time in [from, ...) at which challenger's raw score exceeds the
+   active score by more than preempt_delta. Both scores are piecewise linear,
+   so the difference is walked segment by segment between breakpoints. */
+static bool predict_overtake(const scheduler *s, const task *challenger, const task *active,
+                             time_ms from, time_ms *out_time) {
+    time_ms segment_start = from;
+    while (1) {
+        if (challenger_overtakes(s, challenger, active, segment_start)) {
+            *out_time = segment_start;
+            return true;
+        }
+
+        // Next breakpoint strictly after this segment's start (UINT32_MAX = open-ended)
+        time_ms segment_end = min_time(task_next_breakpoint(s, challenger, segment_start),
+                                       task_next_breakpoint(s, active, segment_start));
+
+        sched_key rate = task_key_rate(s, challenger, segment_start) - task_key_rate(s, active, segment_start);
+        if (rate > 0) {
+            sched_key needed_ms = key_first_crossing(task_key_margin(s, challenger, active, segment_start), rate, true);
+            if (needed_ms < (sched_key)(segment_end - segment_start)) {
+                *out_time = segment_start + (time_ms)needed_ms;
+                return true;
+            }
+        }
+
+        if (segment_end == UINT32_MAX) return false;
+        segment_start = segment_end;
+    }
 }
 
 
-static void scheduler_set_active_task(scheduler *sched, task_id id, time_ms now) {
-    sched->has_active_task = true;
-    sched->active_task_id = id;
-    sched->task_active_since = now;
+/* Next time after `now` at which a challenger's membership of the critical
+   set could flip, given its margin over the threshold (positive while it is
+   critical) and the margin's rate until segment_end: the threshold crossing,
+   or segment_end, where a slope changes and it is re-evaluated. */
+static time_ms critical_flip_time(sched_key margin, sched_key rate, time_ms segment_end, time_ms now) {
+    // Leaving the set is the crossing of -margin to >= 0
+    sched_key needed_ms;
+    if (margin <= 0 && rate > 0)     needed_ms = key_first_crossing(margin, rate, true);
+    else if (margin > 0 && rate < 0) needed_ms = key_first_crossing(-margin, -rate, false);
+    else return segment_end;
+
+    if (needed_ms >= (sched_key)(segment_end - now)) return segment_end;
+    return now + (time_ms)((needed_ms > 0) ? needed_ms : 1);
 }
 
 
-static void scheduler_clear_critical_state(scheduler *sched) {
-    sched->critical_count = 0;
-    sched->top_critical_id = (task_id){ .index = UINT16_MAX, .generation = 0 };
+/* Next time after `now` at which a task ranked below another could outrank
+   it, given its lead (<= 0) and the lead's rate until segment_end. tie_wins
+   when an equal key is enough, as it is for the lower slot index in
+   ranks_above(). Zone adjustments are constant, so only raw slopes count. */
+static time_ms rank_change_time(sched_key lead, sched_key rate, bool tie_wins, time_ms segment_end, time_ms now) {
+    if (rate <= 0) return segment_end;
+
+    sched_key needed_ms = key_first_crossing(lead, rate, !tie_wins);
+    if (needed_ms >= (sched_key)(segment_end - now)) return segment_end;
+    return now + (time_ms)((needed_ms > 0) ? needed_ms : 1);
 }
 
 
-static scheduler_scan_result scheduler_scan_tasks(scheduler *sched, task_pool *pool, task *active_task, float active_raw_priority, bool dwell_satisfied, time_ms current_time) {
-    scheduler_scan_result result = {
-            .best_id = { .index = UINT16_MAX, .generation = 0 },
-            .best_score = -FLT_MAX,
-            .pending_count = 0,
-            .critical_count = 0,
-            .top_critical_id = { .index = UINT16_MAX, .generation = 0 },
-            .top_critical_score = -FLT_MAX,
-        };
+/* ------------------------------------------------------------------ */
+/* Ranking tree                                                        */
+/* ------------------------------------------------------------------ */
 
-    for (uint16_t i = 0; i < TASK_POOL_CAPACITY; ++i) {
-        task_slot *slot = &pool->slots[i];
-        if (!slot->occupied) {
-            continue;
+/* A kinetic tournament over the slots, stored in the pool. Each node holds
+   the best ranked ready slot below it and the best over the switch-prompt
+   threshold, both ranked as the old full scan did: raw key plus the zone
+   adjustment from the active task, ties to the lower slot index, the
+   active slot left out. Each node also holds the earliest time any of that
+   could change without an event: a challenger overtaking a winner, a slot
+   crossing the threshold, or either reaching a score breakpoint. A tick
+   recomputes the nodes above changed slots and the nodes whose time has
+   come, children first. */
+
+typedef struct {
+    const scheduler *s;
+    task_pool *pool;
+    const task *basis;              // zone adjustments are from it, NULL for none
+    uint16_t basis_index;           // left out of the ranking, UINT16_MAX for none
+    bool tracking;                  // keep the critical set against basis
+    sched_key threshold;            // basis key plus preempt_delta, when tracking
+    sched_key basis_rate;           // and the rate and next breakpoint of that key
+    time_ms basis_breakpoint;
+    time_ms now;
+} rank_context;
+
+
+// A slot as it is ranked this tick, its score line up to the next breakpoint
+typedef struct {
+    uint16_t index;                 // TASK_POOL_NO_POS for none
+    sched_key key;                  // raw key plus zone adjustment
+    sched_key rate;
+    time_ms breakpoint;
+} rank_entry;
+
+
+static inline const task *rank_task(const rank_context *c, uint16_t index) {
+    return &c->pool->slots[index].task_instance;
+}
+
+
+static inline sched_key rank_key(const rank_context *c, uint16_t index) {
+    const task *t = rank_task(c, index);
+    return task_key(c->s, t, c->now) + challenger_zone_adjustment(c->s, c->basis, t->table_number, t->kind);
+}
+
+
+static void rank_entry_load(const rank_context *c, uint16_t index, rank_entry *e) {
+    e->index = index;
+    if (index == TASK_POOL_NO_POS) return;
+
+    const task *t = rank_task(c, index);
+    e->key        = rank_key(c, index);
+    e->rate       = task_key_rate(c->s, t, c->now);
+    e->breakpoint = task_next_breakpoint(c->s, t, c->now);
+}
+
+
+/* A node as its parent sees it, with the entries of its best and best
+   critical slots. Leaves are evaluated here: a ready slot other than the
+   active one, critical when its raw key is over the threshold, due when it
+   could cross it. */
+static void rank_child(const rank_context *c, uint32_t node, task_pool_rank_node *out,
+                       rank_entry *best, rank_entry *best_critical) {
+    if (node < c->pool->capacity) {
+        *out = c->pool->rank[node];
+        rank_entry_load(c, out->best, best);
+        // The best critical slot is usually the best slot as well
+        if (out->best_critical == out->best) *best_critical = *best;
+        else                                 rank_entry_load(c, out->best_critical, best_critical);
+        return;
+    }
+
+    uint16_t index = (uint16_t)(node - c->pool->capacity);
+    *out = (task_pool_rank_node){
+        .best = TASK_POOL_NO_POS, .best_critical = TASK_POOL_NO_POS,
+        .due = UINT32_MAX, .due_critical = UINT32_MAX,
+    };
+    best->index = best_critical->index = TASK_POOL_NO_POS;
+    if (c->pool->ready_pos[index] == TASK_POOL_NO_POS || index == c->basis_index) return;
+
+    const task *t = rank_task(c, index);
+    sched_key raw = task_key(c->s, t, c->now);
+    out->best = index;
+    best->index      = index;
+    best->key        = raw + challenger_zone_adjustment(c->s, c->basis, t->table_number, t->kind);
+    best->rate       = task_key_rate(c->s, t, c->now);
+    best->breakpoint = task_next_breakpoint(c->s, t, c->now);
+    if (!c->tracking) return;
+
+    sched_key margin = raw - c->threshold;
+    if (margin > 0) {
+        out->best_critical = index;
+        out->critical_count = 1;
+        *best_critical = *best;
+    }
+    out->due = out->due_critical = critical_flip_time(margin, best->rate - c->basis_rate,
+                                                      min_time(best->breakpoint, c->basis_breakpoint), c->now);
+}
+
+
+static inline task_pool_rank_node rank_node(const rank_context *c, uint32_t node) {
+    if (node < c->pool->capacity) return c->pool->rank[node];
+
+    task_pool_rank_node out;
+    rank_entry best, best_critical;
+    rank_child(c, node, &out, &best, &best_critical);
+    return out;
+}
+
+
+/* The better ranked of a and b, either possibly empty, lowering *due to the
+   time the other could overtake it. */
+static uint16_t rank_pick(const rank_context *c, const rank_entry *a, const rank_entry *b, time_ms *due) {
+    if (a->index == TASK_POOL_NO_POS) return b->index;
+    if (b->index == TASK_POOL_NO_POS) return a->index;
+
+    if (ranks_above(b->key, b->index, a->key, a->index)) {
+        const rank_entry *winner = b;
+        b = a;
+        a = winner;
+    }
+    time_ms t = rank_change_time(b->key - a->key, b->rate - a->rate, b->index < a->index,
+                                 min_time(a->breakpoint, b->breakpoint), c->now);
+    if (t < *due) *due = t;
+    return a->index;
+}
+
+
+static void rank_merge(const rank_context *c, uint32_t node) {
+    task_pool_rank_node l, r;
+    rank_entry lb, rb, lc, rc;
+    rank_child(c, 2 * node, &l, &lb, &lc);
+    rank_child(c, 2 * node + 1, &r, &rb, &rc);
+    task_pool_rank_node *n = &c->pool->rank[node];
+
+    n->due_critical   = min_time(l.due_critical, r.due_critical);
+    n->best_critical  = rank_pick(c, &lc, &rc, &n->due_critical);
+    n->critical_count = (uint16_t)(l.critical_count + r.critical_count);
+
+    n->due  = min_time(min_time(l.due, r.due), n->due_critical);
+    n->best = rank_pick(c, &lb, &rb, &n->due);
+}
+
+
+static void rank_refresh(const rank_context *c, uint32_t node) {
+    for (uint32_t child = 2 * node; child <= 2 * node + 1; ++child) {
+        if (child < c->pool->capacity && c->pool->rank[child].due <= c->now) rank_refresh(c, child);
+    }
+    rank_merge(c, node);
+}
+
+
+static void rank_rebuild(const rank_context *c) {
+    for (uint32_t node = c->pool->capacity; node-- > 1; ) rank_merge(c, node);
+}
+
+
+// Mark the nodes above a slot for recomputing; above a marked node all are marked.
+static void rank_touch(task_pool *pool, uint16_t index) {
+    for (uint32_t node = ((uint32_t)index + pool->capacity) / 2; node >= 1 && pool->rank[node].due != 0; node /= 2) {
+        pool->rank[node].due = 0;
+    }
+}
+
+
+#ifdef DECISION_TRACE
+#define RANK_FRONTIER       (DECISION_TRACE_TOP_N * 17 + 1)
+
+/* The best ranked slots in order, walking down the tree best node first.
+   Reaching each leaf takes at most one node per level, 16 for the largest
+   pool, and each visit leaves one sibling behind. */
+static void rank_note_challengers(const rank_context *c, scheduler_scan_result *r) {
+    uint32_t frontier[RANK_FRONTIER];
+    sched_key frontier_key[RANK_FRONTIER];
+    uint16_t frontier_best[RANK_FRONTIER];
+    uint16_t count = 0;
+
+    task_pool_rank_node root = rank_node(c, 1);
+    if (root.best == TASK_POOL_NO_POS) return;
+    frontier[0] = 1;
+    frontier_key[0] = rank_key(c, root.best);
+    frontier_best[0] = root.best;
+    count = 1;
+
+    while (count > 0 && r->challenger_count < DECISION_TRACE_TOP_N) {
+        uint16_t top = 0;
+        for (uint16_t i = 1; i < count; ++i) {
+            if (ranks_above(frontier_key[i], frontier_best[i], frontier_key[top], frontier_best[top])) top = i;
         }
 
-        task *task_inst = &slot->task_instance;
-        refresh_task(task_inst, current_time);
+        uint32_t node = frontier[top];
+        sched_key key = frontier_key[top];
+        uint16_t best = frontier_best[top];
+        count--;
+        frontier[top] = frontier[count];
+        frontier_key[top] = frontier_key[count];
+        frontier_best[top] = frontier_best[count];
 
-        if (task_inst->status != TASK_ELIGIBLE) {
+        if (node >= c->pool->capacity) {
+            trace_note_challenger(r, key, best);
             continue;
         }
 
-        bool is_active = false;
-        if (sched->has_active_task && active_task) {
-            is_active =
-                (task_inst->id.index == sched->active_task_id.index) &&
-                (task_inst->id.generation == sched->active_task_id.generation);
+        for (uint32_t child = 2 * node; child <= 2 * node + 1 && count < RANK_FRONTIER; ++child) {
+            uint16_t child_best = rank_node(c, child).best;
+            if (child_best == TASK_POOL_NO_POS) continue;
+
+            frontier[count] = child;
+            frontier_key[count] = (child_best == best) ? key : rank_key(c, child_best);
+            frontier_best[count] = child_best;
+            count++;
         }
+    }
+}
+#endif
+
 
-        float raw_priority = task_base_score(sched, task_inst, current_time);
+static inline bool same_task_id(task_id a, task_id b) {
+    return a.index == b.index && a.generation == b.generation;
+}
 
-        /* Zone adjustment affects next-task ranking only.
-           It must never influence the raw preemption threshold. */
-        float ranking_score = is_active
-            ? raw_priority
-            : (raw_priority + challenger_zone_adjustment(sched, active_task, task_inst));
 
-        if (ranking_score > result.best_score) {
-            result.best_score = ranking_score;
-            result.best_id = task_inst->id;
-        }
+/* Bring the ranking tree up to date and read the tick's result off its root.
+   active_task may be ineligible; zone adjustments are still taken from it. */
+static scheduler_scan_result scheduler_rank_tasks(scheduler *sched, task_pool *pool, const task *active_task,
+                                                  bool active_usable, bool dwell_satisfied, time_ms current_time) {
+    scheduler_scan_result result = {
+            .best_id = { .index = UINT16_MAX, .generation = 0 },
+            .best_key = KEY_MIN,
+            .pending_count = 0,
+            .critical_count = 0,
+            .top_critical_id = { .index = UINT16_MAX, .generation = 0 },
+            .top_critical_key = KEY_MIN,
+        };
+    if (pool->capacity == 0) return result;
+
+    task_id basis_id = active_task ? sched->active_task_id : INVALID_TASK_ID;
+    rank_context c = {
+        .s           = sched,
+        .pool        = pool,
+        .basis       = active_task,
+        .basis_index = active_task ? sched->active_task_id.index : UINT16_MAX,
+        .tracking    = active_usable,
+        .now         = current_time,
+    };
+    if (c.tracking) {
+        c.threshold        = task_key(sched, active_task, current_time) + sched->model.preempt_delta;
+        c.basis_rate       = task_key_rate(sched, active_task, current_time);
+        c.basis_breakpoint = task_next_breakpoint(sched, active_task, current_time);
+    }
 
-        if (!is_active) {
-            result.pending_count++;
+    bool rebuild = !pool->rank_valid || !sched->rank_built || !same_task_id(basis_id, sched->rank_basis) ||
+                   (c.tracking && !sched->rank_tracking);
+    for (uint16_t i = 0; i < pool->changed_count && !rebuild; ++i) {
+        uint16_t index = pool->changed[i];
 
-            if (dwell_satisfied &&
-                raw_priority > (active_raw_priority + sched->cfg.preempt_delta)) {
+        // A change to the active task moves the threshold every critical test uses
+        if (index == c.basis_index && c.tracking) rebuild = true;
+        else                                      rank_touch(pool, index);
+    }
+    task_pool_clear_changed(pool);
 
-                result.critical_count++;
+    if (rebuild) rank_rebuild(&c);
+    else if (pool->capacity > 1 && pool->rank[1].due <= current_time) rank_refresh(&c, 1);
 
-                if (ranking_score > result.top_critical_score) {
-                    result.top_critical_score = ranking_score;
-                    result.top_critical_id = task_inst->id;
-                }
-            }
+    pool->rank_valid     = true;
+    sched->rank_built    = true;
+    sched->rank_basis    = basis_id;
+    sched->rank_tracking = c.tracking;
+
+    task_pool_rank_node root = rank_node(&c, 1);
+    if (root.best != TASK_POOL_NO_POS) {
+        result.best_id  = pool->slots[root.best].task_instance.id;
+        result.best_key = rank_key(&c, root.best);
+    }
+    if (dwell_satisfied && c.tracking) {
+        result.critical_count = root.critical_count;
+        if (root.best_critical != TASK_POOL_NO_POS) {
+            result.top_critical_id  = pool->slots[root.best_critical].task_instance.id;
+            result.top_critical_key = rank_key(&c, root.best_critical);
         }
     }
 
+#ifdef DECISION_TRACE
+    if (sched->record_decisions) rank_note_challengers(&c, &result);
+#endif
+
+    /* Every ready task other than the active one is pending. */
+    bool active_in_ready = active_task && active_task->status == TASK_ELIGIBLE;
+    result.pending_count = (uint16_t)(pool->ready_count - (active_in_ready ? 1 : 0));
+
     return result;
 }
 
 
+/* ------------------------------------------------------------------ */
+/* Decision trace                                                      */
+/* ------------------------------------------------------------------ */
+
+/* Record the outcome of a tick. prev_active is the active task the scan
+   ranked against; pool and scan may be NULL when there was no scan. */
+static void trace_decision(const scheduler *s, const task_pool *pool, const task *prev_active,
+                           const scheduler_scan_result *scan, decision_reason reason,
+                           uint8_t flags, time_ms now)
+{
+#ifdef DECISION_TRACE
+    if (!s->record_decisions) return;
+
+    decision_record rec = {
+        .time_ms        = now,
+        .active_index   = UINT16_MAX,
+        .reason         = (uint8_t)reason,
+        .pending_count  = (uint8_t)(s->pending_count > UINT8_MAX ? UINT8_MAX : s->pending_count),
+        .critical_count = (uint8_t)(s->critical_count > UINT8_MAX ? UINT8_MAX : s->critical_count),
+    };
+
+    if (s->has_active_task) {
+        flags |= DECISION_FLAG_HAS_ACTIVE;
+        rec.active_index      = s->active_task_id.index;
+        rec.active_generation = s->active_task_id.generation;
+
+        const task *active = pool ? task_pool_get_const(pool, s->active_task_id) : NULL;
+        if (active) rec.active_score_q8 = key_to_q8(task_key(s, active, now));
+    }
+    rec.flags = flags;
+
+    for (uint8_t i = 0; scan && pool && i < scan->challenger_count; ++i) {
+        const task *t = &pool->slots[scan->challenger_index[i]].task_instance;
+        decision_challenger *c = &rec.challengers[i];
+
+        c->index      = scan->challenger_index[i];
+        c->table      = t->table_number;
+        c->kind       = (uint8_t)t->kind;
+        c->base_q8    = key_to_q8(s->model.base_term[t->kind] - s->model.ignore_penalty * t->ignore_count);
+        c->urgency_q8 = key_to_q8(s->model.urgency_rate * clamp_elapsed(now, t->time_limit, s->model.urgency_span_ms));
+        c->age_q8     = key_to_q8(s->model.age_rate * clamp_elapsed(now, t->created_at, s->model.age_span_ms));
+        c->zone_q8    = key_to_q8(challenger_zone_adjustment(s, prev_active, t->table_number, t->kind));
+        rec.challenger_count++;
+    }
+
+    decision_trace_record(&rec);
+#else
+    (void)s; (void)pool; (void)prev_active; (void)scan; (void)reason; (void)flags; (void)now;
+#endif
+}
+
+
 /* ------------------------------------------------------------------ */
 /* API                                                                 */
 /* ------------------------------------------------------------------ */
 
+sched_key scheduler_task_key(const scheduler *s, const task *t, time_ms now) {
+    return task_key(s, t, now);
+}
+
+
+sched_score scheduler_task_score(const scheduler *s, const task *t, time_ms now) {
+    return score_from_key(task_key(s, t, now));
+}
+
+
+sched_key scheduler_transition_key(const scheduler *s,
+                                   uint8_t from_table, task_kind from_kind,
+                                   uint8_t to_table, task_kind to_kind)
+{
+    return zone_transition_adjustment(s, from_table, from_kind, to_table, to_kind);
+}
+
+
+sched_score scheduler_transition_adjustment(const scheduler *s,
+                                            uint8_t from_table, task_kind from_kind,
+                                            uint8_t to_table, task_kind to_kind)
+{
+    return score_from_key(zone_transition_adjustment(s, from_table, from_kind, to_table, to_kind));
+}
+
+
+void scheduler_transition_key_bounds(const scheduler *s, sched_key *min, sched_key *max) {
+    // Unzoned tables adjust by nothing, other zones by the penalty
+    *min = -s->model.cross_zone_penalty;
+    *max = 0;
+    if (*min > 0) {
+        *max = *min;
+        *min = 0;
+    }
+
+    for (int from = 0; from < (int)TASK_NOT_APPLICABLE; ++from) {
+        for (int to = 0; to < (int)TASK_NOT_APPLICABLE; ++to) {
+            sched_key bonus = s->model.zone_batch_bonus[from][to];
+            if (bonus < *min) *min = bonus;
+            if (bonus > *max) *max = bonus;
+        }
+    }
+}
+
+
 void scheduler_init(scheduler *s, const scheduler_config *cfg) {
     memset(s, 0, sizeof(*s));
     if (cfg) s->cfg = *cfg;
@@ -239,6 +711,8 @@ void scheduler_init(scheduler *s, const scheduler_config *cfg) {
     if (s->cfg.zone_batch_bonus == 0)      s->cfg.zone_batch_bonus       = ZONE_BATCH_BONUS;
     if (s->cfg.cross_zone_penalty == 0)    s->cfg.cross_zone_penalty     = CROSS_ZONE_PENALTY;
 
+    scheduler_init_score_model(s);
+
     s->has_active_task           = false;
     s->active_task_id.index      = UINT16_MAX;
     s->active_task_id.generation = 0;
@@ -247,40 +721,44 @@ void scheduler_init(scheduler *s, const scheduler_config *cfg) {
     s->critical_count            = 0;
     s->top_critical_id.index     = UINT16_MAX;
     s->top_critical_id.generation = 0;
+    s->rank_built                = false;
+    s->rank_tracking             = false;
+    s->rank_basis                = INVALID_TASK_ID;
+    s->record_decisions          = true;
 }
 
 
 void scheduler_tick(scheduler *sched, task_pool *pool, time_ms current_time) {
     task *active_task = NULL;
-    float active_raw_priority = -FLT_MAX;
     bool active_usable = false;
     bool active_task_changed = false;
 
     if (sched->has_active_task) {
         active_task = task_pool_get(pool, sched->active_task_id);
         if (active_task) {
-            refresh_task(active_task, current_time);
             active_usable = (active_task->status == TASK_ELIGIBLE);
-            if (active_usable) {
-                active_raw_priority = task_base_score(sched, active_task, current_time);
-            }
         }
     }
 
     time_ms dwell_elapsed = current_time - sched->task_active_since;
     bool dwell_satisfied = (dwell_elapsed >= sched->cfg.min_dwell_time_ms);
 
-    scheduler_scan_result scan = scheduler_scan_tasks(sched, pool, active_task, active_raw_priority, dwell_satisfied, current_time);
+    scheduler_scan_result scan = scheduler_rank_tasks(sched, pool, active_task, active_usable, dwell_satisfied, current_time);
 
     sched->pending_count   = scan.pending_count;
     sched->critical_count  = scan.critical_count;
     sched->top_critical_id = scan.top_critical_id;
 
+    uint8_t trace_flags = dwell_satisfied ? DECISION_FLAG_DWELL_SATISFIED : 0;
+
     // Case 1: current active task is still valid. Keep it
     if (sched->has_active_task && active_usable) {
+        trace_decision(sched, pool, active_task, &scan, DECISION_KEEP, trace_flags, current_time);
         return;
     }
 
+    decision_reason reason;
+
     // Case 2: no valid active task remains, but a replacement exists
     if (scan.best_id.index != UINT16_MAX) {
         bool was_uninitialised = !sched->has_active_task;
@@ -297,24 +775,32 @@ void scheduler_tick(scheduler *sched, task_pool *pool, time_ms current_time) {
         sched->critical_count  = 0;
         sched->top_critical_id = (task_id){ .index = UINT16_MAX, .generation = 0 };
 
+        /* The scan counted against the old active task; the new one comes off
+           the ready queue. Nothing else recounts until the next deadline. */
+        sched->pending_count = (uint16_t)(pool->ready_count - 1);
+
+        reason = was_stale ? DECISION_STALE_REPLACE
+               : was_ineligible ? DECISION_INELIGIBLE_REPLACE
+               : DECISION_INIT_SELECT;
+
         if (was_uninitialised) {
             ESP_LOGI(TAG, "init_select t=%lu active=(%u,%u) score=%.2f",
                 (unsigned long)current_time,
                 (unsigned)scan.best_id.index,
                 (unsigned)scan.best_id.generation,
-                (double)scan.best_score);
+                key_to_double(scan.best_key));
         } else if (was_stale) {
             ESP_LOGW(TAG, "active_stale t=%lu -> best=(%u,%u) score=%.2f",
                 (unsigned long)current_time,
                 (unsigned)scan.best_id.index,
                 (unsigned)scan.best_id.generation,
-                (double)scan.best_score);
+                key_to_double(scan.best_key));
         } else if (was_ineligible) {
             ESP_LOGI(TAG, "active_ineligible t=%lu -> best=(%u,%u) score=%.2f",
                 (unsigned long)current_time,
                 (unsigned)scan.best_id.index,
                 (unsigned)scan.best_id.generation,
-                (double)scan.best_score);
+                key_to_double(scan.best_key));
         }
     }
     // Case 3: no valid active task remains, and no eligible replacement exists
@@ -324,9 +810,12 @@ void scheduler_tick(scheduler *sched, task_pool *pool, time_ms current_time) {
         sched->pending_count   = 0;
         sched->critical_count  = 0;
         sched->top_critical_id = (task_id){ .index = UINT16_MAX, .generation = 0 };
+        trace_decision(sched, pool, active_task, &scan, DECISION_CLEAR, trace_flags, current_time);
         return;
     }
 
+    trace_decision(sched, pool, active_task, &scan, reason, trace_flags, current_time);
+
     if (active_task_changed) {
         task *newly_active = task_pool_get(pool, sched->active_task_id);
         if (!newly_active) {
@@ -349,6 +838,84 @@ void scheduler_force_active(scheduler *s, task_id id, time_ms current_time_ms) {
     s->has_active_task   = true;
     s->active_task_id    = id;
     s->task_active_since = current_time_ms;
+
+    // The dwell time restarts, so nothing can prompt again until it ends
+    s->critical_count  = 0;
+    s->top_critical_id = (task_id){ .index = UINT16_MAX, .generation = 0 };
+
+    trace_decision(s, NULL, NULL, NULL, DECISION_FORCED, 0, current_time_ms);
     ESP_LOGI(TAG, "force_active (%u,%u) t=%lu",
         (unsigned)id.index, (unsigned)id.generation, (unsigned long)current_time_ms);
 }
+
+
+bool scheduler_predict_next_switch(const scheduler *s, const task_pool *pool, time_ms now,
+                                   time_ms *out_time, task_id *out_id) {
+    if (!s || !pool || !out_time || !s->has_active_task) return false;
+
+    const task *active = task_pool_get_const(pool, s->active_task_id);
+    if (!active || active->status != TASK_ELIGIBLE) return false;
+
+    // No prompt can appear before the dwell time on the active task has elapsed
+    time_ms earliest = s->task_active_since + s->cfg.min_dwell_time_ms;
+    if (earliest < now) earliest = now;
+
+    bool found = false;
+    time_ms best_time = UINT32_MAX;
+    task_id best_id = INVALID_TASK_ID;
+
+    for (uint16_t pos = 0; pos < pool->ready_count; ++pos) {
+        const task *challenger = &pool->slots[pool->ready[pos]].task_instance;
+        if (challenger == active) continue;
+
+        time_ms t;
+        if (predict_overtake(s, challenger, active, earliest, &t) && t < best_time) {
+            found = true;
+            best_time = t;
+            best_id = challenger->id;
+        }
+    }
+
+    // Suppressed tasks can only challenge once their suppression has expired
+    for (uint16_t pos = 0; pos < pool->suppressed_count; ++pos) {
+        const task *challenger = &pool->slots[pool->suppressed[pos]].task_instance;
+        time_ms from = (challenger->suppress_until > earliest) ? challenger->suppress_until : earliest;
+
+        time_ms t;
+        if (predict_overtake(s, challenger, active, from, &t) && t < best_time) {
+            found = true;
+            best_time = t;
+            best_id = challenger->id;
+        }
+    }
+
+    if (!found) return false;
+
+    *out_time = best_time;
+    if (out_id) *out_id = best_id;
+    return true;
+}
+
+
+time_ms scheduler_next_change(const scheduler *s, const task_pool *pool, time_ms now) {
+    time_ms next = UINT32_MAX;
+
+    if (!s->has_active_task) return next;
+
+    const task *active = task_pool_get_const(pool, s->active_task_id);
+    if (!active || active->status != TASK_ELIGIBLE) return next;
+
+    // Until the dwell time has elapsed no prompt can appear, and nothing else is time-driven
+    time_ms dwell_end = s->task_active_since + s->cfg.min_dwell_time_ms;
+    if (dwell_end > now) return (dwell_end < next) ? dwell_end : next;
+
+    // A tree the last tick left behind says nothing about changes since
+    if (pool->changed_count > 0 || !pool->rank_valid || !s->rank_built || !s->rank_tracking ||
+        !same_task_id(s->rank_basis, s->active_task_id)) {
+        return now + 1;
+    }
+    if (pool->capacity < 2) return next;
+
+    next = pool->rank[1].due_critical;
+    return (next > now) ? next : now + 1;
+}
@@ -1,127 +1,337 @@
 #include <string.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "../include/trace_system.h"
 #include "../include/table_fsm.h"
 #include "../include/task_pool.h"
 #include "../include/trace_scheduler.h"
-#include "../include/touch_controller_util.h"
+#include "../include/floor_layout.h"
+#include "../include/timer_wheel.h"
 
 #include "esp_log.h"
+#include "esp_rom_crc.h"
 
 
-#define DEBUG_STALE_STATE
+_Static_assert(3 * SYSTEM_TASK_CAPACITY + MAX_TABLES + 1 <= TIMER_WHEEL_CAPACITY,
+               "timer wheel too small for every task, table and scheduler timer");
+_Static_assert(FLOOR_MAX_TABLES >= MAX_TABLES,
+               "floor layout too small: tables past it would have no zone and no distance; raise FLOOR_MAX_TABLES");
 
+static const char *SYS_TAG = "SYS";
 
-table_context table_fsm_instances[MAX_TABLES];
-static task_pool scheduler_task_pool;
-static scheduler task_scheduler;
 
-static const char *SYS_TAG = "SYS";
+/* Active set: the tables that are not IDLE, packed densely like the pool's
+   ready queue. active_table_pos maps table -> position, ACTIVE_NO_POS for
+   an IDLE table. Every transition into or out of IDLE goes through
+   retire_table_tasks(), which keeps the two in step. */
+#define ACTIVE_NO_POS   UINT8_MAX
+#define TABLE_WORDS     ((MAX_TABLES + 31) / 32)
 
 
-#ifdef DEBUG_STALE_STATE
-static void debug_validate_system_state(void) {
-    for (uint8_t table = 0; table < MAX_TABLES; ++table) {
-        task_kind expected = system_get_current_task_kind_for_table(table);
-        task *actual = system_get_current_task_pointer_for_table(table);
-
-        if (expected == TASK_NOT_APPLICABLE) {
-            if (actual) {
-                ESP_LOGE(SYS_TAG,
-                    "INVARIANT FAIL: table=%u state=%d expects no task but found %s status=%s",
-                    table,
-                    table_fsm_instances[table].state,
-                    task_kind_to_str(actual->kind),
-                    task_status_to_str(actual->status));
-            }
+static inline bool table_task_killed(const trace_system_ctx *ctx, uint8_t table_number) {
+    return (ctx->killed_task_tables[table_number / 32] >> (table_number % 32)) & 1u;
+}
+
+
+static inline void set_table_task_killed(trace_system_ctx *ctx, uint8_t table_number, bool killed) {
+    uint32_t bit = 1u << (table_number % 32);
+    if (killed) ctx->killed_task_tables[table_number / 32] |= bit;
+    else        ctx->killed_task_tables[table_number / 32] &= ~bit;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Invariant checks                                                    */
+/*   check_invariants() runs after every system call. Below             */
+/*   SYSTEM_CHECK_FULL it covers the tables touched since the last     */
+/*   call, then a rotating sample of active tables and pool slots, all */
+/*   within the SYSTEM_CHECK_*_BUDGET limits. Tables touched faster    */
+/*   than the budget stay marked and are checked on later calls. Idle  */
+/*   tables are left to the slot sweep, which flags any live task on   */
+/*   one, so no call costs more with more tables on the floor.         */
+/* ------------------------------------------------------------------ */
+
+#if SYSTEM_CHECK_LEVEL != SYSTEM_CHECK_OFF
+static void report_violation(trace_system_ctx *ctx, system_invariant kind, uint8_t table_number, uint16_t slot) {
+    ctx->check_stats.violations++;
+    ctx->check_stats.by_kind[kind]++;
+    ctx->check_stats.last_kind  = (uint8_t)kind;
+    ctx->check_stats.last_table = table_number;
+
+#if SYSTEM_CHECK_LEVEL >= SYSTEM_CHECK_LOG
+    ESP_LOGE(SYS_TAG, "INVARIANT FAIL: %s table=%u state=%d slot=%u",
+             system_invariant_to_str(kind), (unsigned)table_number,
+             (table_number < ctx->table_count) ? (int)ctx->tables[table_number].state : -1, (unsigned)slot);
+#else
+    (void)slot;
+#endif
+}
+
+
+static inline void mark_table_touched(trace_system_ctx *ctx, uint8_t table_number) {
+    if (table_number < ctx->table_count) ctx->check_touched_tables[table_number / 32] |= 1u << (table_number % 32);
+}
+
+
+static inline void mark_task_touched(trace_system_ctx *ctx, task_id id) {
+    const task *t = task_pool_get_const(&ctx->pool, id);
+    if (t) mark_table_touched(ctx, t->table_number);
+}
+
+
+/* The table's live tasks must be exactly the one its state calls for.
+   Walks the table chain rather than the key map, which only returns
+   eligible tasks and would report every ignored task as missing. */
+static void check_table(trace_system_ctx *ctx, uint8_t table_number) {
+    task_kind expected = system_ctx_get_current_task_kind_for_table(ctx, table_number);
+    bool found = false;
+
+    for (task_id id = task_pool_table_first(&ctx->pool, table_number);
+         id.index != UINT16_MAX;
+         id = task_pool_table_next(&ctx->pool, id)) {
+
+        const task *t = task_pool_get_const(&ctx->pool, id);
+        if (t->status != TASK_ELIGIBLE && t->status != TASK_SUPPRESSED) continue;
+
+        if (t->kind == expected && !found) {
+            found = true;
         } else {
-            if (!actual) {
-                ESP_LOGE(SYS_TAG,
-                    "INVARIANT FAIL: table=%u state=%d expects task=%s but found none",
-                    table,
-                    table_fsm_instances[table].state,
-                    task_kind_to_str(expected));
-            } else if (actual->kind != expected) {
-                ESP_LOGE(SYS_TAG,
-                    "INVARIANT FAIL: table=%u state=%d expects task=%s but found %s status=%s",
-                    table,
-                    table_fsm_instances[table].state,
-                    task_kind_to_str(expected),
-                    task_kind_to_str(actual->kind),
-                    task_status_to_str(actual->status));
-            } else if (actual->status != TASK_ELIGIBLE && actual->status != TASK_SUPPRESSED) {
-                ESP_LOGE(SYS_TAG,
-                    "INVARIANT FAIL: table=%u state=%d expected task=%s has bad status=%s",
-                    table,
-                    table_fsm_instances[table].state,
-                    task_kind_to_str(actual->kind),
-                    task_status_to_str(actual->status));
-            }
+            report_violation(ctx, SYSTEM_INVARIANT_STALE_TASK, table_number, id.index);
         }
     }
 
-    if (task_scheduler.has_active_task) {
-        const task *active = task_pool_get_const(&scheduler_task_pool, task_scheduler.active_task_id);
-        if (!active) {
-            ESP_LOGE(SYS_TAG, "INVARIANT FAIL: scheduler active task id is stale");
-        } else if (active->status != TASK_ELIGIBLE) {
-            ESP_LOGE(SYS_TAG, "INVARIANT FAIL: scheduler active task %s table=%u status=%s",
-                task_kind_to_str(active->kind),
-                active->table_number,
-                task_status_to_str(active->status));
-        }
+    // A task ignored until it was killed leaves its table without one, legitimately
+    if (expected != TASK_NOT_APPLICABLE && !found && !table_task_killed(ctx, table_number)) {
+        report_violation(ctx, SYSTEM_INVARIANT_MISSING_TASK, table_number, TASK_POOL_NO_POS);
+    }
+
+    uint8_t pos = ctx->active_table_pos[table_number];
+    bool in_set = pos != ACTIVE_NO_POS && pos < ctx->active_table_count && ctx->active_tables[pos] == table_number;
+    if (in_set != (ctx->tables[table_number].state != TABLE_IDLE)) {
+        report_violation(ctx, SYSTEM_INVARIANT_ACTIVE_SET, table_number, TASK_POOL_NO_POS);
     }
 }
 
 
-static void debug_log_pool_usage(void) {
-    uint16_t occupied = 0;
-    uint16_t eligible = 0;
-    uint16_t suppressed = 0;
-    uint16_t completed = 0;
-    uint16_t killed = 0;
+static void check_slot(trace_system_ctx *ctx, uint16_t index) {
+    const task_slot *slot = &ctx->pool.slots[index];
+    if (!slot->occupied) return;
 
-    for (uint16_t i = 0; i < TASK_POOL_CAPACITY; ++i) {
-        task_slot *slot = &scheduler_task_pool.slots[i];
-        if (!slot->occupied) {
-            continue;
+    // Idle tables are not sampled by table, so a task left on one is caught here
+    uint8_t table_number = slot->task_instance.table_number;
+    if ((slot->task_instance.status == TASK_ELIGIBLE || slot->task_instance.status == TASK_SUPPRESSED) &&
+        (table_number >= ctx->table_count || ctx->tables[table_number].state == TABLE_IDLE)) {
+        report_violation(ctx, SYSTEM_INVARIANT_STALE_TASK, table_number, index);
+    }
+
+    if (slot->task_instance.status == TASK_ELIGIBLE && ctx->pool.ready_pos[index] == TASK_POOL_NO_POS) {
+        report_violation(ctx, SYSTEM_INVARIANT_READY_QUEUE, slot->task_instance.table_number, index);
+    }
+    if (slot->task_instance.status == TASK_SUPPRESSED && ctx->task_timers[index].unsuppress == TIMER_NONE) {
+        report_violation(ctx, SYSTEM_INVARIANT_SUPPRESS_TIMER, slot->task_instance.table_number, index);
+    }
+}
+
+
+// O(pool) checks, run once per sweep of the slot cursor
+static void check_pool(trace_system_ctx *ctx) {
+    if (task_pool_check_indexes(&ctx->pool) != 0) {
+        report_violation(ctx, SYSTEM_INVARIANT_POOL_INDEX, 0xFF, TASK_POOL_NO_POS);
+    }
+}
+
+
+static void check_invariants(trace_system_ctx *ctx) {
+    ctx->check_stats.runs++;
+
+#if SYSTEM_CHECK_LEVEL >= SYSTEM_CHECK_FULL
+    for (uint16_t table = 0; table < ctx->table_count; ++table) check_table(ctx, (uint8_t)table);
+    for (uint16_t i = 0; i < ctx->pool.capacity; ++i) check_slot(ctx, i);
+    check_pool(ctx);
+    memset(ctx->check_touched_tables, 0, sizeof(ctx->check_touched_tables));
+    ctx->check_stats.sweeps++;
+#else
+    uint8_t table_budget = SYSTEM_CHECK_TABLE_BUDGET;
+    for (uint16_t word = 0; word < TABLE_WORDS && table_budget; ++word) {
+        while (ctx->check_touched_tables[word] && table_budget) {
+            uint8_t table = (uint8_t)(word * 32 + __builtin_ctz(ctx->check_touched_tables[word]));
+            ctx->check_touched_tables[word] &= ctx->check_touched_tables[word] - 1;
+            check_table(ctx, table);
+            table_budget--;
         }
+    }
+    if (table_budget > ctx->active_table_count) table_budget = (uint8_t)ctx->active_table_count;
+    while (table_budget--) {
+        if (ctx->check_table_cursor >= ctx->active_table_count) ctx->check_table_cursor = 0;
+        check_table(ctx, ctx->active_tables[ctx->check_table_cursor++]);
+    }
 
-        occupied++;
+    for (uint8_t n = 0; n < SYSTEM_CHECK_SLOT_BUDGET; ++n) {
+        check_slot(ctx, ctx->check_slot_cursor);
+        if (++ctx->check_slot_cursor == ctx->pool.capacity) {
+            ctx->check_slot_cursor = 0;
+            check_pool(ctx);
+            ctx->check_stats.sweeps++;
+        }
+    }
+#endif
 
-        switch (slot->task_instance.status) {
-            case TASK_ELIGIBLE:   eligible++; break;
-            case TASK_SUPPRESSED: suppressed++; break;
-            case TASK_COMPLETED:  completed++; break;
-            case TASK_KILLED:     killed++; break;
-            default: break;
+    // Popcount and one lookup: cheap enough for every call
+    if (task_pool_count(&ctx->pool, TASK_POOL_ELIGIBLE) != ctx->pool.ready_count) {
+        report_violation(ctx, SYSTEM_INVARIANT_READY_QUEUE, 0xFF, TASK_POOL_NO_POS);
+    }
+    if (ctx->sched.has_active_task) {
+        const task *active = task_pool_get_const(&ctx->pool, ctx->sched.active_task_id);
+        if (!active || active->status != TASK_ELIGIBLE) {
+            report_violation(ctx, SYSTEM_INVARIANT_ACTIVE_TASK, active ? active->table_number : 0xFF,
+                             ctx->sched.active_task_id.index);
         }
     }
+}
+#else
+static inline void mark_table_touched(trace_system_ctx *ctx, uint8_t table_number) { (void)ctx; (void)table_number; }
+static inline void mark_task_touched(trace_system_ctx *ctx, task_id id) { (void)ctx; (void)id; }
+static inline void check_invariants(trace_system_ctx *ctx) { (void)ctx; }
+#endif
+
 
+#if SYSTEM_CHECK_LEVEL >= SYSTEM_CHECK_LOG
+static void debug_log_pool_usage(const trace_system_ctx *ctx) {
     ESP_LOGI(SYS_TAG,
-             "POOL usage: occupied=%u eligible=%u suppressed=%u completed=%u killed=%u capacity=%u",
-             occupied, eligible, suppressed, completed, killed, TASK_POOL_CAPACITY);
+             "POOL usage: occupied=%u eligible=%u suppressed=%u dead=%u capacity=%u",
+             (unsigned)task_pool_count(&ctx->pool, TASK_POOL_OCCUPIED),
+             (unsigned)task_pool_count(&ctx->pool, TASK_POOL_ELIGIBLE),
+             (unsigned)task_pool_count(&ctx->pool, TASK_POOL_SUPPRESSED),
+             (unsigned)task_pool_count(&ctx->pool, TASK_POOL_DEAD),
+             (unsigned)ctx->pool.capacity);
 }
 #endif
 
 
-static inline bool is_valid_table_index(uint8_t table_index) {
-    return table_index < MAX_TABLES;
+static inline void record_event(const trace_system_ctx *ctx, journal_event_type type, uint8_t table, uint8_t arg,
+                                time_ms now) {
+    if (ctx->event_hook) ctx->event_hook(ctx->event_hook_user, type, table, arg, now);
+}
+
+
+static inline bool is_valid_table_index(const trace_system_ctx *ctx, uint8_t table_index) {
+    return table_index < ctx->table_count;
+}
+
+
+// Add a table to the active set or drop it, to match its state
+static void sync_active_table(trace_system_ctx *ctx, uint8_t table_number) {
+    bool busy = ctx->tables[table_number].state != TABLE_IDLE;
+    uint8_t pos = ctx->active_table_pos[table_number];
+
+    if (busy && pos == ACTIVE_NO_POS) {
+        ctx->active_table_pos[table_number] = (uint8_t)ctx->active_table_count;
+        ctx->active_tables[ctx->active_table_count++] = table_number;
+    } else if (!busy && pos != ACTIVE_NO_POS) {
+        uint8_t last = ctx->active_tables[--ctx->active_table_count];
+        ctx->active_tables[pos] = last;
+        ctx->active_table_pos[last] = pos;
+        ctx->active_table_pos[table_number] = ACTIVE_NO_POS;
+    }
+}
+
+
+// ----------------------------
+// Timers
+// ----------------------------
+
+static void arm_timer(trace_system_ctx *ctx, timer_handle *handle, timer_event_type type, uint8_t table, task_id task, time_ms expires_at) {
+    timer_wheel_cancel(&ctx->timers, handle);
+
+    timer_event event = {
+        .type = type,
+        .table = table,
+        .task = task,
+        .expires_at = expires_at,
+    };
+    *handle = timer_wheel_schedule(&ctx->timers, &event);
+    if (*handle == TIMER_NONE) {
+        ESP_LOGE(SYS_TAG, "timer wheel full, dropped timer type=%d", (int)type);
+    }
+}
+
+
+// Re-arm a task slot's timers to match its current status and deadlines.
+static void sync_task_timers(trace_system_ctx *ctx, task_id id) {
+    if (!is_task_id_valid(&ctx->pool, id)) return;
+
+    system_task_timers *timers = &ctx->task_timers[id.index];
+    timer_wheel_cancel(&ctx->timers, &timers->unsuppress);
+    timer_wheel_cancel(&ctx->timers, &timers->overdue);
+    timer_wheel_cancel(&ctx->timers, &timers->critical);
+
+    const task *t = task_pool_get_const(&ctx->pool, id);
+    if (!t || (t->status != TASK_ELIGIBLE && t->status != TASK_SUPPRESSED)) return;
+
+    if (t->status == TASK_SUPPRESSED) {
+        arm_timer(ctx, &timers->unsuppress, TIMER_TASK_UNSUPPRESS, t->table_number, id, t->suppress_until);
+    }
+    if (t->overdue_level < TASK_OVERDUE) {
+        arm_timer(ctx, &timers->overdue, TIMER_TASK_OVERDUE, t->table_number, id, t->time_limit);
+    }
+    if (t->overdue_level < TASK_CRITICALLY_OVERDUE) {
+        arm_timer(ctx, &timers->critical, TIMER_TASK_CRITICAL, t->table_number, id,
+                  t->time_limit + TASK_CRITICAL_OVRDUE_TIME_LIMIT[t->kind]);
+    }
+}
+
+
+// Re-file a task in the pool and on the timer wheel after its status changed.
+static void sync_task(trace_system_ctx *ctx, task_id id) {
+    task_pool_sync(&ctx->pool, id);
+    sync_task_timers(ctx, id);
+    mark_task_touched(ctx, id);
+}
+
+
+static void sync_table_timer(trace_system_ctx *ctx, uint8_t table_number) {
+    time_ms deadline = table_fsm_next_deadline(&ctx->tables[table_number]);
+
+    if (deadline == TABLE_FSM_NO_DEADLINE) {
+        timer_wheel_cancel(&ctx->timers, &ctx->table_checkin_timers[table_number]);
+    } else {
+        arm_timer(ctx, &ctx->table_checkin_timers[table_number], TIMER_TABLE_CHECKIN, table_number, INVALID_TASK_ID, deadline);
+    }
+}
+
+
+static void arm_scheduler_recheck(trace_system_ctx *ctx, time_ms now) {
+    time_ms next = scheduler_next_change(&ctx->sched, &ctx->pool, now);
+
+    if (next == UINT32_MAX) {
+        timer_wheel_cancel(&ctx->timers, &ctx->scheduler_recheck_timer);
+    } else {
+        arm_timer(ctx, &ctx->scheduler_recheck_timer, TIMER_SCHEDULER_RECHECK, 0, INVALID_TASK_ID, next);
+    }
+}
+
+
+static void run_scheduler(trace_system_ctx *ctx, time_ms now) {
+    scheduler_tick(&ctx->sched, &ctx->pool, now);
+#if SYSTEM_STAFF_COUNT > 0
+    staff_scheduler_tick(&ctx->staff, &ctx->sched, &ctx->pool, now);
+#endif
+    arm_scheduler_recheck(ctx, now);
 }
 
 
 // Kill all non-terminal tasks for a table so stale tasks don’t compete with
 // the task implied by the table’s new FSM state.
-static void kill_tasks_for_table(uint8_t table_number) {
-    for (uint16_t i = 0; i < TASK_POOL_CAPACITY; ++i) {
-        task_slot *slot = &scheduler_task_pool.slots[i];
-        if (!slot->occupied) continue;
-
-        task *t = &slot->task_instance;
-        if (t->table_number == table_number &&
-            t->status != TASK_KILLED && t->status != TASK_COMPLETED) {
+static void kill_tasks_for_table(trace_system_ctx *ctx, uint8_t table_number) {
+    for (task_id id = task_pool_table_first(&ctx->pool, table_number);
+         id.index != UINT16_MAX;
+         id = task_pool_table_next(&ctx->pool, id)) {
+
+        task *t = task_pool_get(&ctx->pool, id);
+        if (t->status != TASK_KILLED && t->status != TASK_COMPLETED) {
             kill_task(t);
+            sync_task(ctx, t->id);
             ESP_LOGI(SYS_TAG, "killed stale %s task (table=%u) on FSM transition",
                      task_kind_to_str(t->kind), (unsigned)table_number);
         }
@@ -130,109 +340,329 @@ static void kill_tasks_for_table(uint8_t table_number) {
 
 
 // Admit the task implied by the table’s current FSM state (if any).
-static void admit_task(const uint8_t table_number, time_ms current_time_ms) {
-    if (!is_valid_table_index(table_number)) {
+static void admit_task(trace_system_ctx *ctx, const uint8_t table_number, time_ms current_time_ms) {
+    if (!is_valid_table_index(ctx, table_number)) {
         return;
     }
 
-    task_kind kind = system_get_current_task_kind_for_table(table_number);
+    task_kind kind = system_ctx_get_current_task_kind_for_table(ctx, table_number);
     if (kind == TASK_NOT_APPLICABLE) {
         return;
     }
 
-    task_id id = task_pool_add(&scheduler_task_pool, table_number, kind, current_time_ms);
+    task_id id = task_pool_add(&ctx->pool, table_number, kind, current_time_ms);
     if (id.index == UINT16_MAX) {
         ESP_LOGE(SYS_TAG, "admit_task FAILED: table=%u state=%d kind=%s",
                  (unsigned)table_number,
-                 (int)table_fsm_instances[table_number].state,
+                 (int)ctx->tables[table_number].state,
                  task_kind_to_str(kind));
 
-        #ifdef DEBUG_STALE_STATE
-        debug_log_pool_usage();
+        #if SYSTEM_CHECK_LEVEL >= SYSTEM_CHECK_LOG
+        debug_log_pool_usage(ctx);
         #endif
 
         return;
     }
+    sync_task_timers(ctx, id);
+    record_event(ctx, JOURNAL_ADMIT, table_number, (uint8_t)kind, current_time_ms);
 }
 
 
-static void reap_dead_tasks(void) {
-    for (uint16_t i = 0; i < TASK_POOL_CAPACITY; ++i) {
-        task_slot *slot = &scheduler_task_pool.slots[i];
-        if (!slot->occupied) {
-            continue;
-        }
+static void reap_dead_tasks(trace_system_ctx *ctx) {
+    task_pool_reap(&ctx->pool);
+}
 
-        task *task_inst = &slot->task_instance;
-        if (task_inst->status == TASK_COMPLETED || task_inst->status == TASK_KILLED) {
-            task_id id = { .index = i, .generation = slot->generation };
-            task_pool_free(&scheduler_task_pool, id);
-        }
-    }
+
+/* A table whose FSM state changed has its tasks and timers replaced in
+   two halves around a reap, so a batch can reap once for every table. */
+static void retire_table_tasks(trace_system_ctx *ctx, uint8_t table_number) {
+    mark_table_touched(ctx, table_number);
+    set_table_task_killed(ctx, table_number, false);
+    sync_active_table(ctx, table_number);
+    kill_tasks_for_table(ctx, table_number);
+}
+
+
+static void admit_table_tasks(trace_system_ctx *ctx, uint8_t table_number, time_ms current_time) {
+    admit_task(ctx, table_number, current_time);
+    sync_table_timer(ctx, table_number);
+}
+
+
+// Replace a table's tasks and timers after its FSM state changed.
+static void handle_table_transition(trace_system_ctx *ctx, uint8_t table_number, time_ms current_time) {
+    record_event(ctx, JOURNAL_TRANSITION, table_number, (uint8_t)ctx->tables[table_number].state, current_time);
+    retire_table_tasks(ctx, table_number);
+    reap_dead_tasks(ctx);
+    admit_table_tasks(ctx, table_number, current_time);
 }
 
 
 // Advance the table FSM on task completion and queue the next task.
-static void advance_table_fsm(const uint8_t table_number, time_ms current_time) {
-    if (!is_valid_table_index(table_number)) {
+static void advance_table_fsm(trace_system_ctx *ctx, const uint8_t table_number, time_ms current_time) {
+    if (!is_valid_table_index(ctx, table_number)) {
         return;
     }
 
-    table_context *table = &table_fsm_instances[table_number];
+    table_context *table = &ctx->tables[table_number];
     bool did_state_change = table_apply_event(table, EVENT_MARK_COMPLETE, current_time);
 
     if (did_state_change) {
-        kill_tasks_for_table(table_number);
-        reap_dead_tasks();
-        admit_task(table_number, current_time);
+        handle_table_transition(ctx, table_number, current_time);
+    }
+}
+
+
+// What fire_system_timer() needs from the timer_wheel_advance() caller
+typedef struct {
+    trace_system_ctx *ctx;
+    time_ms now;
+} timer_fire_args;
+
+
+static void fire_system_timer(void *arg, const timer_event *event) {
+    trace_system_ctx *ctx = ((const timer_fire_args *)arg)->ctx;
+    time_ms now = ((const timer_fire_args *)arg)->now;
+
+    switch (event->type) {
+        case TIMER_TASK_UNSUPPRESS: {
+            ctx->task_timers[event->task.index].unsuppress = TIMER_NONE;
+            task *t = task_pool_get(&ctx->pool, event->task);
+            if (!t) break;
+            refresh_task(t, now);
+            task_pool_sync(&ctx->pool, event->task);
+            mark_table_touched(ctx, t->table_number);
+            break;
+        }
+
+        case TIMER_TASK_OVERDUE:
+        case TIMER_TASK_CRITICAL: {
+            bool critical = (event->type == TIMER_TASK_CRITICAL);
+            if (critical) ctx->task_timers[event->task.index].critical = TIMER_NONE;
+            else          ctx->task_timers[event->task.index].overdue = TIMER_NONE;
+
+            task *t = task_pool_get(&ctx->pool, event->task);
+            uint8_t level = critical ? TASK_CRITICALLY_OVERDUE : TASK_OVERDUE;
+            if (t && t->overdue_level < level) t->overdue_level = level;
+            break;
+        }
+
+        case TIMER_TABLE_CHECKIN: {
+            ctx->table_checkin_timers[event->table] = TIMER_NONE;
+            table_state previous_state = ctx->tables[event->table].state;
+
+            table_fsm_tick(&ctx->tables[event->table], now);
+
+            if (ctx->tables[event->table].state != previous_state) {
+                handle_table_transition(ctx, event->table, now);
+            } else {
+                sync_table_timer(ctx, event->table);
+            }
+            break;
+        }
+
+        case TIMER_SCHEDULER_RECHECK:
+            // Nothing to do here: any fired timer makes the caller run the scheduler
+            ctx->scheduler_recheck_timer = TIMER_NONE;
+            break;
     }
 }
 
 
+// Fire every timer due by `now`. Returns true if any fired.
+static bool advance_timers(trace_system_ctx *ctx, time_ms now) {
+    timer_fire_args args = { .ctx = ctx, .now = now };
+    return timer_wheel_advance(&ctx->timers, now, fire_system_timer, &args) > 0;
+}
+
+
 // ----------------------------
 // Public API
 // ----------------------------
 
-void trace_system_init(const scheduler_config *config) {
-    memset(table_fsm_instances, 0, sizeof(table_fsm_instances));
+/* Every count up to MAX_TABLES fits the snapshot's and the notification
+   bus's table bitmaps; a larger one would leave tables the UI never hears of */
+static bool table_count_valid(uint16_t tables) {
+    if (tables <= MAX_TABLES) return true;
+
+    ESP_LOGE(SYS_TAG, "%u tables requested, built for at most %u", (unsigned)tables, (unsigned)MAX_TABLES);
+    return false;
+}
+
+
+/* trace_system_ctx_init() without the hooks, which restoring keeps. The
+   table count must be valid. */
+static void reset_system(trace_system_ctx *ctx, const scheduler_config *config, uint16_t tables, time_ms now) {
+    ctx->table_count = (tables == 0) ? MAX_TABLES : tables;
+
+    memset(ctx->tables, 0, sizeof(ctx->tables));
 
-    for (uint8_t table_index = 0; table_index < MAX_TABLES; table_index++) {
-        table_fsm_instances[table_index].table_number = table_index; // enforce 0-based internally
-        table_fsm_instances[table_index].state = TABLE_IDLE;
-        table_fsm_instances[table_index].state_entered_at = 0;
+    for (uint16_t table_index = 0; table_index < ctx->table_count; table_index++) {
+        ctx->tables[table_index].table_number = (uint8_t)table_index; // enforce 0-based internally
+        ctx->tables[table_index].state = TABLE_IDLE;
+        ctx->tables[table_index].state_entered_at = 0;
     }
 
-    task_pool_init(&scheduler_task_pool);
-    scheduler_init(&task_scheduler, config);
-    touch_init();
+    memset(ctx->active_table_pos, ACTIVE_NO_POS, sizeof(ctx->active_table_pos));
+    ctx->active_table_count = 0;
+    memset(ctx->killed_task_tables, 0, sizeof(ctx->killed_task_tables));
+
+    if (!floor_plan.loaded) floor_layout_load_default();
+    if (floor_plan.table_count < ctx->table_count) {
+        // Still runs, but zone adjustments and walk distances treat the rest as one spot
+        ESP_LOGW(SYS_TAG, "floor layout covers %u of %u tables, the rest have no zone and no distance",
+                 (unsigned)floor_plan.table_count, (unsigned)ctx->table_count);
+    }
+
+    // Sized for table_count, so fewer tables do not turn into more slots than task_timers has
+    task_pool_init(&ctx->pool, ctx->pool_arena,
+                   TASK_POOL_ARENA_SIZE(SYSTEM_TASK_CAPACITY, ctx->table_count), ctx->table_count);
+    scheduler_init(&ctx->sched, config);
+    ctx->sched.record_decisions = ctx->record_decisions;
+#if SYSTEM_STAFF_COUNT > 0
+    staff_scheduler_init(&ctx->staff, NULL, SYSTEM_STAFF_COUNT);
+#endif
+
+    timer_wheel_init(&ctx->timers, now);
+    for (uint16_t i = 0; i < ctx->pool.capacity; ++i) {
+        ctx->task_timers[i] = (system_task_timers){ TIMER_NONE, TIMER_NONE, TIMER_NONE };
+    }
+    for (uint16_t table_index = 0; table_index < ctx->table_count; table_index++) {
+        ctx->table_checkin_timers[table_index] = TIMER_NONE;
+    }
+    ctx->scheduler_recheck_timer = TIMER_NONE;
+
+    memset(&ctx->check_stats, 0, sizeof(ctx->check_stats));
+    memset(ctx->check_touched_tables, 0, sizeof(ctx->check_touched_tables));
+    ctx->check_table_cursor = 0;
+    ctx->check_slot_cursor = 0;
+}
+
+
+bool trace_system_ctx_init(trace_system_ctx *ctx, const scheduler_config *config, uint16_t tables, time_ms now) {
+    if (!table_count_valid(tables)) return false;
+
+    ctx->event_hook = NULL;
+    ctx->event_hook_user = NULL;
+    ctx->record_decisions = false;
+    reset_system(ctx, config, tables, now);
+    return true;
+}
+
+
+void system_ctx_set_event_hook(trace_system_ctx *ctx, system_event_hook hook, void *user) {
+    ctx->event_hook = hook;
+    ctx->event_hook_user = user;
+}
+
+
+void system_ctx_set_record_decisions(trace_system_ctx *ctx, bool record) {
+    ctx->record_decisions = record;
+    ctx->sched.record_decisions = record;
+}
+
+
+void system_ctx_set_staff_config(trace_system_ctx *ctx, const staff_scheduler_config *config) {
+#if SYSTEM_STAFF_COUNT > 0
+    staff_scheduler_init(&ctx->staff, config, SYSTEM_STAFF_COUNT);
+#else
+    (void)ctx;
+    (void)config;
+#endif
 }
 
 
-void system_apply_table_fsm_event(uint8_t table_index, fsm_transition_event event, time_ms current_time_ms) {
-    if (!is_valid_table_index(table_index)) {
+task_id system_ctx_get_staff_task(const trace_system_ctx *ctx, uint8_t staff_index) {
+#if SYSTEM_STAFF_COUNT > 0
+    return staff_scheduler_active_task(&ctx->staff, staff_index);
+#else
+    (void)ctx;
+    (void)staff_index;
+    return INVALID_TASK_ID;
+#endif
+}
+
+
+void system_ctx_set_staff_on_shift(trace_system_ctx *ctx, uint8_t staff_index, bool on_shift, time_ms now) {
+#if SYSTEM_STAFF_COUNT > 0
+    advance_timers(ctx, now);
+    staff_scheduler_set_on_shift(&ctx->staff, staff_index, on_shift);
+    run_scheduler(ctx, now);
+    check_invariants(ctx);
+#else
+    (void)ctx;
+    (void)staff_index;
+    (void)on_shift;
+    (void)now;
+#endif
+}
+
+
+void system_ctx_apply_table_fsm_event(trace_system_ctx *ctx, uint8_t table_index, fsm_transition_event event,
+                                      time_ms current_time_ms) {
+    if (!is_valid_table_index(ctx, table_index)) {
         ESP_LOGE(SYS_TAG, "Invalid table index");
         return;
     }
 
-    table_context *table_instance = &table_fsm_instances[table_index];
+    system_table_event one = { .table_index = table_index, .event = (uint8_t)event };
+    system_ctx_apply_events(ctx, &one, 1, current_time_ms);
+}
 
-    bool did_state_change = table_apply_event(table_instance, event, current_time_ms);
-    if (did_state_change) {
-        kill_tasks_for_table(table_index);
-        reap_dead_tasks();
-        admit_task(table_index, current_time_ms);
+
+uint16_t system_ctx_apply_events(trace_system_ctx *ctx, const system_table_event *batch, uint16_t count,
+                                 time_ms current_time_ms) {
+    if (!batch || count == 0) return 0;
+
+    advance_timers(ctx, current_time_ms);
+
+    // Run every event through the FSMs first, noting which tables moved
+    uint32_t moved[TABLE_WORDS] = {0};
+    uint16_t transitions = 0;
+
+    for (uint16_t i = 0; i < count; ++i) {
+        uint8_t table_index = batch[i].table_index;
+        if (!is_valid_table_index(ctx, table_index)) {
+            ESP_LOGE(SYS_TAG, "Invalid table index %u", (unsigned)table_index);
+            continue;
+        }
+
+        table_context *table_instance = &ctx->tables[table_index];
+        if (table_apply_event(table_instance, (fsm_transition_event)batch[i].event, current_time_ms)) {
+            record_event(ctx, JOURNAL_TRANSITION, table_index, (uint8_t)table_instance->state, current_time_ms);
+            moved[table_index / 32] |= 1u << (table_index % 32);
+            transitions++;
+        }
+    }
+
+    if (transitions) {
+        // Then replace each moved table's tasks once, for the state it ended in
+        for (uint16_t word = 0; word < TABLE_WORDS; ++word) {
+            for (uint32_t bits = moved[word]; bits; bits &= bits - 1) {
+                retire_table_tasks(ctx, (uint8_t)(word * 32 + __builtin_ctz(bits)));
+            }
+        }
+        reap_dead_tasks(ctx);
+        for (uint16_t word = 0; word < TABLE_WORDS; ++word) {
+            for (uint32_t bits = moved[word]; bits; bits &= bits - 1) {
+                admit_table_tasks(ctx, (uint8_t)(word * 32 + __builtin_ctz(bits)), current_time_ms);
+            }
+        }
     }
 
-    scheduler_tick(&task_scheduler, &scheduler_task_pool, current_time_ms);
+    run_scheduler(ctx, current_time_ms);
 
-    #ifdef DEBUG_STALE_STATE
-    debug_validate_system_state();
-    #endif
+    check_invariants(ctx);
+    return transitions;
 }
 
 
-bool system_apply_user_action_to_task(task_id shown_task_id, user_action action, time_ms current_time_ms) {
-    task *current_task = task_pool_get(&scheduler_task_pool, shown_task_id);
+bool system_ctx_apply_user_action_to_task(trace_system_ctx *ctx, task_id shown_task_id, user_action action,
+                                          time_ms current_time_ms) {
+    // Fire due timers first: a check-in may already have replaced the shown task
+    advance_timers(ctx, current_time_ms);
+
+    task *current_task = task_pool_get(&ctx->pool, shown_task_id);
     if (!current_task) {
         ESP_LOGE(SYS_TAG, "NULL current_task");
         return false;  // Stale UI snapshot, ignore or force redraw
@@ -240,18 +670,14 @@ bool system_apply_user_action_to_task(task_id shown_task_id, user_action action,
 
     task task_snapshot = *current_task;
 
-    refresh_task(current_task, current_time_ms);
-
     if (current_task->status != TASK_ELIGIBLE) {
         ESP_LOGI(SYS_TAG, "action_blocked for task=%s (table=%u). Reason=%s",
                  task_kind_to_str(current_task->kind), (unsigned)current_task->table_number, task_status_to_str(current_task->status));
 
         // Recompute best suggestion so UI recovers quickly.
-        scheduler_tick(&task_scheduler, &scheduler_task_pool, current_time_ms);
+        run_scheduler(ctx, current_time_ms);
 
-        #ifdef DEBUG_STALE_STATE
-        debug_validate_system_state();
-        #endif
+        check_invariants(ctx);
 
         return false;
     }
@@ -262,69 +688,78 @@ bool system_apply_user_action_to_task(task_id shown_task_id, user_action action,
             if (task_mark_completed(current_task)) {
                 ESP_LOGE(SYS_TAG, "Task pointer invalid");
             }
+            record_event(ctx, JOURNAL_COMPLETE, task_snapshot.table_number, (uint8_t)task_snapshot.kind, current_time_ms);
             // Use a task copy in case scheduler_tick() altered the task passed here.
-            task_pool_free(&scheduler_task_pool, task_snapshot.id);
-            advance_table_fsm(task_snapshot.table_number, current_time_ms);
+            task_pool_free(&ctx->pool, task_snapshot.id);
+            sync_task_timers(ctx, task_snapshot.id);
+            advance_table_fsm(ctx, task_snapshot.table_number, current_time_ms);
             break;
 
         case USER_ACTION_IGNORE:
             ESP_LOGI(SYS_TAG, "IGNORE");
             task_apply_ignore(current_task, current_time_ms);
+            if (current_task->status == TASK_KILLED) set_table_task_killed(ctx, task_snapshot.table_number, true);
+            sync_task(ctx, current_task->id);
+            record_event(ctx, JOURNAL_IGNORE, task_snapshot.table_number, (uint8_t)task_snapshot.kind, current_time_ms);
             break;  
 
         default: 
             ESP_LOGI(SYS_TAG, "DEFAULT");
             return false;
     }
-    scheduler_tick(&task_scheduler, &scheduler_task_pool, current_time_ms);
+    run_scheduler(ctx, current_time_ms);
+
+    // A task ignored too often is killed; free it once the scheduler has moved off it
+    reap_dead_tasks(ctx);
 
-    #ifdef DEBUG_STALE_STATE
-    debug_validate_system_state();
-    #endif
+    check_invariants(ctx);
 
     return true;
 }
 
 
-bool system_undo_task_ignore(task_id id, uint8_t prev_ignore_count, time_ms prev_suppress_until, time_ms now) {
-    task *t = task_pool_get(&scheduler_task_pool, id);
+bool system_ctx_undo_task_ignore(trace_system_ctx *ctx, task_id id, uint8_t prev_ignore_count,
+                                 time_ms prev_suppress_until, time_ms now) {
+    advance_timers(ctx, now);
+
+    task *t = task_pool_get(&ctx->pool, id);
     if (!t) {
         ESP_LOGE(SYS_TAG, "system_undo_task_ignore: task slot expired");
         return false;
     }
     task_undo_ignore(t, prev_ignore_count, prev_suppress_until);
+    sync_task(ctx, id);
     ESP_LOGI(SYS_TAG, "UNDO IGNORE task=%s (table=%u)", task_kind_to_str(t->kind), (unsigned)t->table_number);
-    scheduler_tick(&task_scheduler, &scheduler_task_pool, now);
+    run_scheduler(ctx, now);
+
+    check_invariants(ctx);
     return true;
 }
 
 
-table_state system_get_table_state(uint8_t table_index) {
-    if (table_index >= MAX_TABLES) return TABLE_IDLE; // safe fallback
-    return table_fsm_instances[table_index].state;
+table_state system_ctx_get_table_state(const trace_system_ctx *ctx, uint8_t table_index) {
+    if (table_index >= ctx->table_count) return TABLE_IDLE; // safe fallback
+    return ctx->tables[table_index].state;
 }
 
 
-void trace_system_tick(time_ms current_time_ms) {
-    for (uint8_t table_index = 0; table_index < MAX_TABLES; table_index++) {
-        table_state previous_state = table_fsm_instances[table_index].state;
+uint16_t system_ctx_get_table_count(const trace_system_ctx *ctx) {
+    return ctx->table_count;
+}
 
-        table_fsm_tick(&table_fsm_instances[table_index], current_time_ms);
 
-        if (table_fsm_instances[table_index].state != previous_state) {
-            kill_tasks_for_table(table_index);
-            reap_dead_tasks();
-            admit_task(table_index, current_time_ms);
-        }
-    }
-    // Loop the task pool and clean up dead tasks
-    reap_dead_tasks();
+uint16_t system_ctx_get_active_tables(const trace_system_ctx *ctx, const uint8_t **tables) {
+    *tables = ctx->active_tables;
+    return ctx->active_table_count;
+}
 
-    scheduler_tick(&task_scheduler, &scheduler_task_pool, current_time_ms);
 
-    #ifdef DEBUG_STALE_STATE
-    debug_validate_system_state();
-    #endif
+void trace_system_ctx_tick(trace_system_ctx *ctx, time_ms current_time_ms) {
+    // Time only matters through timers: with none due there is nothing to do
+    if (advance_timers(ctx, current_time_ms)) {
+        run_scheduler(ctx, current_time_ms);
+        check_invariants(ctx);
+    }
 }
 
 
@@ -332,112 +767,336 @@ void trace_system_tick(time_ms current_time_ms) {
 // Read-only accessors for UI/debugging
 // ----------------------------
 
-const table_context *system_get_table(uint8_t table_index) {
-    if (!is_valid_table_index(table_index)) return NULL;
-    return &table_fsm_instances[table_index];
+const table_context *system_ctx_get_table(const trace_system_ctx *ctx, uint8_t table_index) {
+    if (!is_valid_table_index(ctx, table_index)) return NULL;
+    return &ctx->tables[table_index];
 }
 
 
-task_kind system_get_current_task_kind_for_table(uint8_t table_index) {
-    task_kind kind;
-    const table_context *table = system_get_table(table_index);
+task_kind system_ctx_get_current_task_kind_for_table(const trace_system_ctx *ctx, uint8_t table_index) {
+    const table_context *table = system_ctx_get_table(ctx, table_index);
     if (!table) {
         ESP_LOGE(SYS_TAG, "system_get_current_task_kind_for_table() got a null table pointer, can't continue.");
         return TASK_NOT_APPLICABLE;
     }
 
-    switch (table->state){
-        case TABLE_SEATED:
-            kind = SERVE_WATER;
-            break;
+    return table_fsm_task_kind(table->state);
+}
 
-        case TABLE_READY_FOR_ORDER:
-            kind = TAKE_ORDER;
-            break;
 
-        case TABLE_PLACED_ORDER:
-            kind = PREPARE_ORDER;
-            break;
+task *system_ctx_get_current_task_pointer_for_table(trace_system_ctx *ctx, uint8_t table_index) {
+    task_kind kind = system_ctx_get_current_task_kind_for_table(ctx, table_index);
 
-        case TABLE_WAITING_FOR_ORDER:
-            kind = SERVE_ORDER;
-            break;
+    task_id id = task_pool_find_by_key(&ctx->pool, table_index, kind);
+    if (id.index == INVALID_TASK_ID.index && id.generation == INVALID_TASK_ID.generation) return NULL;
 
-        case TABLE_DINING:
-            kind = TASK_NOT_APPLICABLE;
-            break;
+    task *t = task_pool_get(&ctx->pool, id);
+    if (!t) return NULL;
 
-        case TABLE_CHECKUP:
-            kind = MONITOR_TABLE;
-            break;
+    return t;
+}
 
-        case TABLE_REQUESTED_BILL:
-            kind = PRESENT_BILL;
-            break;
 
-        case TABLE_DONE:
-            kind = CLEAR_TABLE;
-            break;
+task_id system_ctx_get_active_task_id(const trace_system_ctx *ctx) {
+    return ctx->sched.active_task_id;
+}
 
-        case TABLE_IDLE:
-            kind = TASK_NOT_APPLICABLE;
-            break;
+const task *system_ctx_get_active_task(const trace_system_ctx *ctx) {
+    if (!ctx->sched.has_active_task) return NULL;
+    return task_pool_get_const(&ctx->pool, ctx->sched.active_task_id);
+}
 
-        default:
-            kind = TASK_NOT_APPLICABLE;
-            break;
+uint16_t system_ctx_get_pending_count(const trace_system_ctx *ctx) {
+    return ctx->sched.pending_count;
+}
+
+uint16_t system_ctx_get_critical_pending_count(const trace_system_ctx *ctx) {
+    return ctx->sched.critical_count;
+}
+
+const task *system_ctx_get_top_critical_task(const trace_system_ctx *ctx) {
+    if (ctx->sched.critical_count == 0) return NULL;
+    return task_pool_get_const(&ctx->pool, ctx->sched.top_critical_id);
+}
+
+void system_ctx_force_active_task(trace_system_ctx *ctx, task_id id, time_ms now) {
+    task *task_inst = task_pool_get(&ctx->pool, id);
+    if (!task_inst) {
+        ESP_LOGE(SYS_TAG, "force_active rejected: stale id");
+        return;
+    }
+    if (task_inst->status != TASK_ELIGIBLE) {
+        ESP_LOGE(SYS_TAG, "force_active rejected: task not eligible (%s)",
+                 task_status_to_str(task_inst->status));
+        return;
     }
 
-    return kind;
+    scheduler_force_active(&ctx->sched, id, now);
+    arm_scheduler_recheck(ctx, now);
+    record_event(ctx, JOURNAL_FORCE_SWITCH, task_inst->table_number, (uint8_t)task_inst->kind, now);
 }
 
 
-task *system_get_current_task_pointer_for_table(uint8_t table_index) {
-    task_kind kind = system_get_current_task_kind_for_table(table_index);
+bool system_ctx_predict_next_switch(const trace_system_ctx *ctx, time_ms now, time_ms *out_time, task_id *out_id) {
+    return scheduler_predict_next_switch(&ctx->sched, &ctx->pool, now, out_time, out_id);
+}
 
-    task_id id = task_pool_find_by_key(&scheduler_task_pool, table_index, kind);
-    if (id.index == INVALID_TASK_ID.index && id.generation == INVALID_TASK_ID.generation) return NULL;
 
-    task *t = task_pool_get(&scheduler_task_pool, id);
-    if (!t) return NULL;
+const system_check_stats *system_ctx_get_check_stats(const trace_system_ctx *ctx) {
+    return &ctx->check_stats;
+}
 
-    return t;
+
+const char *system_invariant_to_str(system_invariant kind) {
+    switch (kind) {
+        case SYSTEM_INVARIANT_MISSING_TASK:   return "MISSING_TASK";
+        case SYSTEM_INVARIANT_STALE_TASK:     return "STALE_TASK";
+        case SYSTEM_INVARIANT_READY_QUEUE:    return "READY_QUEUE";
+        case SYSTEM_INVARIANT_SUPPRESS_TIMER: return "SUPPRESS_TIMER";
+        case SYSTEM_INVARIANT_POOL_INDEX:     return "POOL_INDEX";
+        case SYSTEM_INVARIANT_ACTIVE_TASK:    return "ACTIVE_TASK";
+        case SYSTEM_INVARIANT_ACTIVE_SET:     return "ACTIVE_SET";
+        default:                              return "UNKNOWN";
+    }
 }
 
 
-task_id system_get_active_task_id(void) {
-    return task_scheduler.active_task_id;
+time_ms system_ctx_next_deadline(const trace_system_ctx *ctx, time_ms now) {
+    (void)now;
+    return timer_wheel_next_expiry(&ctx->timers);
 }
 
-const task *system_get_active_task(void) {
-    if (!task_scheduler.has_active_task) return NULL;
-    return task_pool_get_const(&scheduler_task_pool, task_scheduler.active_task_id);
+
+// ----------------------------
+// Warm restart image
+// ----------------------------
+
+#define SLOT_WORDS      ((SYSTEM_TASK_CAPACITY + 31) / 32)
+
+
+// Set a bit in a bitmap, returning whether it was already set
+static inline bool test_and_set(uint32_t *words, uint16_t bit) {
+    bool was_set = (words[bit / 32] >> (bit % 32)) & 1u;
+    words[bit / 32] |= 1u << (bit % 32);
+    return was_set;
 }
 
-uint8_t system_get_pending_count(void) {
-    return task_scheduler.pending_count;
+
+static uint32_t image_crc(const system_image *image) {
+    return esp_rom_crc32_le(0, (const uint8_t *)image, offsetof(system_image, crc));
 }
 
-uint8_t system_get_critical_pending_count(void) {
-    return task_scheduler.critical_count;
+
+static void capture_task(const trace_system_ctx *ctx, system_image *image, const task *t) {
+    if (image->task_count == SYSTEM_TASK_CAPACITY) return;
+
+    if (ctx->sched.has_active_task &&
+        ctx->sched.active_task_id.index == t->id.index &&
+        ctx->sched.active_task_id.generation == t->id.generation) {
+        image->active_index = image->task_count;
+    }
+
+    image->tasks[image->task_count++] = (system_image_task){
+        .slot           = (uint8_t)t->id.index,
+        .table_number   = t->table_number,
+        .kind           = (uint8_t)t->kind,
+        .status         = (uint8_t)t->status,
+        .ignore_count   = t->ignore_count,
+        .overdue_level  = t->overdue_level,
+        .created_at     = t->created_at,
+        .time_limit     = t->time_limit,
+        .suppress_until = t->suppress_until,
+    };
 }
 
-const task *system_get_top_critical_task(void) {
-    if (task_scheduler.critical_count == 0) return NULL;
-    return task_pool_get_const(&scheduler_task_pool, task_scheduler.top_critical_id);
+
+void system_ctx_capture_image(const trace_system_ctx *ctx, system_image *image, uint32_t sequence, time_ms now) {
+    // Zeroed first so padding bytes are deterministic under the CRC
+    memset(image, 0, sizeof(*image));
+
+    image->magic        = SYSTEM_IMAGE_MAGIC;
+    image->version      = SYSTEM_IMAGE_VERSION;
+    image->size         = sizeof(*image);
+    image->sequence     = sequence;
+    image->table_count  = ctx->table_count;
+    image->captured_at  = now;
+    image->active_since = ctx->sched.task_active_since;
+    image->active_index = SYSTEM_IMAGE_NO_ACTIVE;
+
+    for (uint16_t i = 0; i < ctx->table_count; ++i) {
+        const table_context *table = &ctx->tables[i];
+        image->tables[i] = (system_image_table){
+            .state            = (uint8_t)table->state,
+            .prev_state       = (uint8_t)table->prev_state,
+            .flags            = table_task_killed(ctx, (uint8_t)i) ? SYSTEM_IMAGE_TABLE_TASK_KILLED : 0,
+            .state_entered_at = table->state_entered_at,
+        };
+    }
+
+    /* Between system calls every occupied slot is live: dead tasks are
+       reaped by the call that killed them. Ready queue order first, then
+       the suppressed set, which restoring rebuilds position for position. */
+    for (uint16_t pos = 0; pos < ctx->pool.ready_count; ++pos) {
+        capture_task(ctx, image, &ctx->pool.slots[ctx->pool.ready[pos]].task_instance);
+    }
+    for (uint16_t pos = 0; pos < ctx->pool.suppressed_count; ++pos) {
+        capture_task(ctx, image, &ctx->pool.slots[ctx->pool.suppressed[pos]].task_instance);
+    }
+
+    image->slot_count = (uint8_t)ctx->pool.capacity;
+    for (uint16_t i = 0; i < ctx->pool.capacity && i < SYSTEM_TASK_CAPACITY; ++i) {
+        image->generations[i] = ctx->pool.slots[i].generation;
+    }
+    for (uint16_t i = ctx->pool.free_head;
+         i != TASK_POOL_NO_POS && image->free_count < SYSTEM_TASK_CAPACITY;
+         i = ctx->pool.slots[i].next_free) {
+        image->free_slots[image->free_count++] = (uint8_t)i;
+    }
+
+    image->crc = image_crc(image);
 }
 
-void system_force_active_task(task_id id, time_ms now) {
-    task *task_inst = task_pool_get(&scheduler_task_pool, id);
-    if (!task_inst) {
-        ESP_LOGE(SYS_TAG, "force_active rejected: stale id");
-        return;
+
+bool system_image_valid(const system_image *image, size_t size) {
+    if (!image || size < sizeof(*image)) return false;
+    if (image->magic != SYSTEM_IMAGE_MAGIC || image->version != SYSTEM_IMAGE_VERSION ||
+        image->size != sizeof(*image)) {
+        return false;
     }
-    if (task_inst->status != TASK_ELIGIBLE) {
-        ESP_LOGE(SYS_TAG, "force_active rejected: task not eligible (%s)",
-                 task_status_to_str(task_inst->status));
-        return;
+    if (image_crc(image) != image->crc) return false;
+
+    // A matching CRC from a different build could still hold values this one rejects
+    if (image->slot_count > SYSTEM_TASK_CAPACITY) return false;
+    if ((uint16_t)image->task_count + image->free_count != image->slot_count) return false;
+    if (image->table_count == 0 || image->table_count > MAX_TABLES) return false;
+
+    // Live and free slots together name every slot exactly once
+    uint32_t slots_seen[SLOT_WORDS] = {0};
+    for (uint8_t i = 0; i < image->slot_count; ++i) {
+        uint8_t slot = (i < image->task_count) ? image->tasks[i].slot : image->free_slots[i - image->task_count];
+        if (slot >= image->slot_count || test_and_set(slots_seen, slot)) return false;
+    }
+
+    for (uint16_t i = 0; i < image->table_count; ++i) {
+        const system_image_table *table = &image->tables[i];
+        if (table->state >= TABLE_STATE_COUNT || table->prev_state >= TABLE_STATE_COUNT) return false;
+        if (table->flags & ~SYSTEM_IMAGE_TABLE_TASK_KILLED) return false;
+
+        // Only a table whose state calls for a task can have had it killed
+        if ((table->flags & SYSTEM_IMAGE_TABLE_TASK_KILLED) &&
+            table_fsm_task_kind((table_state)table->state) == TASK_NOT_APPLICABLE) {
+            return false;
+        }
+    }
+
+    uint32_t tables_with_task[TABLE_WORDS] = {0};
+    for (uint8_t i = 0; i < image->task_count; ++i) {
+        const system_image_task *saved = &image->tasks[i];
+
+        if (saved->table_number >= image->table_count) return false;
+        if (saved->status != TASK_ELIGIBLE && saved->status != TASK_SUPPRESSED) return false;
+        if (saved->overdue_level > TASK_CRITICALLY_OVERDUE) return false;
+
+        // One task per table, the one its state calls for
+        if (saved->kind != table_fsm_task_kind((table_state)image->tables[saved->table_number].state)) return false;
+        if (test_and_set(tables_with_task, saved->table_number)) return false;
+        if (image->tables[saved->table_number].flags & SYSTEM_IMAGE_TABLE_TASK_KILLED) return false;
+    }
+
+    if (image->active_index != SYSTEM_IMAGE_NO_ACTIVE &&
+        (image->active_index >= image->task_count || image->tasks[image->active_index].status != TASK_ELIGIBLE)) {
+        return false;
+    }
+
+    return true;
+}
+
+
+bool system_ctx_restore_image(trace_system_ctx *ctx, const system_image *image, size_t size,
+                              const scheduler_config *config, uint16_t tables, time_ms now) {
+    if (!table_count_valid(tables)) return false;
+    reset_system(ctx, config, tables, now);
+
+    if (!system_image_valid(image, size)) return false;
+    if (image->slot_count != ctx->pool.capacity || image->table_count != ctx->table_count) {
+        ESP_LOGE(SYS_TAG, "restore FAILED: image has %u slots and %u tables, system %u and %u, cold start",
+                 (unsigned)image->slot_count, (unsigned)image->table_count,
+                 (unsigned)ctx->pool.capacity, (unsigned)ctx->table_count);
+        return false;
+    }
+
+    // Unsigned arithmetic, so a shift back across the clock wrap works too
+    time_ms shift = now - image->captured_at;
+
+    for (uint16_t i = 0; i < ctx->table_count; ++i) {
+        table_context *table = &ctx->tables[i];
+        table->state            = (table_state)image->tables[i].state;
+        table->prev_state       = (table_state)image->tables[i].prev_state;
+        table->state_entered_at = image->tables[i].state_entered_at + shift;
+        set_table_task_killed(ctx, (uint8_t)i, image->tables[i].flags & SYSTEM_IMAGE_TABLE_TASK_KILLED);
+        sync_active_table(ctx, (uint8_t)i);
     }
 
-    scheduler_force_active(&task_scheduler, id, now);
+    // Live slots first, in the order they are added below, then the saved free list
+    uint16_t order[SYSTEM_TASK_CAPACITY];
+    uint16_t generations[SYSTEM_TASK_CAPACITY];
+    for (uint8_t i = 0; i < image->slot_count; ++i) {
+        order[i] = (i < image->task_count) ? image->tasks[i].slot : image->free_slots[i - image->task_count];
+        generations[i] = image->generations[i];
+    }
+    task_pool_seed_free_list(&ctx->pool, order, generations, image->slot_count);
+
+    uint32_t tables_with_task[TABLE_WORDS] = {0};
+    task_id active = INVALID_TASK_ID;
+
+    for (uint8_t i = 0; i < image->task_count; ++i) {
+        const system_image_task *saved = &image->tasks[i];
+
+        task_id id = task_pool_add(&ctx->pool, saved->table_number, (task_kind)saved->kind, now);
+        task *t = task_pool_get(&ctx->pool, id);
+        if (!t || id.index != saved->slot) {
+            ESP_LOGE(SYS_TAG, "restore FAILED: table=%u not back in slot %u, cold start",
+                     (unsigned)saved->table_number, (unsigned)saved->slot);
+            reset_system(ctx, config, tables, now);
+            return false;
+        }
+
+        t->created_at     = saved->created_at + shift;
+        t->time_limit     = saved->time_limit + shift;
+        t->suppress_until = saved->suppress_until ? saved->suppress_until + shift : 0;
+        t->ignore_count   = saved->ignore_count;
+        t->overdue_level  = saved->overdue_level;
+        t->status         = (task_status)saved->status;
+        sync_task(ctx, id);
+
+        test_and_set(tables_with_task, saved->table_number);
+        if (i == image->active_index) active = id;
+    }
+
+    // Idle tables have neither tasks nor timers
+    for (uint16_t pos = 0; pos < ctx->active_table_count; ++pos) {
+        uint8_t table_number = ctx->active_tables[pos];
+
+        /* A table whose task could not be admitted before the reset, the pool
+           being full, gets another try. One whose task was killed by ignores
+           stays without, as it would have without the reset. */
+        if (!test_and_set(tables_with_task, table_number) && !table_task_killed(ctx, table_number)) {
+            admit_task(ctx, table_number, now);
+        }
+        sync_table_timer(ctx, table_number);
+    }
+
+    // Set directly rather than forced: the operator chose it, no new decision was made
+    ctx->sched.task_active_since = image->active_since + shift;
+    if (active.index != INVALID_TASK_ID.index) {
+        ctx->sched.has_active_task = true;
+        ctx->sched.active_task_id  = active;
+    }
+    run_scheduler(ctx, now);
+
+    check_invariants(ctx);
+
+    ESP_LOGI(SYS_TAG, "restored %u tasks from image seq=%lu, times shifted by %ld ms",
+             (unsigned)image->task_count, (unsigned long)image->sequence, (long)shift);
+    return true;
 }
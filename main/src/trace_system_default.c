@@ -0,0 +1,149 @@
+#include "../include/trace_system.h"
+#include "../include/event_journal.h"
+
+
+/* The firmware's one trace system, owned by the sched_tick task. Everything
+   here wraps the context API on it; trace_system.c itself keeps no state. */
+static trace_system_ctx default_system;
+
+_Static_assert(MAX_TABLES <= EVENT_JOURNAL_NO_TABLE, "journal events hold table numbers below EVENT_JOURNAL_NO_TABLE");
+
+
+static void journal_event(void *user, journal_event_type type, uint8_t table, uint8_t arg, time_ms now) {
+    (void)user;
+    event_journal_record(type, table, arg, now);
+}
+
+
+static void attach_default_hooks(void) {
+    system_ctx_set_event_hook(&default_system, journal_event, NULL);
+    system_ctx_set_record_decisions(&default_system, true);
+}
+
+
+// ----------------------------
+// Setup and updates
+// ----------------------------
+
+bool trace_system_init(const scheduler_config *config, uint16_t table_count) {
+    if (!trace_system_ctx_init(&default_system, config, table_count, get_time())) return false;
+    attach_default_hooks();
+    return true;
+}
+
+
+void system_apply_table_fsm_event(uint8_t table_index, fsm_transition_event event, time_ms current_time_ms) {
+    system_ctx_apply_table_fsm_event(&default_system, table_index, event, current_time_ms);
+}
+
+
+uint16_t system_apply_events(const system_table_event *batch, uint16_t count, time_ms current_time_ms) {
+    return system_ctx_apply_events(&default_system, batch, count, current_time_ms);
+}
+
+
+bool system_apply_user_action_to_task(task_id shown_task_id, user_action action, time_ms current_time_ms) {
+    return system_ctx_apply_user_action_to_task(&default_system, shown_task_id, action, current_time_ms);
+}
+
+
+bool system_undo_task_ignore(task_id id, uint8_t prev_ignore_count, time_ms prev_suppress_until, time_ms now) {
+    return system_ctx_undo_task_ignore(&default_system, id, prev_ignore_count, prev_suppress_until, now);
+}
+
+
+void trace_system_tick(time_ms current_time_ms) {
+    trace_system_ctx_tick(&default_system, current_time_ms);
+}
+
+
+void system_force_active_task(task_id id, time_ms now) {
+    system_ctx_force_active_task(&default_system, id, now);
+}
+
+
+void system_set_staff_on_shift(uint8_t staff_index, bool on_shift, time_ms now) {
+    system_ctx_set_staff_on_shift(&default_system, staff_index, on_shift, now);
+}
+
+
+// ----------------------------
+// Read-only accessors
+// ----------------------------
+
+table_state system_get_table_state(uint8_t table_index) {
+    return system_ctx_get_table_state(&default_system, table_index);
+}
+
+uint16_t system_get_table_count(void) {
+    return system_ctx_get_table_count(&default_system);
+}
+
+uint16_t system_get_active_tables(const uint8_t **tables) {
+    return system_ctx_get_active_tables(&default_system, tables);
+}
+
+const table_context *system_get_table(uint8_t table_index) {
+    return system_ctx_get_table(&default_system, table_index);
+}
+
+task_kind system_get_current_task_kind_for_table(uint8_t table_index) {
+    return system_ctx_get_current_task_kind_for_table(&default_system, table_index);
+}
+
+task *system_get_current_task_pointer_for_table(uint8_t table_index) {
+    return system_ctx_get_current_task_pointer_for_table(&default_system, table_index);
+}
+
+task_id system_get_active_task_id(void) {
+    return system_ctx_get_active_task_id(&default_system);
+}
+
+const task *system_get_active_task(void) {
+    return system_ctx_get_active_task(&default_system);
+}
+
+uint16_t system_get_pending_count(void) {
+    return system_ctx_get_pending_count(&default_system);
+}
+
+uint16_t system_get_critical_pending_count(void) {
+    return system_ctx_get_critical_pending_count(&default_system);
+}
+
+const task *system_get_top_critical_task(void) {
+    return system_ctx_get_top_critical_task(&default_system);
+}
+
+task_id system_get_staff_task(uint8_t staff_index) {
+    return system_ctx_get_staff_task(&default_system, staff_index);
+}
+
+bool system_predict_next_switch(time_ms now, time_ms *out_time, task_id *out_id) {
+    return system_ctx_predict_next_switch(&default_system, now, out_time, out_id);
+}
+
+const system_check_stats *system_get_check_stats(void) {
+    return system_ctx_get_check_stats(&default_system);
+}
+
+time_ms system_next_deadline(time_ms now) {
+    return system_ctx_next_deadline(&default_system, now);
+}
+
+
+// ----------------------------
+// Warm restart image
+// ----------------------------
+
+void system_capture_image(system_image *image, uint32_t sequence, time_ms now) {
+    system_ctx_capture_image(&default_system, image, sequence, now);
+}
+
+
+bool system_restore_image(const system_image *image, size_t size, const scheduler_config *config,
+                          uint16_t table_count, time_ms now) {
+    // Hooks first, so a task re-admitted on restore is journaled like any other
+    attach_default_hooks();
+    return system_ctx_restore_image(&default_system, image, size, config, table_count, now);
+}
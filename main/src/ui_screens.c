@@ -5,7 +5,7 @@
 #include "../include/task_domain.h"
 #include "../include/table_fsm.h"
 #include "../include/battery_monitor.h"
-#include "../include/trace_system.h"
+#include "../include/system_snapshot.h"
 
 #include <string.h>
 #include <stdio.h>
@@ -55,16 +55,16 @@ static void draw_active_task_label(spi_device_handle_t display, ui_snapshot snap
     if (snap.has_task) {
         const char *task_kind_label = task_kind_to_str(snap.task_kind);
         rect task_kind_rect = {.x=0,.y=60,.w=240,.h=30};
-        draw_urgency_icon(display, task_kind_rect, strlen(task_kind_label), task_kind_tile_color(snap.task_kind));
-        draw_label(display, task_kind_rect, task_kind_label, strlen(task_kind_label), COLOR_LABEL_CHROME, false);
+        draw_urgency_icon(display, task_kind_rect, strlen(task_kind_label), task_kind_tile_color(snap.task_kind), BG);
+        draw_label(display, task_kind_rect, task_kind_label, strlen(task_kind_label), COLOR_LABEL_CHROME, BG, false);
 
         char task_table_label[10];
         snprintf(task_table_label, sizeof(task_table_label), "Table %d", snap.table_number + 1);
-        draw_label(display, (rect){.x=0,.y=70+CHAR_HEIGHT*UI_TEXT_SCALE,.w=240,.h=30}, task_table_label, strlen(task_table_label), COLOR_LABEL_CHROME, false);
+        draw_label(display, (rect){.x=0,.y=70+CHAR_HEIGHT*UI_TEXT_SCALE,.w=240,.h=30}, task_table_label, strlen(task_table_label), COLOR_LABEL_CHROME, BG, false);
     }
     else {
         const char *task_label = "NONE";
-        draw_label(display, (rect){.x=0,.y=70,.w=240,.h=30}, task_label, strlen(task_label), COLOR_LABEL_CHROME, false);
+        draw_label(display, (rect){.x=0,.y=70,.w=240,.h=30}, task_label, strlen(task_label), COLOR_LABEL_CHROME, BG, false);
     }
 }
 
@@ -95,6 +95,33 @@ static void format_elapsed(time_ms elapsed_ms, char *buf, size_t len) {
 }
 
 
+static void draw_grid_tile(spi_device_handle_t display, const system_snapshot *view, uint8_t slot, uint8_t table_index) {
+    const system_table_view *tbl = system_snapshot_table(view, table_index);
+    if (!tbl) return;
+
+    uint16_t color_tile  = (tbl->state == TABLE_DINING) ? GREEN : task_kind_tile_color(tbl->task_kind);
+    uint16_t label_color = (color_tile == DARK_GREY || color_tile == RED) ? WHITE : BLACK;
+
+    // Overdue indicator: orange or red border drawn as outer rect with smaller inner fill
+    uint16_t overdue_color = 0;
+    if (tbl->overdue_level != TASK_ON_TIME) {
+        overdue_color = (tbl->overdue_level == TASK_CRITICALLY_OVERDUE) ? RED : ORANGE;
+    }
+
+    rect tile = table_tile_rect(slot);
+    if (overdue_color) {
+        draw_filled_rect(display, tile.x, tile.y, tile.w, tile.h, overdue_color, 10);
+        draw_filled_rect(display, tile.x + 3, tile.y + 3, tile.w - 6, tile.h - 6, color_tile, 7);
+    } else {
+        draw_filled_rect(display, tile.x, tile.y, tile.w, tile.h, color_tile, 10);
+    }
+
+    char table_label[4];
+    snprintf(table_label, sizeof(table_label), "T%u", table_index + 1);
+    draw_label(display, tile, table_label, strlen(table_label), label_color, color_tile, false);
+}
+
+
 /* ------------------- API ------------------- */
 void ui_draw_main(spi_device_handle_t display, ui_snapshot snapshot) {
     const uint16_t COLOR_TOPBAR = GREY;
@@ -102,12 +129,7 @@ void ui_draw_main(spi_device_handle_t display, ui_snapshot snapshot) {
     display_fill(display, BG);
 
     // Top bar: "Tables N" badge shows count of tables with active tasks
-    uint8_t active_tables = 0;
-    for (uint8_t i = 0; i < NUM_OF_TABLES; i++) {
-        if (system_get_current_task_kind_for_table(i) != TASK_NOT_APPLICABLE) {
-            active_tables++;
-        }
-    }
+    uint8_t active_tables = snapshot.active_tables;
 
     char tables_label[12];
     if (active_tables > 0) {
@@ -123,7 +145,7 @@ void ui_draw_main(spi_device_handle_t display, ui_snapshot snapshot) {
                      MAIN_TABLES_BTN.h,
                      COLOR_TOPBAR,
                      10);
-    draw_label(display, MAIN_TABLES_BTN, tables_label, strlen(tables_label), COLOR_LABEL_CHROME, false);
+    draw_label(display, MAIN_TABLES_BTN, tables_label, strlen(tables_label), COLOR_LABEL_CHROME, COLOR_TOPBAR, false);
 
     draw_pending_badge(display, snapshot.pending_count, snapshot.critical_count);
 
@@ -141,8 +163,8 @@ void ui_draw_main(spi_device_handle_t display, ui_snapshot snapshot) {
                               (snapshot.urgency_level == 1) ? ORANGE :
                               task_kind_tile_color(snapshot.task_kind);
 
-        draw_urgency_icon(display, task_kind_rect, strlen(task_kind_label), icon_color);
-        draw_label(display, task_kind_rect, task_kind_label, strlen(task_kind_label), COLOR_LABEL_CHROME, false);
+        draw_urgency_icon(display, task_kind_rect, strlen(task_kind_label), icon_color, BG);
+        draw_label(display, task_kind_rect, task_kind_label, strlen(task_kind_label), COLOR_LABEL_CHROME, BG, false);
 
         char task_table_label[10];
         snprintf(task_table_label, sizeof(task_table_label), "Table %u", snapshot.table_number + 1);
@@ -157,6 +179,7 @@ void ui_draw_main(spi_device_handle_t display, ui_snapshot snapshot) {
                    task_table_label,
                    strlen(task_table_label),
                    COLOR_LABEL_CHROME,
+                   BG,
                    false);
 
         // Time remaining / overdue indicator
@@ -177,7 +200,7 @@ void ui_draw_main(spi_device_handle_t display, ui_snapshot snapshot) {
         uint16_t tx = UI_CENTER_X
                     - (uint16_t)(strlen(time_str) * CHAR_WIDTH * UI_TEXT_SCALE / 2);
 
-        draw_text(display, tx, UI_MAIN_TIME_Y, time_str, time_color, UI_TEXT_SCALE);
+        draw_text(display, tx, UI_MAIN_TIME_Y, time_str, time_color, BG, UI_TEXT_SCALE);
     } else {
         const char *task_label = "NONE";
         draw_label(display,
@@ -190,6 +213,7 @@ void ui_draw_main(spi_device_handle_t display, ui_snapshot snapshot) {
                    task_label,
                    strlen(task_label),
                    COLOR_LABEL_CHROME,
+                   BG,
                    false);
     }
 
@@ -226,7 +250,7 @@ void ui_draw_main_time(spi_device_handle_t display, ui_snapshot snapshot) {
         time_color = (snapshot.urgency_level >= 2) ? RED : ORANGE;
     }
     uint16_t tx = UI_CENTER_X - (uint16_t)(strlen(time_str) * CHAR_WIDTH * UI_TEXT_SCALE / 2);
-    draw_text(display, tx, UI_MAIN_TIME_Y, time_str, time_color, UI_TEXT_SCALE);
+    draw_text(display, tx, UI_MAIN_TIME_Y, time_str, time_color, BG, UI_TEXT_SCALE);
 }
 
 
@@ -243,7 +267,24 @@ rect table_tile_rect(uint8_t index) {
 }
 
 
-void ui_draw_grid(spi_device_handle_t display) {
+void ui_draw_grid_tiles(spi_device_handle_t display, const system_snapshot *view, const uint32_t *tables) {
+    const uint8_t page_start = UI_GRID_PAGE * TABLES_PER_PAGE;
+
+    for (uint8_t slot = 0; slot < TABLES_PER_PAGE; ++slot) {
+        uint8_t table_index = page_start + slot;
+        if (table_index >= NUM_OF_TABLES) break;
+
+        if (!system_tables_test(tables, table_index)) continue;
+
+        // Tiles have rounded corners, so clear the cell before redrawing one in place
+        rect tile = table_tile_rect(slot);
+        draw_filled_rect(display, tile.x, tile.y, tile.w, tile.h, BG, 0);
+        draw_grid_tile(display, view, slot, table_index);
+    }
+}
+
+
+void ui_draw_grid(spi_device_handle_t display, const system_snapshot *view) {
     display_fill(display, BG);
     const uint8_t num_pages   = (NUM_OF_TABLES + TABLES_PER_PAGE - 1) / TABLES_PER_PAGE;
     const uint8_t page_start  = UI_GRID_PAGE * TABLES_PER_PAGE;
@@ -254,53 +295,29 @@ void ui_draw_grid(spi_device_handle_t display) {
 
     draw_back_icon(display);
     draw_label(display, (rect){.x=0,.y=0,.w=UI_SCREEN_W,.h=UI_TOPBAR_H},
-               title_label, strlen(title_label), COLOR_LABEL_CHROME, false);
-
-    time_ms now = get_time();
+               title_label, strlen(title_label), COLOR_LABEL_CHROME, BG, false);
 
     for (uint8_t slot = 0; slot < TABLES_PER_PAGE; ++slot) {
         uint8_t table_index = page_start + slot;
         if (table_index >= NUM_OF_TABLES) break;
 
-        table_state tile_state    = system_get_table_state(table_index);
-        task_kind tile_task_kind  = system_get_current_task_kind_for_table(table_index);
-        uint16_t color_tile       = (tile_state == TABLE_DINING) ? GREEN : task_kind_tile_color(tile_task_kind);
-        uint16_t label_color = (color_tile == DARK_GREY || color_tile == RED) ? WHITE : BLACK;
-
-        // Overdue indicator: orange or red border drawn as outer rect with smaller inner fill
-        task *tbl_task = system_get_current_task_pointer_for_table(table_index);
-        uint16_t overdue_color = 0;
-        if (tbl_task && now > tbl_task->time_limit) {
-            overdue_color = ((now - tbl_task->time_limit) >= (5 * TIME_SCALE)) ? RED : ORANGE;
-        }
-
-        rect tile = table_tile_rect(slot);
-        if (overdue_color) {
-            draw_filled_rect(display, tile.x, tile.y, tile.w, tile.h, overdue_color, 10);
-            draw_filled_rect(display, tile.x + 3, tile.y + 3, tile.w - 6, tile.h - 6, color_tile, 7);
-        } else {
-            draw_filled_rect(display, tile.x, tile.y, tile.w, tile.h, color_tile, 10);
-        }
-
-        char table_label[4];
-        snprintf(table_label, sizeof(table_label), "T%u", table_index + 1);
-        draw_label(display, tile, table_label, strlen(table_label), label_color, false);
+        draw_grid_tile(display, view, slot, table_index);
     }
 
     uint16_t prev_color = (UI_GRID_PAGE > 0)             ? LIGHT_GREY : DARK_GREY;
     uint16_t next_color = (UI_GRID_PAGE < num_pages - 1) ? LIGHT_GREY : DARK_GREY;
 
     draw_filled_rect(display, TABLE_GRID_PREV_BTN.x, TABLE_GRID_PREV_BTN.y, TABLE_GRID_PREV_BTN.w, TABLE_GRID_PREV_BTN.h, prev_color, 0);
-    draw_label(display, TABLE_GRID_PREV_BTN, prev_label, strlen(prev_label), COLOR_LABEL_CHROME, false);
+    draw_label(display, TABLE_GRID_PREV_BTN, prev_label, strlen(prev_label), COLOR_LABEL_CHROME, prev_color, false);
 
     draw_filled_rect(display, TABLE_GRID_NEXT_BTN.x, TABLE_GRID_NEXT_BTN.y, TABLE_GRID_NEXT_BTN.w, TABLE_GRID_NEXT_BTN.h, next_color, 0);
-    draw_label(display, TABLE_GRID_NEXT_BTN, next_label, strlen(next_label), COLOR_LABEL_CHROME, false);
+    draw_label(display, TABLE_GRID_NEXT_BTN, next_label, strlen(next_label), COLOR_LABEL_CHROME, next_color, false);
 
     draw_battery_icon(display, battery_monitor_get_bars());
 }
 
 
-void draw_active_table_page(spi_device_handle_t display_handle, uint8_t table_index) {
+void draw_active_table_page(spi_device_handle_t display_handle, const system_snapshot *view, uint8_t table_index) {
     display_fill(display_handle, BG);
 
     draw_back_icon(display_handle);
@@ -308,19 +325,19 @@ void draw_active_table_page(spi_device_handle_t display_handle, uint8_t table_in
     char table_number_label[10];
     snprintf(table_number_label, sizeof(table_number_label), "Table %d", table_index + 1);
     draw_label(display_handle, (rect){.x=0,.y=0,.w=UI_SCREEN_W,.h=UI_TOPBAR_H},
-               table_number_label, strlen(table_number_label), WHITE, false);
+               table_number_label, strlen(table_number_label), WHITE, BG, false);
 
-    const table_context *tbl = system_get_table(table_index);
+    const system_table_view *tbl = system_snapshot_table(view, table_index);
     time_ms now = get_time();
-    table_state tbl_state = tbl ? tbl->state : TABLE_IDLE;
+    table_state tbl_state = tbl ? (table_state)tbl->state : TABLE_IDLE;
 
     const char *state_name = table_state_to_str(tbl_state);
-    task_kind tbl_task_kind = system_get_current_task_kind_for_table(table_index);
+    task_kind tbl_task_kind = tbl ? (task_kind)tbl->task_kind : TASK_NOT_APPLICABLE;
     rect state_rect = {.x=10,.y=35,.w=220,.h=40};
     if (tbl_task_kind != TASK_NOT_APPLICABLE) {
-        draw_urgency_icon(display_handle, state_rect, strlen(state_name), task_kind_tile_color(tbl_task_kind));
+        draw_urgency_icon(display_handle, state_rect, strlen(state_name), task_kind_tile_color(tbl_task_kind), BG);
     }
-    draw_label(display_handle, state_rect, state_name, strlen(state_name), COLOR_LABEL_CHROME, false);
+    draw_label(display_handle, state_rect, state_name, strlen(state_name), COLOR_LABEL_CHROME, BG, false);
 
     char elapsed_str[16];
     if (tbl) {
@@ -329,7 +346,7 @@ void draw_active_table_page(spi_device_handle_t display_handle, uint8_t table_in
         snprintf(elapsed_str, sizeof(elapsed_str), "?");
     }
     draw_label(display_handle, (rect){.x=10,.y=78,.w=220,.h=30},
-               elapsed_str, strlen(elapsed_str), LIGHT_GREY, false);
+               elapsed_str, strlen(elapsed_str), LIGHT_GREY, BG, false);
 
     bool take_order_enabled = state_can_take_order(tbl_state);
     bool bill_enabled       = state_can_request_bill(tbl_state);
@@ -351,17 +368,17 @@ void ui_draw_switch_prompt(spi_device_handle_t display, ui_snapshot snap) {
 
     const char *header = "Urgent Task";
     rect header_rect = { .x = 0, .y = UI_CONFIRM_OVERLAY_Y + 30, .w = UI_SCREEN_W, .h = 25 };
-    draw_urgency_icon(display, header_rect, strlen(header), RED);
-    draw_label(display, header_rect, header, strlen(header), RED, false);
+    draw_urgency_icon(display, header_rect, strlen(header), RED, DARK_GREY);
+    draw_label(display, header_rect, header, strlen(header), RED, DARK_GREY, false);
 
     const char *kind_str = task_kind_to_str(snap.critical_task_kind);
     rect kind_rect = { .x = 0, .y = UI_CONFIRM_OVERLAY_Y + 80, .w = UI_SCREEN_W, .h = 25 };
-    draw_label(display, kind_rect, kind_str, strlen(kind_str), WHITE, false);
+    draw_label(display, kind_rect, kind_str, strlen(kind_str), WHITE, DARK_GREY, false);
 
     char table_label[10];
     snprintf(table_label, sizeof(table_label), "Table %d", snap.critical_table_number + 1);
     rect table_rect = { .x = 0, .y = UI_CONFIRM_OVERLAY_Y + 115, .w = UI_SCREEN_W, .h = 25 };
-    draw_label(display, table_rect, table_label, strlen(table_label), LIGHT_GREY, false);
+    draw_label(display, table_rect, table_label, strlen(table_label), LIGHT_GREY, DARK_GREY, false);
 
     time_ms now = get_time();
     if (now > snap.critical_deadline) {
@@ -369,7 +386,7 @@ void ui_draw_switch_prompt(spi_device_handle_t display, ui_snapshot snap) {
         char overdue_str[14];
         snprintf(overdue_str, sizeof(overdue_str), "+%um %02us", (unsigned)(s / 60), (unsigned)(s % 60));
         rect time_rect = { .x = 0, .y = UI_CONFIRM_OVERLAY_Y + 150, .w = UI_SCREEN_W, .h = 20 };
-        draw_label(display, time_rect, overdue_str, strlen(overdue_str), ORANGE, false);
+        draw_label(display, time_rect, overdue_str, strlen(overdue_str), ORANGE, DARK_GREY, false);
     }
 
     draw_button(display, CONFIRM_ALLOW_BTN, "Allow", BTN_PRIMARY);
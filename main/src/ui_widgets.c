@@ -2,7 +2,7 @@
 #include "../include/ui_internal.h"
 #include "../include/font5x7.h"
 #include "../include/table_fsm.h"
-#include "../include/trace_system.h"
+#include "../include/system_snapshot.h"
 
 #include <stdio.h>
 #include <stdint.h>
@@ -12,7 +12,8 @@
 #include "driver/spi_master.h"
 
 
-void draw_label(spi_device_handle_t display, rect r, const char *label, size_t label_len, uint16_t text_color, bool snap_left) {
+void draw_label(spi_device_handle_t display, rect r, const char *label, size_t label_len, uint16_t text_color,
+                uint16_t bg_color, bool snap_left) {
     // Split label in parts and arrange vertically if too long for its container.
     if (label_len * CHAR_WIDTH * UI_TEXT_SCALE > r.w) {
         char label_cpy[32];
@@ -30,8 +31,8 @@ void draw_label(spi_device_handle_t display, rect r, const char *label, size_t l
             uint16_t first_part_x = snap_left ? r.x : r.x + r.w/2 - strlen(first_part) * CHAR_WIDTH * UI_TEXT_SCALE/2;
             uint16_t second_part_x = snap_left ? r.x : r.x + r.w/2 - strlen(second_part) * CHAR_WIDTH * UI_TEXT_SCALE/2;
 
-            draw_text(display, first_part_x, first_part_y, first_part, text_color, UI_TEXT_SCALE);
-            draw_text(display, second_part_x, second_part_y, second_part, text_color, UI_TEXT_SCALE);
+            draw_text(display, first_part_x, first_part_y, first_part, text_color, bg_color, UI_TEXT_SCALE);
+            draw_text(display, second_part_x, second_part_y, second_part, text_color, bg_color, UI_TEXT_SCALE);
             return;
         }
         else {
@@ -42,7 +43,7 @@ void draw_label(spi_device_handle_t display, rect r, const char *label, size_t l
             uint16_t text_x = snap_left ? r.x : r.x + r.w/2 - draw_len * CHAR_WIDTH * UI_SMALL_TEXT_SCALE/2;
             char truncated[32];
             snprintf(truncated, sizeof(truncated), "%.*s", (int)draw_len, label);
-            draw_text(display, text_x, text_y, truncated, text_color, UI_SMALL_TEXT_SCALE);
+            draw_text(display, text_x, text_y, truncated, text_color, bg_color, UI_SMALL_TEXT_SCALE);
             return;
         }
     }
@@ -50,7 +51,7 @@ void draw_label(spi_device_handle_t display, rect r, const char *label, size_t l
     uint16_t text_y = r.y + r.h/2 - CHAR_HEIGHT * UI_TEXT_SCALE/2;
     uint16_t text_x = snap_left ? r.x : r.x + r.w/2 - label_len * CHAR_WIDTH * UI_TEXT_SCALE/2;
 
-    draw_text(display, text_x, text_y, label, text_color, UI_TEXT_SCALE);
+    draw_text(display, text_x, text_y, label, text_color, bg_color, UI_TEXT_SCALE);
 }
 
 
@@ -156,7 +157,7 @@ void draw_button(spi_device_handle_t display, rect r, const char *label, btn_sty
         r.x + BORDER_W, r.y + BORDER_W,
         r.w - 2 * BORDER_W, r.h - 2 * BORDER_W,
         fill, UI_CORNER_RADIUS - BORDER_W);
-    draw_label(display, r, label, strlen(label), text, false);
+    draw_label(display, r, label, strlen(label), text, fill, false);
 }
 
 
@@ -214,7 +215,7 @@ void draw_button_highlight(spi_device_handle_t display, ui_action act) {
 
 
 /* Restore a button to its normal style after a press animation. */
-void restore_button(spi_device_handle_t display, ui_action act, uint8_t sel_table) {
+void restore_button(spi_device_handle_t display, ui_action act, const system_table_view *sel_table) {
     switch (act) {
         case UI_ACTION_START_TASK:
             draw_button(display, MAIN_START_BTN,     "Start",      BTN_PRIMARY);   break;
@@ -227,20 +228,20 @@ void restore_button(spi_device_handle_t display, ui_action act, uint8_t sel_tabl
         case UI_ACTION_TAKE_ORDER:
             draw_button(display, MAIN_TAKEORDER_BTN, "Take Order", BTN_SECONDARY); break;
         case UI_ACTION_TABLE_INFO_TAKE_ORDER: {
-            table_state state = system_get_table_state(sel_table);
+            table_state state = sel_table ? (table_state)sel_table->state : TABLE_IDLE;
             draw_button(display, TABLE_INFO_TAKE_ORDER_BTN, "Take Order",
                         state_can_take_order(state) ? BTN_PRIMARY : BTN_DISABLED);
             break;
         }
         case UI_ACTION_TABLE_INFO_BILL: {
-            table_state state = system_get_table_state(sel_table);
+            table_state state = sel_table ? (table_state)sel_table->state : TABLE_IDLE;
             draw_button(display, TABLE_INFO_BILL_BTN, "Bill",
                         state_can_request_bill(state) ? BTN_SECONDARY : BTN_DISABLED);
             break;
         }
         case UI_ACTION_TABLE_INFO_UNDO:
             draw_button(display, TABLE_INFO_UNDO_BTN, "Undo",
-                        table_can_undo(system_get_table(sel_table)) ? BTN_SECONDARY : BTN_DISABLED);
+                        table_can_undo(sel_table) ? BTN_SECONDARY : BTN_DISABLED);
             break;
         case UI_ACTION_MAIN_UNDO:
             draw_button(display, MAIN_IGNORE_BTN, "Undo", BTN_SECONDARY);
@@ -254,7 +255,7 @@ void restore_button(spi_device_handle_t display, ui_action act, uint8_t sel_tabl
 }
 
 
-void draw_pending_badge(spi_device_handle_t display, uint8_t pending_count, uint8_t critical_count) {
+void draw_pending_badge(spi_device_handle_t display, uint16_t pending_count, uint16_t critical_count) {
     if (pending_count == 0) {
         draw_filled_rect(display, MAIN_QUEUE_BADGE.x, MAIN_QUEUE_BADGE.y,
                          MAIN_QUEUE_BADGE.w, MAIN_QUEUE_BADGE.h, BG, 0);
@@ -265,19 +266,19 @@ void draw_pending_badge(spi_device_handle_t display, uint8_t pending_count, uint
                      MAIN_QUEUE_BADGE.w, MAIN_QUEUE_BADGE.h, color, UI_CORNER_RADIUS);
     char count_str[4];
     snprintf(count_str, sizeof(count_str), "%u", (unsigned)pending_count);
-    draw_label(display, MAIN_QUEUE_BADGE, count_str, strlen(count_str), WHITE, false);
+    draw_label(display, MAIN_QUEUE_BADGE, count_str, strlen(count_str), WHITE, color, false);
 }
 
 
 /* ------------------- Icons ------------------- */
 /* Draw a coloured '!' to the left of where draw_label would centre label_len chars in rect r. */
 #define URGENCY_ICON_SCALE  3
-void draw_urgency_icon(spi_device_handle_t display, rect r, size_t label_len, uint16_t color) {
+void draw_urgency_icon(spi_device_handle_t display, rect r, size_t label_len, uint16_t color, uint16_t bg_color) {
     int16_t label_x = (int16_t)(r.x + r.w / 2) - (int16_t)(label_len * CHAR_WIDTH * UI_TEXT_SCALE / 2);
     uint16_t text_y = r.y + r.h / 2 - CHAR_HEIGHT * URGENCY_ICON_SCALE / 2;
     int16_t icon_x  = label_x - CHAR_WIDTH * URGENCY_ICON_SCALE - 4;
     if (icon_x >= 0) {
-        draw_text(display, (uint16_t)icon_x, text_y, "!", color, URGENCY_ICON_SCALE);
+        draw_text(display, (uint16_t)icon_x, text_y, "!", color, bg_color, URGENCY_ICON_SCALE);
     }
 }
 
@@ -314,5 +315,5 @@ void draw_battery_icon(spi_device_handle_t display, uint8_t bars) {
 void draw_back_icon(spi_device_handle_t display) {
     const uint16_t icon_x = 20;
     const uint16_t icon_y = (UI_TOPBAR_H - CHAR_HEIGHT * UI_TEXT_SCALE) / 2;
-    draw_text(display, icon_x, icon_y, "<", WHITE, UI_TEXT_SCALE);
+    draw_text(display, icon_x, icon_y, "<", WHITE, BG, UI_TEXT_SCALE);
 }
\ No newline at end of file
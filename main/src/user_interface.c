@@ -14,6 +14,10 @@
 #include "../include/font5x7.h"
 #include "../include/haptic_driver.h"
 #include "../include/battery_monitor.h"
+#include "../include/sched_tick.h"
+#include "../include/system_command.h"
+#include "../include/system_snapshot.h"
+#include "../include/system_notify.h"
 
 #include "driver/spi_master.h"
 #include <string.h>
@@ -34,10 +38,16 @@ typedef enum {
 } ui_urgency_band;
 
 
+/* System changes the UI wakes for, and those the main screen redraws in full. */
+#define UI_MAIN_CHANGES         (SYSTEM_CHANGE_ACTIVE | SYSTEM_CHANGE_COUNTS)
+#define UI_SUBSCRIBED_CHANGES   (UI_MAIN_CHANGES | SYSTEM_CHANGE_CRITICAL | SYSTEM_CHANGE_TABLES)
+
+
 static const char *TAG_UI = "ui";
 
 static volatile ui_mode UI_MODE = UI_MODE_TABLE_GRID;
 static volatile ui_snapshot UI_SNAPSHOT;
+static system_snapshot SYSTEM_VIEW;        // last snapshot read, UI_SNAPSHOT is derived from it
 
 static bool last_touch_pressed = false;
 
@@ -85,18 +95,21 @@ static inline bool task_id_equal(task_id a, task_id b) {
 }
 
 
-static void force_current_table_task_to_main(uint8_t table_number, time_ms now)
+/* The table's task only exists once its FSM event has been applied, so the
+   lookup is a command too, applied right after the event. */
+static void force_current_table_task_to_main(uint8_t table_number)
 {
-    task *t = system_get_current_task_pointer_for_table(table_number);
-    if (!t) return;
-
-    system_force_active_task(t->id, now);
+    system_post_force_table_task(table_number);
 }
 
 
+/* Everything the UI draws comes from one published snapshot, never from
+   live system state, which belongs to the scheduler tick task. */
 static void ui_update_snapshot_from_system() {
-    const task *task_inst = system_get_active_task();
-    if (!task_inst) {
+    system_snapshot_read(&SYSTEM_VIEW);
+
+    const system_task_view *task_inst = &SYSTEM_VIEW.active;
+    if (!task_inst->has_task) {
         UI_SNAPSHOT.has_task     = false;
         UI_SNAPSHOT.task_id      = INVALID_TASK_ID;
         UI_SNAPSHOT.table_number = 0;
@@ -104,62 +117,67 @@ static void ui_update_snapshot_from_system() {
         UI_SNAPSHOT.urgency_level = UI_URGENCY_ON_TIME;
         UI_SNAPSHOT.deadline      = 0;
     } else {
-        time_ms current_time_ms = get_time();
         uint8_t urgency_level = UI_URGENCY_ON_TIME;
-        if (current_time_ms > task_inst->time_limit)
-            urgency_level = ((current_time_ms - task_inst->time_limit) >= TASK_CRITICAL_OVRDUE_TIME_LIMIT[(int)task_inst->kind]) 
-                ? UI_URGENCY_CRITICAL : UI_URGENCY_OVERDUE;
+        if (task_inst->overdue_level == TASK_CRITICALLY_OVERDUE)  urgency_level = UI_URGENCY_CRITICAL;
+        else if (task_inst->overdue_level == TASK_OVERDUE)        urgency_level = UI_URGENCY_OVERDUE;
 
         UI_SNAPSHOT.has_task      = true;
         UI_SNAPSHOT.task_id       = task_inst->id;
         UI_SNAPSHOT.table_number  = task_inst->table_number;
         UI_SNAPSHOT.task_kind     = task_inst->kind;
         UI_SNAPSHOT.urgency_level = urgency_level;
-        UI_SNAPSHOT.deadline      = task_inst->time_limit;
+        UI_SNAPSHOT.deadline      = task_inst->deadline;
     }
 
-    UI_SNAPSHOT.pending_count  = system_get_pending_count();
-    UI_SNAPSHOT.critical_count = system_get_critical_pending_count();
+    UI_SNAPSHOT.active_tables  = SYSTEM_VIEW.active_tables;
+    UI_SNAPSHOT.pending_count  = SYSTEM_VIEW.pending_count;
+    UI_SNAPSHOT.critical_count = SYSTEM_VIEW.critical_count;
 
-    const task *top_critical_task = system_get_top_critical_task();
-    if (top_critical_task) {
+    const system_task_view *top_critical_task = &SYSTEM_VIEW.critical;
+    if (top_critical_task->has_task) {
         UI_SNAPSHOT.critical_task_id      = top_critical_task->id;
         UI_SNAPSHOT.critical_task_kind    = top_critical_task->kind;
         UI_SNAPSHOT.critical_table_number = top_critical_task->table_number;
-        UI_SNAPSHOT.critical_deadline     = top_critical_task->time_limit;
+        UI_SNAPSHOT.critical_deadline     = top_critical_task->deadline;
     } else {
         UI_SNAPSHOT.critical_task_id      = INVALID_TASK_ID;
         UI_SNAPSHOT.critical_task_kind    = TASK_NOT_APPLICABLE;
         UI_SNAPSHOT.critical_table_number = 0xFF;
         UI_SNAPSHOT.critical_deadline     = 0;
     }
+
+    UI_SNAPSHOT.switch_at      = SYSTEM_VIEW.switch_at;
+    UI_SNAPSHOT.switch_task_id = SYSTEM_VIEW.switch_task;
 }
 
 
 /* ---------------- Page mode wrappers ---------------- */
-static void ui_enter_main(spi_device_handle_t display, task_id *prev_task_id) {
+static void ui_enter_main(spi_device_handle_t display) {
     UI_MODE = UI_MODE_MAIN;
+    system_notify_ack(UI_MAIN_CHANGES);
     ui_update_snapshot_from_system();
     ui_draw_main(display, UI_SNAPSHOT);
 
     if (undo_available || undo_ignore_available) {
         draw_button(display, MAIN_IGNORE_BTN, "Undo", BTN_SECONDARY);
     }
-
-    *prev_task_id = UI_SNAPSHOT.task_id;
 }
 
 
 static void ui_enter_grid(spi_device_handle_t display) {
     UI_MODE = UI_MODE_TABLE_GRID;
-    ui_draw_grid(display);
+    system_notify_ack(SYSTEM_CHANGE_TABLES);
+    ui_update_snapshot_from_system();
+    ui_draw_grid(display, &SYSTEM_VIEW);
 }
 
 
 static void ui_enter_table_info(spi_device_handle_t display, uint8_t table_number) {
     SELECTED_TABLE = table_number;
     UI_MODE = UI_MODE_TABLE_INFO;
-    draw_active_table_page(display, table_number);
+    if (table_number < NUM_OF_TABLES) system_notify_ack_table(table_number);
+    ui_update_snapshot_from_system();
+    draw_active_table_page(display, &SYSTEM_VIEW, table_number);
 }
 
 
@@ -172,16 +190,18 @@ static void ui_enter_switch_prompt(spi_device_handle_t display, ui_snapshot snap
 
 /* Execute a button action (called on touch-up after press animation). */
 static void execute_button_action(spi_device_handle_t display, ui_action act,
-                                  ui_snapshot snap, time_ms now, uint8_t sel_table,
-                                  task_id *prev_task_id) {
+                                  ui_snapshot snap, time_ms now, uint8_t sel_table) {
+    const system_table_view *selected = system_snapshot_table(&SYSTEM_VIEW, sel_table);
+    table_state selected_state = selected ? (table_state)selected->state : TABLE_IDLE;
+
     switch (act) {
         case UI_ACTION_IGNORE:
             if (snap.has_task) {
-                const task *t = system_get_active_task();
-                undo_ignore_prev_count    = t ? t->ignore_count    : 0;
-                undo_ignore_prev_suppress = t ? t->suppress_until  : 0;
+                const system_task_view *t = &SYSTEM_VIEW.active;
+                undo_ignore_prev_count    = t->ignore_count;
+                undo_ignore_prev_suppress = t->suppress_until;
                 undo_ignore_task_id       = snap.task_id;
-                system_apply_user_action_to_task(snap.task_id, USER_ACTION_IGNORE, now);
+                system_post_user_action(snap.task_id, USER_ACTION_IGNORE);
                 undo_ignore_available = true;
                 undo_available        = false;
                 undo_ignore_start_ms  = now;
@@ -189,13 +209,14 @@ static void execute_button_action(spi_device_handle_t display, ui_action act,
             }
             break;
         case UI_ACTION_BILL:
-            system_apply_table_fsm_event(snap.table_number, EVENT_TABLE_REQUESTED_BILL, now);
-            force_current_table_task_to_main(snap.table_number, now);
-            ui_enter_main(display, prev_task_id);
+            system_post_table_event(snap.table_number, EVENT_TABLE_REQUESTED_BILL);
+            force_current_table_task_to_main(snap.table_number);
+            sched_tick_sync();
+            ui_enter_main(display);
             break;
         case UI_ACTION_COMPLETE: {
             if (snap.has_task) {
-                system_apply_user_action_to_task(snap.task_id, USER_ACTION_COMPLETE, now);
+                system_post_user_action(snap.task_id, USER_ACTION_COMPLETE);
                 undo_available        = true;
                 undo_ignore_available = false;
                 undo_table            = snap.table_number;
@@ -206,39 +227,44 @@ static void execute_button_action(spi_device_handle_t display, ui_action act,
         }
         case UI_ACTION_MAIN_UNDO:
             if (undo_available) {
-                system_apply_table_fsm_event(undo_table, EVENT_UNDO, now);
+                system_post_table_event(undo_table, EVENT_UNDO);
                 undo_available = false;
                 draw_button(display, MAIN_IGNORE_BTN, "Ignore", BTN_DISABLED);
             } else if (undo_ignore_available) {
-                system_undo_task_ignore(undo_ignore_task_id, undo_ignore_prev_count, undo_ignore_prev_suppress, now);
+                system_post_undo_ignore(undo_ignore_task_id, undo_ignore_prev_count, undo_ignore_prev_suppress);
                 undo_ignore_available = false;
+                sched_tick_sync();
                 ui_update_snapshot_from_system();
                 draw_button(display, MAIN_IGNORE_BTN, "Ignore",
                             UI_SNAPSHOT.has_task ? BTN_WARNING : BTN_DISABLED);
             }
             break;
         case UI_ACTION_TAKE_ORDER:
-            system_apply_table_fsm_event(snap.table_number, EVENT_TAKE_ORDER_EARLY_OR_REPEAT, now);
-            force_current_table_task_to_main(snap.table_number, now);
-            ui_enter_main(display, prev_task_id);
+            system_post_table_event(snap.table_number, EVENT_TAKE_ORDER_EARLY_OR_REPEAT);
+            force_current_table_task_to_main(snap.table_number);
+            sched_tick_sync();
+            ui_enter_main(display);
             break;
         case UI_ACTION_TABLE_INFO_TAKE_ORDER:
-            if (state_can_take_order(system_get_table_state(sel_table))) {
-                system_apply_table_fsm_event(sel_table, EVENT_TAKE_ORDER_EARLY_OR_REPEAT, now);
-                force_current_table_task_to_main(sel_table, now);
-                ui_enter_main(display, prev_task_id);
+            if (state_can_take_order(selected_state)) {
+                system_post_table_event(sel_table, EVENT_TAKE_ORDER_EARLY_OR_REPEAT);
+                force_current_table_task_to_main(sel_table);
+                sched_tick_sync();
+                ui_enter_main(display);
             }
             break;
         case UI_ACTION_TABLE_INFO_BILL:
-            if (state_can_request_bill(system_get_table_state(sel_table))) {
-                system_apply_table_fsm_event(sel_table, EVENT_TABLE_REQUESTED_BILL, now);
-                force_current_table_task_to_main(sel_table, now);
-                ui_enter_main(display, prev_task_id);
+            if (state_can_request_bill(selected_state)) {
+                system_post_table_event(sel_table, EVENT_TABLE_REQUESTED_BILL);
+                force_current_table_task_to_main(sel_table);
+                sched_tick_sync();
+                ui_enter_main(display);
             }
             break;
         case UI_ACTION_TABLE_INFO_UNDO:
-            if (table_can_undo(system_get_table(sel_table))) {
-                system_apply_table_fsm_event(sel_table, EVENT_UNDO, now);
+            if (table_can_undo(selected)) {
+                system_post_table_event(sel_table, EVENT_UNDO);
+                sched_tick_sync();
                 ui_enter_table_info(display, sel_table);
             }
             break;
@@ -328,11 +354,34 @@ static void expire_undo_buttons(spi_device_handle_t display, time_ms now, ui_sna
 
 
 
-static void sync_main_task_state(spi_device_handle_t display, ui_snapshot snap, task_id *prev_task_id) {
-    if (UI_MODE != UI_MODE_MAIN) return;
+/* Redraw what the published changes touched on the current screen. Screens
+   redraw in full when entered and ack the bits they cover, so this only
+   sees changes made since. */
+static void apply_system_changes(spi_device_handle_t display, uint32_t changes) {
+    uint32_t tables[SYSTEM_TABLE_WORDS];
 
-    if (!task_id_equal(snap.task_id, *prev_task_id)) {
-        ui_enter_main(display, prev_task_id);
+    switch (UI_MODE) {
+        case UI_MODE_MAIN:
+            if (changes & SYSTEM_CHANGE_ACTIVE) {
+                ui_enter_main(display);
+            } else if (changes & SYSTEM_CHANGE_COUNTS) {
+                draw_pending_badge(display, UI_SNAPSHOT.pending_count, UI_SNAPSHOT.critical_count);
+            }
+            break;
+        case UI_MODE_TABLE_GRID:
+            if (!(changes & SYSTEM_CHANGE_TABLES)) break;
+            system_notify_take_tables(tables);
+            ui_draw_grid_tiles(display, &SYSTEM_VIEW, tables);
+            break;
+        case UI_MODE_TABLE_INFO:
+            if (!(changes & SYSTEM_CHANGE_TABLES)) break;
+            system_notify_take_tables(tables);
+            if (SELECTED_TABLE < NUM_OF_TABLES && system_tables_test(tables, SELECTED_TABLE)) {
+                ui_enter_table_info(display, SELECTED_TABLE);
+            }
+            break;
+        default:
+            break;
     }
 }
 
@@ -375,7 +424,7 @@ static void process_touch_down(spi_device_handle_t display, uint16_t x, uint16_t
 }
 
 
-static void handle_swipe(spi_device_handle_t display, int16_t dx, ui_action *pending_action, task_id *prev_task_id) {
+static void handle_swipe(spi_device_handle_t display, int16_t dx, ui_action *pending_action) {
     *pending_action = UI_ACTION_NONE;
     const uint8_t num_pages = (NUM_OF_TABLES + TABLES_PER_PAGE - 1) / TABLES_PER_PAGE;
     if (UI_MODE == UI_MODE_MAIN) {
@@ -387,7 +436,7 @@ static void handle_swipe(spi_device_handle_t display, int16_t dx, ui_action *pen
             UI_GRID_PAGE--;
             ui_enter_grid(display);
         } else {
-            ui_enter_main(display, prev_task_id);
+            ui_enter_main(display);
         }
     } else {
         // Swipe left: go to next page
@@ -399,9 +448,9 @@ static void handle_swipe(spi_device_handle_t display, int16_t dx, ui_action *pen
 }
 
 
-static void dispatch_action(spi_device_handle_t display, ui_action pact, time_ms now, task_id *prev_task_id) {
-    restore_button(display, pact, SELECTED_TABLE);
+static void dispatch_action(spi_device_handle_t display, ui_action pact, time_ms now) {
     ui_update_snapshot_from_system();
+    restore_button(display, pact, system_snapshot_table(&SYSTEM_VIEW, SELECTED_TABLE));
     ui_snapshot snap = UI_SNAPSHOT;
 
     const uint8_t num_pages = (NUM_OF_TABLES + TABLES_PER_PAGE - 1) / TABLES_PER_PAGE;
@@ -414,7 +463,7 @@ static void dispatch_action(spi_device_handle_t display, ui_action pact, time_ms
             ui_enter_table_info(display, snap.table_number);
             break;
         case UI_ACTION_BACK:
-            ui_enter_main(display, prev_task_id);
+            ui_enter_main(display);
             break;
         case UI_ACTION_GRID_PREV_PAGE:
             if (UI_GRID_PAGE > 0) { 
@@ -429,35 +478,37 @@ static void dispatch_action(spi_device_handle_t display, ui_action pact, time_ms
             }
             break;
         case UI_ACTION_TABLE_INFO_BACK:
-            ui_enter_main(display, prev_task_id);
+            ui_enter_main(display);
             break;
         case UI_ACTION_CONFIRM_ALLOW:
-            system_force_active_task(switch_overlay_task_id, now);
+            system_post_force_active(switch_overlay_task_id);
+            sched_tick_sync();
             switch_denied_task_id        = UNINITIALISED_TASK_ID;
             active_task_id_during_switch = UNINITIALISED_TASK_ID;
             switch_overlay_task_id       = UNINITIALISED_TASK_ID;
-            ui_enter_main(display, prev_task_id);
+            ui_enter_main(display);
             break;
         case UI_ACTION_CONFIRM_DENY:
             switch_denied_task_id        = switch_overlay_task_id;
             active_task_id_during_switch = snap.task_id;
             switch_overlay_task_id       = UNINITIALISED_TASK_ID;
-            ui_enter_main(display, prev_task_id);
+            ui_enter_main(display);
             break;
         default:
             if (pact >= UI_ACTION_TABLE_TILE_1 && pact <= UI_ACTION_TABLE_TILE_9) {
                 uint8_t slot = (uint8_t)(pact - UI_ACTION_TABLE_TILE_1);
                 uint8_t table = UI_GRID_PAGE * TABLES_PER_PAGE + slot;
                 if (table < NUM_OF_TABLES) {
-                    if (system_get_table_state(table) == TABLE_IDLE) {
-                        system_apply_table_fsm_event(table, EVENT_CUSTOMERS_SEATED, now);
-                        ui_enter_main(display, prev_task_id);
+                    if (SYSTEM_VIEW.tables[table].state == TABLE_IDLE) {
+                        system_post_table_event(table, EVENT_CUSTOMERS_SEATED);
+                        sched_tick_sync();
+                        ui_enter_main(display);
                     } else {
                         ui_enter_table_info(display, table);
                     }
                 }
             } else {
-                execute_button_action(display, pact, snap, now, SELECTED_TABLE, prev_task_id);
+                execute_button_action(display, pact, snap, now, SELECTED_TABLE);
             }
             break;
     }
@@ -468,8 +519,6 @@ static void tick_periodic_updates(spi_device_handle_t display, bool display_slee
     static uint32_t time_tick = 0;
     static uint32_t batt_tick = 0;
     static uint8_t prev_bars          = 0xFF;
-    static uint8_t prev_pending_count  = 0xFF;
-    static uint8_t prev_critical_count = 0xFF;
 
     if (++time_tick >= 20) {
         time_tick = 0;
@@ -489,22 +538,16 @@ static void tick_periodic_updates(spi_device_handle_t display, bool display_slee
         draw_battery_icon(display, current_bars);
         prev_bars = current_bars;
     }
-
-    if (UI_MODE == UI_MODE_MAIN && !display_sleeping) {
-        uint8_t p = UI_SNAPSHOT.pending_count;
-        uint8_t c = UI_SNAPSHOT.critical_count;
-        if (p != prev_pending_count || c != prev_critical_count) {
-            draw_pending_badge(display, p, c);
-            prev_pending_count  = p;
-            prev_critical_count = c;
-        }
-    }
 }
 
 
 void ui_task(void *arg) {
     display_spi_ctx display = *(display_spi_ctx *)arg;
-    task_id prev_task_id = UNINITIALISED_TASK_ID;
+    // Changes published while the display sleeps or before the screen is drawn pile up here
+    uint32_t system_changes = 0;
+    system_notify_subscribe(NULL, UI_SUBSCRIBED_CHANGES);
+
+    ui_enter_grid(display.dev_handle);
 
     bool display_sleeping = false;
     time_ms last_activity_ms = get_time();
@@ -524,12 +567,16 @@ void ui_task(void *arg) {
     bool urgent_level1_notified = false;
     task_id last_urgent_task_id   = UNINITIALISED_TASK_ID;
     task_id last_critical_task_id = UNINITIALISED_TASK_ID;
+    task_id prewoken_switch_task_id = UNINITIALISED_TASK_ID;
 
     while (1) {
         time_ms now = get_time();
         uint16_t x = 0, y = 0;
         bool pressed = read_touch_point(&x, &y);
 
+        ui_update_snapshot_from_system();
+        ui_snapshot snap = UI_SNAPSHOT;
+
         // Haptic notifications (run regardless of sleep state)
         // Any haptic trigger also wakes the display.
         {
@@ -541,18 +588,16 @@ void ui_task(void *arg) {
     } \
 } while (0)
 
-            const task *active = system_get_active_task();
-            if (active) {
-                if (!task_id_equal(active->id, last_urgent_task_id)) {
+            if (snap.has_task) {
+                if (!task_id_equal(snap.task_id, last_urgent_task_id)) {
                     drv2605l_play_effect(1);
                     WAKE_IF_SLEEPING();
                     urgent_notified = false;
                     urgent_level1_notified = false;
-                    last_urgent_task_id = active->id;
+                    last_urgent_task_id = snap.task_id;
                 }
-                bool is_overdue = (now > active->time_limit);
-                bool is_critically_overdue = is_overdue &&
-                                             (now - active->time_limit) >= TASK_CRITICAL_OVRDUE_TIME_LIMIT[(int)active->kind];
+                bool is_overdue            = (snap.urgency_level >= UI_URGENCY_OVERDUE);
+                bool is_critically_overdue = (snap.urgency_level >= UI_URGENCY_CRITICAL);
                 // Urgency level 1: task just became overdue — single click + wake
                 if (is_overdue && !urgent_level1_notified) {
                     drv2605l_play_effect(1);
@@ -572,16 +617,26 @@ void ui_task(void *arg) {
             }
 
             // Critical pending task — urgent haptic + wake on first detection
-            const task *critical_pending = system_get_top_critical_task();
-            if (critical_pending) {
-                if (!task_id_equal(critical_pending->id, last_critical_task_id)) {
+            if (snap.critical_count > 0) {
+                if (!task_id_equal(snap.critical_task_id, last_critical_task_id)) {
                     drv2605l_play_urgent_pattern();
                     WAKE_IF_SLEEPING();
-                    last_critical_task_id = critical_pending->id;
+                    last_critical_task_id = snap.critical_task_id;
                 }
             } else {
                 last_critical_task_id = UNINITIALISED_TASK_ID;
             }
+
+            // Predicted switch prompt close — light the display ahead of it, once per challenger,
+            // so the prompt is readable when the haptic above fires
+            if (snap.switch_at != 0 && (int32_t)(snap.switch_at - now) <= UI_SWITCH_PREWAKE_MS) {
+                if (!task_id_equal(snap.switch_task_id, prewoken_switch_task_id)) {
+                    WAKE_IF_SLEEPING();
+                    prewoken_switch_task_id = snap.switch_task_id;
+                }
+            } else if (snap.switch_at == 0) {
+                prewoken_switch_task_id = UNINITIALISED_TASK_ID;
+            }
 #undef WAKE_IF_SLEEPING
         }
 
@@ -595,7 +650,7 @@ void ui_task(void *arg) {
                 sleep_triggered_this_hold = false;
             }
             last_touch_pressed = pressed;
-            vTaskDelay(pdMS_TO_TICKS(50));
+            system_changes |= system_notify_wait(pdMS_TO_TICKS(UI_POLL_MS));
             continue;
         }
 
@@ -606,7 +661,7 @@ void ui_task(void *arg) {
             corner_hold_active = false;
             sleep_triggered_this_hold = false;
             last_touch_pressed = pressed;
-            vTaskDelay(pdMS_TO_TICKS(50));
+            system_changes |= system_notify_wait(pdMS_TO_TICKS(UI_POLL_MS));
             continue;
         }
 
@@ -630,7 +685,7 @@ void ui_task(void *arg) {
                 display_sleeping = true;
                 display_backlight_set(false);
                 last_touch_pressed = pressed;
-                vTaskDelay(pdMS_TO_TICKS(50));
+                system_changes |= system_notify_wait(pdMS_TO_TICKS(UI_POLL_MS));
                 continue;
             }
         }
@@ -641,11 +696,9 @@ void ui_task(void *arg) {
         }
 
         // --- Normal UI update ---
-        ui_update_snapshot_from_system();
-        ui_snapshot snap = UI_SNAPSHOT;
-
         expire_undo_buttons(display.dev_handle, now, snap);
-        sync_main_task_state(display.dev_handle, snap, &prev_task_id);
+        apply_system_changes(display.dev_handle, system_changes);
+        system_changes = 0;
 
         // Expire deny suppression once the current task has changed
         if (switch_denied_task_id.index != UINT16_MAX &&
@@ -680,11 +733,12 @@ void ui_task(void *arg) {
                             (UI_MODE == UI_MODE_TABLE_GRID && (dx >  (int16_t)UI_SWIPE_THRESHOLD ||
                                                                dx < -(int16_t)UI_SWIPE_THRESHOLD));
             if (is_swipe) {
-                handle_swipe(display.dev_handle, dx, &PENDING_ACTION, &prev_task_id);
+                handle_swipe(display.dev_handle, dx, &PENDING_ACTION);
             } else if (PENDING_ACTION != UI_ACTION_NONE) {
                 ui_action pact = PENDING_ACTION;
                 PENDING_ACTION = UI_ACTION_NONE;
-                dispatch_action(display.dev_handle, pact, now, &prev_task_id);
+                dispatch_action(display.dev_handle, pact, now);
+                sched_tick_wake();      // the action may have moved the next deadline
             }
         }
 
@@ -692,6 +746,7 @@ void ui_task(void *arg) {
 
         tick_periodic_updates(display.dev_handle, display_sleeping);
 
-        vTaskDelay(pdMS_TO_TICKS(50));
+        // Touch is polled, so wait at most one poll period; a published change ends the wait early
+        system_changes |= system_notify_wait(pdMS_TO_TICKS(UI_POLL_MS));
     }
 }
@@ -0,0 +1,98 @@
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+#include "../include/warm_restart.h"
+#include "../include/trace_system.h"
+
+
+static const char *TAG = "warm_restart";
+
+/* Left alone by the bootloader and by every reset except power-on, which
+   leaves garbage that the CRC rejects. */
+static RTC_NOINIT_ATTR system_image warm_images[2];
+
+// Resumes in a row that did not reach WARM_RESTART_STABLE_MS; trusted only while the check matches
+static RTC_NOINIT_ATTR uint32_t resume_streak;
+static RTC_NOINIT_ATTR uint32_t resume_streak_check;
+
+static uint32_t save_sequence;      // sequence of the last image written
+
+
+static bool reset_keeps_rtc_memory(esp_reset_reason_t reason) {
+    switch (reason) {
+        case ESP_RST_SW:
+        case ESP_RST_PANIC:
+        case ESP_RST_INT_WDT:
+        case ESP_RST_TASK_WDT:
+        case ESP_RST_WDT:
+        case ESP_RST_BROWNOUT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+// Newest image that passes its checks, NULL if neither does
+static const system_image *newest_valid_image(void) {
+    bool valid0 = system_image_valid(&warm_images[0], sizeof(warm_images[0]));
+    bool valid1 = system_image_valid(&warm_images[1], sizeof(warm_images[1]));
+
+    if (valid0 && valid1) {
+        // Signed difference, so the comparison survives the sequence wrapping
+        return ((int32_t)(warm_images[1].sequence - warm_images[0].sequence) > 0) ? &warm_images[1] : &warm_images[0];
+    }
+    if (valid0) return &warm_images[0];
+    if (valid1) return &warm_images[1];
+    return NULL;
+}
+
+
+static void set_resume_streak(uint32_t streak) {
+    resume_streak       = streak;
+    resume_streak_check = ~streak;
+}
+
+
+bool warm_restart_resume(const scheduler_config *config) {
+    esp_reset_reason_t reason = esp_reset_reason();
+    const system_image *image = NULL;
+
+    if (reset_keeps_rtc_memory(reason)) {
+        if (resume_streak_check != ~resume_streak) set_resume_streak(0);
+
+        if (resume_streak >= WARM_RESTART_MAX_RESUMES) {
+            ESP_LOGW(TAG, "%lu resumes in a row did not hold, not resuming", (unsigned long)resume_streak);
+        } else {
+            image = newest_valid_image();
+        }
+    }
+
+    if (!image) {
+        ESP_LOGI(TAG, "cold start (reset reason %d)", (int)reason);
+        trace_system_init(config, MAX_TABLES);
+        set_resume_streak(0);
+        save_sequence = 0;
+        return false;
+    }
+
+    int64_t start_us = clock_now_us();
+    bool resumed = system_restore_image(image, sizeof(*image), config, MAX_TABLES, get_time());
+
+    // Carry on from the restored sequence so the older image is the next one overwritten
+    save_sequence = resumed ? image->sequence : 0;
+    set_resume_streak(resumed ? resume_streak + 1 : 0);
+    ESP_LOGI(TAG, "%s after reset reason %d in %lld us", resumed ? "resumed" : "cold start",
+             (int)reason, (long long)(clock_now_us() - start_us));
+    return resumed;
+}
+
+
+void warm_restart_save(time_ms now) {
+    // get_time() is uptime, so this is how long the firmware has run since the resume
+    if (resume_streak && now >= WARM_RESTART_STABLE_MS) set_resume_streak(0);
+
+    save_sequence++;
+    system_capture_image(&warm_images[save_sequence & 1], save_sequence, now);
+}
@@ -0,0 +1,68 @@
+# Table FSM transition spec.
+#
+# tools/table_fsm_gen.py compiles this file into src/table_fsm_table.c: a
+# dense next-state table indexed [state][event] and one descriptor per
+# state. The build regenerates it when this file changes; the output is
+# checked in so host builds need no Python. Names are the enumerators of
+# table_fsm.h and task_domain.h, listed here in enum order.
+#
+#   state  NAME  TASK|-  [TIMEOUT_MS TIMEOUT_EVENT]
+#          The task a table in this state asks for, "-" for none. With a
+#          timeout, TIMEOUT_EVENT fires once the table has been in the
+#          state that long (a C expression without spaces).
+#   event  NAME
+#   undo   NAME
+#          Steps back to the previous state, unless that was the initial
+#          one. Handled ahead of the table, so it takes no transitions.
+#   initial NAME
+#   FROM  EVENT  TO
+#          One transition. Every other (state, event) pair leaves the
+#          state unchanged.
+
+state   TABLE_IDLE                  -
+state   TABLE_SEATED                SERVE_WATER
+state   TABLE_READY_FOR_ORDER       TAKE_ORDER
+state   TABLE_PLACED_ORDER          PREPARE_ORDER
+state   TABLE_WAITING_FOR_ORDER     SERVE_ORDER
+state   TABLE_DINING                -               DINING_CHECKIN_INTERVAL_MS  TIMEOUT_PERIODIC_CHECKIN
+state   TABLE_CHECKUP               MONITOR_TABLE
+state   TABLE_REQUESTED_BILL        PRESENT_BILL
+state   TABLE_DONE                  CLEAR_TABLE
+
+event   EVENT_MARK_COMPLETE
+event   EVENT_TAKE_ORDER_EARLY_OR_REPEAT
+event   EVENT_CUSTOMERS_SEATED
+event   EVENT_POS_ORDER_READY
+event   EVENT_TABLE_REQUESTED_BILL
+undo    EVENT_UNDO
+event   TIMEOUT_PERIODIC_CHECKIN
+
+initial TABLE_IDLE
+
+
+TABLE_IDLE                  EVENT_CUSTOMERS_SEATED              TABLE_SEATED
+
+TABLE_SEATED                EVENT_MARK_COMPLETE                 TABLE_READY_FOR_ORDER
+TABLE_SEATED                EVENT_TAKE_ORDER_EARLY_OR_REPEAT    TABLE_READY_FOR_ORDER
+
+TABLE_READY_FOR_ORDER       EVENT_MARK_COMPLETE                 TABLE_PLACED_ORDER
+
+TABLE_PLACED_ORDER          EVENT_MARK_COMPLETE                 TABLE_WAITING_FOR_ORDER
+TABLE_PLACED_ORDER          EVENT_TAKE_ORDER_EARLY_OR_REPEAT    TABLE_READY_FOR_ORDER
+TABLE_PLACED_ORDER          EVENT_POS_ORDER_READY               TABLE_WAITING_FOR_ORDER
+
+TABLE_WAITING_FOR_ORDER     EVENT_MARK_COMPLETE                 TABLE_DINING
+TABLE_WAITING_FOR_ORDER     EVENT_TAKE_ORDER_EARLY_OR_REPEAT    TABLE_READY_FOR_ORDER
+TABLE_WAITING_FOR_ORDER     EVENT_TABLE_REQUESTED_BILL          TABLE_REQUESTED_BILL
+
+TABLE_DINING                TIMEOUT_PERIODIC_CHECKIN            TABLE_CHECKUP
+TABLE_DINING                EVENT_TAKE_ORDER_EARLY_OR_REPEAT    TABLE_READY_FOR_ORDER
+TABLE_DINING                EVENT_TABLE_REQUESTED_BILL          TABLE_REQUESTED_BILL
+
+TABLE_CHECKUP               EVENT_TAKE_ORDER_EARLY_OR_REPEAT    TABLE_READY_FOR_ORDER
+TABLE_CHECKUP               EVENT_MARK_COMPLETE                 TABLE_DINING
+TABLE_CHECKUP               EVENT_TABLE_REQUESTED_BILL          TABLE_REQUESTED_BILL
+
+TABLE_REQUESTED_BILL        EVENT_MARK_COMPLETE                 TABLE_DONE
+
+TABLE_DONE                  EVENT_MARK_COMPLETE                 TABLE_IDLE
@@ -0,0 +1,271 @@
+/*
+ * Batched table event benchmark.
+ *
+ * Compares a burst of POS events applied one system_apply_table_fsm_event()
+ * at a time, which reschedules after every event, against the same burst
+ * handed to system_apply_events() as one batch. A floor is first played
+ * into a mix of table states and captured with system_capture_image().
+ * Every round restores that image, applies a fresh random burst one way,
+ * restores it again and applies the same burst the other way. Only the
+ * apply calls are timed, and the median round is reported.
+ *
+ * Bursts look like what the POS sends after a reconnect or a busy minute:
+ * seatings, order-ready and bill messages spread over the floor, with some
+ * delivered twice and some tables getting two or three messages that take
+ * them through more than one state. Both ways must leave every table in
+ * the same state with the same current task, and the invariant checker
+ * must stay quiet, or the run fails.
+ *
+ * Build from the repository root:
+ *
+ *   gcc -O2 -std=gnu11 -DTRACE_VIRTUAL_CLOCK -Itools/replay/stubs -Imain/include \
+ *       tools/bench/event_batch_bench.c main/src/task_domain.c main/src/task_pool.c \
+ *       main/src/trace_scheduler.c main/src/table_fsm.c main/src/table_fsm_table.c \
+ *       main/src/trace_system.c main/src/trace_system_default.c main/src/floor_layout.c \
+ *       main/src/decision_trace.c main/src/timer_wheel.c main/src/event_journal.c -lm -o event_batch_bench
+ *
+ * Usage:
+ *
+ *   ./event_batch_bench [-r rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "trace_system.h"
+#include "esp_partition.h"
+
+
+#define BENCH_WARMUP_MS     (90 * 60 * 1000)    // floor play before the capture
+#define BENCH_STEP_MS       5000
+#define BENCH_REPEAT_ODDS   4                   // a message is a repeat of an earlier one one in this many
+
+static const uint16_t BURST_SIZES[] = { 1, 4, 16, 32 };      // 16 is SCHED_TICK_COMMAND_BATCH
+
+static const fsm_transition_event POS_EVENTS[] = {
+    EVENT_CUSTOMERS_SEATED,
+    EVENT_POS_ORDER_READY,
+    EVENT_TABLE_REQUESTED_BILL,
+};
+
+int64_t virtual_clock_us;
+
+static system_image floor_image;
+
+
+/* The system journals events; there is no partition here, so they are
+   staged and dropped. */
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label) {
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size) {
+    return ESP_FAIL;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size) {
+    return ESP_FAIL;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size) {
+    return ESP_FAIL;
+}
+
+// The image is captured and restored in the same process, so no real checksum is needed
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len) {
+    return crc;
+}
+
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+
+// xorshift32, so runs are repeatable across libcs
+static uint32_t rng_state = 0x9e3779b9u;
+
+static uint32_t rng_next(void) {
+    uint32_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return rng_state = x;
+}
+
+
+static void set_clock(time_ms now) {
+    virtual_clock_us = (int64_t)now * 1000;
+}
+
+
+// Play the floor for a while so the capture holds tables in every part of their cycle
+static time_ms build_floor(void) {
+    static const scheduler_config config = {0};
+    trace_system_init(&config, MAX_TABLES);
+
+    time_ms now = 0;
+    for (; now < BENCH_WARMUP_MS; now += BENCH_STEP_MS) {
+        set_clock(now);
+
+        uint8_t table = (uint8_t)(rng_next() % MAX_TABLES);
+        system_apply_table_fsm_event(table, POS_EVENTS[rng_next() % 3], now);
+
+        const task *shown = system_get_active_task();
+        if (shown && rng_next() % 2 == 0) system_apply_user_action_to_task(shown->id, USER_ACTION_COMPLETE, now);
+
+        trace_system_tick(now);
+    }
+
+    set_clock(now);
+    system_capture_image(&floor_image, 1, now);
+    return now;
+}
+
+
+// The POS message that moves a table on from `state`, as the floor image holds it
+static fsm_transition_event pos_event_for(table_state state) {
+    switch (state) {
+        case TABLE_IDLE:            return EVENT_CUSTOMERS_SEATED;
+        case TABLE_PLACED_ORDER:    return EVENT_POS_ORDER_READY;
+        default:                    return EVENT_TABLE_REQUESTED_BILL;
+    }
+}
+
+
+static void make_burst(system_table_event *burst, uint16_t size) {
+    for (uint16_t i = 0; i < size; ++i) {
+        uint8_t table = (uint8_t)(rng_next() % MAX_TABLES);
+        fsm_transition_event event = (rng_next() % 2) ? pos_event_for((table_state)floor_image.tables[table].state)
+                                                      : POS_EVENTS[rng_next() % 3];
+
+        if (i > 0 && rng_next() % BENCH_REPEAT_ODDS == 0) {
+            burst[i] = burst[rng_next() % i];
+        } else {
+            burst[i] = (system_table_event){ .table_index = table, .event = (uint8_t)event };
+        }
+    }
+}
+
+
+static void restore_floor(time_ms now) {
+    static const scheduler_config config = {0};
+
+    if (!system_restore_image(&floor_image, sizeof(floor_image), &config, MAX_TABLES, now)) {
+        fprintf(stderr, "floor image did not restore\n");
+        exit(2);
+    }
+}
+
+
+typedef struct {
+    uint8_t state[MAX_TABLES];
+    uint8_t task[MAX_TABLES];       // task_kind of the table's current task, TASK_NOT_APPLICABLE if none
+} floor_result;
+
+static void read_result(floor_result *out) {
+    for (uint8_t t = 0; t < MAX_TABLES; ++t) {
+        const task *current = system_get_current_task_pointer_for_table(t);
+        out->state[t] = (uint8_t)system_get_table_state(t);
+        out->task[t] = current ? (uint8_t)current->kind : (uint8_t)TASK_NOT_APPLICABLE;
+    }
+}
+
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+
+static double median_ns(uint32_t *samples, unsigned long count) {
+    qsort(samples, count, sizeof(samples[0]), compare_u32);
+    return (count % 2) ? samples[count / 2] : 0.5 * ((double)samples[count / 2 - 1] + samples[count / 2]);
+}
+
+
+static int bench_burst(uint16_t size, unsigned long rounds, time_ms now) {
+    system_table_event burst[32];
+    uint32_t *single_ns = malloc(rounds * sizeof(uint32_t));
+    uint32_t *batch_ns = malloc(rounds * sizeof(uint32_t));
+    uint64_t transitions = 0;
+    unsigned long mismatches = 0;
+    unsigned long violations = 0;
+
+    if (!single_ns || !batch_ns) {
+        fprintf(stderr, "out of memory\n");
+        exit(2);
+    }
+
+    for (unsigned long round = 0; round < rounds; ++round) {
+        make_burst(burst, size);
+        floor_result single, batched;
+
+        // Restoring starts the invariant counters over, so they are read after each way
+        restore_floor(now);
+        uint64_t start = now_ns();
+        for (uint16_t i = 0; i < size; ++i) {
+            system_apply_table_fsm_event(burst[i].table_index, (fsm_transition_event)burst[i].event, now);
+        }
+        single_ns[round] = (uint32_t)(now_ns() - start);
+        violations += system_get_check_stats()->violations;
+        read_result(&single);
+
+        restore_floor(now);
+        start = now_ns();
+        transitions += system_apply_events(burst, size, now);
+        batch_ns[round] = (uint32_t)(now_ns() - start);
+        violations += system_get_check_stats()->violations;
+        read_result(&batched);
+
+        if (memcmp(&single, &batched, sizeof(single)) != 0) mismatches++;
+    }
+
+    double single_median = median_ns(single_ns, rounds);
+    double batch_median = median_ns(batch_ns, rounds);
+    printf("%6u %12.1f %12.1f %8.2fx %12.2f %10lu %11lu\n", size, single_median, batch_median,
+           batch_median > 0 ? single_median / batch_median : 0.0,
+           (double)transitions / rounds, mismatches, violations);
+
+    free(single_ns);
+    free(batch_ns);
+    return (mismatches || violations) ? 1 : 0;
+}
+
+
+int main(int argc, char **argv) {
+    unsigned long rounds = 20000;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            rounds = strtoul(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "usage: %s [-r rounds]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (rounds == 0) {
+        fprintf(stderr, "rounds must be > 0\n");
+        return 2;
+    }
+
+    time_ms now = build_floor();
+
+    uint8_t busy = 0;
+    for (uint8_t t = 0; t < MAX_TABLES; ++t) busy += system_get_table_state(t) != TABLE_IDLE;
+    printf("floor: %u of %u tables busy\n\n", busy, MAX_TABLES);
+
+    printf("%6s %12s %12s %9s %12s %10s %11s\n",
+           "burst", "single ns", "batch ns", "speedup", "transitions", "mismatches", "violations");
+
+    int status = 0;
+    for (size_t i = 0; i < sizeof(BURST_SIZES) / sizeof(BURST_SIZES[0]); ++i) {
+        status |= bench_burst(BURST_SIZES[i], rounds, now);
+    }
+    return status;
+}
@@ -0,0 +1,247 @@
+/*
+ * Parallel shift simulation benchmark.
+ *
+ * Runs many independent restaurant shifts, each on its own trace_system_ctx,
+ * first one after another on one thread and then spread over worker
+ * threads. Every shift is seeded by its number, so both runs must produce
+ * the same events: each shift folds every event its context reports, and
+ * its final table states, into a digest, and any shift whose digest
+ * differs between the two runs fails the run, as does any invariant
+ * violation. Contexts that shared state would make the threaded digests
+ * depend on the interleaving.
+ *
+ * Only the context API is used. The build leaves out event_journal.c and
+ * trace_system_default.c, so the link also shows that trace_system.c needs
+ * neither the journal nor the default instance.
+ *
+ * Build from the repository root:
+ *
+ *   gcc -O2 -std=gnu11 -pthread -DTRACE_VIRTUAL_CLOCK -Itools/replay/stubs -Imain/include \
+ *       tools/bench/parallel_sim_bench.c main/src/task_domain.c main/src/task_pool.c \
+ *       main/src/trace_scheduler.c main/src/table_fsm.c main/src/table_fsm_table.c \
+ *       main/src/trace_system.c main/src/floor_layout.c main/src/decision_trace.c \
+ *       main/src/timer_wheel.c -lm -o parallel_sim_bench
+ *
+ * Usage:
+ *
+ *   ./parallel_sim_bench [-s shifts] [-t threads] [-p passes]
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "trace_system.h"
+#include "floor_layout.h"
+
+
+#define BENCH_TICK_MS       500
+#define BENCH_SEAT_ODDS     30          // an idle table is seated one pass in this many
+#define BENCH_COMPLETE_ODDS 6           // the operator completes the shown task one pass in this many
+#define BENCH_IGNORE_ODDS   25          // or ignores it, one pass in this many
+#define BENCH_POS_ODDS      40          // a POS event reaches a busy table one pass in this many
+#define BENCH_MAX_THREADS   64
+
+/* Never advanced: each shift keeps its own time and hands it to the
+   context. Budget checks read this, so they never cut work short and
+   shifts stay repeatable. */
+int64_t virtual_clock_us;
+
+
+// Only warm restart images are checksummed, and the bench takes none
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len) {
+    return crc;
+}
+
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+
+// xorshift32, one state per shift so shifts are repeatable on any thread
+static uint32_t rng_next(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+
+typedef struct {
+    uint64_t digest;                // FNV-1a over the events and the final table states
+    uint32_t events;
+    uint32_t violations;
+} shift_result;
+
+
+static void fold(uint64_t *digest, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        *digest ^= (value >> (8 * i)) & 0xFFu;
+        *digest *= 0x100000001b3ull;
+    }
+}
+
+
+static void count_event(void *user, journal_event_type type, uint8_t table, uint8_t arg, time_ms now) {
+    shift_result *result = user;
+    fold(&result->digest, ((uint32_t)type << 16) | ((uint32_t)table << 8) | arg);
+    fold(&result->digest, now);
+    result->events++;
+}
+
+
+static void run_shift(trace_system_ctx *ctx, uint32_t shift, unsigned long passes, shift_result *result) {
+    static const scheduler_config config = {0};
+    uint32_t rng = 0x9e3779b9u ^ (shift * 0x85ebca6bu);
+    if (rng == 0) rng = 1;
+
+    *result = (shift_result){ .digest = 0xcbf29ce484222325ull };
+    trace_system_ctx_init(ctx, &config, MAX_TABLES, 0);
+    system_ctx_set_event_hook(ctx, count_event, result);
+
+    time_ms now = 0;
+    for (unsigned long pass = 0; pass < passes; ++pass) {
+        now += BENCH_TICK_MS;
+
+        uint8_t table = (uint8_t)(rng_next(&rng) % MAX_TABLES);
+        table_state state = system_ctx_get_table_state(ctx, table);
+        if (state == TABLE_IDLE && rng_next(&rng) % BENCH_SEAT_ODDS == 0) {
+            system_ctx_apply_table_fsm_event(ctx, table, EVENT_CUSTOMERS_SEATED, now);
+        } else if (rng_next(&rng) % BENCH_POS_ODDS == 0) {
+            if (state == TABLE_PLACED_ORDER) {
+                system_ctx_apply_table_fsm_event(ctx, table, EVENT_POS_ORDER_READY, now);
+            } else if (state == TABLE_DINING || state == TABLE_CHECKUP) {
+                system_ctx_apply_table_fsm_event(ctx, table, EVENT_TABLE_REQUESTED_BILL, now);
+            }
+        }
+
+        const task *shown = system_ctx_get_active_task(ctx);
+        if (shown) {
+            uint32_t roll = rng_next(&rng);
+            if (roll % BENCH_COMPLETE_ODDS == 0) {
+                system_ctx_apply_user_action_to_task(ctx, shown->id, USER_ACTION_COMPLETE, now);
+            } else if (roll % BENCH_IGNORE_ODDS == 1 && shown->ignore_count < 2) {
+                // Kept short of the ignore that kills a task, which leaves its table with none
+                system_ctx_apply_user_action_to_task(ctx, shown->id, USER_ACTION_IGNORE, now);
+            }
+        }
+
+        if (system_ctx_next_deadline(ctx, now) <= now) trace_system_ctx_tick(ctx, now);
+    }
+
+    for (uint8_t t = 0; t < MAX_TABLES; ++t) fold(&result->digest, (uint32_t)system_ctx_get_table_state(ctx, t));
+    result->violations = system_ctx_get_check_stats(ctx)->violations;
+}
+
+
+typedef struct {
+    atomic_uint   next_shift;
+    uint32_t      shift_count;
+    unsigned long passes;
+    shift_result *results;
+} shift_queue;
+
+
+static void *worker(void *arg) {
+    shift_queue *queue = arg;
+
+    // Far too large for a thread's stack, and must not move once initialised
+    trace_system_ctx *ctx = malloc(sizeof(*ctx));
+    if (!ctx) {
+        fprintf(stderr, "out of memory\n");
+        exit(2);
+    }
+
+    for (;;) {
+        uint32_t shift = atomic_fetch_add(&queue->next_shift, 1);
+        if (shift >= queue->shift_count) break;
+        run_shift(ctx, shift, queue->passes, &queue->results[shift]);
+    }
+
+    free(ctx);
+    return NULL;
+}
+
+
+// Run every shift on `threads` workers. Returns the wall time in ns.
+static uint64_t run_all(shift_queue *queue, unsigned threads) {
+    pthread_t ids[BENCH_MAX_THREADS];
+    atomic_store(&queue->next_shift, 0);
+
+    uint64_t start = now_ns();
+    for (unsigned i = 0; i < threads; ++i) {
+        if (pthread_create(&ids[i], NULL, worker, queue) != 0) {
+            fprintf(stderr, "pthread_create failed\n");
+            exit(2);
+        }
+    }
+    for (unsigned i = 0; i < threads; ++i) pthread_join(ids[i], NULL);
+    return now_ns() - start;
+}
+
+
+int main(int argc, char **argv) {
+    unsigned long shifts = 64;
+    unsigned long threads = 4;
+    unsigned long passes = 20000;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            shifts = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            threads = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            passes = strtoul(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "usage: %s [-s shifts] [-t threads] [-p passes]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (shifts == 0 || shifts > UINT32_MAX || passes == 0 || threads == 0 || threads > BENCH_MAX_THREADS) {
+        fprintf(stderr, "shifts and passes must be > 0, threads in 1..%d\n", BENCH_MAX_THREADS);
+        return 2;
+    }
+
+    // Shared and read-only from here on, see trace_system_ctx_init()
+    floor_layout_load_default();
+
+    shift_result *serial = calloc(shifts, sizeof(*serial));
+    shift_result *threaded = calloc(shifts, sizeof(*threaded));
+    if (!serial || !threaded) {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+
+    shift_queue queue = { .shift_count = (uint32_t)shifts, .passes = passes, .results = serial };
+    uint64_t serial_ns = run_all(&queue, 1);
+    queue.results = threaded;
+    uint64_t threaded_ns = run_all(&queue, (unsigned)threads);
+
+    unsigned long mismatches = 0;
+    unsigned long violations = 0;
+    uint64_t events = 0;
+    for (unsigned long i = 0; i < shifts; ++i) {
+        if (serial[i].digest != threaded[i].digest || serial[i].events != threaded[i].events) mismatches++;
+        violations += serial[i].violations + threaded[i].violations;
+        events += serial[i].events;
+    }
+
+    double shift_hours = (double)passes * BENCH_TICK_MS / 3.6e6;
+    printf("%lu shifts of %.1f h, %lu tables, %.0f events per shift\n\n",
+           shifts, shift_hours, (unsigned long)MAX_TABLES, (double)events / shifts);
+    printf("%8s %12s %14s %9s %10s %11s\n", "threads", "wall ms", "shifts/s", "speedup", "mismatches", "violations");
+    printf("%8u %12.1f %14.1f %9s %10s %11s\n", 1u, serial_ns / 1e6, shifts / (serial_ns / 1e9), "", "", "");
+    printf("%8lu %12.1f %14.1f %8.2fx %10lu %11lu\n", threads, threaded_ns / 1e6, shifts / (threaded_ns / 1e9),
+           (double)serial_ns / threaded_ns, mismatches, violations);
+
+    free(serial);
+    free(threaded);
+    return (mismatches || violations) ? 1 : 0;
+}
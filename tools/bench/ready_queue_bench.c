@@ -0,0 +1,371 @@
+/*
+ * Ready queue vs linear scan benchmark.
+ *
+ * scheduler_tick() ranks only the pool's ready queue, after
+ * task_pool_wake_expired() has moved expired suppressions back onto it,
+ * and does so incrementally: its ranking tree re-ranks only the slots
+ * filed since the last tick and the nodes whose next crossing time has
+ * come, and is rebuilt when the active task changes. Before the queue it
+ * walked every slot, calling refresh_task() on each occupied one and
+ * scoring the eligible ones. That scan is kept below as the baseline.
+ *
+ * Pools of 32, 1k and 64k slots are filled to the given load with a mix of
+ * eligible, suppressed and dead tasks and then played forward one tick at
+ * a time: the clock moves on by 0.5 to 5 s, some tasks (1 + capacity / 64,
+ * or -c per tick) are ignored, completed or replaced by new ones, and now
+ * and then the active task is
+ * completed so the next tick has to pick another, or replaced by a random
+ * task as if picked on the UI; once its dwell time runs out, challengers
+ * raise switch prompts. Each tick runs the
+ * queue path (wake plus scheduler_tick) and then the linear scan from the
+ * scheduler state the tick started with. The scan runs on the pool the
+ * wake left, so its refresh_task() calls find nothing left to wake.
+ *
+ * The active task, pending count, critical count and top critical task
+ * must come out the same both ways, or the run fails. The median tick
+ * is reported.
+ *
+ * Build from the repository root:
+ *
+ *   gcc -O2 -std=gnu11 -DTRACE_VIRTUAL_CLOCK -Itools/replay/stubs -Imain/include \
+ *       tools/bench/ready_queue_bench.c main/src/task_domain.c main/src/task_pool.c \
+ *       main/src/trace_scheduler.c main/src/floor_layout.c main/src/decision_trace.c \
+ *       -lm -o ready_queue_bench
+ *
+ * Usage:
+ *
+ *   ./ready_queue_bench [-r ticks] [-l load_percent] [-c changes_per_tick]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "task_pool.h"
+#include "trace_scheduler.h"
+#include "floor_layout.h"
+
+
+#define BENCH_TABLES        24
+#define BENCH_START_MS      3600000u        // an hour into the shift, so tasks can be old
+#define BENCH_MAX_AGE_MS    1800000u
+
+static const uint16_t CAPACITIES[] = { 32, 1024, TASK_POOL_MAX_CAPACITY };
+
+
+// floor_layout.c checksums NVS blobs; only the built-in layout is used here
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len) {
+    return crc;
+}
+
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+
+// xorshift32, so runs are repeatable across libcs
+static uint32_t rng_state = 0x9e3779b9u;
+
+static uint32_t rng_next(void) {
+    uint32_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return rng_state = x;
+}
+
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+
+static double median_ns(uint32_t *samples, unsigned long count) {
+    qsort(samples, count, sizeof(samples[0]), compare_u32);
+    return (count % 2) ? samples[count / 2] : 0.5 * ((double)samples[count / 2 - 1] + samples[count / 2]);
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Pool setup and churn                                                */
+/* ------------------------------------------------------------------ */
+
+static bool same_id(task_id a, task_id b) {
+    return a.index == b.index && a.generation == b.generation;
+}
+
+
+// A task created up to BENCH_MAX_AGE_MS ago, some of it ignored and snoozed
+static void spawn_task(task_pool *pool, time_ms now) {
+    task_id id = task_pool_allocate(pool);
+    task *t = task_pool_get(pool, id);
+    if (!t) return;
+
+    time_ms age = rng_next() % BENCH_MAX_AGE_MS;
+    task_init(t, id, (task_kind)(rng_next() % TASK_NOT_APPLICABLE), now - age, (uint8_t)(rng_next() % BENCH_TABLES));
+    t->ignore_count = (uint8_t)(rng_next() % 3);
+
+    switch (rng_next() % 8) {
+        case 0:
+        case 1:
+            t->status = TASK_SUPPRESSED;
+            t->suppress_until = now + rng_next() % 60000;
+            break;
+        case 2:
+            t->status = (rng_next() & 1) ? TASK_COMPLETED : TASK_KILLED;
+            break;
+        default:
+            break;
+    }
+    task_pool_sync(pool, id);
+}
+
+
+/* Ignore, complete or replace a few random tasks, sometimes finish the
+   active one, and sometimes pick one by hand as the UI does, which is
+   what lets challengers overtake it. */
+static void churn(task_pool *pool, scheduler *s, time_ms now, unsigned changes) {
+    if (changes == 0) changes = 1 + pool->capacity / 64;
+
+    for (unsigned i = 0; i < changes; ++i) {
+        task_slot *slot = &pool->slots[rng_next() % pool->capacity];
+        if (!slot->occupied) continue;
+
+        task *t = &slot->task_instance;
+        task_id id = t->id;
+        if (s->has_active_task && same_id(id, s->active_task_id)) continue;    // left to the breakpoint below
+        if (t->status == TASK_COMPLETED || t->status == TASK_KILLED) {
+            task_pool_free(pool, id);
+            spawn_task(pool, now);
+            continue;
+        }
+        if (t->status != TASK_ELIGIBLE) continue;
+
+        if (rng_next() % 3 == 0) task_mark_completed(t);
+        else                     task_apply_ignore(t, now);
+        task_pool_sync(pool, id);
+    }
+
+    if (s->has_active_task && rng_next() % 8 == 0) {
+        task *active = task_pool_get(pool, s->active_task_id);
+        if (active && active->status == TASK_ELIGIBLE) {
+            task_mark_completed(active);
+            task_pool_sync(pool, s->active_task_id);
+        }
+    } else if (pool->ready_count > 0 && rng_next() % 8 == 0) {
+        const task *pick = &pool->slots[pool->ready[rng_next() % pool->ready_count]].task_instance;
+        scheduler_force_active(s, pick->id, now);
+    }
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Linear scan baseline                                                */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    bool has_active;
+    task_id active;
+    uint16_t pending_count;
+    uint16_t critical_count;
+    task_id top_critical;
+} tick_outcome;
+
+
+/* The scan scheduler_tick() did before the ready queue: every slot,
+   refresh_task() on the occupied ones, first-wins ranking in slot order.
+   `s` is the scheduler as the tick found it; returns what the tick
+   should have left. */
+static tick_outcome linear_scan_tick(const scheduler *s, task_pool *pool, time_ms now) {
+    tick_outcome out = { .active = INVALID_TASK_ID, .top_critical = INVALID_TASK_ID };
+
+    task *active = s->has_active_task ? task_pool_get(pool, s->active_task_id) : NULL;
+    if (active) refresh_task(active, now);
+    bool active_usable = active && active->status == TASK_ELIGIBLE;
+    sched_key active_raw = active_usable ? scheduler_task_key(s, active, now) : KEY_MIN;
+    bool dwell_satisfied = (now - s->task_active_since) >= s->cfg.min_dwell_time_ms;
+
+    task_id best = INVALID_TASK_ID;
+    sched_key best_key = KEY_MIN;
+    sched_key top_key = KEY_MIN;
+    uint16_t eligible = 0;
+
+    for (uint16_t i = 0; i < pool->capacity; ++i) {
+        task_slot *slot = &pool->slots[i];
+        if (!slot->occupied) continue;
+
+        task *t = &slot->task_instance;
+        refresh_task(t, now);
+        if (t->status != TASK_ELIGIBLE) continue;
+        eligible++;
+
+        bool is_active = active && same_id(t->id, s->active_task_id);
+        sched_key raw = scheduler_task_key(s, t, now);
+        sched_key ranking = raw;
+        if (!is_active && active) {
+            ranking += scheduler_transition_key(s, active->table_number, active->kind, t->table_number, t->kind);
+        }
+
+        if (ranking > best_key) {
+            best_key = ranking;
+            best = t->id;
+        }
+        if (!is_active && dwell_satisfied && raw > active_raw + s->model.preempt_delta) {
+            out.critical_count++;
+            if (ranking > top_key) {
+                top_key = ranking;
+                out.top_critical = t->id;
+            }
+        }
+    }
+
+    if (active_usable) {
+        out.has_active = true;
+        out.active = s->active_task_id;
+        out.pending_count = eligible - 1;
+    } else if (best.index != UINT16_MAX) {
+        // A new task is picked at the breakpoint and the prompt is cleared
+        out.has_active = true;
+        out.active = best;
+        out.pending_count = eligible - 1;
+        out.critical_count = 0;
+        out.top_critical = INVALID_TASK_ID;
+    } else {
+        out.critical_count = 0;
+        out.top_critical = INVALID_TASK_ID;
+    }
+    return out;
+}
+
+
+static bool outcome_matches(const tick_outcome *expected, const scheduler *s) {
+    if (expected->has_active != s->has_active_task) return false;
+    if (expected->has_active && !same_id(expected->active, s->active_task_id)) return false;
+    return expected->pending_count == s->pending_count &&
+           expected->critical_count == s->critical_count &&
+           same_id(expected->top_critical, s->top_critical_id);
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Benchmark                                                           */
+/* ------------------------------------------------------------------ */
+
+static int bench_capacity(uint16_t capacity, unsigned long ticks, unsigned load_percent, unsigned changes) {
+    size_t arena_size = TASK_POOL_ARENA_SIZE(capacity, BENCH_TABLES);
+    void *arena = malloc(arena_size);
+    uint32_t *queue_ns = malloc(ticks * sizeof(uint32_t));
+    uint32_t *scan_ns = malloc(ticks * sizeof(uint32_t));
+    if (!arena || !queue_ns || !scan_ns) {
+        fprintf(stderr, "out of memory at capacity %u\n", capacity);
+        free(arena);
+        free(queue_ns);
+        free(scan_ns);
+        return 1;
+    }
+
+    task_pool pool;
+    task_pool_init(&pool, arena, arena_size, BENCH_TABLES);
+
+    scheduler sched;
+    scheduler_init(&sched, NULL);
+    sched.record_decisions = false;
+
+    time_ms now = BENCH_START_MS;
+    uint32_t live_count = (uint32_t)capacity * load_percent / 100;
+    if (live_count == 0) live_count = 1;
+    for (uint32_t i = 0; i < live_count; ++i) spawn_task(&pool, now);
+
+    unsigned long mismatches = 0, switches = 0, prompts = 0;
+    uint64_t ready_total = 0;
+
+    for (unsigned long tick = 0; tick < ticks; ++tick) {
+        now += 500 + rng_next() % 4500;
+        churn(&pool, &sched, now, changes);
+
+        scheduler before = sched;
+
+        uint64_t start = now_ns();
+        task_pool_wake_expired(&pool, now);
+        scheduler_tick(&sched, &pool, now);
+        queue_ns[tick] = (uint32_t)(now_ns() - start);
+
+        start = now_ns();
+        tick_outcome expected = linear_scan_tick(&before, &pool, now);
+        scan_ns[tick] = (uint32_t)(now_ns() - start);
+
+        if (!outcome_matches(&expected, &sched)) {
+            if (mismatches++ == 0) {
+                fprintf(stderr, "capacity %u tick %lu: queue active=(%u,%u) pending=%u critical=%u top=(%u,%u), "
+                        "scan active=(%u,%u) pending=%u critical=%u top=(%u,%u)\n", capacity, tick,
+                        sched.active_task_id.index, sched.active_task_id.generation,
+                        sched.pending_count, sched.critical_count,
+                        sched.top_critical_id.index, sched.top_critical_id.generation,
+                        expected.active.index, expected.active.generation,
+                        expected.pending_count, expected.critical_count,
+                        expected.top_critical.index, expected.top_critical.generation);
+            }
+        }
+
+        if (!same_id(before.active_task_id, sched.active_task_id)) switches++;
+        if (sched.critical_count > 0) prompts++;
+        ready_total += pool.ready_count;
+    }
+
+    double queue_median = median_ns(queue_ns, ticks);
+    double scan_median = median_ns(scan_ns, ticks);
+    printf("%8u %8.0f %12.1f %12.1f %8.2fx %8lu %8lu %10lu\n", capacity, (double)ready_total / ticks,
+           scan_median, queue_median, queue_median > 0 ? scan_median / queue_median : 0.0,
+           switches, prompts, mismatches);
+
+    int status = mismatches ? 1 : 0;
+    if (task_pool_check_indexes(&pool) != 0) {
+        fprintf(stderr, "pool indexes inconsistent at capacity %u\n", capacity);
+        status = 1;
+    }
+
+    free(arena);
+    free(queue_ns);
+    free(scan_ns);
+    return status;
+}
+
+
+int main(int argc, char **argv) {
+    unsigned long ticks = 2000;
+    unsigned load_percent = 90;
+    unsigned changes = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            ticks = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            load_percent = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            changes = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "usage: %s [-r ticks] [-l load_percent] [-c changes_per_tick]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (ticks == 0 || load_percent == 0 || load_percent > 100) {
+        fprintf(stderr, "ticks must be > 0 and load_percent in 1..100\n");
+        return 2;
+    }
+
+    floor_layout_load_default();
+
+    printf("%8s %8s %12s %12s %9s %8s %8s %10s\n",
+           "capacity", "ready", "scan ns", "queue ns", "speedup", "switches", "prompts", "mismatches");
+
+    int status = 0;
+    for (size_t i = 0; i < sizeof(CAPACITIES) / sizeof(CAPACITIES[0]); ++i) {
+        status |= bench_capacity(CAPACITIES[i], ticks, load_percent, changes);
+    }
+    return status;
+}
@@ -0,0 +1,380 @@
+/*
+ * Float vs Q16.16 task scoring benchmark and differential test.
+ *
+ * sched_score.h picks the reported score type at build time, float by
+ * default and Q16.16 with SCHEDULER_FIXED_POINT, so this file is built
+ * once each way against the real trace_scheduler.c. The scheduler ranks
+ * on the exact sched_key in both.
+ *
+ * Timing: scheduler_task_score() over an array of random tasks, and a
+ * scheduler_tick() that re-ranks a whole pool of ready tasks. Both are
+ * reported per task, median of the runs.
+ *
+ * Differential test: each set fills a pool with random tasks (ages,
+ * lateness and ignore counts spread across both sides of the age and
+ * urgency caps), a quarter of them copying the age, kind and ignore count
+ * of an earlier task so that exact ties are common. scheduler_tick() then
+ * picks a task, which is replaced by a random one as if picked on the UI,
+ * runs on past the dwell time, loses its active task and picks again at
+ * the breakpoint, then runs on once more. Each of the four
+ * ticks records the active task, pending count, critical count and top
+ * critical task, plus the reported score of the active task. The float
+ * build writes the records with -w; the fixed build replays the same sets
+ * from the same seed and compares with -c. Any difference in a decision
+ * fails the run, as does a reported score further than SCORE_ERROR_BOUND
+ * from the other build's.
+ *
+ * Build and run from the repository root:
+ *
+ *   SRC="tools/bench/sched_score_bench.c main/src/task_domain.c main/src/task_pool.c \
+ *        main/src/trace_scheduler.c main/src/floor_layout.c main/src/decision_trace.c"
+ *   gcc -O2 -std=gnu11 -DTRACE_VIRTUAL_CLOCK -Itools/replay/stubs -Imain/include $SRC -lm \
+ *       -o sched_score_float
+ *   gcc -O2 -std=gnu11 -DTRACE_VIRTUAL_CLOCK -DSCHEDULER_FIXED_POINT -Itools/replay/stubs -Imain/include $SRC -lm \
+ *       -o sched_score_fixed
+ *   ./sched_score_float -w float.decisions
+ *   ./sched_score_fixed -c float.decisions
+ *
+ * Usage:
+ *
+ *   ./sched_score_float [-r runs] [-s sets] [-w decisions_out | -c decisions_in]
+ *   ./sched_score_fixed [-r runs] [-s sets] [-w decisions_out | -c decisions_in]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "task_pool.h"
+#include "trace_scheduler.h"
+#include "floor_layout.h"
+
+
+#ifdef SCHEDULER_FIXED_POINT
+#define SCORE_MODE          "q16.16"
+#else
+#define SCORE_MODE          "float"
+#endif
+
+/* Both builds report the same key: Q16.16 truncates it to 2^-16, float
+   rounds it to 2^-24 of scores below 64. The bound leaves room, and is
+   still sixteen times finer than the Q8.8 the decision trace records. */
+#define SCORE_ERROR_BOUND   (1.0 / 4096.0)
+
+#define BENCH_TABLES        24
+#define SET_TASKS           32
+#define SCORE_TASKS         4096
+#define TICK_TASKS          1024
+#define MAX_AGE_MS          (40u * 60000u)      // well past the age and urgency caps
+#define SET_TICKS           4
+#define DECISIONS_MAGIC     0x44454353u         // "DECS"
+
+
+// floor_layout.c checksums NVS blobs; only the built-in layout is used here
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len) {
+    return crc;
+}
+
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+
+// xorshift32, so both builds generate the same tasks
+static uint32_t rng_state;
+
+static uint32_t rng_next(void) {
+    uint32_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return rng_state = x;
+}
+
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+
+static double median(double *samples, unsigned long count) {
+    qsort(samples, count, sizeof(samples[0]), compare_double);
+    return (count % 2) ? samples[count / 2] : 0.5 * (samples[count / 2 - 1] + samples[count / 2]);
+}
+
+
+// A task created up to MAX_AGE_MS before `now`, as the pool would set it up
+static void random_task(task *t, task_id id, time_ms now) {
+    time_ms age = rng_next() % MAX_AGE_MS;
+
+    task_init(t, id, (task_kind)(rng_next() % TASK_NOT_APPLICABLE), now - age, (uint8_t)(rng_next() % BENCH_TABLES));
+    t->ignore_count = (uint8_t)(rng_next() % 4);
+}
+
+
+static volatile double sink;
+
+
+static bool same_task(task_id a, task_id b) {
+    return a.index == b.index && a.generation == b.generation;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Timing                                                              */
+/* ------------------------------------------------------------------ */
+
+static double time_task_score(const scheduler *s, unsigned long runs) {
+    static task tasks[SCORE_TASKS];
+    time_ms now = MAX_AGE_MS + 3600000u;
+    for (uint16_t i = 0; i < SCORE_TASKS; ++i) random_task(&tasks[i], (task_id){ .index = i }, now);
+
+    double *per_task = malloc(runs * sizeof(double));
+    for (unsigned long run = 0; run < runs; ++run) {
+        sched_score sum = 0;
+        uint64_t start = now_ns();
+        for (uint16_t i = 0; i < SCORE_TASKS; ++i) sum += scheduler_task_score(s, &tasks[i], now + run);
+        per_task[run] = (double)(now_ns() - start) / SCORE_TASKS;
+        sink += score_to_double(sum);
+    }
+
+    double result = median(per_task, runs);
+    free(per_task);
+    return result;
+}
+
+
+static double time_tick(const scheduler *base, unsigned long runs) {
+    size_t arena_size = TASK_POOL_ARENA_SIZE(TICK_TASKS, BENCH_TABLES);
+    void *arena = malloc(arena_size);
+    double *per_task = malloc(runs * sizeof(double));
+
+    task_pool pool;
+    task_pool_init(&pool, arena, arena_size, BENCH_TABLES);
+
+    time_ms now = MAX_AGE_MS + 3600000u;
+    for (uint16_t i = 0; i < TICK_TASKS; ++i) {
+        task_id id = task_pool_allocate(&pool);
+        random_task(task_pool_get(&pool, id), id, now);
+        task_pool_sync(&pool, id);
+    }
+
+    // Alternate between two active tasks, so every tick rebuilds the ranking tree
+    scheduler s = *base;
+    scheduler_tick(&s, &pool, now);
+    task_id picks[2] = { s.active_task_id, pool.slots[pool.ready[0]].task_instance.id };
+    if (same_task(picks[0], picks[1])) picks[1] = pool.slots[pool.ready[1]].task_instance.id;
+
+    for (unsigned long run = 0; run < runs; ++run) {
+        scheduler_force_active(&s, picks[run % 2], now + run);
+        uint64_t start = now_ns();
+        scheduler_tick(&s, &pool, now + run);
+        per_task[run] = (double)(now_ns() - start) / pool.ready_count;
+        sink += s.critical_count;
+    }
+
+    double result = median(per_task, runs);
+    free(arena);
+    free(per_task);
+    return result;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Differential test                                                   */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    uint16_t active;                // slot index, UINT16_MAX for none
+    uint16_t top_critical;
+    uint16_t critical_count;
+    uint16_t pending_count;
+    double active_score;
+} tick_record;
+
+
+static void record_tick(tick_record *r, const scheduler *s, const task_pool *pool, time_ms now) {
+    const task *active = s->has_active_task ? task_pool_get_const(pool, s->active_task_id) : NULL;
+
+    r->active         = s->has_active_task ? s->active_task_id.index : UINT16_MAX;
+    r->top_critical   = s->top_critical_id.index;
+    r->critical_count = s->critical_count;
+    r->pending_count  = s->pending_count;
+    r->active_score   = active ? score_to_double(scheduler_task_score(s, active, now)) : 0.0;
+}
+
+
+// SET_TICKS decisions for every set, in set order
+static tick_record *decide_sets(const scheduler *base, uint32_t sets) {
+    tick_record *records = calloc((size_t)sets * SET_TICKS, sizeof(tick_record));
+    size_t arena_size = TASK_POOL_ARENA_SIZE(SET_TASKS, BENCH_TABLES);
+    void *arena = malloc(arena_size);
+    task_pool pool;
+
+    rng_state = 0x2545f491u;
+    for (uint32_t set = 0; set < sets; ++set) {
+        tick_record *r = &records[(size_t)set * SET_TICKS];
+        time_ms now = MAX_AGE_MS + rng_next() % (4u * 3600000u);
+
+        task_pool_init(&pool, arena, arena_size, BENCH_TABLES);
+        for (uint16_t i = 0; i < SET_TASKS; ++i) {
+            task_id id = task_pool_allocate(&pool);
+            task *t = task_pool_get(&pool, id);
+            random_task(t, id, now);
+
+            if (i > 0 && rng_next() % 4 == 0) {
+                const task *twin = &pool.slots[rng_next() % i].task_instance;
+                task_init(t, id, twin->kind, twin->created_at, t->table_number);
+                t->ignore_count = twin->ignore_count;
+            }
+            task_pool_sync(&pool, id);
+        }
+
+        scheduler s = *base;
+        scheduler_tick(&s, &pool, now);
+        record_tick(&r[0], &s, &pool, now);
+
+        // Picked on the UI, so that challengers have something to overtake
+        uint16_t picked = (uint16_t)(rng_next() % SET_TASKS);
+        scheduler_force_active(&s, pool.slots[picked].task_instance.id, now);
+
+        now += s.cfg.min_dwell_time_ms + rng_next() % 600000u;
+        scheduler_tick(&s, &pool, now);
+        record_tick(&r[1], &s, &pool, now);
+
+        if (s.has_active_task) task_pool_free(&pool, s.active_task_id);
+        scheduler_tick(&s, &pool, now);
+        record_tick(&r[2], &s, &pool, now);
+
+        now += s.cfg.min_dwell_time_ms + rng_next() % 600000u;
+        scheduler_tick(&s, &pool, now);
+        record_tick(&r[3], &s, &pool, now);
+    }
+
+    free(arena);
+    return records;
+}
+
+
+static int write_records(const char *path, const tick_record *records, uint32_t sets) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+
+    uint32_t header[2] = { DECISIONS_MAGIC, sets };
+    size_t count = (size_t)sets * SET_TICKS;
+    int ok = fwrite(header, sizeof(header), 1, f) == 1 && fwrite(records, sizeof(tick_record), count, f) == count;
+    ok &= fclose(f) == 0;
+    if (!ok) fprintf(stderr, "%s: write failed\n", path);
+    return ok ? 0 : 1;
+}
+
+
+static tick_record *read_records(const char *path, uint32_t sets) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+
+    uint32_t header[2];
+    size_t count = (size_t)sets * SET_TICKS;
+    tick_record *records = malloc(count * sizeof(tick_record));
+    if (fread(header, sizeof(header), 1, f) != 1 || header[0] != DECISIONS_MAGIC || header[1] != sets ||
+        fread(records, sizeof(tick_record), count, f) != count) {
+        fprintf(stderr, "%s: not a decision file for %u sets\n", path, sets);
+        free(records);
+        records = NULL;
+    }
+    fclose(f);
+    return records;
+}
+
+
+static int compare_records(const tick_record *ours, const tick_record *theirs, uint32_t sets) {
+    double max_error = 0.0;
+    unsigned long out_of_bound = 0, differing = 0, critical_ticks = 0;
+
+    for (size_t i = 0; i < (size_t)sets * SET_TICKS; ++i) {
+        const tick_record *a = &ours[i];
+        const tick_record *b = &theirs[i];
+
+        if (a->active != b->active || a->top_critical != b->top_critical ||
+            a->critical_count != b->critical_count || a->pending_count != b->pending_count) {
+            if (differing++ < 10) {
+                fprintf(stderr, "set %zu tick %zu: active %u/%u top %u/%u critical %u/%u pending %u/%u\n",
+                        i / SET_TICKS, i % SET_TICKS, a->active, b->active, a->top_critical, b->top_critical,
+                        a->critical_count, b->critical_count, a->pending_count, b->pending_count);
+            }
+        }
+        if (b->critical_count) critical_ticks++;
+
+        double error = fabs(a->active_score - b->active_score);
+        if (error > max_error) max_error = error;
+        if (error > SCORE_ERROR_BOUND) out_of_bound++;
+    }
+
+    printf("%u sets of %d tasks, %d ticks each (%lu with a switch prompt): %lu differing decisions, "
+           "max score error %.3g (bound %.3g), %lu out of bound\n",
+           sets, SET_TASKS, SET_TICKS, critical_ticks, differing, max_error, SCORE_ERROR_BOUND, out_of_bound);
+    return (differing || out_of_bound) ? 1 : 0;
+}
+
+
+int main(int argc, char **argv) {
+    unsigned long runs = 1000;
+    uint32_t sets = 20000;
+    const char *write_path = NULL;
+    const char *compare_path = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            runs = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            sets = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            write_path = argv[++i];
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            compare_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [-r runs] [-s sets] [-w decisions_out | -c decisions_in]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (runs == 0 || sets == 0 || (write_path && compare_path)) {
+        fprintf(stderr, "runs and sets must be > 0, and -w and -c do not go together\n");
+        return 2;
+    }
+
+    floor_layout_load_default();
+
+    scheduler s;
+    scheduler_init(&s, NULL);
+    s.record_decisions = false;
+
+    rng_state = 0x9e3779b9u;
+    printf("%-8s %14s %14s\n", "scores", "task ns/task", "tick ns/task");
+    printf("%-8s %14.2f %14.2f\n", SCORE_MODE, time_task_score(&s, runs), time_tick(&s, runs));
+
+    if (!write_path && !compare_path) return 0;
+
+    tick_record *ours = decide_sets(&s, sets);
+    int status;
+    if (write_path) {
+        status = write_records(write_path, ours, sets);
+    } else {
+        tick_record *theirs = read_records(compare_path, sets);
+        status = theirs ? compare_records(ours, theirs, sets) : 1;
+        free(theirs);
+    }
+    free(ours);
+    return status;
+}
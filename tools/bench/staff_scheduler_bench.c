@@ -0,0 +1,511 @@
+/*
+ * Multi-waiter assignment benchmark: 50 waiters on a 500-table floor.
+ *
+ * Task table numbers are uint8_t, so one trace system holds at most 255
+ * tables; the floor runs as two sections of 250 tables, each a
+ * trace_system_ctx built with SYSTEM_STAFF_COUNT=25, as a device per
+ * section would. Every scheduler run in a context then re-solves the
+ * staff_scheduler assignment after the single operator's scheduler.
+ *
+ * Guests seat, order, wait on the kitchen, dine and ask for the bill on
+ * their own clocks; the doors open on a queue, every table seated within
+ * the first half-minute. Waiters work the task they are assigned: they walk to
+ * its table at 1 m/s and spend SERVICE_MS there, then complete it, and
+ * every so often go on a break, which takes them off shift. Time advances
+ * in 500 ms steps of virtual time; each step applies the due guest events
+ * as one batch, as the owner task does with queued POS events, then the
+ * completions and shift changes, then trace_system_ctx_tick() when a
+ * deadline is due. Waiters freed one at a time bid alone; the opening
+ * rush and batches of new tasks meeting idle waiters make real auctions.
+ *
+ * Every system call is timed. The floor's cost per step, both sections'
+ * calls together, must stay under the per-tick budget at every step, the
+ * worst included. The shift is deterministic, so it runs several times
+ * and each call keeps its fastest time, which drops host preemption and
+ * page faults but keeps any step that is slow every time. After every call the
+ * assignment is checked: on-shift waiters hold distinct eligible tasks,
+ * off-shift waiters hold none, and no waiter is idle while a free ready
+ * task waits. That, and any invariant violation, fails the run.
+ *
+ * The shift runs twice: with the default bid budget, and with a bid budget
+ * small enough that auctions run out of bids and finish greedily, so both
+ * ways of ending an auction are exercised. STAFF_MAX_CANDIDATES covers the
+ * pool, so every auction is over all the tasks within reach; the "cut"
+ * column counts auctions that still had to leave some out.
+ *
+ * Build from the repository root:
+ *
+ *   gcc -O2 -std=gnu11 -DTRACE_VIRTUAL_CLOCK -DMAX_TABLES=250 -DSYSTEM_TASK_CAPACITY=254 \
+ *       -DTIMER_WHEEL_CAPACITY=1024 -DFLOOR_MAX_TABLES=250 -DSYSTEM_STAFF_COUNT=25 -DMAX_STAFF=25 \
+ *       -DSTAFF_MAX_CANDIDATES=254 -Itools/replay/stubs -Imain/include \
+ *       tools/bench/staff_scheduler_bench.c main/src/task_domain.c main/src/task_pool.c \
+ *       main/src/trace_scheduler.c main/src/staff_scheduler.c main/src/table_fsm.c \
+ *       main/src/table_fsm_table.c main/src/trace_system.c main/src/floor_layout.c \
+ *       main/src/decision_trace.c main/src/timer_wheel.c -lm -o staff_scheduler_bench
+ *
+ * Usage:
+ *
+ *   ./staff_scheduler_bench [-H hours] [-b budget_us] [-m fallback_max_bids] [-R runs]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "trace_system.h"
+#include "floor_layout.h"
+
+
+#define BENCH_SECTIONS      2
+#define BENCH_TICK_MS       500
+#define WALK_MS_PER_DM      100             // 1 m/s
+#define SERVICE_MS          45000           // time at the table per task
+
+#define GRID_COLUMNS        25              // tables per row, 3 m apart
+#define GRID_SPACING_DM     30
+#define ZONE_TABLES         25              // one zone per row
+
+#define BREAK_EVERY_MS      (60 * 60000)
+#define BREAK_MS            (10 * 60000)
+
+// Guest timings, drawn per table: [min, min + spread)
+#define OPENING_MS          0,            30000           // queued at the door
+#define SEAT_GAP_MS         (2 * 60000),  (13 * 60000)
+#define KITCHEN_MS          (6 * 60000),  (12 * 60000)
+#define DINING_MS           (20 * 60000), (30 * 60000)
+
+#if SYSTEM_STAFF_COUNT == 0
+#error "build with -DSYSTEM_STAFF_COUNT=25 -DMAX_STAFF=25, see the build line"
+#endif
+
+
+int64_t virtual_clock_us;
+
+
+// Only warm restart images are checksummed, and the bench takes none
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len) {
+    return crc;
+}
+
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+
+// xorshift32, one state per table so guests do not depend on the waiters
+static uint32_t rng_next(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+
+static time_ms draw(uint32_t *state, time_ms min, time_ms spread) {
+    return min + rng_next(state) % spread;
+}
+
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+
+// A row of tables per zone, straight-line walks; no blob covers 250 tables
+static void load_grid_layout(void) {
+    memset(&floor_plan, 0, sizeof(floor_plan));
+    floor_plan.table_count = MAX_TABLES;
+    floor_plan.zone_count = (MAX_TABLES + ZONE_TABLES - 1) / ZONE_TABLES;
+
+    for (uint16_t a = 0; a < MAX_TABLES; ++a) {
+        floor_plan.zone[a] = (uint8_t)(a / ZONE_TABLES);
+        for (uint16_t b = 0; b < MAX_TABLES; ++b) {
+            double dx = (double)(a % GRID_COLUMNS) - (double)(b % GRID_COLUMNS);
+            double dy = (double)(a / GRID_COLUMNS) - (double)(b / GRID_COLUMNS);
+            floor_plan.distance_dm[a][b] = (uint16_t)(GRID_SPACING_DM * __builtin_sqrt(dx * dx + dy * dy) + 0.5);
+        }
+    }
+    floor_plan.loaded = true;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Floor                                                               */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    uint32_t rng;
+    table_state last_state;
+    time_ms event_at;               // when `event` reaches the table, UINT32_MAX if none is due
+    fsm_transition_event event;
+} guest_table;
+
+
+typedef struct {
+    bool on_shift;
+    task_id task;                   // task being worked, INVALID_TASK_ID when idle
+    uint8_t table;                  // where the waiter is, or is heading
+    time_ms busy_until;
+    time_ms shift_change_at;        // next break, or the end of this one
+} waiter;
+
+
+typedef struct {
+    trace_system_ctx ctx;
+    guest_table guests[MAX_TABLES];
+    waiter waiters[SYSTEM_STAFF_COUNT];
+} section;
+
+
+typedef struct {
+    uint64_t *call_ns;
+    size_t calls, call_capacity;
+    uint64_t *step_ns;
+    size_t steps;
+
+    uint32_t completed;
+    uint32_t auctions;
+    uint64_t bids;
+    uint16_t max_bids;
+    uint32_t fallbacks;             // auctions that ran out of bids and finished greedily
+    uint32_t truncated;             // auctions that left out tasks within reach
+    uint32_t bad_assignments;
+    uint32_t violations;
+} pass_stats;
+
+
+static bool same_task(task_id a, task_id b) {
+    return a.index == b.index && a.generation == b.generation;
+}
+
+
+// Schedule what the guests do next after the table entered `state`
+static void on_table_state(guest_table *g, table_state state, table_state prev, time_ms now) {
+    switch (state) {
+        case TABLE_IDLE:
+            g->event = EVENT_CUSTOMERS_SEATED;
+            g->event_at = now + draw(&g->rng, SEAT_GAP_MS);
+            break;
+        case TABLE_PLACED_ORDER:
+            g->event = EVENT_POS_ORDER_READY;
+            g->event_at = now + draw(&g->rng, KITCHEN_MS);
+            break;
+        case TABLE_DINING:
+            // Back from a check-in the bill stays where it was
+            if (prev != TABLE_CHECKUP) {
+                g->event = EVENT_TABLE_REQUESTED_BILL;
+                g->event_at = now + draw(&g->rng, DINING_MS);
+            }
+            break;
+        case TABLE_CHECKUP:
+            break;
+        default:
+            g->event_at = UINT32_MAX;
+            break;
+    }
+}
+
+
+static bool event_applies(fsm_transition_event event, table_state state) {
+    switch (event) {
+        case EVENT_CUSTOMERS_SEATED:     return state == TABLE_IDLE;
+        case EVENT_POS_ORDER_READY:      return state == TABLE_PLACED_ORDER;
+        case EVENT_TABLE_REQUESTED_BILL: return state == TABLE_DINING || state == TABLE_CHECKUP;
+        default:                         return false;
+    }
+}
+
+
+// The assignment after a system call, see the header comment
+static void check_assignment(section *s, pass_stats *stats) {
+    const staff_scheduler *ss = &s->ctx.staff;
+    bool idle_waiter = false;
+
+    for (uint8_t w = 0; w < SYSTEM_STAFF_COUNT; ++w) {
+        task_id id = system_ctx_get_staff_task(&s->ctx, w);
+
+        if (id.index == INVALID_TASK_ID.index) {
+            if (s->waiters[w].on_shift) idle_waiter = true;
+            continue;
+        }
+
+        const task *t = task_pool_get(&s->ctx.pool, id);
+        if (!s->waiters[w].on_shift || !t || t->status != TASK_ELIGIBLE) stats->bad_assignments++;
+
+        for (uint8_t other = 0; other < w; ++other) {
+            if (same_task(system_ctx_get_staff_task(&s->ctx, other), id)) stats->bad_assignments++;
+        }
+    }
+    if (idle_waiter && ss->pending_count > 0) stats->bad_assignments++;
+}
+
+
+static void record_call(section *s, pass_stats *stats, uint64_t ns, uint64_t *step_ns) {
+    if (stats->calls == stats->call_capacity) {
+        stats->call_capacity = stats->call_capacity ? 2 * stats->call_capacity : 65536;
+        stats->call_ns = realloc(stats->call_ns, stats->call_capacity * sizeof(uint64_t));
+    }
+    stats->call_ns[stats->calls++] = ns;
+    *step_ns += ns;
+
+    const staff_scheduler *ss = &s->ctx.staff;
+    if (ss->last_bid_count > 0) {
+        stats->auctions++;
+        stats->bids += ss->last_bid_count;
+        if (ss->last_bid_count > stats->max_bids) stats->max_bids = ss->last_bid_count;
+        if (ss->last_bid_count >= ss->cfg.max_bids) stats->fallbacks++;
+        if (ss->last_truncated) stats->truncated++;
+    }
+    check_assignment(s, stats);
+}
+
+
+static void init_section(section *s, uint32_t seed, const staff_scheduler_config *staff_config) {
+    trace_system_ctx_init(&s->ctx, NULL, MAX_TABLES, 0);
+    system_ctx_set_staff_config(&s->ctx, staff_config);
+
+    for (uint16_t t = 0; t < MAX_TABLES; ++t) {
+        guest_table *g = &s->guests[t];
+        g->rng = 0x9e3779b9u ^ (seed * 0x85ebca6bu) ^ ((uint32_t)(t + 1) * 0xc2b2ae35u);
+        if (g->rng == 0) g->rng = 1;
+        g->last_state = TABLE_IDLE;
+        g->event = EVENT_CUSTOMERS_SEATED;
+        g->event_at = draw(&g->rng, OPENING_MS);
+    }
+
+    // Breaks staggered over the hour
+    for (uint8_t w = 0; w < SYSTEM_STAFF_COUNT; ++w) {
+        s->waiters[w] = (waiter){
+            .on_shift = true,
+            .task = INVALID_TASK_ID,
+            .table = (uint8_t)((w * MAX_TABLES) / SYSTEM_STAFF_COUNT),
+            .shift_change_at = BREAK_MS + (time_ms)w * (BREAK_EVERY_MS / SYSTEM_STAFF_COUNT),
+        };
+    }
+}
+
+
+static void step_section(section *s, pass_stats *stats, time_ms now, uint64_t *step_ns) {
+    trace_system_ctx *ctx = &s->ctx;
+    system_table_event batch[MAX_TABLES];
+    uint16_t batch_count = 0;
+    uint64_t start;
+
+    for (uint16_t t = 0; t < MAX_TABLES; ++t) {
+        guest_table *g = &s->guests[t];
+        if (g->event_at > now) continue;
+
+        g->event_at = UINT32_MAX;
+        if (event_applies(g->event, system_ctx_get_table_state(ctx, (uint8_t)t))) {
+            batch[batch_count++] = (system_table_event){ .table_index = (uint8_t)t, .event = (uint8_t)g->event };
+        }
+    }
+    if (batch_count) {
+        start = now_ns();
+        system_ctx_apply_events(ctx, batch, batch_count, now);
+        record_call(s, stats, now_ns() - start, step_ns);
+    }
+
+    for (uint8_t w = 0; w < SYSTEM_STAFF_COUNT; ++w) {
+        waiter *wt = &s->waiters[w];
+
+        if (now >= wt->shift_change_at) {
+            wt->on_shift = !wt->on_shift;
+            wt->shift_change_at = now + (wt->on_shift ? BREAK_EVERY_MS - BREAK_MS : BREAK_MS);
+            wt->task = INVALID_TASK_ID;
+
+            start = now_ns();
+            system_ctx_set_staff_on_shift(ctx, w, wt->on_shift, now);
+            record_call(s, stats, now_ns() - start, step_ns);
+            continue;
+        }
+
+        if (wt->on_shift && wt->task.index != INVALID_TASK_ID.index && now >= wt->busy_until &&
+            same_task(system_ctx_get_staff_task(ctx, w), wt->task)) {
+            start = now_ns();
+            bool done = system_ctx_apply_user_action_to_task(ctx, wt->task, USER_ACTION_COMPLETE, now);
+            record_call(s, stats, now_ns() - start, step_ns);
+
+            if (done) stats->completed++;
+            wt->task = INVALID_TASK_ID;
+        }
+    }
+
+    if (system_ctx_next_deadline(ctx, now) <= now) {
+        start = now_ns();
+        trace_system_ctx_tick(ctx, now);
+        record_call(s, stats, now_ns() - start, step_ns);
+    }
+
+    // Waiters take up what they were assigned
+    for (uint8_t w = 0; w < SYSTEM_STAFF_COUNT; ++w) {
+        waiter *wt = &s->waiters[w];
+        task_id id = system_ctx_get_staff_task(ctx, w);
+
+        if (same_task(id, wt->task)) continue;
+
+        wt->task = id;
+        if (id.index == INVALID_TASK_ID.index) continue;
+
+        const task *t = task_pool_get(&ctx->pool, id);
+        wt->busy_until = now + (time_ms)floor_layout_distance_dm(wt->table, t->table_number) * WALK_MS_PER_DM + SERVICE_MS;
+        wt->table = t->table_number;
+    }
+
+    // Follow every table's state, so the guests react to the waiters' work
+    for (uint16_t t = 0; t < MAX_TABLES; ++t) {
+        table_state state = system_ctx_get_table_state(ctx, (uint8_t)t);
+        if (state != s->guests[t].last_state) {
+            on_table_state(&s->guests[t], state, s->guests[t].last_state, now);
+            s->guests[t].last_state = state;
+        }
+    }
+}
+
+
+static void run_once(section *sections, const staff_scheduler_config *staff_config, time_ms length, pass_stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->step_ns = malloc((length / BENCH_TICK_MS + 1) * sizeof(uint64_t));
+
+    for (uint32_t i = 0; i < BENCH_SECTIONS; ++i) init_section(&sections[i], i, staff_config);
+
+    for (time_ms now = 0; now < length; now += BENCH_TICK_MS) {
+        uint64_t step_ns = 0;
+        for (uint32_t i = 0; i < BENCH_SECTIONS; ++i) step_section(&sections[i], stats, now, &step_ns);
+        stats->step_ns[stats->steps++] = step_ns;
+    }
+
+    for (uint32_t i = 0; i < BENCH_SECTIONS; ++i) {
+        stats->violations += system_ctx_get_check_stats(&sections[i].ctx)->violations;
+    }
+}
+
+
+// Runs the shift `runs` times, keeping each call's and step's fastest time
+static bool run_pass(section *sections, const staff_scheduler_config *staff_config, time_ms length,
+                     unsigned runs, pass_stats *stats)
+{
+    run_once(sections, staff_config, length, stats);
+
+    for (unsigned r = 1; r < runs; ++r) {
+        pass_stats again;
+        run_once(sections, staff_config, length, &again);
+
+        bool same = again.calls == stats->calls && again.completed == stats->completed &&
+                    again.auctions == stats->auctions && again.bids == stats->bids;
+        if (same) {
+            for (size_t i = 0; i < stats->calls; ++i) {
+                if (again.call_ns[i] < stats->call_ns[i]) stats->call_ns[i] = again.call_ns[i];
+            }
+            for (size_t i = 0; i < stats->steps; ++i) {
+                if (again.step_ns[i] < stats->step_ns[i]) stats->step_ns[i] = again.step_ns[i];
+            }
+        }
+        free(again.call_ns);
+        free(again.step_ns);
+
+        if (!same) {
+            fprintf(stderr, "run %u of the shift differs from the first\n", r + 1);
+            return false;
+        }
+    }
+    return true;
+}
+
+
+static uint64_t percentile(uint64_t *samples, size_t count, double p) {
+    qsort(samples, count, sizeof(samples[0]), compare_u64);
+    size_t i = (size_t)(p * (double)(count - 1) + 0.5);
+    return samples[i];
+}
+
+
+// Returns whether every step stayed within budget and kept a valid assignment
+static bool report(const char *name, pass_stats *stats, uint64_t budget_ns) {
+    uint64_t call_p50 = percentile(stats->call_ns, stats->calls, 0.50);
+    uint64_t call_p99 = percentile(stats->call_ns, stats->calls, 0.99);
+    uint64_t call_max = stats->call_ns[stats->calls - 1];
+    uint64_t step_p99 = percentile(stats->step_ns, stats->steps, 0.99);
+    uint64_t step_max = stats->step_ns[stats->steps - 1];
+
+    printf("%-9s %8zu %8.1f %8.1f %8.1f %9.1f %9.1f %8u %8u %7.1f %7u %7u %6u %6u %6u\n",
+           name, stats->calls, call_p50 / 1e3, call_p99 / 1e3, call_max / 1e3, step_p99 / 1e3, step_max / 1e3,
+           stats->completed, stats->auctions,
+           stats->auctions ? (double)stats->bids / stats->auctions : 0.0, stats->max_bids, stats->fallbacks,
+           stats->truncated, stats->bad_assignments, stats->violations);
+
+    bool ok = step_max <= budget_ns && stats->bad_assignments == 0 && stats->violations == 0;
+    free(stats->call_ns);
+    free(stats->step_ns);
+    return ok;
+}
+
+
+int main(int argc, char **argv) {
+    double hours = 4.0;
+    unsigned long budget_us = 2000;
+    unsigned long fallback_bids = 4;
+    unsigned long runs = 3;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-H") == 0 && i + 1 < argc) {
+            hours = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            budget_us = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            fallback_bids = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-R") == 0 && i + 1 < argc) {
+            runs = strtoul(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "usage: %s [-H hours] [-b budget_us] [-m fallback_max_bids] [-R runs]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (hours <= 0.0 || hours > 24.0 || budget_us == 0 || fallback_bids == 0 || fallback_bids > UINT16_MAX ||
+        runs == 0 || runs > 100) {
+        fprintf(stderr, "hours must be in (0, 24], budget and bids > 0, runs in [1, 100]\n");
+        return 2;
+    }
+
+    load_grid_layout();
+
+    // Far too large for the stack, and must not move once initialised
+    section *sections = malloc(BENCH_SECTIONS * sizeof(section));
+    if (!sections) {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+
+    time_ms length = (time_ms)(hours * 3600000.0);
+    staff_scheduler_config defaults = {0};
+    staff_scheduler_config tight = { .max_bids = (uint16_t)fallback_bids };
+    pass_stats stats;
+    bool ok = true;
+
+    printf("%u sections of %u tables and %u waiters, %.1f h, per-tick budget %lu us, fastest of %lu runs\n\n",
+           BENCH_SECTIONS, (unsigned)MAX_TABLES, (unsigned)SYSTEM_STAFF_COUNT, hours, budget_us, runs);
+    printf("%-9s %8s %8s %8s %8s %9s %9s %8s %8s %7s %7s %7s %6s %6s %6s\n", "bids", "calls", "p50 us", "p99 us",
+           "max us", "tick p99", "tick max", "tasks", "auctions", "bids", "max", "greedy", "cut", "bad", "viol");
+
+    ok &= run_pass(sections, &defaults, length, (unsigned)runs, &stats);
+    ok &= report("default", &stats, budget_us * 1000);
+
+    char name[16];
+    snprintf(name, sizeof(name), "max %lu", fallback_bids);
+    ok &= run_pass(sections, &tight, length, (unsigned)runs, &stats);
+    bool fallback_ran = stats.fallbacks > 0;
+    ok &= report(name, &stats, budget_us * 1000);
+
+    free(sections);
+    if (!fallback_ran) {
+        fprintf(stderr, "no auction ran out of bids with max_bids %lu; lower -m\n", fallback_bids);
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
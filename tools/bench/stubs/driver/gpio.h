@@ -0,0 +1,31 @@
+#ifndef BENCH_STUB_GPIO_H
+#define BENCH_STUB_GPIO_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/* The subset of the GPIO driver display_util.c uses. */
+
+typedef enum {
+    GPIO_MODE_INPUT  = 1,
+    GPIO_MODE_OUTPUT = 2,
+} gpio_mode_t;
+
+typedef enum {
+    GPIO_PULLUP_DISABLE = 0,
+    GPIO_PULLUP_ENABLE  = 1,
+} gpio_pullup_t;
+
+typedef struct {
+    uint64_t pin_bit_mask;
+    gpio_mode_t mode;
+    gpio_pullup_t pull_up_en;
+    int pull_down_en;
+    int intr_type;
+} gpio_config_t;
+
+esp_err_t gpio_config(const gpio_config_t *config);
+esp_err_t gpio_set_level(int gpio_num, uint32_t level);
+
+#endif
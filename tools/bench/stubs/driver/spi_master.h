@@ -0,0 +1,70 @@
+#ifndef BENCH_STUB_SPI_MASTER_H
+#define BENCH_STUB_SPI_MASTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/* The subset of the SPI master driver display_util.c uses. The bench
+   defines the functions and counts what goes over the bus instead. */
+
+#define SPI_TRANS_USE_TXDATA        (1u << 3)
+#define SPI_TRANS_CS_KEEP_ACTIVE    (1u << 8)
+
+typedef enum {
+    SPI1_HOST,
+    SPI2_HOST,
+    SPI3_HOST,
+} spi_host_device_t;
+
+#define SPI_DMA_CH_AUTO             3
+
+typedef struct spi_device_t *spi_device_handle_t;
+
+typedef struct spi_transaction_t spi_transaction_t;
+typedef void (*transaction_cb_t)(spi_transaction_t *trans);
+
+struct spi_transaction_t {
+    uint32_t flags;
+    size_t length;                  // in bits
+    size_t rxlength;
+    void *user;
+    union {
+        const void *tx_buffer;
+        uint8_t tx_data[4];
+    };
+    union {
+        void *rx_buffer;
+        uint8_t rx_data[4];
+    };
+};
+
+typedef struct {
+    int mosi_io_num;
+    int miso_io_num;
+    int sclk_io_num;
+    int quadwp_io_num;
+    int quadhd_io_num;
+    int max_transfer_sz;
+} spi_bus_config_t;
+
+typedef struct {
+    uint8_t mode;
+    int clock_speed_hz;
+    int spics_io_num;
+    int queue_size;
+    transaction_cb_t pre_cb;
+    transaction_cb_t post_cb;
+} spi_device_interface_config_t;
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t *config, int dma_chan);
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t *config,
+                             spi_device_handle_t *handle);
+esp_err_t spi_device_acquire_bus(spi_device_handle_t device, uint32_t wait);
+void spi_device_release_bus(spi_device_handle_t device);
+esp_err_t spi_device_polling_transmit(spi_device_handle_t device, spi_transaction_t *trans);
+esp_err_t spi_device_queue_trans(spi_device_handle_t device, spi_transaction_t *trans, uint32_t ticks_to_wait);
+esp_err_t spi_device_get_trans_result(spi_device_handle_t device, spi_transaction_t **trans, uint32_t ticks_to_wait);
+
+#endif
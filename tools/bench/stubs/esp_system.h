@@ -0,0 +1,6 @@
+#ifndef BENCH_STUB_ESP_SYSTEM_H
+#define BENCH_STUB_ESP_SYSTEM_H
+
+/* display_util.c includes this but uses nothing from it. */
+
+#endif
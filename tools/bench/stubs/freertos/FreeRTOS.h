@@ -0,0 +1,15 @@
+#ifndef BENCH_STUB_FREERTOS_H
+#define BENCH_STUB_FREERTOS_H
+
+#include <assert.h>
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+
+#define portMAX_DELAY               ((TickType_t)0xffffffffu)
+#define portTICK_PERIOD_MS          1
+#define pdMS_TO_TICKS(ms)           ((TickType_t)(ms) / portTICK_PERIOD_MS)
+
+#define DRAM_ATTR
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef BENCH_STUB_TASK_H
+#define BENCH_STUB_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+void vTaskDelay(TickType_t ticks);
+
+#endif
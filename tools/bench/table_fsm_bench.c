@@ -0,0 +1,263 @@
+/*
+ * Table FSM transition benchmark.
+ *
+ * Reads the vectors tools/table_fsm_gen.py derives from main/table_fsm.spec
+ * and first checks table_apply_event() against every one of them: the state,
+ * previous state and changed flag it leaves, and the entry time on a change.
+ * A mismatch fails the run. The nested switch the generated table replaced
+ * is kept below as the baseline and checked the same way, so the spec is
+ * known to describe the machine it was written from.
+ *
+ * Then both are timed over the vectors in a shuffled order, each applied to
+ * a freshly set context, so the event and state differ from one call to the
+ * next as they do on the device. "setup ns" is the loop without the
+ * transition, to subtract.
+ *
+ * Build from the repository root:
+ *
+ *   python tools/table_fsm_gen.py main/table_fsm.spec --vectors table_fsm.vectors
+ *   gcc -O2 -std=gnu11 -DTRACE_VIRTUAL_CLOCK -Itools/replay/stubs -Imain/include tools/bench/table_fsm_bench.c \
+ *       main/src/table_fsm.c main/src/table_fsm_table.c -o table_fsm_bench
+ *
+ * Usage:
+ *
+ *   ./table_fsm_bench table_fsm.vectors [-r rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "table_fsm.h"
+
+
+#define BENCH_MAX_VECTORS   4096
+#define BENCH_ENTERED_AT    1000
+#define BENCH_NOW           2000
+
+typedef struct {
+    uint8_t state, prev, event;
+    uint8_t want_state, want_prev, want_changed;
+} fsm_vector;
+
+typedef bool (*apply_fn)(table_context *table, fsm_transition_event event, time_ms current_time);
+
+static fsm_vector vectors[BENCH_MAX_VECTORS];
+static uint32_t vector_count;
+
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+
+// xorshift32, so runs are repeatable across libcs
+static uint32_t rng_state = 0x9e3779b9u;
+
+static uint32_t rng_next(void) {
+    uint32_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return rng_state = x;
+}
+
+
+/* table_apply_event() as it was before main/table_fsm.spec, the baseline. */
+static inline void switch_enter_state(table_context *table, table_state next, time_ms current_time) {
+    table->prev_state = table->state;
+    table->state = next;
+    table->state_entered_at = current_time;
+}
+
+static bool switch_apply_event(table_context *table, fsm_transition_event event, time_ms current_time) {
+    table_state prev = table->state;
+
+    if (event == EVENT_UNDO && table->prev_state != TABLE_IDLE) {
+        table_state restore = table->prev_state;
+        table->prev_state = TABLE_IDLE;
+        table->state = restore;
+        table->state_entered_at = current_time;
+        return true;
+    }
+
+    switch (table->state) {
+        case TABLE_IDLE:
+            if (event == EVENT_CUSTOMERS_SEATED) switch_enter_state(table, TABLE_SEATED, current_time);
+            break;
+        case TABLE_SEATED:
+            if (event == EVENT_MARK_COMPLETE || event == EVENT_TAKE_ORDER_EARLY_OR_REPEAT) {
+                switch_enter_state(table, TABLE_READY_FOR_ORDER, current_time);
+            }
+            break;
+        case TABLE_READY_FOR_ORDER:
+            if (event == EVENT_MARK_COMPLETE) switch_enter_state(table, TABLE_PLACED_ORDER, current_time);
+            break;
+        case TABLE_PLACED_ORDER:
+            if (event == EVENT_MARK_COMPLETE) switch_enter_state(table, TABLE_WAITING_FOR_ORDER, current_time);
+            else if (event == EVENT_TAKE_ORDER_EARLY_OR_REPEAT) switch_enter_state(table, TABLE_READY_FOR_ORDER, current_time);
+            else if (event == EVENT_POS_ORDER_READY) switch_enter_state(table, TABLE_WAITING_FOR_ORDER, current_time);
+            break;
+        case TABLE_WAITING_FOR_ORDER:
+            if (event == EVENT_MARK_COMPLETE) switch_enter_state(table, TABLE_DINING, current_time);
+            else if (event == EVENT_TAKE_ORDER_EARLY_OR_REPEAT) switch_enter_state(table, TABLE_READY_FOR_ORDER, current_time);
+            else if (event == EVENT_TABLE_REQUESTED_BILL) switch_enter_state(table, TABLE_REQUESTED_BILL, current_time);
+            break;
+        case TABLE_DINING:
+            if (event == TIMEOUT_PERIODIC_CHECKIN) switch_enter_state(table, TABLE_CHECKUP, current_time);
+            else if (event == EVENT_TAKE_ORDER_EARLY_OR_REPEAT) switch_enter_state(table, TABLE_READY_FOR_ORDER, current_time);
+            else if (event == EVENT_TABLE_REQUESTED_BILL) switch_enter_state(table, TABLE_REQUESTED_BILL, current_time);
+            break;
+        case TABLE_CHECKUP:
+            if (event == EVENT_TAKE_ORDER_EARLY_OR_REPEAT) switch_enter_state(table, TABLE_READY_FOR_ORDER, current_time);
+            else if (event == EVENT_MARK_COMPLETE) switch_enter_state(table, TABLE_DINING, current_time);
+            else if (event == EVENT_TABLE_REQUESTED_BILL) switch_enter_state(table, TABLE_REQUESTED_BILL, current_time);
+            break;
+        case TABLE_REQUESTED_BILL:
+            if (event == EVENT_MARK_COMPLETE) switch_enter_state(table, TABLE_DONE, current_time);
+            break;
+        case TABLE_DONE:
+            if (event == EVENT_MARK_COMPLETE) switch_enter_state(table, TABLE_IDLE, current_time);
+            break;
+        default:
+            break;
+    }
+
+    return table->state != prev;
+}
+
+
+static bool no_transition(table_context *table, fsm_transition_event event, time_ms current_time) {
+    return false;
+}
+
+
+static int load_vectors(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+
+        unsigned v[6];
+        if (sscanf(line, "%u %u %u %u %u %u", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) != 6 ||
+            v[0] >= TABLE_STATE_COUNT || v[1] >= TABLE_STATE_COUNT || v[2] >= FSM_EVENT_COUNT ||
+            v[3] >= TABLE_STATE_COUNT || v[4] >= TABLE_STATE_COUNT || v[5] > 1) {
+            fprintf(stderr, "%s: bad vector: %s", path, line);
+            fclose(f);
+            return -1;
+        }
+        if (vector_count == BENCH_MAX_VECTORS) {
+            fprintf(stderr, "%s: more than %d vectors\n", path, BENCH_MAX_VECTORS);
+            fclose(f);
+            return -1;
+        }
+        vectors[vector_count++] = (fsm_vector){ v[0], v[1], v[2], v[3], v[4], v[5] };
+    }
+
+    fclose(f);
+    return vector_count ? 0 : -1;
+}
+
+
+static inline void set_context(table_context *table, const fsm_vector *v) {
+    table->state = (table_state)v->state;
+    table->prev_state = (table_state)v->prev;
+    table->state_entered_at = BENCH_ENTERED_AT;
+}
+
+
+static uint32_t check_vectors(const char *name, apply_fn apply) {
+    uint32_t failures = 0;
+
+    for (uint32_t i = 0; i < vector_count; ++i) {
+        const fsm_vector *v = &vectors[i];
+        table_context table = { .table_number = 0 };
+        set_context(&table, v);
+
+        bool changed = apply(&table, (fsm_transition_event)v->event, BENCH_NOW);
+        time_ms want_entered = v->want_changed ? BENCH_NOW : BENCH_ENTERED_AT;
+
+        if (table.state != v->want_state || table.prev_state != v->want_prev ||
+            changed != (bool)v->want_changed || table.state_entered_at != want_entered) {
+            if (failures++ < 10) {
+                fprintf(stderr, "%s: state %u prev %u event %u -> state %u prev %u changed %d, want %u %u %u\n",
+                        name, v->state, v->prev, v->event, (unsigned)table.state, (unsigned)table.prev_state,
+                        (int)changed, v->want_state, v->want_prev, v->want_changed);
+            }
+        }
+    }
+    return failures;
+}
+
+
+static double time_vectors(apply_fn apply, const uint32_t *order, unsigned long rounds, volatile uint32_t *sink) {
+    table_context table = { .table_number = 0 };
+    uint32_t changed = 0;
+
+    uint64_t start = now_ns();
+    for (unsigned long r = 0; r < rounds; ++r) {
+        for (uint32_t i = 0; i < vector_count; ++i) {
+            const fsm_vector *v = &vectors[order[i]];
+            set_context(&table, v);
+            changed += apply(&table, (fsm_transition_event)v->event, BENCH_NOW);
+            changed += table.state;
+        }
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    *sink += changed;
+    return (double)elapsed / ((double)rounds * vector_count);
+}
+
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    unsigned long rounds = 20000;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            rounds = strtoul(argv[++i], NULL, 10);
+        } else if (!path && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (!path || rounds == 0) {
+        fprintf(stderr, "usage: %s vectors_file [-r rounds]\n", argv[0]);
+        return 2;
+    }
+    if (load_vectors(path) != 0) return 2;
+
+    uint32_t table_failures = check_vectors("table", table_apply_event);
+    uint32_t switch_failures = check_vectors("switch", switch_apply_event);
+    printf("%u vectors: table %u failed, switch %u failed\n", vector_count, table_failures, switch_failures);
+    if (table_failures || switch_failures) return 1;
+
+    static uint32_t order[BENCH_MAX_VECTORS];
+    for (uint32_t i = 0; i < vector_count; ++i) order[i] = i;
+    for (uint32_t i = vector_count - 1; i > 0; --i) {
+        uint32_t j = rng_next() % (i + 1);
+        uint32_t t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+
+    volatile uint32_t sink = 0;
+    double setup_ns = time_vectors(no_transition, order, rounds, &sink);
+    double table_ns = time_vectors(table_apply_event, order, rounds, &sink);
+    double switch_ns = time_vectors(switch_apply_event, order, rounds, &sink);
+
+    printf("%10s %10s %10s\n", "setup ns", "table ns", "switch ns");
+    printf("%10.2f %10.2f %10.2f\n", setup_ns, table_ns, switch_ns);
+    return 0;
+}
@@ -0,0 +1,300 @@
+/*
+ * Task pool allocation benchmark.
+ *
+ * Measures allocate/free churn on task pools of several capacities, each
+ * backed by a heap arena sized with TASK_POOL_ARENA_SIZE(). Every pool is
+ * filled to the given load, then slots are freed and reallocated at random
+ * for a fixed number of rounds. Each freed handle is looked up again once
+ * its slot has been reused, and every live handle at the end, so a stale
+ * generation getting through or a live task going missing fails the run.
+ *
+ * A second table compares the slot bitmaps against per-slot loops at 32
+ * and 4096 slots: usage counts (popcount vs testing every slot's status),
+ * walking the eligible tasks (count-trailing-zeros vs testing every slot)
+ * and reaping dead tasks (dead mask vs testing every slot). Pools are
+ * filled to the same load with a random status mix, a quarter of it dead.
+ *
+ * Build from the repository root:
+ *
+ *   gcc -O2 -std=gnu11 -DTRACE_VIRTUAL_CLOCK -Itools/replay/stubs -Imain/include \
+ *       tools/bench/task_pool_bench.c main/src/task_pool.c main/src/task_domain.c \
+ *       -o task_pool_bench
+ *
+ * Usage:
+ *
+ *   ./task_pool_bench [-r rounds] [-l load_percent]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "task_pool.h"
+
+
+#define BENCH_TABLES    24
+
+static const uint16_t CAPACITIES[] = { 32, 256, 4096, 32768, TASK_POOL_MAX_CAPACITY };
+static const uint16_t SCAN_CAPACITIES[] = { 32, 4096 };
+
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+
+// xorshift32, so runs are repeatable across libcs
+static uint32_t rng_state = 0x9e3779b9u;
+
+static uint32_t rng_next(void) {
+    uint32_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return rng_state = x;
+}
+
+
+static int bench_capacity(uint16_t capacity, unsigned long rounds, unsigned load_percent) {
+    size_t arena_size = TASK_POOL_ARENA_SIZE(capacity, BENCH_TABLES);
+    void *arena = malloc(arena_size);
+    task_id *live = malloc(capacity * sizeof(task_id));
+    if (!arena || !live) {
+        fprintf(stderr, "out of memory at capacity %u\n", capacity);
+        free(arena);
+        free(live);
+        return 1;
+    }
+
+    task_pool pool;
+    if (task_pool_init(&pool, arena, arena_size, BENCH_TABLES) != capacity) {
+        fprintf(stderr, "arena for %u slots gave capacity %u\n", capacity, pool.capacity);
+        free(arena);
+        free(live);
+        return 1;
+    }
+
+    uint32_t live_count = (uint32_t)capacity * load_percent / 100;
+    if (live_count == 0) live_count = 1;
+    for (uint32_t i = 0; i < live_count; ++i) {
+        live[i] = task_pool_allocate(&pool);
+    }
+
+    unsigned long stale_hits = 0;
+
+    uint64_t start = now_ns();
+    for (unsigned long round = 0; round < rounds; ++round) {
+        uint32_t victim = rng_next() % live_count;
+
+        task_id stale = live[victim];
+        task_pool_free(&pool, stale);
+        live[victim] = task_pool_allocate(&pool);
+
+        // The slot is reused at once, so the old handle must fail on generation alone
+        if (task_pool_get(&pool, stale)) stale_hits++;
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    unsigned long failures = 0;
+    for (uint32_t i = 0; i < live_count; ++i) {
+        if (!task_pool_get(&pool, live[i])) failures++;
+    }
+
+    printf("%8u %8u %12lu %10.1f %8lu %8lu\n",
+           capacity, live_count, rounds,
+           (double)elapsed / (double)(rounds * 2), failures, stale_hits);
+
+    free(arena);
+    free(live);
+    return (failures || stale_hits) ? 1 : 0;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Bitmaps vs per-slot loops                                           */
+/* ------------------------------------------------------------------ */
+
+static const task_status STATUS_MIX[] = { TASK_ELIGIBLE, TASK_ELIGIBLE, TASK_SUPPRESSED, TASK_COMPLETED,
+                                          TASK_ELIGIBLE, TASK_SUPPRESSED, TASK_ELIGIBLE, TASK_KILLED };
+
+// Bring the pool back to live_count tasks, a random status each, filed with the pool
+static void fill_pool(task_pool *pool, uint32_t live_count) {
+    uint32_t occupied = task_pool_count(pool, TASK_POOL_OCCUPIED);
+    for (; occupied < live_count; ++occupied) {
+        task_id id = task_pool_allocate(pool);
+        task *t = task_pool_get(pool, id);
+        task_init(t, id, (task_kind)(rng_next() % TASK_NOT_APPLICABLE), 0, (uint8_t)(rng_next() % BENCH_TABLES));
+        t->status = STATUS_MIX[rng_next() % (sizeof(STATUS_MIX) / sizeof(STATUS_MIX[0]))];
+        task_pool_sync(pool, id);
+    }
+}
+
+
+static uint32_t usage_by_loop(const task_pool *pool) {
+    uint16_t eligible = 0, suppressed = 0, dead = 0;
+    for (uint16_t i = 0; i < pool->capacity; ++i) {
+        const task_slot *slot = &pool->slots[i];
+        if (!slot->occupied) continue;
+
+        switch (slot->task_instance.status) {
+            case TASK_ELIGIBLE:   eligible++; break;
+            case TASK_SUPPRESSED: suppressed++; break;
+            default:              dead++; break;
+        }
+    }
+    return (uint32_t)eligible + suppressed + dead;
+}
+
+
+static uint32_t usage_by_bitmap(const task_pool *pool) {
+    return (uint32_t)task_pool_count(pool, TASK_POOL_ELIGIBLE) + task_pool_count(pool, TASK_POOL_SUPPRESSED) +
+           task_pool_count(pool, TASK_POOL_DEAD);
+}
+
+
+static uint32_t walk_by_loop(const task_pool *pool) {
+    uint32_t sum = 0;
+    for (uint16_t i = 0; i < pool->capacity; ++i) {
+        const task_slot *slot = &pool->slots[i];
+        if (slot->occupied && slot->task_instance.status == TASK_ELIGIBLE) sum += slot->task_instance.table_number;
+    }
+    return sum;
+}
+
+
+static uint32_t walk_by_bitmap(const task_pool *pool) {
+    uint32_t sum = 0;
+    task_pool_iter it = task_pool_iter_begin(pool, TASK_POOL_ELIGIBLE);
+    for (uint16_t i = task_pool_iter_next(&it); i != TASK_POOL_NO_POS; i = task_pool_iter_next(&it)) {
+        sum += pool->slots[i].task_instance.table_number;
+    }
+    return sum;
+}
+
+
+static uint32_t reap_by_loop(task_pool *pool) {
+    uint32_t reaped = 0;
+    for (uint16_t i = 0; i < pool->capacity; ++i) {
+        task_slot *slot = &pool->slots[i];
+        if (!slot->occupied) continue;
+
+        if (slot->task_instance.status == TASK_COMPLETED || slot->task_instance.status == TASK_KILLED) {
+            task_id id = { .index = i, .generation = slot->generation };
+            task_pool_free(pool, id);
+            reaped++;
+        }
+    }
+    return reaped;
+}
+
+
+static uint32_t reap_by_bitmap(task_pool *pool) {
+    return task_pool_reap(pool);
+}
+
+
+static volatile uint32_t sink;
+
+static double time_scan(task_pool *pool, uint32_t (*scan)(const task_pool *), unsigned long rounds) {
+    uint64_t start = now_ns();
+    for (unsigned long round = 0; round < rounds; ++round) {
+        sink += scan(pool);
+    }
+    return (double)(now_ns() - start) / (double)rounds;
+}
+
+
+// Reaping empties the dead set, so refill between rounds and time the reaps alone
+static double time_reap(task_pool *pool, uint32_t live_count, uint32_t (*reap)(task_pool *), unsigned long rounds) {
+    uint64_t elapsed = 0;
+    for (unsigned long round = 0; round < rounds; ++round) {
+        fill_pool(pool, live_count);
+
+        uint64_t start = now_ns();
+        sink += reap(pool);
+        elapsed += now_ns() - start;
+    }
+    return (double)elapsed / (double)rounds;
+}
+
+
+static int bench_scans(uint16_t capacity, unsigned long rounds, unsigned load_percent) {
+    size_t arena_size = TASK_POOL_ARENA_SIZE(capacity, BENCH_TABLES);
+    void *arena = malloc(arena_size);
+    if (!arena) {
+        fprintf(stderr, "out of memory at capacity %u\n", capacity);
+        return 1;
+    }
+
+    task_pool pool;
+    task_pool_init(&pool, arena, arena_size, BENCH_TABLES);
+
+    uint32_t live_count = (uint32_t)capacity * load_percent / 100;
+    if (live_count == 0) live_count = 1;
+    fill_pool(&pool, live_count);
+
+    // Scans of big pools are slow enough that fewer rounds give stable numbers
+    unsigned long scan_rounds = rounds / (1 + capacity / 256);
+    if (scan_rounds == 0) scan_rounds = 1;
+
+    int status = 0;
+    if (usage_by_loop(&pool) != usage_by_bitmap(&pool) || walk_by_loop(&pool) != walk_by_bitmap(&pool)) {
+        fprintf(stderr, "bitmaps disagree with the slots at capacity %u\n", capacity);
+        status = 1;
+    }
+
+    printf("%8u %-7s %12.1f %12.1f\n", capacity, "usage",
+           time_scan(&pool, usage_by_loop, scan_rounds), time_scan(&pool, usage_by_bitmap, scan_rounds));
+    printf("%8u %-7s %12.1f %12.1f\n", capacity, "walk",
+           time_scan(&pool, walk_by_loop, scan_rounds), time_scan(&pool, walk_by_bitmap, scan_rounds));
+    printf("%8u %-7s %12.1f %12.1f\n", capacity, "reap",
+           time_reap(&pool, live_count, reap_by_loop, scan_rounds),
+           time_reap(&pool, live_count, reap_by_bitmap, scan_rounds));
+
+    if (task_pool_check_indexes(&pool) != 0) {
+        fprintf(stderr, "pool indexes inconsistent at capacity %u\n", capacity);
+        status = 1;
+    }
+
+    free(arena);
+    return status;
+}
+
+
+int main(int argc, char **argv) {
+    unsigned long rounds = 1000000;
+    unsigned load_percent = 90;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            rounds = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            load_percent = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "usage: %s [-r rounds] [-l load_percent]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (rounds == 0 || load_percent == 0 || load_percent > 100) {
+        fprintf(stderr, "rounds must be > 0 and load_percent in 1..100\n");
+        return 2;
+    }
+
+    printf("task_slot %zu bytes, %zu arena bytes per slot\n\n",
+           sizeof(task_slot), (size_t)TASK_POOL_BYTES_PER_SLOT);
+    printf("%8s %8s %12s %10s %8s %8s\n", "capacity", "live", "rounds", "ns/op", "lost", "stale");
+
+    int status = 0;
+    for (size_t i = 0; i < sizeof(CAPACITIES) / sizeof(CAPACITIES[0]); ++i) {
+        status |= bench_capacity(CAPACITIES[i], rounds, load_percent);
+    }
+
+    printf("\n%8s %-7s %12s %12s\n", "capacity", "op", "loop ns", "bitmap ns");
+    for (size_t i = 0; i < sizeof(SCAN_CAPACITIES) / sizeof(SCAN_CAPACITIES[0]); ++i) {
+        status |= bench_scans(SCAN_CAPACITIES[i], rounds, load_percent);
+    }
+    return status;
+}
@@ -0,0 +1,411 @@
+/*
+ * Text render benchmark.
+ *
+ * Compares draw_text(), which rasterises a string with its background and
+ * sends it through one address window, against the renderer it replaced,
+ * kept below as the baseline: one display_write() per pixel row of every
+ * lit font pixel, each with its own bus acquire and CASET/RASET/RAMWR.
+ * draw_text is wrapped at link time, so draw_label() and the rest of
+ * ui_widgets.c run unchanged on either renderer.
+ *
+ * The SPI driver is replaced by functions that count what reaches the bus
+ * and, while checking, play it into a copy of the panel's memory. Each case
+ * is first drawn both ways on a screen cleared to its background, and the
+ * two screens must match pixel for pixel; the counters display_util.c keeps
+ * for the device must also agree with the ones counted here. Then each case
+ * is timed both ways.
+ *
+ * "cpu ns" is host time per call with a driver that does nothing, so it is
+ * the drawing code alone. "bus us" is a model, not a measurement: the bytes
+ * at the 80 MHz SPI clock plus a fixed cost per transaction for setting it
+ * up, toggling D/C and waiting for it. The default cost is an assumption;
+ * pass what the device shows with -o.
+ *
+ * Build from the repository root (GNU ld, for --wrap):
+ *
+ *   gcc -O2 -std=gnu11 -DTRACE_VIRTUAL_CLOCK -Itools/bench/stubs -Itools/replay/stubs -Imain/include \
+ *       tools/bench/text_render_bench.c main/src/display_util.c main/src/ui_widgets.c main/src/font5x7.c \
+ *       -Wl,--wrap=draw_text -lm -o text_render_bench
+ *
+ * Usage:
+ *
+ *   ./text_render_bench [-r rounds] [-o transaction overhead ns]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "display_util.h"
+#include "font5x7.h"
+#include "ui_internal.h"
+#include "ui_widgets.h"
+#include "driver/gpio.h"
+#include "freertos/task.h"
+
+
+#define BENCH_SPI_HZ                80000000    // SPI_CLOCK_SPEED in display_util.c
+#define BENCH_TRANSACTION_NS        5000        // assumed, see above
+#define BENCH_PANEL_W               240         // ST7789V2 frame memory
+#define BENCH_PANEL_H               320
+
+#define ST7789_CASET                0x2A
+#define ST7789_RASET                0x2B
+#define ST7789_RAMWR                0x2C
+
+int64_t virtual_clock_us;
+
+
+// ----------------------------
+// SPI driver stand-in
+// ----------------------------
+
+typedef struct {
+    uint32_t transactions;
+    uint32_t windows;
+    uint32_t bus_acquires;
+    uint32_t bytes;
+} bus_count;
+
+static bus_count bus;
+
+/* Panel state, followed only while checking */
+static bool     emulate;
+static uint16_t panel[BENCH_PANEL_H][BENCH_PANEL_W];
+static uint8_t  panel_cmd;
+static uint8_t  panel_args[4];
+static uint8_t  panel_arg_count;
+static uint16_t window_x0, window_x1, window_y0, window_y1;
+static uint16_t cursor_x, cursor_y;
+static int      pixel_high = -1;         // first byte of a pixel, -1 between pixels
+
+
+static void panel_command(uint8_t cmd) {
+    panel_cmd = cmd;
+    panel_arg_count = 0;
+    pixel_high = -1;
+    if (cmd == ST7789_RAMWR) {
+        cursor_x = window_x0;
+        cursor_y = window_y0;
+    }
+}
+
+
+static void panel_data(uint8_t byte) {
+    if (panel_cmd == ST7789_CASET || panel_cmd == ST7789_RASET) {
+        if (panel_arg_count == 4) return;
+        panel_args[panel_arg_count++] = byte;
+        if (panel_arg_count < 4) return;
+
+        uint16_t start = (uint16_t)((panel_args[0] << 8) | panel_args[1]);
+        uint16_t end   = (uint16_t)((panel_args[2] << 8) | panel_args[3]);
+        if (panel_cmd == ST7789_CASET) {
+            window_x0 = start;
+            window_x1 = end;
+        } else {
+            window_y0 = start;
+            window_y1 = end;
+        }
+    } else if (panel_cmd == ST7789_RAMWR) {
+        if (pixel_high < 0) {
+            pixel_high = byte;
+            return;
+        }
+
+        // Pixels go out high byte first
+        if (cursor_x < BENCH_PANEL_W && cursor_y < BENCH_PANEL_H) {
+            panel[cursor_y][cursor_x] = (uint16_t)((pixel_high << 8) | byte);
+        }
+        pixel_high = -1;
+
+        if (cursor_x++ == window_x1) {
+            cursor_x = window_x0;
+            cursor_y = (cursor_y == window_y1) ? window_y0 : (uint16_t)(cursor_y + 1);
+        }
+    }
+}
+
+
+static void transmit(const spi_transaction_t *trans) {
+    size_t bytes = trans->length / 8;
+    bool is_data = (intptr_t)trans->user != 0;
+
+    bus.transactions++;
+    bus.bytes += (uint32_t)bytes;
+
+    const uint8_t *data = (trans->flags & SPI_TRANS_USE_TXDATA) ? trans->tx_data : trans->tx_buffer;
+    if (!is_data && bytes > 0 && data[0] == ST7789_RAMWR) bus.windows++;
+    if (!emulate) return;
+
+    if (!is_data) {
+        panel_command(data[0]);
+        return;
+    }
+    for (size_t i = 0; i < bytes; ++i) panel_data(data[i]);
+}
+
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t *config, int dma_chan) {
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t *config,
+                             spi_device_handle_t *handle) {
+    *handle = NULL;
+    return ESP_OK;
+}
+
+esp_err_t spi_device_acquire_bus(spi_device_handle_t device, uint32_t wait) {
+    bus.bus_acquires++;
+    return ESP_OK;
+}
+
+void spi_device_release_bus(spi_device_handle_t device) {
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t device, spi_transaction_t *trans) {
+    transmit(trans);
+    return ESP_OK;
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t device, spi_transaction_t *trans, uint32_t ticks_to_wait) {
+    transmit(trans);
+    return ESP_OK;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t device, spi_transaction_t **trans, uint32_t ticks_to_wait) {
+    *trans = NULL;
+    return ESP_OK;
+}
+
+esp_err_t gpio_config(const gpio_config_t *config) {
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(int gpio_num, uint32_t level) {
+    return ESP_OK;
+}
+
+void vTaskDelay(TickType_t ticks) {
+}
+
+
+// ----------------------------
+// Baseline: the renderer draw_text replaced
+// ----------------------------
+
+static void legacy_draw_block(spi_device_handle_t display, uint16_t x, uint16_t y, uint8_t scale, uint16_t color) {
+    uint16_t line[16];
+    if (scale == 0 || scale > 4) return;
+
+    for (uint8_t i = 0; i < scale; i++) line[i] = color;
+
+    for (uint8_t row = 0; row < scale; row++) {
+        display_write(display, x, (uint16_t)(y + row), scale, 1, line);
+    }
+}
+
+
+static void legacy_draw_char(spi_device_handle_t display, uint16_t x, uint16_t y, char c,
+                             uint16_t color, uint8_t scale) {
+    const uint8_t *glyph = get_glyph(c);
+    if (!glyph) return;
+
+    for (uint8_t col = 0; col < 5; col++) {
+        uint8_t bits = glyph[col];
+
+        for (uint8_t row = 0; row < 7; row++) {
+            if (!(bits & (1u << row))) continue;
+            legacy_draw_block(display, (uint16_t)(x + col * scale), (uint16_t)(y + row * scale), scale, color);
+        }
+    }
+}
+
+
+static void legacy_draw_text(spi_device_handle_t display, uint16_t x, uint16_t y, const char *text,
+                             uint16_t color, uint8_t scale) {
+    if (!text || scale == 0) return;
+
+    uint16_t cx = x;
+    const uint16_t advance = (uint16_t)(CHAR_WIDTH * scale);
+
+    while (*text) {
+        legacy_draw_char(display, cx, y, *text, color, scale);
+        cx = (uint16_t)(cx + advance);
+        text++;
+    }
+}
+
+
+static bool use_legacy;
+
+void __real_draw_text(spi_device_handle_t display, uint16_t x, uint16_t y, const char *text,
+                      uint16_t color, uint16_t bg, uint8_t scale);
+
+// Every draw_text call outside display_util.c lands here, draw_label's included
+void __wrap_draw_text(spi_device_handle_t display, uint16_t x, uint16_t y, const char *text,
+                      uint16_t color, uint16_t bg, uint8_t scale) {
+    if (use_legacy) {
+        legacy_draw_text(display, x, y, text, color, scale);
+    } else {
+        __real_draw_text(display, x, y, text, color, bg, scale);
+    }
+}
+
+
+// ----------------------------
+// Cases
+// ----------------------------
+
+typedef struct {
+    const char *name;
+    bool        label;              // through draw_label() into `r`, otherwise draw_text() at r->x, r->y
+    const rect *r;
+    const char *text;
+    uint16_t    color;
+    uint16_t    bg;
+    uint8_t     scale;              // draw_text() only
+} text_case;
+
+static const text_case CASES[] = {
+    { "text \"Table 12\" x2",    false, &(rect){ .x = 10, .y = 40 },  "Table 12",   WHITE,      BLACK,     2 },
+    { "text \"+4m 05s\" x2",     false, &(rect){ .x = 78, .y = 150 }, "+4m 05s",    ORANGE,     BLACK,     2 },
+    { "text \"!\" x3",           false, &(rect){ .x = 20, .y = 60 },  "!",          RED,        BLACK,     3 },
+    { "text \"Take Order\" x1",  false, &(rect){ .x = 10, .y = 200 }, "Take Order", LIGHT_GREY, DARK_GREY, 1 },
+    { "label COMPLETE",          true,  &MAIN_COMPLETE_BTN,           "COMPLETE",   BLACK,      GREEN,     0 },
+    { "label Take Order",        true,  &MAIN_TAKEORDER_BTN,          "Take Order", BLACK,      GREEN,     0 },
+    { "label Tables",            true,  &MAIN_TABLES_BTN,             "Tables",     WHITE,      BLACK,     0 },
+    { "label truncated",         true,  &MAIN_TAKEORDER_BTN,          "Reservations4567", WHITE, BLACK,    0 },
+};
+
+
+static void draw_case(size_t index) {
+    const text_case *c = &CASES[index];
+
+    if (c->label) {
+        draw_label(NULL, *c->r, c->text, strlen(c->text), c->color, c->bg, false);
+    } else {
+        draw_text(NULL, c->r->x, c->r->y, c->text, c->color, c->bg, c->scale);
+    }
+}
+
+
+static void clear_panel(uint16_t colour) {
+    for (int y = 0; y < BENCH_PANEL_H; ++y) {
+        for (int x = 0; x < BENCH_PANEL_W; ++x) panel[y][x] = colour;
+    }
+}
+
+
+// Draw the case both ways on its background and compare. Returns the number of differing pixels.
+static uint32_t check_case(size_t index, bus_count *legacy_count, bus_count *glyph_count) {
+    static uint16_t legacy_panel[BENCH_PANEL_H][BENCH_PANEL_W];
+    const text_case *c = &CASES[index];
+
+    emulate = true;
+
+    clear_panel(c->bg);
+    use_legacy = true;
+    memset(&bus, 0, sizeof(bus));
+    draw_case(index);
+    *legacy_count = bus;
+    memcpy(legacy_panel, panel, sizeof(panel));
+
+    clear_panel(c->bg);
+    use_legacy = false;
+    memset(&bus, 0, sizeof(bus));
+    display_reset_bus_stats();
+    draw_case(index);
+    *glyph_count = bus;
+
+    emulate = false;
+
+    const display_bus_stats *own = display_get_bus_stats();
+    if (own->transactions != bus.transactions || own->windows != bus.windows ||
+        own->bus_acquires != bus.bus_acquires || own->bytes != bus.bytes) {
+        fprintf(stderr, "%s: display_util counted %u/%u/%u/%u, the bus saw %u/%u/%u/%u\n", c->name,
+                own->transactions, own->windows, own->bus_acquires, own->bytes,
+                bus.transactions, bus.windows, bus.bus_acquires, bus.bytes);
+        exit(1);
+    }
+
+    uint32_t differing = 0;
+    for (int y = 0; y < BENCH_PANEL_H; ++y) {
+        for (int x = 0; x < BENCH_PANEL_W; ++x) differing += panel[y][x] != legacy_panel[y][x];
+    }
+    return differing;
+}
+
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+
+static double time_case(size_t index, bool legacy, unsigned long rounds) {
+    use_legacy = legacy;
+
+    uint64_t start = now_ns();
+    for (unsigned long i = 0; i < rounds; ++i) draw_case(index);
+    return (double)(now_ns() - start) / rounds;
+}
+
+
+static double bus_us(const bus_count *count, double transaction_ns) {
+    return ((double)count->bytes * 8 * 1e9 / BENCH_SPI_HZ + count->transactions * transaction_ns) / 1000.0;
+}
+
+
+static void print_row(const char *name, const char *way, const bus_count *count, double cpu_ns, double transaction_ns) {
+    printf("%-24s %-7s %7u %7u %8u %7u %10.0f %9.1f\n", name, way, count->transactions, count->windows,
+           count->bus_acquires, count->bytes, cpu_ns, bus_us(count, transaction_ns));
+}
+
+
+int main(int argc, char **argv) {
+    unsigned long rounds = 20000;
+    double transaction_ns = BENCH_TRANSACTION_NS;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            rounds = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            transaction_ns = strtod(argv[++i], NULL);
+        } else {
+            fprintf(stderr, "usage: %s [-r rounds] [-o transaction overhead ns]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (rounds == 0 || transaction_ns < 0) {
+        fprintf(stderr, "rounds must be > 0, overhead >= 0\n");
+        return 2;
+    }
+
+    printf("bus model: %d MHz, %.0f ns per transaction\n\n", BENCH_SPI_HZ / 1000000, transaction_ns);
+    printf("%-24s %-7s %7s %7s %8s %7s %10s %9s\n",
+           "case", "way", "trans", "windows", "acquires", "bytes", "cpu ns", "bus us");
+
+    int status = 0;
+    for (size_t i = 0; i < sizeof(CASES) / sizeof(CASES[0]); ++i) {
+        bus_count legacy_count, glyph_count;
+        uint32_t differing = check_case(i, &legacy_count, &glyph_count);
+
+        double legacy_ns = time_case(i, true, rounds);
+        double glyph_ns = time_case(i, false, rounds);
+
+        print_row(CASES[i].name, "legacy", &legacy_count, legacy_ns, transaction_ns);
+        print_row("", "window", &glyph_count, glyph_ns, transaction_ns);
+        printf("%-24s %-7s %6.1fx %34s %9.1fx\n", "", "",
+               (double)legacy_count.transactions / glyph_count.transactions, "",
+               bus_us(&legacy_count, transaction_ns) / bus_us(&glyph_count, transaction_ns));
+
+        if (differing) {
+            printf("%-24s %u pixels differ\n", "", differing);
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,222 @@
+/*
+ * Trace system pass benchmark.
+ *
+ * Runs a synthetic floor through the trace system on the virtual clock and
+ * measures one scheduling pass: the operator's action, if any, POS events,
+ * then trace_system_tick(), every 500 ms of virtual time. A fixed number of
+ * tables is kept busy: each is seated, served through its task cycle and
+ * bills out, and another idle table is seated in its place. The operator
+ * completes the task on screen every few passes.
+ *
+ * The first table keeps the busy count fixed and grows the floor from 24
+ * to 255 tables; per-pass cost should stay flat, since per-table work only
+ * visits the active set. The "scan ns" column is what one loop over every
+ * table adds to a pass, for comparison. The second table keeps the floor
+ * at its largest and grows the busy count, which is what the cost does
+ * follow. Invariant violations are counted throughout and fail the run.
+ *
+ * Build from the repository root, with the table and slot capacities raised
+ * for the large floors:
+ *
+ *   gcc -O2 -std=gnu11 -DTRACE_VIRTUAL_CLOCK -DMAX_TABLES=255 -DSYSTEM_TASK_CAPACITY=254 \
+ *       -DTIMER_WHEEL_CAPACITY=1024 -DFLOOR_MAX_TABLES=255 -Itools/replay/stubs -Imain/include \
+ *       tools/bench/trace_system_bench.c main/src/task_domain.c main/src/task_pool.c \
+ *       main/src/trace_scheduler.c main/src/table_fsm.c main/src/table_fsm_table.c \
+ *       main/src/trace_system.c main/src/trace_system_default.c main/src/floor_layout.c \
+ *       main/src/decision_trace.c main/src/timer_wheel.c main/src/event_journal.c -lm -o trace_system_bench
+ *
+ * Usage:
+ *
+ *   ./trace_system_bench [-p passes] [-b busy_tables]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "trace_system.h"
+#include "esp_partition.h"
+
+
+#define BENCH_TICK_MS       500
+#define BENCH_COMPLETE_ODDS 6           // the operator completes the shown task one pass in this many
+#define BENCH_POS_ODDS      40          // a POS event reaches a busy table one pass in this many
+
+static const uint16_t FLOOR_SIZES[] = { 24, 64, 128, 255 };
+static const uint16_t BUSY_COUNTS[] = { 8, 32, 128 };
+
+int64_t virtual_clock_us;
+
+
+/* The system journals events; there is no partition here, so they are
+   staged and dropped. */
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label) {
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size) {
+    return ESP_FAIL;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size) {
+    return ESP_FAIL;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size) {
+    return ESP_FAIL;
+}
+
+// Only warm restart images are checksummed, and the bench takes none
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len) {
+    return crc;
+}
+
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+
+// xorshift32, so runs are repeatable across libcs
+static uint32_t rng_state = 0x9e3779b9u;
+
+static uint32_t rng_next(void) {
+    uint32_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return rng_state = x;
+}
+
+
+static void seat_idle_table(uint16_t table_count, time_ms now) {
+    uint8_t table;
+    do {
+        table = (uint8_t)(rng_next() % table_count);
+    } while (system_get_table_state(table) != TABLE_IDLE);
+
+    system_apply_table_fsm_event(table, EVENT_CUSTOMERS_SEATED, now);
+}
+
+
+// One pass of POS events and operator input, then the tick. Returns tables seated to replace cleared ones.
+static uint16_t run_pass(uint16_t table_count, time_ms now) {
+    uint16_t cleared = 0;
+
+    const uint8_t *active;
+    uint16_t active_count = system_get_active_tables(&active);
+    if (active_count && rng_next() % BENCH_POS_ODDS == 0) {
+        uint8_t table = active[rng_next() % active_count];
+        table_state state = system_get_table_state(table);
+
+        if (state == TABLE_PLACED_ORDER) {
+            system_apply_table_fsm_event(table, EVENT_POS_ORDER_READY, now);
+        } else if (state == TABLE_DINING || state == TABLE_CHECKUP) {
+            system_apply_table_fsm_event(table, EVENT_TABLE_REQUESTED_BILL, now);
+        }
+    }
+
+    const task *shown = system_get_active_task();
+    if (shown && rng_next() % BENCH_COMPLETE_ODDS == 0) {
+        uint8_t table = shown->table_number;
+        system_apply_user_action_to_task(shown->id, USER_ACTION_COMPLETE, now);
+        if (system_get_table_state(table) == TABLE_IDLE) cleared++;
+    }
+
+    trace_system_tick(now);
+    return cleared;
+}
+
+
+static int bench_floor(uint16_t table_count, uint16_t busy, unsigned long passes) {
+    static const scheduler_config config = {0};
+
+    rng_state = 0x9e3779b9u;
+    virtual_clock_us = 0;
+    if (!trace_system_init(&config, table_count)) return 2;
+
+    time_ms now = 0;
+    for (uint16_t i = 0; i < busy; ++i) seat_idle_table(table_count, now);
+
+    uint64_t pass_ns = 0;
+    uint64_t scan_ns = 0;
+    uint64_t active_sum = 0;
+    volatile uint32_t sink = 0;
+
+    for (unsigned long pass = 0; pass < passes; ++pass) {
+        now += BENCH_TICK_MS;
+        virtual_clock_us = (int64_t)now * 1000;
+
+        uint64_t start = now_ns();
+        uint16_t cleared = run_pass(table_count, now);
+        pass_ns += now_ns() - start;
+
+        for (uint16_t i = 0; i < cleared; ++i) seat_idle_table(table_count, now);
+
+        const uint8_t *active;
+        active_sum += system_get_active_tables(&active);
+    }
+
+    /* What a loop over every table costs, as the tick once ran. Timed on
+       its own: interleaved with the passes it evicts their working set and
+       inflates them on the larger floors. */
+    uint64_t start = now_ns();
+    for (unsigned long pass = 0; pass < passes; ++pass) {
+        for (uint16_t t = 0; t < table_count; ++t) {
+            const table_context *table = system_get_table((uint8_t)t);
+            sink += table_fsm_next_deadline(table) + system_get_current_task_kind_for_table((uint8_t)t);
+        }
+    }
+    scan_ns = now_ns() - start;
+
+    const system_check_stats *checks = system_get_check_stats();
+    printf("%7u %5u %10.1f %9.1f %9.1f %11lu\n", table_count, busy,
+           (double)active_sum / passes, (double)pass_ns / passes, (double)scan_ns / passes,
+           (unsigned long)checks->violations);
+
+    (void)sink;
+    return checks->violations ? 1 : 0;
+}
+
+
+int main(int argc, char **argv) {
+    unsigned long passes = 200000;
+    unsigned busy = 16;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            passes = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            busy = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "usage: %s [-p passes] [-b busy_tables]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (passes == 0 || busy == 0 || busy > FLOOR_SIZES[0]) {
+        fprintf(stderr, "passes must be > 0 and busy_tables in 1..%u\n", FLOOR_SIZES[0]);
+        return 2;
+    }
+    if (MAX_TABLES < FLOOR_SIZES[sizeof(FLOOR_SIZES) / sizeof(FLOOR_SIZES[0]) - 1]) {
+        fprintf(stderr, "built with MAX_TABLES=%u, see the build line\n", MAX_TABLES);
+        return 2;
+    }
+
+    printf("%7s %5s %10s %9s %9s %11s\n", "tables", "busy", "avg active", "pass ns", "scan ns", "violations");
+
+    int status = 0;
+    for (size_t i = 0; i < sizeof(FLOOR_SIZES) / sizeof(FLOOR_SIZES[0]); ++i) {
+        status |= bench_floor(FLOOR_SIZES[i], (uint16_t)busy, passes);
+    }
+
+    printf("\n");
+    uint16_t largest = FLOOR_SIZES[sizeof(FLOOR_SIZES) / sizeof(FLOOR_SIZES[0]) - 1];
+    for (size_t i = 0; i < sizeof(BUSY_COUNTS) / sizeof(BUSY_COUNTS[0]); ++i) {
+        status |= bench_floor(largest, BUSY_COUNTS[i], passes);
+    }
+    return status;
+}
@@ -0,0 +1,179 @@
+"""
+Trace scheduler decision trace decoder.
+
+Rebuilds the per-tick decision timeline from either source:
+  - a binary capture written by pos_server.py's "trace" command
+    (framed batches of records), or
+  - a serial monitor log containing "DTR:<hex>" lines printed by
+    decision_trace_dump_serial().
+
+Record layout (must stay in sync with decision_record in decision_trace.h):
+  <IIHHhBBBBBB   seq, time_ms, active index/generation, active score,
+                 reason, flags, pending, critical, challenger count, reserved
+  3 x <HBBhhhh   challenger index, table, kind, base, urgency, age, zone
+Scores are Q8.8.
+
+Usage:
+  python decision_trace.py decision_trace.bin
+  python decision_trace.py monitor.log --csv timeline.csv
+  python decision_trace.py decision_trace.bin --changes-only
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+
+TOP_N        = 3                 # DECISION_TRACE_TOP_N
+FRAME_MAGIC  = 0x43525444        # DECISION_TRACE_FRAME_MAGIC
+FRAME_HDR    = struct.Struct("<IHH")
+RECORD_HDR   = struct.Struct("<IIHHhBBBBBB")
+CHALLENGER   = struct.Struct("<HBBhhhh")
+RECORD_SIZE  = RECORD_HDR.size + TOP_N * CHALLENGER.size
+
+NO_INDEX     = 0xFFFF
+
+REASONS = ["keep", "init_select", "stale_replace", "ineligible_replace", "clear", "forced"]
+KINDS   = ["SERVE_WATER", "TAKE_ORDER", "PREPARE_ORDER", "SERVE_ORDER",
+           "MONITOR_TABLE", "PRESENT_BILL", "CLEAR_TABLE"]
+
+FLAG_DWELL_SATISFIED = 0x01
+FLAG_HAS_ACTIVE      = 0x04
+
+
+def _q8(v: int) -> float:
+    return v / 256.0
+
+
+def decode_record(raw: bytes) -> dict:
+    (seq, time_ms, active_index, active_gen, active_score,
+     reason, flags, pending, critical, n, _reserved) = RECORD_HDR.unpack_from(raw, 0)
+
+    challengers = []
+    for i in range(min(n, TOP_N)):
+        index, table, kind, base, urgency, age, zone = CHALLENGER.unpack_from(raw, RECORD_HDR.size + i * CHALLENGER.size)
+        challengers.append({
+            "index":   index,
+            "table":   table,
+            "kind":    KINDS[kind] if kind < len(KINDS) else str(kind),
+            "base":    _q8(base),
+            "urgency": _q8(urgency),
+            "age":     _q8(age),
+            "zone":    _q8(zone),
+            "rank":    _q8(base + urgency + age + zone),
+        })
+
+    return {
+        "seq":          seq,
+        "time_ms":      time_ms,
+        "active":       None if active_index == NO_INDEX else (active_index, active_gen),
+        "active_score": _q8(active_score),
+        "reason":       REASONS[reason] if reason < len(REASONS) else str(reason),
+        "dwell_ok":     bool(flags & FLAG_DWELL_SATISFIED),
+        "pending":      pending,
+        "critical":     critical,
+        "challengers":  challengers,
+    }
+
+
+def read_binary(data: bytes) -> list:
+    records = []
+    pos = 0
+    while pos + FRAME_HDR.size <= len(data):
+        magic, record_size, count = FRAME_HDR.unpack_from(data, pos)
+        if magic != FRAME_MAGIC or record_size != RECORD_SIZE:
+            raise ValueError(f"bad frame at offset {pos} (magic {magic:#x}, record size {record_size})")
+        pos += FRAME_HDR.size
+        for _ in range(count):
+            records.append(decode_record(data[pos:pos + RECORD_SIZE]))
+            pos += RECORD_SIZE
+    return records
+
+
+def read_log(text: str) -> list:
+    records = []
+    for line in text.splitlines():
+        at = line.find("DTR:")
+        if at < 0:
+            continue
+        raw = bytes.fromhex(line[at + 4:at + 4 + 2 * RECORD_SIZE])
+        if len(raw) == RECORD_SIZE:
+            records.append(decode_record(raw))
+    return records
+
+
+def load(path: str) -> list:
+    with open(path, "rb") as f:
+        data = f.read()
+    records = read_log(data.decode("ascii", "replace")) if b"DTR:" in data else read_binary(data)
+
+    # Captures may overlap (serial dumps resend the whole ring); keep one copy per seq.
+    unique = {r["seq"]: r for r in records}
+    return [unique[s] for s in sorted(unique)]
+
+
+def print_timeline(records: list, changes_only: bool):
+    expected = None
+    for r in records:
+        if expected is not None and r["seq"] != expected:
+            print(f"  ... {r['seq'] - expected} records dropped ...")
+        expected = r["seq"] + 1
+
+        if changes_only and r["reason"] == "keep" and r["critical"] == 0:
+            continue
+
+        active = "-" if r["active"] is None else f"{r['active'][0]}:{r['active'][1]}"
+        tags = "dwell " if r["dwell_ok"] else ""
+        print(f"{r['time_ms'] / 1000.0:10.1f}s  {r['reason']:<18} active={active:<7} "
+              f"score={r['active_score']:6.2f} pending={r['pending']:<2} critical={r['critical']:<2} {tags}")
+
+        for c in r["challengers"]:
+            print(f"{'':14}  #{c['index']:<3} t{c['table']:<3} {c['kind']:<14} rank={c['rank']:6.2f} "
+                  f"(base {c['base']:.2f} urg {c['urgency']:.2f} age {c['age']:.2f} zone {c['zone']:+.2f})")
+
+
+def write_csv(records: list, path: str):
+    with open(path, "w", newline="") as f:
+        w = csv.writer(f)
+        header = ["seq", "time_ms", "reason", "active", "active_score", "pending", "critical", "dwell_ok"]
+        for i in range(TOP_N):
+            header += [f"c{i}_{k}" for k in ("index", "table", "kind", "base", "urgency", "age", "zone")]
+        w.writerow(header)
+
+        for r in records:
+            active = "" if r["active"] is None else f"{r['active'][0]}:{r['active'][1]}"
+            row = [r["seq"], r["time_ms"], r["reason"], active, r["active_score"],
+                   r["pending"], r["critical"], int(r["dwell_ok"])]
+            for i in range(TOP_N):
+                if i < len(r["challengers"]):
+                    c = r["challengers"][i]
+                    row += [c["index"], c["table"], c["kind"], c["base"], c["urgency"], c["age"], c["zone"]]
+                else:
+                    row += [""] * 7
+            w.writerow(row)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Decode scheduler decision trace records.")
+    parser.add_argument("input", help="binary capture from pos_server.py or a serial log with DTR: lines")
+    parser.add_argument("--csv", help="write one row per tick to this CSV file")
+    parser.add_argument("--changes-only", action="store_true", help="omit ticks that kept the active task with no prompt")
+    args = parser.parse_args()
+
+    try:
+        records = load(args.input)
+    except ValueError as e:
+        print(f"error: {e}", file=sys.stderr)
+        return 1
+
+    if args.csv:
+        write_csv(records, args.csv)
+        print(f"[trace] {len(records)} records -> {args.csv}")
+    else:
+        print_timeline(records, args.changes_only)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
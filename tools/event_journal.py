@@ -0,0 +1,245 @@
+"""
+Flash event journal decoder.
+
+Rebuilds per-table timelines from either source:
+  - an export capture written by pos_server.py's "journal" command
+    (columnar frames, ended by an empty frame), or
+  - a raw image of the "journal" partition, e.g. from
+    `esptool.py read_flash 0x110000 0x80000 journal.bin` or the file
+    written by `replay -j`.
+
+Layouts (must stay in sync with event_journal.h):
+  partition: 4 KiB sectors, each <IIII magic, seq, ~seq, reserved, then
+             4-byte aligned blocks <HHII length, count, base_time, crc32
+             followed by `length` bytes of rows (varint head, table, arg)
+  export:    <IHHII magic, count, length, base_time, sector_seq, then the
+             same events as columns: count varint heads, count tables,
+             count args
+A head is time delta << 3 | type; times are ms since the boot that wrote them.
+
+Usage:
+  python event_journal.py journal.bin
+  python event_journal.py journal.bin --table 3
+  python event_journal.py journal.bin --csv events.csv
+"""
+
+import argparse
+import binascii
+import csv
+import struct
+import sys
+
+
+SECTOR_SIZE  = 4096              # EVENT_JOURNAL_SECTOR_SIZE
+SECTOR_MAGIC = 0x324A4545        # EVENT_JOURNAL_SECTOR_MAGIC
+FRAME_MAGIC  = 0x4C4E4A45        # EVENT_JOURNAL_FRAME_MAGIC
+SECTOR_HDR   = struct.Struct("<IIII")
+BLOCK_HDR    = struct.Struct("<HHII")
+FRAME_HDR    = struct.Struct("<IHHII")
+BLOCK_MAX    = 496               # EVENT_JOURNAL_BLOCK_MAX
+LENGTH_ERASED = 0xFFFF
+NO_TABLE     = 0xFF              # EVENT_JOURNAL_NO_TABLE
+TYPE_BITS    = 3                 # EVENT_JOURNAL_TYPE_BITS
+
+TYPES  = ["boot", "transition", "admit", "ignore", "complete", "force_switch"]
+STATES = ["IDLE", "SEATED", "READY_FOR_ORDER", "PLACED_ORDER", "WAITING_FOR_ORDER",
+          "DINING", "CHECKUP", "REQUESTED_BILL", "DONE"]
+KINDS  = ["SERVE_WATER", "TAKE_ORDER", "PREPARE_ORDER", "SERVE_ORDER",
+          "MONITOR_TABLE", "PRESENT_BILL", "CLEAR_TABLE"]
+
+
+def _name(names: list, i: int) -> str:
+    return names[i] if i < len(names) else str(i)
+
+
+def _varint(data: bytes, pos: int) -> tuple:
+    value = shift = 0
+    while pos < len(data) and shift < 35:
+        b = data[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return value, pos
+        shift += 7
+    raise ValueError("truncated varint")
+
+
+def _event(time_ms: int, head: int, table: int, arg: int, seq: int) -> dict:
+    return {"time_ms": time_ms & 0xFFFFFFFF, "type": head & ((1 << TYPE_BITS) - 1), "table": table,
+            "arg": arg, "sector_seq": seq}
+
+
+def decode_rows(body: bytes, count: int, base_time: int, seq: int) -> list:
+    events, pos, t = [], 0, base_time
+    for _ in range(count):
+        head, pos = _varint(body, pos)
+        t += head >> TYPE_BITS
+        events.append(_event(t, head, body[pos], body[pos + 1], seq))
+        pos += 2
+    return events
+
+
+def decode_columns(body: bytes, count: int, base_time: int, seq: int) -> list:
+    heads, pos = [], 0
+    for _ in range(count):
+        head, pos = _varint(body, pos)
+        heads.append(head)
+    tables, args = body[pos:pos + count], body[pos + count:pos + 2 * count]
+    if len(args) != count:
+        raise ValueError("frame shorter than its columns")
+
+    events, t = [], base_time
+    for head, table, arg in zip(heads, tables, args):
+        t += head >> TYPE_BITS
+        events.append(_event(t, head, table, arg, seq))
+    return events
+
+
+def read_export(data: bytes) -> list:
+    events, pos, finished = [], 0, False
+    while pos + FRAME_HDR.size <= len(data):
+        magic, count, length, base_time, seq = FRAME_HDR.unpack_from(data, pos)
+        if magic != FRAME_MAGIC:
+            raise ValueError(f"bad frame at offset {pos} (magic {magic:#x})")
+        pos += FRAME_HDR.size
+        if count == 0:
+            finished = True
+            break
+        events += decode_columns(data[pos:pos + length], count, base_time, seq)
+        pos += length
+
+    if not finished:
+        print("warning: export has no end frame, the transfer was cut short", file=sys.stderr)
+    return events
+
+
+def read_partition(data: bytes) -> list:
+    sectors = []
+    for base in range(0, len(data) - SECTOR_SIZE + 1, SECTOR_SIZE):
+        magic, seq, check, _ = SECTOR_HDR.unpack_from(data, base)
+        if magic == SECTOR_MAGIC and seq != 0 and check == seq ^ 0xFFFFFFFF:
+            sectors.append((seq, base))
+    if not sectors:
+        return []
+
+    # Sectors older than one lap of the ring are stale leftovers of a resize
+    newest = max(seq for seq, _ in sectors)
+    keep = len(data) // SECTOR_SIZE
+    events = []
+    for seq, base in sorted(s for s in sectors if newest - s[0] < keep):
+        offset = SECTOR_HDR.size
+        while offset + BLOCK_HDR.size <= SECTOR_SIZE:
+            length, count, base_time, crc = BLOCK_HDR.unpack_from(data, base + offset)
+            if length == LENGTH_ERASED or length > BLOCK_MAX or offset + BLOCK_HDR.size + length > SECTOR_SIZE:
+                break
+            body = data[base + offset + BLOCK_HDR.size:base + offset + BLOCK_HDR.size + length]
+            if binascii.crc32(body) != crc:
+                print(f"warning: sector seq {seq} block at {offset} fails its CRC, rest of sector skipped",
+                      file=sys.stderr)
+                break
+            events += decode_rows(body, count, base_time, seq)
+            offset += (BLOCK_HDR.size + length + 3) & ~3
+    return events
+
+
+def load(path: str) -> list:
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) >= 4 and struct.unpack_from("<I", data)[0] == FRAME_MAGIC:
+        return read_export(data)
+    return read_partition(data)
+
+
+def describe(e: dict) -> str:
+    kind = e["type"]
+    if kind == 0:
+        return "boot (state resumed)" if e["arg"] else "boot (cold start)"
+    if kind == 1:
+        return f"-> {_name(STATES, e['arg'])}"
+    return f"{_name(TYPES, kind)} {_name(KINDS, e['arg'])}"
+
+
+def split_boots(events: list) -> list:
+    """Number each event's boot; times restart from zero at every boot."""
+    boot = 0
+    for e in events:
+        if e["type"] == 0:
+            boot += 1
+        e["boot"] = boot
+    return events
+
+
+def print_timelines(events: list, only_table):
+    tables = sorted({e["table"] for e in events if e["table"] != NO_TABLE})
+    if only_table is not None:
+        tables = [t for t in tables if t == only_table]
+
+    boots = [e for e in events if e["type"] == 0]
+    print(f"[journal] {len(events)} events, {len(boots)} boots, {len(tables)} tables")
+
+    for table in tables:
+        print(f"\ntable {table}")
+        entered, printed = None, False
+        for e in events:
+            if e["type"] == 0:
+                if printed:
+                    print(f"{'':12}  -- boot {e['boot']}{' (resumed)' if e['arg'] else ''} --")
+                continue
+            if e["table"] != table:
+                continue
+
+            note = ""
+            if e["type"] == 1:
+                if entered is not None and entered[0] == e["boot"]:
+                    note = f"  (previous state {(e['time_ms'] - entered[1]) / 1000.0:.1f}s)"
+                entered = (e["boot"], e["time_ms"])
+            print(f"{e['time_ms'] / 1000.0:10.1f}s  {describe(e)}{note}")
+            printed = True
+
+    summary = {}
+    for e in events:
+        if e["table"] == NO_TABLE or (only_table is not None and e["table"] != only_table):
+            continue
+        counts = summary.setdefault(e["table"], [0] * len(TYPES))
+        if e["type"] < len(TYPES):
+            counts[e["type"]] += 1
+
+    print(f"\n{'table':>5} {'transitions':>11} {'admitted':>8} {'ignored':>7} {'completed':>9} {'forced':>6}")
+    for table in sorted(summary):
+        c = summary[table]
+        print(f"{table:>5} {c[1]:>11} {c[2]:>8} {c[3]:>7} {c[4]:>9} {c[5]:>6}")
+
+
+def write_csv(events: list, path: str):
+    with open(path, "w", newline="") as f:
+        w = csv.writer(f)
+        w.writerow(["boot", "time_ms", "table", "event", "detail", "sector_seq"])
+        for e in events:
+            table = "" if e["table"] == NO_TABLE else e["table"]
+            detail = e["arg"] if e["type"] == 0 else _name(STATES if e["type"] == 1 else KINDS, e["arg"])
+            w.writerow([e["boot"], e["time_ms"], table, _name(TYPES, e["type"]), detail, e["sector_seq"]])
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Decode the flash event journal into per-table timelines.")
+    parser.add_argument("input", help="export capture from pos_server.py or a raw journal partition image")
+    parser.add_argument("--table", type=int, help="only this table index")
+    parser.add_argument("--csv", help="write one row per event to this CSV file")
+    args = parser.parse_args()
+
+    try:
+        events = split_boots(load(args.input))
+    except (ValueError, IndexError) as e:
+        print(f"error: {e}", file=sys.stderr)
+        return 1
+
+    if args.csv:
+        write_csv(events, args.csv)
+        print(f"[journal] {len(events)} events -> {args.csv}")
+    else:
+        print_timelines(events, args.table)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,152 @@
+"""
+Trace floor layout compiler.
+
+Turns a floor plan (JSON) into the binary layout blob loaded by
+floor_layout_load_blob() on the device, and optionally an NVS CSV that
+nvs_partition_gen.py can flash into the "floor" namespace.
+
+Plan file:
+  {
+    "zones":  ["bar", "terrace"],
+    "tables": [
+      {"table": 1,  "x": 2.0, "y": 1.5, "zone": "bar"},
+      {"table": 11, "x": 9.0, "y": 4.0, "zone": "terrace"},
+      {"table": 0,  "x": 0.0, "y": 0.0}
+    ],
+    "walks": [[1, 11, 14.5]]
+  }
+
+Coordinates and walk lengths are in metres. Tables without a zone are
+unzoned. "walks" are walkable legs between tables. The distance between
+two tables is the shortest walk made of those legs. If no walk links
+them, the device uses the straight line between their coordinates.
+
+Blob layout (must stay in sync with floor_layout.h):
+  header   <IHBB   magic "FLAY", version, table_count, zone_count
+  tables   <hhBB   x_dm, y_dm, zone (255 = none), reserved
+  distance <H      upper triangle, row-major, decimetres, 65535 = straight line
+  crc32    <I      zlib.crc32 of everything above
+
+Usage:
+  python floor_layout.py plan.json layout.bin [--nvs-csv layout.csv]
+"""
+
+import argparse
+import json
+import struct
+import sys
+import zlib
+
+
+MAGIC            = 0x59414C46    # FLOOR_LAYOUT_MAGIC
+VERSION          = 1             # FLOOR_LAYOUT_VERSION
+MAX_TABLES       = 32            # FLOOR_MAX_TABLES
+ZONE_NONE        = 255           # FLOOR_ZONE_NONE
+DISTANCE_UNKNOWN = 65535         # FLOOR_DISTANCE_UNKNOWN
+
+NVS_NAMESPACE    = "floor"       # FLOOR_NVS_NAMESPACE
+NVS_KEY          = "layout"      # FLOOR_NVS_KEY
+
+
+def _dm(metres: float) -> int:
+    return int(round(metres * 10))
+
+
+def _shortest_walks(count: int, walks: list) -> list:
+    """All-pairs shortest walk in decimetres (Floyd-Warshall), None if unreachable."""
+    dist = [[None] * count for _ in range(count)]
+    for i in range(count):
+        dist[i][i] = 0
+
+    for a, b, metres in walks:
+        if not (0 <= a < count and 0 <= b < count):
+            raise ValueError(f"walk {a}-{b} references a table outside the layout")
+        d = _dm(metres)
+        if dist[a][b] is None or d < dist[a][b]:
+            dist[a][b] = dist[b][a] = d
+
+    for k in range(count):
+        for i in range(count):
+            if dist[i][k] is None:
+                continue
+            for j in range(count):
+                if dist[k][j] is None:
+                    continue
+                through = dist[i][k] + dist[k][j]
+                if dist[i][j] is None or through < dist[i][j]:
+                    dist[i][j] = through
+    return dist
+
+
+def compile_plan(plan: dict) -> bytes:
+    zones = plan.get("zones", [])
+    if len(zones) >= ZONE_NONE:
+        raise ValueError(f"at most {ZONE_NONE - 1} zones")
+    zone_index = {name: i for i, name in enumerate(zones)}
+
+    tables = {}
+    for entry in plan["tables"]:
+        number = int(entry["table"])
+        if number in tables:
+            raise ValueError(f"table {number} listed twice")
+        tables[number] = entry
+
+    count = max(tables) + 1 if tables else 0
+    if count > MAX_TABLES:
+        raise ValueError(f"table numbers must be below {MAX_TABLES}")
+
+    blob = bytearray(struct.pack("<IHBB", MAGIC, VERSION, count, len(zones)))
+
+    for number in range(count):
+        entry = tables.get(number, {})
+        zone = entry.get("zone")
+        if zone is not None and zone not in zone_index:
+            raise ValueError(f"table {number} has unknown zone {zone!r}")
+        blob += struct.pack("<hhBB",
+                            _dm(entry.get("x", 0.0)),
+                            _dm(entry.get("y", 0.0)),
+                            ZONE_NONE if zone is None else zone_index[zone],
+                            0)
+
+    dist = _shortest_walks(count, plan.get("walks", []))
+    for a in range(count):
+        for b in range(a + 1, count):
+            d = dist[a][b]
+            blob += struct.pack("<H", DISTANCE_UNKNOWN if d is None else min(d, DISTANCE_UNKNOWN - 1))
+
+    blob += struct.pack("<I", zlib.crc32(bytes(blob)) & 0xFFFFFFFF)
+    return bytes(blob)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Compile a floor plan into a layout blob.")
+    parser.add_argument("plan", help="floor plan JSON file")
+    parser.add_argument("output", help="layout blob to write")
+    parser.add_argument("--nvs-csv", help="also write an nvs_partition_gen.py CSV referencing the blob")
+    args = parser.parse_args()
+
+    with open(args.plan) as f:
+        plan = json.load(f)
+
+    try:
+        blob = compile_plan(plan)
+    except (KeyError, ValueError) as e:
+        print(f"error: {e}", file=sys.stderr)
+        return 1
+
+    with open(args.output, "wb") as f:
+        f.write(blob)
+    print(f"[layout] {args.output}: {len(blob)} bytes")
+
+    if args.nvs_csv:
+        with open(args.nvs_csv, "w") as f:
+            f.write("key,type,encoding,value\n")
+            f.write(f"{NVS_NAMESPACE},namespace,,\n")
+            f.write(f"{NVS_KEY},file,binary,{args.output}\n")
+        print(f"[layout] {args.nvs_csv}: NVS CSV for nvs_partition_gen.py")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -12,6 +12,10 @@ Commands:
   seated <table>       Customers seated at table
   order_ready <table>  Kitchen order ready for table
   bill <table>         Table requested the bill
+  trace [file]         Pull new decision trace records into file
+                       (default decision_trace.bin; decode with decision_trace.py)
+  journal [file]       Export the whole flash event journal into file
+                       (default event_journal.bin; decode with event_journal.py)
   status               Show whether a device is connected
   help                 Show this message
   quit                 Exit the server
@@ -30,9 +34,20 @@ MAX_TABLES = 24    # MAX_TABLES from trace_system.h
 CUSTOMERS_SEATED = 0
 ORDER_READY      = 1
 BILL_REQUESTED   = 2
+TRACE_DUMP       = 3
+JOURNAL_DUMP     = 4
+
+TRACE_FRAME_MAGIC = 0x43525444   # DECISION_TRACE_FRAME_MAGIC in decision_trace.h
+TRACE_FRAME_HDR   = struct.Struct("<IHH")
+
+JOURNAL_FRAME_MAGIC = 0x4C4E4A45  # EVENT_JOURNAL_FRAME_MAGIC in event_journal.h
+JOURNAL_FRAME_HDR   = struct.Struct("<IHHII")
 
 _conn: socket.socket | None = None
 _conn_lock = threading.Lock()
+_trace_path = "decision_trace.bin"
+_journal_path = "event_journal.bin"
+_trace_records = 0
 
 
 def _send_event(event_type: int, table_index: int) -> bool:
@@ -47,6 +62,82 @@ def _send_event(event_type: int, table_index: int) -> bool:
             return False
 
 
+def _recv_exact(conn: socket.socket, n: int) -> bytes | None:
+    data = b""
+    while len(data) < n:
+        chunk = conn.recv(n - len(data))
+        if not chunk:
+            return None
+        data += chunk
+    return data
+
+
+def _receive_trace_frame(conn: socket.socket, magic: bytes) -> bool:
+    """Append one frame of decision records to _trace_path. False if the connection dropped."""
+    global _trace_records
+
+    rest = _recv_exact(conn, TRACE_FRAME_HDR.size - len(magic))
+    if rest is None:
+        return False
+
+    header = magic + rest
+    _, record_size, count = TRACE_FRAME_HDR.unpack(header)
+    if count == 0:
+        print(f"\n[server] Decision trace: {_trace_records} records appended to {_trace_path}")
+        _trace_records = 0
+        return True
+
+    body = _recv_exact(conn, record_size * count)
+    if body is None:
+        return False
+    with open(_trace_path, "ab") as f:
+        f.write(header + body)
+    _trace_records += count
+    return True
+
+
+def _receive_journal_frame(conn: socket.socket, magic: bytes) -> bool:
+    """Append one journal frame to _journal_path. False if the connection dropped."""
+    rest = _recv_exact(conn, JOURNAL_FRAME_HDR.size - len(magic))
+    if rest is None:
+        return False
+
+    header = magic + rest
+    _, count, length, _, _ = JOURNAL_FRAME_HDR.unpack(header)
+    body = _recv_exact(conn, length)
+    if body is None:
+        return False
+
+    # The end frame is kept too: it tells the decoder the export finished
+    with open(_journal_path, "ab") as f:
+        f.write(header + body)
+    if count == 0:
+        print(f"\n[server] Event journal: exported to {_journal_path}")
+    return True
+
+
+def _receive_frames(conn: socket.socket):
+    """Store the frames the device sends until the connection drops."""
+    while True:
+        magic = _recv_exact(conn, 4)
+        if magic is None:
+            return
+
+        value = struct.unpack("<I", magic)[0]
+        if value == TRACE_FRAME_MAGIC:
+            ok = _receive_trace_frame(conn, magic)
+        elif value == JOURNAL_FRAME_MAGIC:
+            ok = _receive_journal_frame(conn, magic)
+        else:
+            print("\n[server] Unexpected data from device, ignoring connection output")
+            while conn.recv(4096):
+                pass
+            return
+
+        if not ok:
+            return
+
+
 def _tcp_server():
     global _conn
 
@@ -64,9 +155,10 @@ def _tcp_server():
                 _conn = conn
 
             try:
-                # recv() blocks until the connection drops
-                while conn.recv(1):
-                    pass
+                # recv() blocks until the connection drops; the device only
+                # sends decision trace and journal frames, in reply to
+                # TRACE_DUMP and JOURNAL_DUMP
+                _receive_frames(conn)
             except OSError:
                 pass
             finally:
@@ -88,6 +180,8 @@ def _parse_table(arg: str) -> int | None:
 
 
 def _cli():
+    global _trace_path, _journal_path
+
     print("POS server ready. Type 'help' for commands.")
 
     while True:
@@ -114,6 +208,24 @@ def _cli():
         elif cmd == "help":
             print(__doc__)
 
+        elif cmd == "trace":
+            if len(parts) > 1:
+                _trace_path = parts[1]
+            if _send_event(TRACE_DUMP, 0):
+                print(f"[server] Requested decision trace -> {_trace_path}")
+            else:
+                print("[server] No device connected.")
+
+        elif cmd == "journal":
+            if len(parts) > 1:
+                _journal_path = parts[1]
+            # Every export starts from the oldest block, so replace rather than append
+            open(_journal_path, "wb").close()
+            if _send_event(JOURNAL_DUMP, 0):
+                print(f"[server] Requested event journal -> {_journal_path}")
+            else:
+                print("[server] No device connected.")
+
         elif cmd in ("seated", "order_ready", "bill"):
             if len(parts) != 2:
                 print(f"Usage: {cmd} <table>")
@@ -0,0 +1,107 @@
+"""
+Replay regression check.
+
+Builds the replay tool at the default invariant check level and at
+SYSTEM_CHECK_FULL and replays every shift in tools/replay/shifts with
+both, once straight through and once with -w, a warm restart after every
+event. It fails if any run counts an invariant violation, if restore
+accepts a damaged image, or if the -w metrics differ from the straight
+run's in anything but the restart counters. Shifts are plain replay
+traces (see replay.c); add one for every behaviour worth keeping.
+
+Run from the repository root:
+  python tools/replay/check_shifts.py
+  python tools/replay/check_shifts.py --cc clang shifts/one.txt
+"""
+
+import argparse
+import glob
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+
+SOURCES = [
+    "tools/replay/replay.c", "main/src/task_domain.c", "main/src/task_pool.c",
+    "main/src/trace_scheduler.c", "main/src/table_fsm.c", "main/src/table_fsm_table.c",
+    "main/src/trace_system.c", "main/src/trace_system_default.c", "main/src/floor_layout.c",
+    "main/src/decision_trace.c", "main/src/timer_wheel.c", "main/src/event_journal.c",
+]
+CHECK_LEVELS = {"count": [], "full": ["-DSYSTEM_CHECK_LEVEL=3"]}
+RESTART_METRICS = {"warm_restarts", "bad_images_accepted"}      # only printed with -w
+
+
+def build(cc: str, out: str, flags: list) -> None:
+    cmd = [cc, "-O2", "-std=gnu11", "-DTRACE_VIRTUAL_CLOCK", "-Itools/replay/stubs", "-Imain/include",
+           *flags, *SOURCES, "-lm", "-o", out]
+    result = subprocess.run(cmd, capture_output=True, text=True)
+    if result.returncode != 0:
+        sys.stderr.write(result.stderr)
+        raise SystemExit(f"build failed: {' '.join(cmd)}")
+
+
+def replay(binary: str, shift: str, *args: str) -> dict:
+    out = subprocess.run([binary, shift, *args], check=True, capture_output=True, text=True).stdout
+    metrics = {}
+    for line in out.splitlines():
+        # Kind names hold single spaces ("PREPARE ORDER"), so split at the first wide gap if any
+        parts = re.split(r"\s{2,}", line.strip(), maxsplit=1)
+        if len(parts) == 1:
+            parts = line.split(None, 1)
+        if parts:
+            metrics[parts[0]] = parts[1] if len(parts) > 1 else ""
+    return metrics
+
+
+def check_shift(binaries: dict, shift: str) -> list:
+    failures = []
+    for level, binary in binaries.items():
+        plain = replay(binary, shift)
+        warm = replay(binary, shift, "-w")
+
+        for name, run in (("plain", plain), ("-w", warm)):
+            if run.get("invariant_violations") != "0":
+                failures.append(f"{level} {name}: {run.get('invariant_violations')} invariant violations")
+        if warm.get("bad_images_accepted") != "0":
+            failures.append(f"{level} -w: {warm.get('bad_images_accepted')} damaged images restored")
+
+        for key in sorted(set(plain) | set(warm)):
+            if key in RESTART_METRICS or key == "invariant_violations":
+                continue
+            if plain.get(key) != warm.get(key):
+                failures.append(f"{level} -w: {key} {warm.get(key)!r}, straight run {plain.get(key)!r}")
+    return failures
+
+
+def main() -> int:
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("shifts", nargs="*", help="default: tools/replay/shifts/*.txt")
+    ap.add_argument("--cc", default="gcc")
+    args = ap.parse_args()
+
+    shifts = args.shifts or sorted(glob.glob("tools/replay/shifts/*.txt"))
+    if not shifts:
+        print("no shifts found; run from the repository root", file=sys.stderr)
+        return 2
+
+    failed = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        binaries = {}
+        for level, flags in CHECK_LEVELS.items():
+            binaries[level] = os.path.join(tmp, f"replay_{level}")
+            build(args.cc, binaries[level], flags)
+
+        for shift in shifts:
+            failures = check_shift(binaries, shift)
+            print(f"{'FAIL' if failures else 'ok  '} {shift}")
+            for failure in failures:
+                print(f"     {failure}")
+            failed += bool(failures)
+
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,466 @@
+/*
+ * Trace shift replay.
+ *
+ * Replays a recorded shift through the scheduling core on a Linux host.
+ * The clock is virtual and logging is compiled out, so an 8-hour shift
+ * replays in milliseconds. The output is deterministic, so two builds of
+ * the scheduler can be A/B compared on the same trace.
+ *
+ * Build from the repository root:
+ *
+ *   gcc -O2 -std=gnu11 -DTRACE_VIRTUAL_CLOCK -Itools/replay/stubs -Imain/include \
+ *       tools/replay/replay.c main/src/task_domain.c main/src/task_pool.c \
+ *       main/src/trace_scheduler.c main/src/table_fsm.c main/src/table_fsm_table.c \
+ *       main/src/trace_system.c main/src/trace_system_default.c main/src/floor_layout.c \
+ *       main/src/decision_trace.c main/src/timer_wheel.c main/src/event_journal.c -lm -o replay
+ *
+ * Usage:
+ *
+ *   ./replay shift.txt [-t tick_ms] [-n tables] [-w] [-j journal.bin [-J kib]]
+ *
+ * Trace format, one event per line, times in ms from shift start and
+ * non-decreasing, '#' starts a comment:
+ *
+ *   1000   seat 3              POS: customers seated at table 3
+ *   64000  order_ready 3       POS: kitchen order ready
+ *   70000  complete            operator completes the task on screen
+ *   71000  ignore              operator ignores the task on screen
+ *   72000  confirm_switch      operator accepts the switch prompt
+ *   80000  take_order 3        table-grid actions
+ *   81000  bill 3
+ *   82000  undo 3
+ *   90000  end                 optional, stop here
+ *
+ * Between events the core is ticked every tick_ms (default 500, as on the
+ * device). -n sets the tables in use, MAX_TABLES by default; floors above
+ * 24 tables need a build with -DMAX_TABLES=n, see trace_system.h.
+ *
+ * With -w the system goes through a warm restart after every event: its
+ * image is captured and restored, as warm_restart.c does across a reset.
+ * The metrics must match a run without -w. Each image is also offered
+ * truncated and with one byte flipped, and bad_images_accepted counts
+ * those that restore did not reject.
+ *
+ * With -j the event journal is written to journal.bin, a file standing in
+ * for the flash partition (created with -J KiB, default 64, if missing).
+ * It is flushed every tick as the writer task would, and an existing file
+ * is mounted and appended to, as after a reboot. Decode it with
+ * tools/event_journal.py.
+ *
+ * tools/replay/check_shifts.py replays every shift in tools/replay/shifts
+ * with and without -w and fails on any invariant violation or mismatch.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../main/include/trace_system.h"
+#include "../../main/include/table_fsm.h"
+#include "../../main/include/task_domain.h"
+#include "../../main/include/event_journal.h"
+#include "esp_partition.h"
+
+
+#define DEFAULT_TICK_MS     500
+#define DEFAULT_JOURNAL_KIB 64
+#define MAX_LINE            256
+
+
+int64_t virtual_clock_us;
+
+
+/* ------------------------------------------------------------------ */
+/* Host stand-ins for ESP-IDF services used by the core               */
+/* ------------------------------------------------------------------ */
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+    return ~crc;
+}
+
+
+static FILE *journal_file;
+static esp_partition_t journal_stand_in = {
+    .type       = ESP_PARTITION_TYPE_DATA,
+    .subtype    = EVENT_JOURNAL_SUBTYPE,
+    .erase_size = EVENT_JOURNAL_SECTOR_SIZE,
+    .label      = EVENT_JOURNAL_PARTITION,
+};
+
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label) {
+    if (!journal_file || type != journal_stand_in.type || subtype != journal_stand_in.subtype ||
+        strcmp(label, journal_stand_in.label) != 0) {
+        return NULL;
+    }
+    return &journal_stand_in;
+}
+
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size) {
+    if (src_offset + size > partition->size) return ESP_ERR_INVALID_SIZE;
+    if (fseek(journal_file, (long)src_offset, SEEK_SET) != 0) return ESP_FAIL;
+    return (fread(dst, 1, size, journal_file) == size) ? ESP_OK : ESP_FAIL;
+}
+
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size) {
+    static uint8_t cell[EVENT_JOURNAL_SECTOR_SIZE];
+    const uint8_t *bytes = src;
+
+    if (dst_offset + size > partition->size) return ESP_ERR_INVALID_SIZE;
+    while (size > 0) {
+        size_t n = (size < sizeof(cell)) ? size : sizeof(cell);
+        if (esp_partition_read(partition, dst_offset, cell, n) != ESP_OK) return ESP_FAIL;
+        for (size_t i = 0; i < n; ++i) cell[i] &= bytes[i];     // programming only clears bits
+
+        if (fseek(journal_file, (long)dst_offset, SEEK_SET) != 0 || fwrite(cell, 1, n, journal_file) != n) {
+            return ESP_FAIL;
+        }
+        dst_offset += n;
+        bytes += n;
+        size -= n;
+    }
+    return ESP_OK;
+}
+
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size) {
+    static uint8_t erased[EVENT_JOURNAL_SECTOR_SIZE];
+
+    if (offset % partition->erase_size || size % partition->erase_size) return ESP_ERR_INVALID_ARG;
+    if (offset + size > partition->size) return ESP_ERR_INVALID_SIZE;
+
+    memset(erased, 0xFF, sizeof(erased));
+    for (size_t at = offset; at < offset + size; at += sizeof(erased)) {
+        if (fseek(journal_file, (long)at, SEEK_SET) != 0 || fwrite(erased, 1, sizeof(erased), journal_file) != sizeof(erased)) {
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+
+// Open the stand-in, or create it erased; an existing file keeps its size
+static bool open_journal_file(const char *path, uint32_t kib) {
+    journal_file = fopen(path, "r+b");
+    if (!journal_file) {
+        journal_file = fopen(path, "w+b");
+        if (!journal_file) return false;
+
+        journal_stand_in.size = kib * 1024;
+        return esp_partition_erase_range(&journal_stand_in, 0, journal_stand_in.size) == ESP_OK;
+    }
+
+    fseek(journal_file, 0, SEEK_END);
+    journal_stand_in.size = (uint32_t)ftell(journal_file);
+    return journal_stand_in.size % EVENT_JOURNAL_SECTOR_SIZE == 0;
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Metrics                                                             */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    uint32_t *lateness_ms;          // per completed task, 0 when on time
+    size_t count;
+    size_t capacity;
+    size_t missed;
+} kind_stats;
+
+static kind_stats stats[TASK_NOT_APPLICABLE];
+
+static size_t prompts_shown;        // critical_count rising from zero
+static size_t prompts_accepted;
+static size_t ignores;
+static size_t stale_actions;        // actions with no task on screen
+static uint16_t last_critical;
+
+static size_t warm_restarts;
+static size_t bad_images_accepted;
+static uint32_t violations_before_restarts;     // restore re-initialises the checker counters
+
+
+static void record_completion(const task *t, time_ms now) {
+    kind_stats *k = &stats[t->kind];
+    if (k->count == k->capacity) {
+        k->capacity = k->capacity ? 2 * k->capacity : 64;
+        k->lateness_ms = realloc(k->lateness_ms, k->capacity * sizeof(k->lateness_ms[0]));
+        if (!k->lateness_ms) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+
+    uint32_t late = (now > t->time_limit) ? now - t->time_limit : 0;
+    k->lateness_ms[k->count++] = late;
+    if (late > 0) k->missed++;
+}
+
+
+static void observe_prompt(void) {
+    uint16_t critical = system_get_critical_pending_count();
+    if (critical > 0 && last_critical == 0) prompts_shown++;
+    last_critical = critical;
+}
+
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+
+/* Nearest-rank percentile of a sorted array. */
+static double percentile_s(const uint32_t *sorted, size_t n, unsigned pct) {
+    size_t rank = (pct * n + 99) / 100;
+    return sorted[rank ? rank - 1 : 0] / 1000.0;
+}
+
+
+static void print_metrics(time_ms end) {
+    size_t total = 0;
+    size_t missed = 0;
+
+    printf("shift_end_s          %.1f\n", end / 1000.0);
+    printf("%-16s %6s %6s %9s %9s %9s %9s\n", "kind", "done", "missed", "p50_s", "p90_s", "p99_s", "max_s");
+
+    for (int kind = 0; kind < (int)TASK_NOT_APPLICABLE; ++kind) {
+        kind_stats *k = &stats[kind];
+        total  += k->count;
+        missed += k->missed;
+        if (k->count == 0) {
+            printf("%-16s %6u %6u %9s %9s %9s %9s\n", task_kind_to_str((task_kind)kind), 0u, 0u, "-", "-", "-", "-");
+            continue;
+        }
+
+        qsort(k->lateness_ms, k->count, sizeof(k->lateness_ms[0]), compare_u32);
+        printf("%-16s %6zu %6zu %9.1f %9.1f %9.1f %9.1f\n", task_kind_to_str((task_kind)kind),
+            k->count, k->missed,
+            percentile_s(k->lateness_ms, k->count, 50),
+            percentile_s(k->lateness_ms, k->count, 90),
+            percentile_s(k->lateness_ms, k->count, 99),
+            k->lateness_ms[k->count - 1] / 1000.0);
+    }
+
+    printf("completed            %zu\n", total);
+    printf("missed_deadlines     %zu\n", missed);
+    printf("switch_prompts       %zu\n", prompts_shown);
+    printf("prompts_accepted     %zu\n", prompts_accepted);
+    printf("ignores              %zu\n", ignores);
+    printf("stale_actions        %zu\n", stale_actions);
+    printf("pending_at_end       %u\n", system_get_pending_count());
+    printf("invariant_violations %u\n",
+           (unsigned)(violations_before_restarts + system_get_check_stats()->violations));
+    if (journal_file) {
+        const event_journal_stats *journal = event_journal_get_stats();
+        printf("journal_events       %u\n", (unsigned)journal->written);
+        printf("journal_dropped      %u\n", (unsigned)journal->dropped);
+        printf("journal_blocks       %u\n", (unsigned)journal->blocks);
+        printf("journal_erases       %u\n", (unsigned)journal->erases);
+    }
+    if (warm_restarts) {
+        printf("warm_restarts        %zu\n", warm_restarts);
+        printf("bad_images_accepted  %zu\n", bad_images_accepted);
+    }
+}
+
+
+/* ------------------------------------------------------------------ */
+/* Replay                                                              */
+/* ------------------------------------------------------------------ */
+
+static void advance_to(time_ms *now, time_ms target, time_ms tick_ms) {
+    while (*now + tick_ms <= target) {
+        *now += tick_ms;
+        virtual_clock_us = (int64_t)*now * 1000;
+        trace_system_tick(*now);
+        observe_prompt();
+        event_journal_flush(*now, false);
+    }
+    *now = target;
+    virtual_clock_us = (int64_t)*now * 1000;
+}
+
+
+static bool table_event(const char *name, fsm_transition_event *out) {
+    static const struct { const char *name; fsm_transition_event event; } events[] = {
+        { "seat",        EVENT_CUSTOMERS_SEATED },
+        { "order_ready", EVENT_POS_ORDER_READY },
+        { "bill",        EVENT_TABLE_REQUESTED_BILL },
+        { "take_order",  EVENT_TAKE_ORDER_EARLY_OR_REPEAT },
+        { "undo",        EVENT_UNDO },
+    };
+
+    for (size_t i = 0; i < sizeof(events) / sizeof(events[0]); ++i) {
+        if (strcmp(name, events[i].name) == 0) {
+            *out = events[i].event;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+static bool apply_event(const char *name, int table, time_ms now) {
+    fsm_transition_event event;
+
+    if (table_event(name, &event)) {
+        if (table < 0 || table >= system_get_table_count()) return false;
+        system_apply_table_fsm_event((uint8_t)table, event, now);
+        return true;
+    }
+
+    if (strcmp(name, "complete") == 0 || strcmp(name, "ignore") == 0) {
+        const task *shown = system_get_active_task();
+        if (!shown) {
+            stale_actions++;
+            return true;
+        }
+
+        task snapshot = *shown;
+        bool complete = (name[0] == 'c');
+        if (system_apply_user_action_to_task(snapshot.id, complete ? USER_ACTION_COMPLETE : USER_ACTION_IGNORE, now)) {
+            if (complete) record_completion(&snapshot, now);
+            else ignores++;
+        }
+        return true;
+    }
+
+    if (strcmp(name, "confirm_switch") == 0) {
+        const task *critical = system_get_top_critical_task();
+        if (critical) {
+            system_force_active_task(critical->id, now);
+            prompts_accepted++;
+        } else {
+            stale_actions++;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+
+static void warm_restart(const scheduler_config *config, time_ms now) {
+    static system_image image;
+    static system_image damaged;
+    uint16_t tables = system_get_table_count();
+
+    system_capture_image(&image, (uint32_t)warm_restarts, now);
+    violations_before_restarts += system_get_check_stats()->violations;
+
+    // Damaged images must leave a cold system; the good one then replaces it
+    if (system_restore_image(&image, sizeof(image) - 1, config, tables, now)) bad_images_accepted++;
+
+    damaged = image;
+    ((uint8_t *)&damaged)[warm_restarts % sizeof(damaged)] ^= 0x5A;
+    if (system_restore_image(&damaged, sizeof(damaged), config, tables, now)) bad_images_accepted++;
+
+    if (!system_restore_image(&image, sizeof(image), config, tables, now)) {
+        fprintf(stderr, "warm restart %zu: image rejected\n", warm_restarts);
+        exit(1);
+    }
+    warm_restarts++;
+}
+
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    time_ms tick_ms = DEFAULT_TICK_MS;
+    scheduler_config config = {0};
+    bool warm = false;
+    unsigned long tables = 0;
+    const char *journal_path = NULL;
+    uint32_t journal_kib = DEFAULT_JOURNAL_KIB;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            tick_ms = (time_ms)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            tables = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-w") == 0) {
+            warm = true;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            journal_path = argv[++i];
+        } else if (strcmp(argv[i], "-J") == 0 && i + 1 < argc) {
+            journal_kib = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else {
+            path = argv[i];
+        }
+    }
+    if (tables > MAX_TABLES) {
+        fprintf(stderr, "-n %lu: built for at most %u tables, see trace_system.h\n", tables, (unsigned)MAX_TABLES);
+        return 2;
+    }
+    if (!path || tick_ms == 0) {
+        fprintf(stderr, "usage: %s shift.txt [-t tick_ms] [-n tables] [-w] [-j journal.bin [-J kib]]\n", argv[0]);
+        return 2;
+    }
+
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+
+    if (journal_path) {
+        if (!open_journal_file(journal_path, journal_kib) || !event_journal_mount()) {
+            fprintf(stderr, "%s: cannot use as a journal partition\n", journal_path);
+            fclose(f);
+            return 1;
+        }
+    }
+
+    virtual_clock_us = 0;
+    trace_system_init(&config, (uint16_t)tables);
+    event_journal_record(JOURNAL_BOOT, EVENT_JOURNAL_NO_TABLE, 0, 0);
+
+    char line[MAX_LINE];
+    unsigned line_number = 0;
+    time_ms now = 0;
+
+    while (fgets(line, sizeof(line), f)) {
+        line_number++;
+
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        unsigned long at;
+        char name[32];
+        int table = -1;
+        int fields = sscanf(line, "%lu %31s %d", &at, name, &table);
+        if (fields <= 0) continue;
+        if (fields < 2 || at < now) {
+            fprintf(stderr, "%s:%u: bad or out-of-order event\n", path, line_number);
+            fclose(f);
+            return 1;
+        }
+
+        advance_to(&now, (time_ms)at, tick_ms);
+        if (strcmp(name, "end") == 0) break;
+
+        if (!apply_event(name, table, now)) {
+            fprintf(stderr, "%s:%u: unknown event '%s'\n", path, line_number, name);
+            fclose(f);
+            return 1;
+        }
+        observe_prompt();
+
+        if (warm) warm_restart(&config, now);
+    }
+    fclose(f);
+
+    event_journal_flush(now, true);
+    print_metrics(now);
+    if (journal_file) fclose(journal_file);
+    return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef REPLAY_STUB_ESP_ERR_H
+#define REPLAY_STUB_ESP_ERR_H
+
+#include <assert.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK                      0
+#define ESP_FAIL                    -1
+#define ESP_ERR_INVALID_ARG         0x102
+#define ESP_ERR_INVALID_SIZE        0x104
+#define ESP_ERR_NOT_FOUND           0x105
+#define ESP_ERR_INVALID_CRC         0x109
+#define ESP_ERR_INVALID_VERSION     0x10A
+
+#define ESP_ERROR_CHECK(x)          do { esp_err_t err_rc_ = (x); (void)err_rc_; assert(err_rc_ == ESP_OK); } while (0)
+
+static inline const char *esp_err_to_name(esp_err_t err) {
+    (void)err;
+    return "ESP_ERR";
+}
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef REPLAY_STUB_ESP_LOG_H
+#define REPLAY_STUB_ESP_LOG_H
+
+/* Logging compiled out for replay; errors still reach stderr with -DREPLAY_VERBOSE. */
+
+#include <stdio.h>
+
+#ifdef REPLAY_VERBOSE
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#else
+#define ESP_LOGE(tag, fmt, ...) ((void)(tag))
+#endif
+#define ESP_LOGW(tag, fmt, ...) ((void)(tag))
+#define ESP_LOGI(tag, fmt, ...) ((void)(tag))
+#define ESP_LOGD(tag, fmt, ...) ((void)(tag))
+
+#endif
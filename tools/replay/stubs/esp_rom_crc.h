@@ -0,0 +1,9 @@
+#ifndef REPLAY_STUB_ESP_ROM_CRC_H
+#define REPLAY_STUB_ESP_ROM_CRC_H
+
+#include <stdint.h>
+
+/* Same result as the ROM routine and zlib.crc32; defined in replay.c. */
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef REPLAY_STUB_NVS_H
+#define REPLAY_STUB_NVS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/* Replay has no NVS: every open fails, so the built-in floor layout is used. */
+
+typedef uint32_t nvs_handle_t;
+typedef enum { NVS_READONLY, NVS_READWRITE } nvs_open_mode_t;
+
+static inline esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *out) {
+    (void)ns; (void)mode; (void)out;
+    return ESP_ERR_NOT_FOUND;
+}
+
+static inline esp_err_t nvs_get_blob(nvs_handle_t h, const char *key, void *out, size_t *len) {
+    (void)h; (void)key; (void)out; (void)len;
+    return ESP_ERR_NOT_FOUND;
+}
+
+static inline void nvs_close(nvs_handle_t h) {
+    (void)h;
+}
+
+#endif
@@ -0,0 +1,247 @@
+"""
+Table FSM generator.
+
+Compiles main/table_fsm.spec into main/src/table_fsm_table.c, the dense
+lookup tables behind table_apply_event(), fsm_get_current_task_for_table()
+and table_fsm_tick(). The build runs it whenever the spec changes (see
+main/CMakeLists.txt); the output is checked in.
+
+Before writing anything the spec is checked:
+  - every name is declared once, and transitions only use declared names
+  - determinism: at most one transition per (state, event), none to itself
+  - the undo event takes no transitions
+  - each timeout event has a transition out of the state it fires in, and
+    is taken from no state whose timeout does not fire it
+  - reachability: every state can be reached from the initial state, and
+    the initial state can be reached again from every state
+
+--vectors writes one line per (state, previous state, event), with the
+state, previous state and changed flag table_apply_event() must leave,
+computed here straight from the spec. tools/bench/table_fsm_bench.c checks
+the firmware against them and replays them as its workload.
+
+Usage:
+  python table_fsm_gen.py main/table_fsm.spec -o main/src/table_fsm_table.c
+  python table_fsm_gen.py main/table_fsm.spec -o main/src/table_fsm_table.c --check
+  python table_fsm_gen.py main/table_fsm.spec --vectors table_fsm.vectors
+"""
+
+import argparse
+import sys
+
+
+class SpecError(ValueError):
+    pass
+
+
+class Spec:
+    def __init__(self):
+        self.states = []            # names in enum order
+        self.tasks = {}             # state -> task kind name, None for none
+        self.timeouts = {}          # state -> (expression, event)
+        self.events = []            # names in enum order, undo included
+        self.undo = None
+        self.initial = None
+        self.next = {}              # (state, event) -> state
+
+
+def parse(path: str) -> Spec:
+    spec = Spec()
+    declared = set()
+
+    def declare(name, line_no):
+        if name in declared:
+            raise SpecError(f"{path}:{line_no}: {name} declared twice")
+        declared.add(name)
+
+    with open(path) as f:
+        lines = f.readlines()
+
+    transitions = []
+    for line_no, line in enumerate(lines, 1):
+        words = line.split("#", 1)[0].split()
+        if not words:
+            continue
+
+        keyword = words[0]
+        if keyword == "state":
+            if len(words) not in (3, 5):
+                raise SpecError(f"{path}:{line_no}: expected: state NAME TASK|- [TIMEOUT_MS TIMEOUT_EVENT]")
+            declare(words[1], line_no)
+            spec.states.append(words[1])
+            spec.tasks[words[1]] = None if words[2] == "-" else words[2]
+            if len(words) == 5:
+                spec.timeouts[words[1]] = (words[3], words[4])
+        elif keyword in ("event", "undo"):
+            if len(words) != 2:
+                raise SpecError(f"{path}:{line_no}: expected: {keyword} NAME")
+            declare(words[1], line_no)
+            spec.events.append(words[1])
+            if keyword == "undo":
+                if spec.undo:
+                    raise SpecError(f"{path}:{line_no}: a second undo event")
+                spec.undo = words[1]
+        elif keyword == "initial":
+            if len(words) != 2 or spec.initial:
+                raise SpecError(f"{path}:{line_no}: expected one line: initial NAME")
+            spec.initial = words[1]
+        elif len(words) == 3:
+            transitions.append((line_no, *words))
+        else:
+            raise SpecError(f"{path}:{line_no}: expected: FROM EVENT TO")
+
+    if not spec.states or not spec.events:
+        raise SpecError(f"{path}: no states or no events")
+    if spec.initial not in spec.tasks:
+        raise SpecError(f"{path}: initial state {spec.initial} is not a declared state")
+    for state, (_, event) in spec.timeouts.items():
+        if event not in spec.events:
+            raise SpecError(f"{path}: {state} times out with undeclared event {event}")
+
+    for line_no, src, event, dst in transitions:
+        for name, kind, known in ((src, "state", spec.tasks), (event, "event", spec.events), (dst, "state", spec.tasks)):
+            if name not in known:
+                raise SpecError(f"{path}:{line_no}: {name} is not a declared {kind}")
+        if (src, event) in spec.next:
+            raise SpecError(f"{path}:{line_no}: second transition for {src} on {event}")
+        if src == dst:
+            raise SpecError(f"{path}:{line_no}: {src} on {event} goes nowhere, leave it out")
+        if event == spec.undo:
+            raise SpecError(f"{path}:{line_no}: {event} is the undo event and takes no transitions")
+        spec.next[(src, event)] = dst
+
+    return spec
+
+
+def check(spec: Spec):
+    timeout_events = {event for _, event in spec.timeouts.values()}
+    for state, (_, event) in spec.timeouts.items():
+        if (state, event) not in spec.next:
+            raise SpecError(f"{state} times out with {event}, which has no transition out of it")
+    for (state, event) in spec.next:
+        if event in timeout_events and spec.timeouts.get(state, (None, None))[1] != event:
+            raise SpecError(f"{state} takes timeout event {event} but does not time out with it")
+
+    def reach(start, edges):
+        seen, todo = {start}, [start]
+        while todo:
+            for nxt in edges.get(todo.pop(), ()):
+                if nxt not in seen:
+                    seen.add(nxt)
+                    todo.append(nxt)
+        return seen
+
+    forward, backward = {}, {}
+    for (src, _), dst in spec.next.items():
+        forward.setdefault(src, set()).add(dst)
+        backward.setdefault(dst, set()).add(src)
+
+    unreachable = [s for s in spec.states if s not in reach(spec.initial, forward)]
+    if unreachable:
+        raise SpecError(f"unreachable from {spec.initial}: {', '.join(unreachable)}")
+    stuck = [s for s in spec.states if s not in reach(spec.initial, backward)]
+    if stuck:
+        raise SpecError(f"never return to {spec.initial}: {', '.join(stuck)}")
+
+    unused = [e for e in spec.events if e != spec.undo and not any(k[1] == e for k in spec.next)]
+    for event in unused:
+        print(f"warning: {event} takes no transition from any state", file=sys.stderr)
+
+
+def generate(spec: Spec, spec_name: str) -> str:
+    width_s = max(len(s) for s in spec.states) + 2
+    width_e = max(len(e) for e in spec.events) + 2
+
+    out = [
+        f"/* Generated by tools/table_fsm_gen.py from {spec_name}. Do not edit. */",
+        "",
+        '#include "../include/table_fsm.h"',
+        "",
+        "",
+        "// Names are bound by enum value, so the spec must list them in enum order",
+        f'_Static_assert(TABLE_STATE_COUNT == {len(spec.states)}, "{spec_name} lists every table_state");',
+        f'_Static_assert(FSM_EVENT_COUNT == {len(spec.events)}, "{spec_name} lists every fsm_transition_event");',
+    ]
+    for i, name in enumerate(spec.states):
+        out.append(f'_Static_assert({name} == {i}, "{spec_name} lists table_state in enum order");')
+    for i, name in enumerate(spec.events):
+        out.append(f'_Static_assert({name} == {i}, "{spec_name} lists fsm_transition_event in enum order");')
+
+    out += ["", "", "const uint8_t TABLE_FSM_NEXT_STATE[TABLE_STATE_COUNT][FSM_EVENT_COUNT] = {"]
+    for state in spec.states:
+        out.append(f"    [{state}] = {{")
+        for event in spec.events:
+            out.append(f"        {('[' + event + ']').ljust(width_e)} = {spec.next.get((state, event), state)},")
+        out.append("    },")
+    out.append("};")
+
+    out += ["", "", "const table_fsm_state_info TABLE_FSM_STATES[TABLE_STATE_COUNT] = {"]
+    for state in spec.states:
+        task = spec.tasks[state] or "TASK_NOT_APPLICABLE"
+        timeout, event = spec.timeouts.get(state, ("TABLE_FSM_NO_DEADLINE", spec.events[0]))
+        out.append(f"    {('[' + state + ']').ljust(width_s)} = {{ .task = {task}, "
+                   f".timeout = {timeout}, .timeout_event = {event} }},")
+    out.append("};")
+    return "\n".join(out) + "\n"
+
+
+def vectors(spec: Spec) -> str:
+    state_no = {s: i for i, s in enumerate(spec.states)}
+    initial = state_no[spec.initial]
+
+    out = [f"# table_apply_event() vectors: state prev event -> state prev changed",
+           f"# {len(spec.states) ** 2 * len(spec.events)} lines"]
+    for s, state in enumerate(spec.states):
+        for p in range(len(spec.states)):
+            for e, event in enumerate(spec.events):
+                if event == spec.undo and p != initial:
+                    result = (p, initial, 1)
+                elif (state, event) in spec.next:
+                    result = (state_no[spec.next[(state, event)]], s, 1)
+                else:
+                    result = (s, p, 0)
+                out.append(f"{s} {p} {e} {result[0]} {result[1]} {result[2]}")
+    return "\n".join(out) + "\n"
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Compile the table FSM spec into C lookup tables.")
+    parser.add_argument("spec", help="transition spec, main/table_fsm.spec")
+    parser.add_argument("-o", "--output", help="C source to write")
+    parser.add_argument("--check", action="store_true", help="fail if --output is not what the spec generates")
+    parser.add_argument("--vectors", help="also write host test vectors to this file")
+    args = parser.parse_args()
+
+    try:
+        spec = parse(args.spec)
+        check(spec)
+    except (OSError, SpecError) as e:
+        print(f"error: {e}", file=sys.stderr)
+        return 1
+
+    if args.output:
+        source = generate(spec, "main/table_fsm.spec")
+        if args.check:
+            try:
+                with open(args.output) as f:
+                    current = f.read()
+            except OSError:
+                current = None
+            if current != source:
+                print(f"error: {args.output} is out of date with {args.spec}", file=sys.stderr)
+                return 1
+        else:
+            with open(args.output, "w") as f:
+                f.write(source)
+            print(f"[fsm] {len(spec.states)} states, {len(spec.events)} events, "
+                  f"{len(spec.next)} transitions -> {args.output}")
+
+    if args.vectors:
+        with open(args.vectors, "w") as f:
+            f.write(vectors(spec))
+        print(f"[fsm] vectors -> {args.vectors}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())